@@ -257,6 +257,8 @@ cdef extern from "pocketsphinx/lattice.h":
         pass
     ctypedef struct ps_latlink_iter_t:
         pass
+    ctypedef struct ps_confnet_t:
+        pass
 
     ps_lattice_t *ps_lattice_read(ps_decoder_t *ps,
                                   const char *file)
@@ -298,6 +300,16 @@ cdef extern from "pocketsphinx/lattice.h":
     int ps_lattice_posterior(ps_lattice_t *dag, ngram_model_t *lmset, float ascale)
     int ps_lattice_posterior_prune(ps_lattice_t *dag, int beam)
     int ps_lattice_n_frames(ps_lattice_t *dag)
+    ps_confnet_t *ps_lattice_confnet(ps_lattice_t *dag, int beam)
+    ps_confnet_t *ps_confnet_retain(ps_confnet_t *cn)
+    int ps_confnet_free(ps_confnet_t *cn)
+    logmath_t *ps_confnet_get_logmath(ps_confnet_t *cn)
+    int ps_confnet_n_slots(ps_confnet_t *cn)
+    int ps_confnet_slot(ps_confnet_t *cn, int slot, int *out_sf, int *out_ef)
+    const char *ps_confnet_word(ps_confnet_t *cn, int slot, int arc,
+                                int *out_prob)
+    const char *ps_confnet_hyp(ps_confnet_t *cn)
+    int ps_confnet_write(ps_confnet_t *cn, const char *filename)
 
 
 # Still need this unfortunately
@@ -792,6 +792,119 @@ cdef class Lattice:
         if rv < 0:
             raise RuntimeError("Failed to write lattice to %s" % path)
 
+    def posterior(self, NGramModel lm=None, double lw=1.0,
+                  double ascale=1.0/20):
+        """Calculate posterior probabilities for links in the lattice.
+
+        This is done automatically for lattices from
+        `Decoder.get_lattice` once the hypothesis has been obtained,
+        if `bestpath` is enabled (the default).
+
+        Args:
+            lm(NGramModel): Language model to score the lattice with,
+                            or None to use only acoustic scores.
+            lw(float): Language model weight, relative to the one
+                       used in decoding.
+            ascale(float): Scaling factor for acoustic scores.
+        Raises:
+            RuntimeError: If there is no path through the lattice.
+        """
+        cdef ngram_model_t *clm = NULL
+        if lm is not None:
+            clm = lm.lm
+        if ps_lattice_bestpath(self.dag, clm, lw, ascale) == NULL:
+            raise RuntimeError("No path found through lattice")
+        ps_lattice_posterior(self.dag, clm, ascale)
+
+    def confusion_network(self, double beam=1e-10):
+        """Build a word confusion network from posterior probabilities.
+
+        Posterior probabilities must already have been calculated,
+        see `posterior`.
+
+        Args:
+            beam(float): Minimum posterior probability for words to
+                         be included.
+        Returns:
+            ConfusionNetwork: Newly created confusion network.
+        Raises:
+            RuntimeError: If there is no path through the lattice.
+        """
+        cdef logmath_t *lmath = ps_lattice_get_logmath(self.dag)
+        cdef ps_confnet_t *cn = ps_lattice_confnet(self.dag,
+                                                   logmath_log(lmath, beam))
+        if cn == NULL:
+            raise RuntimeError("Failed to build confusion network")
+        return ConfusionNetwork.create_from_ptr(cn)
+
+
+cdef class ConfusionNetwork:
+    """Word confusion network, as returned by `Lattice.confusion_network`.
+
+    This is a sequence of slots, each of which is a list of
+    ``(word, prob)`` tuples giving competing words and their
+    posterior probabilities, best first.  The word is None for the
+    empty arc, whose probability is that of no word in the slot.
+    """
+    cdef ps_confnet_t *cn
+
+    @staticmethod
+    cdef create_from_ptr(ps_confnet_t *cn):
+        cdef ConfusionNetwork self = ConfusionNetwork.__new__(ConfusionNetwork)
+        self.cn = cn
+        return self
+
+    def __dealloc__(self):
+        if self.cn != NULL:
+            ps_confnet_free(self.cn)
+
+    def __len__(self):
+        return ps_confnet_n_slots(self.cn)
+
+    def __getitem__(self, int slot):
+        cdef logmath_t *lmath = ps_confnet_get_logmath(self.cn)
+        cdef const char *word
+        cdef int prob
+        if slot < 0:
+            slot += ps_confnet_n_slots(self.cn)
+        n_arcs = ps_confnet_slot(self.cn, slot, NULL, NULL)
+        if n_arcs < 0:
+            raise IndexError("Slot %d out of range" % slot)
+        arcs = []
+        for i in range(n_arcs):
+            word = ps_confnet_word(self.cn, slot, i, &prob)
+            arcs.append((None if word == NULL else word.decode("utf-8"),
+                         logmath_exp(lmath, prob)))
+        return arcs
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self[i]
+
+    def frames(self, int slot):
+        """Get the start and end frames (inclusive) of a slot.
+
+        Returns:
+            Tuple[int, int]: Start and end frame.
+        Raises:
+            IndexError: If slot is out of range.
+        """
+        cdef int sf, ef
+        if ps_confnet_slot(self.cn, slot, &sf, &ef) < 0:
+            raise IndexError("Slot %d out of range" % slot)
+        return sf, ef
+
+    @property
+    def hyp(self):
+        """Consensus hypothesis, made of the best word in each slot."""
+        return ps_confnet_hyp(self.cn).decode("utf-8")
+
+    def write(self, str path):
+        """Write confusion network to a file in SRILM mesh format."""
+        rv = ps_confnet_write(self.cn, path.encode("utf-8"))
+        if rv < 0:
+            raise RuntimeError("Failed to write confusion network to %s" % path)
+
 cdef class Decoder:
     """Main class for speech recognition and alignment in PocketSphinx.
 
@@ -1489,13 +1602,14 @@ cdef class Decoder:
     def save_dict(self, str dict_path, str _format = None):
         """Save dictionary to a file.
 
-        Note that the `format` argument does nothing, never has done
-        anything, and never will.  It's only here for historical
-        reasons.
+        The binary format (`_format="bin"`) includes filler words and
+        a perfect hash for lookup, and is memory-mapped when loaded,
+        which is much faster for large dictionaries.  It is detected
+        automatically by `load_dict` and the `dict` option.
 
         Args:
             dict_path(str): Path to save pronunciation dictionary in.
-            _format(str): Useless argument that does nothing.
+            _format(str): "bin" for binary, or None or "text" for text.
         Raises:
             RuntimeError: If dictionary saving failed for some reason.
         """
@@ -49,6 +49,7 @@ from ._pocketsphinx import FsgModel  # noqa: F401
 from ._pocketsphinx import Segment  # noqa: F401
 from ._pocketsphinx import Hypothesis  # noqa: F401
 from ._pocketsphinx import Lattice  # noqa: F401
+from ._pocketsphinx import ConfusionNetwork  # noqa: F401
 from ._pocketsphinx import Vad  # noqa: F401
 from ._pocketsphinx import Endpointer  # noqa: F401
 from ._pocketsphinx import Alignment  # noqa: F401
@@ -28,6 +28,30 @@ class LatticeTest(unittest.TestCase):
         os.unlink("goforward.lat")
         os.unlink("goforward.htk")
 
+    def test_confusion_network(self):
+        decoder = Decoder(
+            lm=os.path.join(DATADIR, "turtle.lm.bin"),
+            dict=os.path.join(DATADIR, "turtle.dic"),
+            fwdflat=False,
+        )
+        with open(os.path.join(DATADIR, "goforward.raw"), "rb") as fh:
+            decoder.start_utt()
+            decoder.process_raw(fh.read(), full_utt=True)
+            decoder.end_utt()
+        # Getting the hypothesis also calculates posteriors
+        self.assertEqual(decoder.hyp().hypstr, "go forward ten meters")
+        cn = decoder.get_lattice().confusion_network()
+        self.assertEqual(cn.hyp, "go forward ten meters")
+        for i, arcs in enumerate(cn):
+            sf, ef = cn.frames(i)
+            print(sf, ef, arcs)
+            self.assertLessEqual(sf, ef)
+            self.assertAlmostEqual(sum(prob for word, prob in arcs), 1.0, 2)
+        with self.assertRaises(IndexError):
+            cn[len(cn)]
+        cn.write("goforward.mesh")
+        os.unlink("goforward.mesh")
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -80,6 +80,7 @@
 #include <pocketsphinx/lattice.h>
 #include <pocketsphinx/alignment.h>
 #include <pocketsphinx/mllr.h>
+#include <pocketsphinx/alloc.h>
 
 /* Namum manglium ii domum */
 #ifdef __cplusplus
@@ -673,7 +674,8 @@ ps_mllr_t *ps_update_mllr(ps_decoder_t *ps, ps_mllr_t *mllr);
  * @memberof ps_decoder_t
  * @param dictfile Path to dictionary file to load.
  * @param fdictfile Path to filler dictionary to load, or NULL to keep
- *                  the existing filler dictionary.
+ *                  the existing filler dictionary.  Ignored for binary
+ *                  dictionaries, which contain their own filler words.
  * @param format Format of the dictionary file, or NULL to determine
  *               automatically (currently unused,should be NULL)
  */
@@ -684,12 +686,16 @@ int ps_load_dict(ps_decoder_t *ps, char const *dictfile,
 /**
  * Dump the current pronunciation dictionary to a file.
  *
- * This function dumps the current pronunciation dictionary to a text file.
+ * This function dumps the current pronunciation dictionary to a text
+ * file, or to a binary file which can be memory-mapped for fast
+ * loading with large dictionaries.  Binary dictionaries are
+ * recognized automatically by ps_load_dict() and `-dict`, and can
+ * only be used with an acoustic model with the same phone set.
  *
  * @memberof ps_decoder_t
  * @param dictfile Path to file where dictionary will be written.
  * @param format Format of the dictionary file, or NULL for the
- *               default (text) format (currently unused, should be NULL)
+ *               default (text) format.  "bin" selects the binary format.
  */
 POCKETSPHINX_EXPORT
 int ps_save_dict(ps_decoder_t *ps, char const *dictfile, char const *format);
@@ -926,7 +932,10 @@ int32 ps_get_prob(ps_decoder_t *ps);
  *         if no hypotheses are available.  This pointer is owned by
  *         the decoder and you should not attempt to free it manually.
  *         It is only valid until the next utterance, unless you use
- *         ps_lattice_retain() to retain it.
+ *         ps_lattice_retain() to retain it.  When called in the middle
+ *         of an utterance, it returns a partial lattice, which is only
+ *         valid until the next call to this function or to
+ *         ps_end_utt().
  */
 POCKETSPHINX_EXPORT
 ps_lattice_t *ps_get_lattice(ps_decoder_t *ps);
@@ -1092,6 +1101,81 @@ POCKETSPHINX_EXPORT
 void ps_get_all_time(ps_decoder_t *ps, double *out_nspeech,
                      double *out_ncpu, double *out_nwall);
 
+/**
+ * Get language model score cache statistics for the current utterance.
+ *
+ * The N-Gram search keeps a small cache of recently computed language
+ * model scores.  These counts are reset at the start of each
+ * utterance, and include lookups made while computing the final
+ * hypothesis and lattice.
+ *
+ * @memberof ps_decoder_t
+ * @param ps Decoder.
+ * @param out_n_lookup Output: Number of scores looked up, or NULL.
+ * @param out_n_hit    Output: Number of those found in the cache, or NULL.
+ * @return 0 for success, -1 if the current search is not an N-Gram search.
+ */
+POCKETSPHINX_EXPORT
+int ps_get_lm_cache_stats(ps_decoder_t *ps, int32 *out_n_lookup,
+                          int32 *out_n_hit);
+
+/**
+ * @struct ps_governor_stats_t
+ * @brief State of the real-time governor.
+ *
+ * If `-maxrtf` is set, the decoder times each frame of search, and
+ * when it falls behind that real-time factor, it degrades the search
+ * by one level, narrowing the beams and (for semi-continuous and PTM
+ * models) reducing the number of Gaussians computed.  When it catches
+ * up again, it restores them one level at a time.
+ */
+typedef struct ps_governor_stats_s {
+    int level;            /**< Current level of degradation, 0 for none. */
+    double rtf;           /**< Recent real-time factor (wall time). */
+    double beam_scale;    /**< Scaling applied to search beams. */
+    int topn;             /**< Top-N Gaussians computed. */
+    int ds_ratio;         /**< Frame downsampling ratio for Gaussians. */
+    int n_degrade;        /**< Number of times the search was degraded. */
+    int n_restore;        /**< Number of times the search was restored. */
+    long n_frame;         /**< Number of frames searched. */
+    long n_frame_degraded; /**< Number of frames searched while degraded. */
+} ps_governor_stats_t;
+
+/**
+ * Callback for changes in the real-time governor's level.
+ *
+ * @param user_data User data passed to ps_set_governor_cb()
+ * @param stats State of the governor after the change.
+ */
+typedef void (*ps_governor_cb_t)(void *user_data,
+                                 ps_governor_stats_t const *stats);
+
+/**
+ * Set a callback to be called when the real-time governor changes level.
+ *
+ * This is called from inside ps_process_raw() and friends, so it
+ * should return quickly.
+ *
+ * @memberof ps_decoder_t
+ * @param ps Decoder.
+ * @param cb Callback, or NULL to remove it.
+ * @param user_data Passed to the callback.
+ * @return 0 for success, -1 if the governor is not enabled (with `-maxrtf`).
+ */
+POCKETSPHINX_EXPORT
+int ps_set_governor_cb(ps_decoder_t *ps, ps_governor_cb_t cb, void *user_data);
+
+/**
+ * Get the state of the real-time governor.
+ *
+ * @memberof ps_decoder_t
+ * @param ps Decoder.
+ * @return Governor state (owned by decoder), or NULL if the governor is
+ *         not enabled (with `-maxrtf`).
+ */
+POCKETSPHINX_EXPORT
+ps_governor_stats_t const *ps_get_governor_stats(ps_decoder_t *ps);
+
 /**
  * @mainpage PocketSphinx API Documentation
  * @author David Huggins-Daines <dhdaines@gmail.com>
@@ -0,0 +1,115 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+
+/**
+ * @file alloc.h
+ * @brief Control over memory allocation in PocketSphinx
+ *
+ * All of PocketSphinx's memory is allocated through one set of
+ * functions, which can be routed to a different allocator such as a
+ * pool or arena.  Small objects such as lattice nodes and search
+ * history entries are allocated in blocks, which can be cached
+ * per-thread when many decoders run in one process.
+ */
+
+#ifndef __PS_ALLOC_H__
+#define __PS_ALLOC_H__
+
+#include <stddef.h>
+
+#include <pocketsphinx/export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * @struct ckd_allocator_t pocketsphinx/alloc.h
+ * @brief Pluggable allocator used for all memory in PocketSphinx.
+ *
+ * Each function receives the <code>ctx</code> pointer from this
+ * structure as its first argument, and should behave like the
+ * corresponding C library function (returning NULL on failure, which
+ * is then reported as a fatal error).  <code>free_fn</code> must
+ * accept NULL.
+ */
+typedef struct ckd_allocator_s {
+    void *(*malloc_fn)(void *ctx, size_t size);
+    void *(*calloc_fn)(void *ctx, size_t n_elem, size_t elem_size);
+    void *(*realloc_fn)(void *ctx, void *ptr, size_t size);
+    void (*free_fn)(void *ctx, void *ptr);
+    void *ctx;
+} ckd_allocator_t;
+
+/**
+ * Route all allocations through a different allocator, such as a
+ * pool or a per-thread arena.
+ *
+ * This is process-wide and is not synchronized, so it should be done
+ * once, before anything is allocated (memory must be released by the
+ * same allocator which allocated it).
+ *
+ * @param alloc Allocator to use, which must remain valid until it is
+ * replaced, or NULL to go back to the C library.
+ * @return Previously set allocator, or NULL if there was none.
+ */
+POCKETSPHINX_EXPORT
+const ckd_allocator_t *ckd_set_allocator(const ckd_allocator_t *alloc);
+
+/**
+ * Keep blocks of small objects released in the calling thread in a
+ * cache local to that thread, for reuse by objects created later in
+ * it.  This avoids contention in the system allocator when many
+ * decoders run in one process.  Call it with 0 to release the cache
+ * before the thread exits.
+ *
+ * @param max_bytes Maximum number of bytes to keep in the cache, or 0
+ *                  to disable it (the default).
+ * @return 0 on success, -1 if thread-local storage is not available.
+ */
+POCKETSPHINX_EXPORT
+int listelem_thread_cache(size_t max_bytes);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __PS_ALLOC_H__ */
@@ -93,12 +93,39 @@ typedef struct ps_latlink_s ps_latlink_t;
  */
 typedef struct latlink_list_s ps_latlink_iter_t;
 
+/**
+ * @struct ps_lattice_writer_t pocketsphinx/lattice.h
+ * @brief Writer for archives of lattices in binary format.
+ */
+typedef struct ps_lattice_writer_s ps_lattice_writer_t;
+
+/**
+ * @struct ps_lattice_reader_t pocketsphinx/lattice.h
+ * @brief Reader for archives of lattices in binary format.
+ */
+typedef struct ps_lattice_reader_s ps_lattice_reader_t;
+
+/**
+ * @struct ps_confnet_t pocketsphinx/lattice.h
+ * @brief Word confusion network ("sausage") derived from a lattice.
+ *
+ * A confusion network is a sequence of slots, each of which contains
+ * a set of competing words with their posterior probabilities,
+ * sorted best first.  A slot may also contain an empty arc,
+ * representing the probability that no word occurs there.
+ */
+typedef struct ps_confnet_s ps_confnet_t;
+
 /* Forward declaration needed to avoid circular includes */
 struct ps_decoder_s;
 
 /**
  * Read a lattice from a file on disk.
  *
+ * This reads either the text format written by ps_lattice_write()
+ * or, if the file is in the binary format written by
+ * ps_lattice_write_bin(), the first lattice in it.
+ *
  * @memberof ps_lattice_t
  * @param ps Decoder to use for processing this lattice, or NULL.
  * @param file Path to lattice file.
@@ -148,6 +175,87 @@ int ps_lattice_write(ps_lattice_t *dag, char const *filename);
 POCKETSPHINX_EXPORT
 int ps_lattice_write_htk(ps_lattice_t *dag, char const *filename);
 
+/**
+ * Write a lattice to disk in binary format.
+ *
+ * This format is much smaller and faster to read than the text
+ * formats, and, unlike them, preserves link scores and end frames
+ * exactly.  It is an archive which can hold any number of lattices;
+ * this writes one containing only dag.  To write many lattices to
+ * one file, use ps_lattice_writer_open().
+ *
+ * @memberof ps_lattice_t
+ * @return 0 for success, <0 on failure.
+ */
+POCKETSPHINX_EXPORT
+int ps_lattice_write_bin(ps_lattice_t *dag, char const *filename);
+
+/**
+ * Open a binary lattice archive for writing.
+ *
+ * @memberof ps_lattice_writer_t
+ * @param filename Archive to write.
+ * @param append If TRUE, add lattices to the end of an existing
+ *        archive (if there is one) rather than replacing it.
+ * @return Newly created writer, or NULL on failure.
+ */
+POCKETSPHINX_EXPORT
+ps_lattice_writer_t *ps_lattice_writer_open(char const *filename, int append);
+
+/**
+ * Add a lattice to a binary lattice archive.
+ *
+ * All lattices in an archive must use the same log-base.
+ *
+ * @memberof ps_lattice_writer_t
+ * @return 0 for success, <0 on failure.
+ */
+POCKETSPHINX_EXPORT
+int ps_lattice_writer_add(ps_lattice_writer_t *writer, ps_lattice_t *dag);
+
+/**
+ * Finish writing and close a binary lattice archive.
+ *
+ * @memberof ps_lattice_writer_t
+ * @return 0 for success, <0 on failure.
+ */
+POCKETSPHINX_EXPORT
+int ps_lattice_writer_close(ps_lattice_writer_t *writer);
+
+/**
+ * Open a binary lattice archive for reading.
+ *
+ * The archive is memory-mapped, if possible, and lattices are
+ * decoded one at a time as they are requested.
+ *
+ * @memberof ps_lattice_reader_t
+ * @param ps Decoder to use for processing lattices, or NULL.
+ * @param filename Archive to read.
+ * @return Newly created reader, or NULL on failure.
+ */
+POCKETSPHINX_EXPORT
+ps_lattice_reader_t *ps_lattice_reader_open(struct ps_decoder_s *ps,
+                                            char const *filename);
+
+/**
+ * Read the next lattice from a binary lattice archive.
+ *
+ * @memberof ps_lattice_reader_t
+ * @return Newly created lattice, which must be freed with
+ *         ps_lattice_free(), or NULL at the end of the archive or on
+ *         failure.
+ */
+POCKETSPHINX_EXPORT
+ps_lattice_t *ps_lattice_reader_next(ps_lattice_reader_t *reader);
+
+/**
+ * Close a binary lattice archive.
+ *
+ * @memberof ps_lattice_reader_t
+ */
+POCKETSPHINX_EXPORT
+void ps_lattice_reader_close(ps_lattice_reader_t *reader);
+
 /**
  * Get the log-math computation object for this lattice
  *
@@ -442,6 +550,34 @@ POCKETSPHINX_EXPORT
 ps_latlink_t *ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
                                   float32 lwf, float32 ascale);
 
+/**
+ * Do best-path search on a word graph with an N-Gram model of any order.
+ *
+ * ps_lattice_bestpath() scores each link given only the word before
+ * it, which is exact for a bigram model.  This instead keeps a
+ * partial path for each distinct history of N-1 words reaching each
+ * node, in effect expanding the lattice by language model state, so
+ * that it finds the best path under a model of any order.  The model
+ * need not be the one used for decoding, since words are looked up
+ * in it by name, so a lattice from a fast first pass with a small
+ * model can be rescored with a larger one.
+ *
+ * The best path is stored in the lattice as ps_lattice_bestpath()
+ * does, so the link returned can be passed to ps_lattice_hyp().
+ * Posterior probabilities are not calculated.
+ *
+ * @memberof ps_lattice_t
+ * @param lm Language model, with weights already applied (see
+ *        ngram_model_apply_weights()).
+ * @param lwf Language weight factor, as for ps_lattice_bestpath().
+ * @param maxhist Maximum number of histories to keep at each node,
+ *        or 0 for no limit.
+ * @return Final link in best path, NULL on error.
+ */
+POCKETSPHINX_EXPORT
+ps_latlink_t *ps_lattice_rescore(ps_lattice_t *dag, ngram_model_t *lm,
+                                 float32 lwf, int32 maxhist);
+
 /**
  * Calculate link posterior probabilities on a word graph.
  *
@@ -469,6 +605,36 @@ int32 ps_lattice_posterior(ps_lattice_t *dag, ngram_model_t *lmset,
 POCKETSPHINX_EXPORT
 int32 ps_lattice_posterior_prune(ps_lattice_t *dag, int32 beam);
 
+/**
+ * Prune links (and associated nodes) far from the best path, or in
+ * excess of a given density.
+ *
+ * Unlike ps_lattice_posterior_prune(), this does not need posterior
+ * probabilities.  Each link is scored by the best path through it,
+ * using its acoustic score and bigram language model probabilities
+ * (as in the heuristic for ps_lattice_nbest()).  It is therefore
+ * cheap enough to apply to every lattice as it is built, which is
+ * done with the "latbeam" and "latdensity" parameters.
+ *
+ * This overwrites the results of any previous ps_lattice_bestpath()
+ * or ps_lattice_posterior().
+ *
+ * @memberof ps_lattice_t
+ * @param lmset Language model, or NULL to use only link scores.
+ * @param lwf Language weight factor.
+ * @param beam Minimum score for links relative to the best path.
+ *         This is expressed in the log-base used in the decoder.  To
+ *         convert from linear floating-point, use
+ *         logmath_log(ps_lattice_get_logmath(), prob), or use
+ *         logmath_get_zero() for no beam.
+ * @param density Maximum average number of links per frame to keep,
+ *         over the whole lattice, or 0 for no limit.
+ * @return number of links removed, or -1 on error.
+ */
+POCKETSPHINX_EXPORT
+int32 ps_lattice_beam_prune(ps_lattice_t *dag, ngram_model_t *lmset,
+                            float32 lwf, int32 beam, float32 density);
+
 #ifdef NOT_IMPLEMENTED_YET
 /**
  * Expand lattice using an N-gram language model.
@@ -490,6 +656,119 @@ int32 ps_lattice_ngram_expand(ps_lattice_t *dag, ngram_model_t *lm);
 POCKETSPHINX_EXPORT
 int ps_lattice_n_frames(ps_lattice_t *dag);
 
+/**
+ * Build a word confusion network from lattice posterior probabilities.
+ *
+ * This function assumes that ps_lattice_posterior() has already been
+ * called.  The best path through the lattice is used as a pivot:
+ * each of its words defines a slot, and every other word in the
+ * lattice is placed in the slot it overlaps most in time, or in a new
+ * slot between two pivot words if it overlaps none of them.
+ * Posteriors for the same word in the same slot are summed.  Filler
+ * words and sentence markers are not included.
+ *
+ * @memberof ps_lattice_t
+ * @param beam Minimum posterior probability for links to be
+ *         included, in the log-base used in the decoder (see
+ *         ps_lattice_posterior_prune()).
+ * @return Newly created confusion network, or NULL on failure.
+ */
+POCKETSPHINX_EXPORT
+ps_confnet_t *ps_lattice_confnet(ps_lattice_t *dag, int32 beam);
+
+/**
+ * Retain a confusion network.
+ *
+ * @memberof ps_confnet_t
+ * @return pointer to the retained confusion network.
+ */
+POCKETSPHINX_EXPORT
+ps_confnet_t *ps_confnet_retain(ps_confnet_t *cn);
+
+/**
+ * Release a confusion network.
+ *
+ * @memberof ps_confnet_t
+ * @return new reference count (0 if cn was freed)
+ */
+POCKETSPHINX_EXPORT
+int ps_confnet_free(ps_confnet_t *cn);
+
+/**
+ * Get the log-math computation object for a confusion network.
+ *
+ * @memberof ps_confnet_t
+ * @return The log-math object used for posterior probabilities.  The
+ *         confusion network retains ownership of this pointer, so
+ *         you should not attempt to free it manually.
+ */
+POCKETSPHINX_EXPORT
+logmath_t *ps_confnet_get_logmath(ps_confnet_t *cn);
+
+/**
+ * Get the number of slots in a confusion network.
+ *
+ * @memberof ps_confnet_t
+ */
+POCKETSPHINX_EXPORT
+int ps_confnet_n_slots(ps_confnet_t *cn);
+
+/**
+ * Get information about a slot in a confusion network.
+ *
+ * @memberof ps_confnet_t
+ * @param slot Index of slot.
+ * @param out_sf Output: first frame of this slot.
+ * @param out_ef Output: last frame of this slot.
+ * @return Number of arcs in this slot, or -1 if slot is out of range.
+ */
+POCKETSPHINX_EXPORT
+int ps_confnet_slot(ps_confnet_t *cn, int slot, int *out_sf, int *out_ef);
+
+/**
+ * Get an arc in a slot of a confusion network.
+ *
+ * Arcs are sorted by decreasing posterior probability.
+ *
+ * @memberof ps_confnet_t
+ * @param slot Index of slot.
+ * @param arc Index of arc in slot.
+ * @param out_prob Output: posterior probability of this arc, in the
+ *         log-base used in the decoder.
+ * @return Word for this arc, or NULL if it is the empty arc (or if
+ *         slot or arc are out of range, in which case out_prob is not
+ *         set).
+ */
+POCKETSPHINX_EXPORT
+char const *ps_confnet_word(ps_confnet_t *cn, int slot, int arc,
+                            int32 *out_prob);
+
+/**
+ * Get the consensus hypothesis from a confusion network.
+ *
+ * This is the sequence of best words in each slot, skipping those
+ * where the empty arc is best.
+ *
+ * @memberof ps_confnet_t
+ * @return Hypothesis string.  The confusion network retains ownership
+ *         of this pointer.
+ */
+POCKETSPHINX_EXPORT
+char const *ps_confnet_hyp(ps_confnet_t *cn);
+
+/**
+ * Write a confusion network to disk.
+ *
+ * This uses the mesh format of the SRI LM toolkit, with one line per
+ * slot listing its words and their (linear) posterior probabilities.
+ * The empty arc is written as "*DELETE*".
+ *
+ * @memberof ps_confnet_t
+ * @return 0 for success, <0 on failure.
+ */
+POCKETSPHINX_EXPORT
+int ps_confnet_write(ps_confnet_t *cn, char const *filename);
+
 #ifdef __cplusplus
 }
 #endif
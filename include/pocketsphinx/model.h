@@ -548,7 +548,18 @@ int32 ngram_bg_score(ngram_model_t *model,
 /**
  * Quick general N-Gram score lookup.
  *
+ * Scoring functions (this one, ngram_tg_score(), ngram_bg_score(),
+ * ngram_ng_prob() and friends) do not modify the model.  One model
+ * can be scored from several threads at once, for instance by
+ * decoders that each wrap it in their own set.  Nothing may modify
+ * the model while this happens: no words added, no weights applied,
+ * and no set members selected, added or removed.  Retaining and
+ * freeing a model are also not thread-safe, so do them from one
+ * thread or under a lock.
+ *
  * @memberof ngram_model_t
+ * @param history Most recent word first.  Class words in it are
+ *                replaced with their class tags.
  */
 POCKETSPHINX_EXPORT
 int32 ngram_ng_score(ngram_model_t *model, int32 wid, int32 *history,
@@ -808,6 +819,36 @@ int32 ngram_model_add_class_word(ngram_model_t *model,
                                  const char *word,
                                  float32 weight);
 
+/**
+ * Replace the members of a class in a language model.
+ *
+ * This allows a class to be used as a slot which is filled at run
+ * time, for instance with a list of contacts, from a larger set of
+ * words added with ngram_model_add_class() or
+ * ngram_model_add_class_word().  Words in the class which are not
+ * listed here keep their word IDs (so the decoder does not need to
+ * be reinitialized) but get zero probability.  The first call
+ * visits every word in the class, after which the cost is
+ * proportional to the number of old and new members.
+ *
+ * @memberof ngram_model_t
+ * @param model The model containing the class.
+ * @param classname Name of the class tag.
+ * @param words Words in the class to make members.  Each may only be
+ *              listed once.
+ * @param weights Relative weights of the members, or NULL to make
+ *                them equally likely.
+ * @param n_words Number of elements in words (may be 0 to empty the
+ *                class).
+ * @return Number of members, or <0 for error.
+ */
+POCKETSPHINX_EXPORT
+int32 ngram_model_update_class(ngram_model_t *model,
+                               const char *classname,
+                               const char **words,
+                               const float32 *weights,
+                               int32 n_words);
+
 /**
  * Create a set of language models sharing a common space of word IDs.
  *
@@ -969,6 +1010,28 @@ ngram_model_t *ngram_model_set_interp(ngram_model_t *set,
                                       const char **names,
                                       const float32 *weights);
 
+/**
+ * Compile the interpolation of a set into a single language model.
+ *
+ * The result contains every N-Gram found in any model of the set,
+ * with its exact linearly interpolated probability under the set's
+ * current interpolation weights.  Backoff weights are then
+ * recomputed so that each history is normalized.  Scoring the
+ * result costs the same as scoring any single model, and it can be
+ * written out with ngram_model_write().
+ *
+ * N-Grams not in any model are approximated.  Their true
+ * interpolated probability mixes each model's own backoff, and the
+ * merged model cannot represent that.
+ *
+ * @memberof ngram_model_t
+ * @param set The language model set to merge.  Its models must not
+ *            use classes.
+ * @return A newly created language model, or NULL on failure.
+ */
+POCKETSPHINX_EXPORT
+ngram_model_t *ngram_model_set_merge(ngram_model_t *set);
+
 /**
  * Add a language model to a set.
  *
@@ -1039,6 +1102,9 @@ int32 ngram_model_set_known_wid(ngram_model_t *set, int32 set_wid);
 
 /**
  * Flush any cached N-Gram information
+ *
+ * No built-in model keeps such a cache now, so this does nothing
+ * unless a model implementation provides it.
  * @memberof ngram_model_t
  */
 POCKETSPHINX_EXPORT
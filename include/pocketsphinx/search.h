@@ -93,6 +93,12 @@ extern "C" {
  */
 typedef struct ps_search_iter_s ps_search_iter_t;
 
+/**
+ * @struct ps_search_t pocketsphinx/search.h
+ * @brief Search module built for later use by a decoder.
+ */
+typedef struct ps_search_s ps_search_t;
+
 /* Forward-declare this because header files are an atrocity. */
 typedef struct ps_decoder_s ps_decoder_t;
 
@@ -194,6 +200,32 @@ const char* ps_search_iter_val(ps_search_iter_t *itor);
 POCKETSPHINX_EXPORT 
 ngram_model_t *ps_get_lm(ps_decoder_t *ps, const char *name);
 
+/**
+ * Replace the members of a word class in a language model search.
+ *
+ * This fills a class defined in the language model (see
+ * ngram_model_add_class()) with some of its words, for example a
+ * list of contacts for the current user, using
+ * ngram_model_update_class().  The other words of the class are
+ * still in the search's vocabulary, but cannot be recognized, and
+ * no search structures are rebuilt.  The change should be made
+ * between utterances.  If any model in the search cannot be updated,
+ * none of them are.
+ *
+ * @memberof ps_decoder_t
+ * @arg name Name of language model search, or NULL for current search.
+ * @arg classname Name of the class tag.
+ * @arg words Words in the class to make members.
+ * @arg weights Relative weights of the members, or NULL to make them
+ *              equally likely.
+ * @arg n_words Number of elements in words.
+ * @return Number of members, or <0 for error.
+ */
+POCKETSPHINX_EXPORT
+int ps_update_lm_class(ps_decoder_t *ps, const char *name,
+                       const char *classname, const char **words,
+                       const float32 *weights, int32 n_words);
+
 /**
  * Adds new search based on N-gram language model.
  *
@@ -217,6 +249,69 @@ int ps_add_lm(ps_decoder_t *ps, const char *name, ngram_model_t *lm);
 POCKETSPHINX_EXPORT
 int ps_add_lm_file(ps_decoder_t *ps, const char *name, const char *path);
 
+/**
+ * Builds a search based on N-gram language model, to be swapped in
+ * later.
+ *
+ * This does the slow part of ps_add_lm() without changing the
+ * decoder (or the reference counts of anything it uses), so it can
+ * run in another thread while the decoder is processing audio, as
+ * long as nothing changes the decoder's configuration, acoustic
+ * model or dictionary (e.g. ps_reinit(), ps_load_dict()) until it
+ * returns.  The result is passed to ps_swap_search(), or freed with
+ * ps_discard_search() if it is not needed.
+ *
+ * @memberof ps_decoder_t
+ * @return Newly built search, or NULL on failure.
+ * @see ps_swap_search
+ */
+POCKETSPHINX_EXPORT
+ps_search_t *ps_build_lm(ps_decoder_t *ps, const char *name,
+                         ngram_model_t *lm);
+
+/**
+ * Builds a search based on N-gram language model, to be swapped in
+ * later.
+ *
+ * Convenient method to load an N-gram model and build a search,
+ * with the same restrictions as ps_build_lm().
+ *
+ * @memberof ps_decoder_t
+ * @see ps_build_lm
+ */
+POCKETSPHINX_EXPORT
+ps_search_t *ps_build_lm_file(ps_decoder_t *ps, const char *name,
+                              const char *path);
+
+/**
+ * Swaps in a search built with ps_build_lm() at the next utterance.
+ *
+ * This must be called from the thread which uses the decoder, but
+ * may be called during an utterance.  At the next ps_start_utt(),
+ * the search replaces (and frees) any search with the same name,
+ * and is activated if that search was active or if no search was.
+ * Language models are reference counted, so those used by other
+ * decoders are not freed along with the old search.  If another
+ * search is already waiting to be swapped in, it is discarded.
+ *
+ * @memberof ps_decoder_t
+ * @param search Search to swap in.  The decoder takes ownership of it
+ *               (and of its reference to the language model).  If it
+ *               cannot be swapped in, it is freed and ps_start_utt()
+ *               fails.
+ * @return 0 on success, -1 on failure.
+ */
+POCKETSPHINX_EXPORT
+int ps_swap_search(ps_decoder_t *ps, ps_search_t *search);
+
+/**
+ * Frees a search built with ps_build_lm() which was not swapped in.
+ *
+ * @memberof ps_search_t
+ */
+POCKETSPHINX_EXPORT
+void ps_discard_search(ps_search_t *search);
+
 /**
  * Get the finite-state grammar set object associated with a search.
  *
@@ -0,0 +1,363 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * \file pocketsphinx_lattice_rescore.c
+ * Rescore word lattices with a (possibly higher-order) language model.
+ *
+ * Lattices written by pocketsphinx_batch -outlatdir are read, the
+ * best path through each one under the given model is found with
+ * ps_lattice_rescore(), and the results are written in the same
+ * format as pocketsphinx_batch -hyp.  Lattices are independent of
+ * one another, so they can be processed by several threads sharing a
+ * single copy of the language model.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <pocketsphinx.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "util/ckd_alloc.h"
+#include "util/strfuncs.h"
+#include "util/pio.h"
+#include "util/cmd_ln.h"
+#include "lm/ngram_model.h"
+#include "config_macro.h"
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+
+static const ps_arg_t defn[] = {
+    { "argfile",
+      ARG_STRING,
+      NULL,
+      "Argument file giving extra arguments." },
+    { "ctl",
+      ARG_STRING,
+      NULL,
+      "Control file listing utterances to be processed" },
+    { "ctloffset",
+      ARG_INTEGER,
+      "0",
+      "No. of utterances at the beginning of -ctl file to be skipped" },
+    { "ctlcount",
+      ARG_INTEGER,
+      "-1",
+      "No. of utterances to be processed (after skipping -ctloffset entries)" },
+    { "inlatdir",
+      ARG_STRING,
+      NULL,
+      "Directory containing word lattices" },
+    { "inlatext",
+      ARG_STRING,
+      ".lat",
+      "Filename extension for word lattices (text or binary format)" },
+    { "lm",
+      ARG_STRING,
+      NULL,
+      "Language model to rescore with" },
+    { "lw",
+      ARG_FLOATING,
+      "6.5",
+      "Language model probability weight" },
+    { "wip",
+      ARG_FLOATING,
+      "0.65",
+      "Word insertion penalty" },
+    { "lmindex",
+      ARG_BOOLEAN,
+      "no",
+      "Build an index of language model word IDs for faster lookup (uses more memory)" },
+    { "maxhist",
+      ARG_INTEGER,
+      "0",
+      "Maximum number of language model histories to keep at each lattice node (0 for no limit)" },
+    { "nthreads",
+      ARG_INTEGER,
+      "1",
+      "Number of lattices to rescore in parallel" },
+    { "hyp",
+      ARG_STRING,
+      NULL,
+      "Recognition output file name" },
+    { "loglevel",
+      ARG_STRING,
+      "WARN",
+      "Minimum level of log messages (DEBUG, INFO, WARN, ERROR)" },
+
+    CMDLN_EMPTY_OPTION
+};
+
+/* One lattice to be rescored, and its result. */
+typedef struct rescore_utt_s {
+    char *uttid;
+    char *hyp;
+    int32 score;
+} rescore_utt_t;
+
+/* State shared by all threads. */
+typedef struct rescore_batch_s {
+    ngram_model_t *lm;
+    char const *inlatdir;
+    char const *inlatext;
+    int32 maxhist;
+    rescore_utt_t *utts;
+    int32 n_utts;
+    int32 next_utt;
+#ifndef _WIN32
+    pthread_mutex_t mtx;
+#endif
+} rescore_batch_t;
+
+static void
+rescore_one(rescore_batch_t *batch, rescore_utt_t *utt)
+{
+    ps_lattice_t *dag;
+    ps_latlink_t *link;
+    char *file;
+
+    if (batch->inlatdir)
+        file = string_join(batch->inlatdir, "/", utt->uttid,
+                           batch->inlatext, NULL);
+    else
+        file = string_join(utt->uttid, batch->inlatext, NULL);
+    if ((dag = ps_lattice_read(NULL, file)) == NULL) {
+        E_ERROR("Failed to read lattice from %s\n", file);
+        ckd_free(file);
+        return;
+    }
+    ckd_free(file);
+    if ((link = ps_lattice_rescore(dag, batch->lm,
+                                   1.0, batch->maxhist)) != NULL) {
+        utt->hyp = ckd_salloc(ps_lattice_hyp(dag, link));
+        utt->score = link->path_scr;
+    }
+    else
+        E_ERROR("Failed to rescore lattice for %s\n", utt->uttid);
+    ps_lattice_free(dag);
+}
+
+/* Take lattices from the batch until there are none left.  The
+ * language model is only read from, so it is safely shared. */
+static void *
+rescore_worker(void *arg)
+{
+    rescore_batch_t *batch = arg;
+
+    while (TRUE) {
+        int32 i;
+
+#ifndef _WIN32
+        pthread_mutex_lock(&batch->mtx);
+#endif
+        i = batch->next_utt++;
+#ifndef _WIN32
+        pthread_mutex_unlock(&batch->mtx);
+#endif
+        if (i >= batch->n_utts)
+            break;
+        rescore_one(batch, batch->utts + i);
+    }
+    return NULL;
+}
+
+static int
+read_ctl(rescore_batch_t *batch, cmd_ln_t *config, FILE *ctlfh)
+{
+    int32 ctloffset, ctlcount, i, n_alloc;
+    size_t len;
+    char *line;
+
+    ctloffset = ps_config_int(config, "ctloffset");
+    ctlcount = ps_config_int(config, "ctlcount");
+    n_alloc = 0;
+    for (i = 0; (line = fread_line(ctlfh, &len)) != NULL; ++i) {
+        char *wptr[4];
+        int32 nf;
+
+        if (i < ctloffset
+            || (ctlcount != -1 && i >= ctloffset + ctlcount)) {
+            ckd_free(line);
+            continue;
+        }
+        /* Utterance ID is the file name unless given explicitly. */
+        nf = str2words(line, wptr, 4);
+        if (nf < 0)
+            E_ERROR("Unexpected extra data in control file at line %d\n", i);
+        else if (nf > 0) {
+            if (batch->n_utts == n_alloc) {
+                n_alloc = n_alloc ? n_alloc * 2 : 64;
+                batch->utts = ckd_realloc(batch->utts,
+                                          n_alloc * sizeof(*batch->utts));
+            }
+            batch->utts[batch->n_utts].uttid
+                = ckd_salloc(nf > 3 ? wptr[3] : wptr[0]);
+            batch->utts[batch->n_utts].hyp = NULL;
+            batch->utts[batch->n_utts].score = 0;
+            ++batch->n_utts;
+        }
+        ckd_free(line);
+    }
+    return batch->n_utts;
+}
+
+static void
+process_ctl(rescore_batch_t *batch, cmd_ln_t *config)
+{
+    int32 nthreads, i;
+    FILE *hypfh = NULL;
+    char const *str;
+
+    nthreads = ps_config_int(config, "nthreads");
+    if (nthreads > batch->n_utts)
+        nthreads = batch->n_utts;
+#ifndef _WIN32
+    pthread_mutex_init(&batch->mtx, NULL);
+    if (nthreads > 1) {
+        pthread_t *threads = ckd_calloc(nthreads, sizeof(*threads));
+        int32 n_started;
+        int rv;
+
+        for (n_started = 0; n_started < nthreads; ++n_started) {
+            if ((rv = pthread_create(&threads[n_started], NULL,
+                                     rescore_worker, batch)) != 0) {
+                E_WARN("Failed to start thread %d of %d: %s\n",
+                       n_started + 1, nthreads, strerror(rv));
+                break;
+            }
+        }
+        /* Since lattices are taken from a shared queue, whatever the
+         * missing threads would have done gets done here instead. */
+        if (n_started < nthreads)
+            rescore_worker(batch);
+        for (i = 0; i < n_started; ++i)
+            pthread_join(threads[i], NULL);
+        ckd_free(threads);
+    }
+    else
+        rescore_worker(batch);
+    pthread_mutex_destroy(&batch->mtx);
+#else
+    if (nthreads > 1)
+        E_WARN("Threads are not supported, rescoring sequentially\n");
+    rescore_worker(batch);
+#endif
+
+    /* Write results in control file order. */
+    if ((str = ps_config_str(config, "hyp"))) {
+        if ((hypfh = fopen(str, "w")) == NULL) {
+            E_ERROR_SYSTEM("Failed to open hypothesis file %s for writing", str);
+            return;
+        }
+    }
+    for (i = 0; i < batch->n_utts; ++i) {
+        rescore_utt_t *utt = batch->utts + i;
+        FILE *fh = hypfh ? hypfh : stdout;
+        fprintf(fh, "%s (%s %d)\n", utt->hyp ? utt->hyp : "",
+                utt->uttid, utt->score);
+    }
+    if (hypfh)
+        fclose(hypfh);
+}
+
+int
+main(int argc, char *argv[])
+{
+    rescore_batch_t batch;
+    cmd_ln_t *config;
+    logmath_t *lmath;
+    char const *str;
+    FILE *ctlfh;
+    int32 i;
+
+    config = cmd_ln_parse_r(NULL, defn, argc, argv, TRUE);
+    if (config && (str = ps_config_str(config, "argfile")) != NULL) {
+        config = cmd_ln_parse_file_r(config, defn, str, FALSE);
+    }
+    if (config == NULL) {
+        /* This probably just means that we got no arguments. */
+        err_set_loglevel(ERR_INFO);
+        cmd_ln_log_help_r(NULL, defn);
+        return 1;
+    }
+    if ((str = ps_config_str(config, "loglevel"))) {
+        if (err_set_loglevel_str(str) == NULL) {
+            E_ERROR("Invalid log level: %s\n", str);
+            ps_config_free(config);
+            return 1;
+        }
+    }
+    if ((str = ps_config_str(config, "ctl")) == NULL) {
+        E_FATAL("-ctl argument not present, nothing to do!\n");
+    }
+    if ((ctlfh = fopen(str, "r")) == NULL) {
+        E_FATAL_SYSTEM("Failed to open control file '%s'", str);
+    }
+    if ((str = ps_config_str(config, "lm")) == NULL) {
+        E_FATAL("-lm argument not present, nothing to rescore with!\n");
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    /* Lattices read without a decoder use the default log base. */
+    lmath = logmath_init(1.0001, 0, FALSE);
+    /* Weights are applied from -lw and -wip. */
+    if ((batch.lm = ngram_model_read(config, str, NGRAM_AUTO, lmath)) == NULL) {
+        logmath_free(lmath);
+        fclose(ctlfh);
+        E_FATAL("Failed to read language model from %s\n", str);
+    }
+    batch.inlatdir = ps_config_str(config, "inlatdir");
+    batch.inlatext = ps_config_str(config, "inlatext");
+    batch.maxhist = ps_config_int(config, "maxhist");
+    read_ctl(&batch, config, ctlfh);
+    fclose(ctlfh);
+
+    process_ctl(&batch, config);
+
+    for (i = 0; i < batch.n_utts; ++i) {
+        ckd_free(batch.utts[i].uttid);
+        ckd_free(batch.utts[i].hyp);
+    }
+    ckd_free(batch.utts);
+    ngram_model_free(batch.lm);
+    logmath_free(lmath);
+    ps_config_free(config);
+    return 0;
+}
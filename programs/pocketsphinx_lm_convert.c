@@ -41,6 +41,7 @@
 #include <pocketsphinx.h>
 #include "pocketsphinx_internal.h"
 #include "lm/ngram_model.h"
+#include "lm/ngram_model_trie.h"
 #include "util/ckd_alloc.h"
 #include "util/cmd_ln.h"
 #include "util/ckd_alloc.h"
@@ -51,6 +52,10 @@
 #include <string.h>
 #include <math.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 static const ps_arg_t defn[] = {
   { "help",
     ARG_BOOLEAN,
@@ -63,9 +68,19 @@ static const ps_arg_t defn[] = {
     "Base in which all log-likelihoods calculated" },
 
   { "i",
-    REQARG_STRING,
+    ARG_STRING,
+    NULL,
+    "Input language model file (required unless -lmctl is given)"},
+
+  { "lmctl",
+    ARG_STRING,
     NULL,
-    "Input language model file (required)"},
+    "Input language model set control file, models are interpolated and merged into one"},
+
+  { "lmweights",
+    ARG_STRING,
+    NULL,
+    "Comma-separated interpolation weights for -lmctl, in order (default: uniform)"},
 
   { "o",
     REQARG_STRING,
@@ -92,6 +107,31 @@ static const ps_arg_t defn[] = {
     "no",
     "Use memory-mapped I/O for reading binary LM files"},
 
+  { "prune",
+    ARG_FLOATING,
+    "0",
+    "Prune N-Grams whose removal increases perplexity by less than this (relative, e.g. 1e-8)"},
+
+  { "probbits",
+    ARG_INTEGER,
+    "16",
+    "Bits per quantized N-Gram probability in binary output (1 to 16)"},
+
+  { "bobits",
+    ARG_INTEGER,
+    "16",
+    "Bits per quantized N-Gram backoff weight in binary output (1 to 16)"},
+
+  { "lsn",
+    ARG_STRING,
+    NULL,
+    "Transcription file on which to report perplexity of input and output models"},
+
+  { "nthreads",
+    ARG_INTEGER,
+    "1",
+    "Number of threads for parsing an uncompressed ARPA input model"},
+
   { NULL, 0, NULL, NULL }
 };
 
@@ -101,11 +141,183 @@ usagemsg(char *pgm)
     E_INFO("Usage: %s -i <input.lm> \\\n", pgm);
     E_INFOCONT("\t[-ifmt txt] [-ofmt dmp]\n");
     E_INFOCONT("\t-o <output.lm.DMP>\n");
+    E_INFOCONT("or: %s -lmctl <input.lmctl> [-lmweights 0.6,0.4] \\\n", pgm);
+    E_INFOCONT("\t-o <output.lm.bin>\n");
 
     exit(0);
 }
 
 
+/**
+ * Read and interpolate a language model set, then merge it into a
+ * single model.
+ */
+static ngram_model_t *
+read_merged_set(cmd_ln_t *config, logmath_t *lmath)
+{
+    ngram_model_t *set, *lm;
+    ngram_model_set_iter_t *itor;
+    const char **names;
+    float32 *weights;
+    int32 n_models, i;
+    char const *lmweights;
+
+    if ((set = ngram_model_set_read(config, ps_config_str(config, "lmctl"),
+                                    lmath)) == NULL)
+        return NULL;
+    n_models = ngram_model_set_count(set);
+    names = ckd_calloc(n_models, sizeof(*names));
+    weights = ckd_calloc(n_models, sizeof(*weights));
+    for (i = 0, itor = ngram_model_set_iter(set);
+         itor; ++i, itor = ngram_model_set_iter_next(itor)) {
+        ngram_model_set_iter_model(itor, &names[i]);
+        weights[i] = 1.0 / n_models;
+    }
+    if ((lmweights = ps_config_str(config, "lmweights"))) {
+        char *wstr = ckd_salloc(lmweights);
+        char *wptr = wstr;
+
+        for (i = 0; i < n_models; ++i) {
+            char *tok = strtok(wptr, ", ");
+            wptr = NULL;
+            if (tok == NULL) {
+                E_ERROR("Need %d weights in -lmweights, got %d\n",
+                        n_models, i);
+                break;
+            }
+            weights[i] = atof_c(tok);
+        }
+        ckd_free(wstr);
+        if (i < n_models) {
+            lm = NULL;
+            goto done;
+        }
+    }
+    ngram_model_set_interp(set, names, weights);
+    lm = ngram_model_set_merge(set);
+
+done:
+    ckd_free(names);
+    ckd_free(weights);
+    ngram_model_free(set);
+    return lm;
+}
+
+/**
+ * Report perplexity of a model on a transcription, as
+ * pocketsphinx_lm_eval does.
+ */
+static float64
+report_perplexity(ngram_model_t *lm, const char *lsnfn, const char *name)
+{
+    int32 nccs, noovs, nwords, lscr;
+    float64 ch;
+
+    if ((ch = ngram_model_eval_file(lm, lsnfn, NULL, &nwords,
+                                    &nccs, &noovs, &lscr)) < 0)
+        return -1;
+    printf("%s model: cross-entropy %f bits, perplexity %f "
+           "(%d words, %d OOVs)\n", name, ch, pow(2.0, ch),
+           nwords, noovs);
+    return pow(2.0, ch);
+}
+
+#ifndef _WIN32
+/* Tasks shared by the threads reading an ARPA model. */
+typedef struct read_tasks_s {
+    ngram_task_fn fn;
+    void **args;
+    int n_args;
+    int next_arg;
+    pthread_mutex_t mtx;
+} read_tasks_t;
+
+/* Take tasks until there are none left. */
+static void *
+read_worker(void *arg)
+{
+    read_tasks_t *tasks = arg;
+
+    while (TRUE) {
+        int i;
+
+        pthread_mutex_lock(&tasks->mtx);
+        i = tasks->next_arg++;
+        pthread_mutex_unlock(&tasks->mtx);
+        if (i >= tasks->n_args)
+            break;
+        tasks->fn(tasks->args[i]);
+    }
+    return NULL;
+}
+
+static void
+run_read_tasks(ngram_task_fn fn, void **args, int n_args, void *udata)
+{
+    int nthreads = *(int *)udata;
+    pthread_t *threads;
+    read_tasks_t tasks;
+    int i, n_started, rv;
+
+    if (nthreads > n_args)
+        nthreads = n_args;
+    tasks.fn = fn;
+    tasks.args = args;
+    tasks.n_args = n_args;
+    tasks.next_arg = 0;
+    pthread_mutex_init(&tasks.mtx, NULL);
+    threads = ckd_calloc(nthreads > 0 ? nthreads : 1, sizeof(*threads));
+    for (n_started = 0; n_started < nthreads; ++n_started) {
+        if ((rv = pthread_create(&threads[n_started], NULL,
+                                 read_worker, &tasks)) != 0) {
+            E_WARN("Failed to start thread %d of %d: %s\n",
+                   n_started + 1, nthreads, strerror(rv));
+            break;
+        }
+    }
+    /* Whatever the missing threads would have done gets done here. */
+    if (n_started < nthreads)
+        read_worker(&tasks);
+    for (i = 0; i < n_started; ++i)
+        pthread_join(threads[i], NULL);
+    ckd_free(threads);
+    pthread_mutex_destroy(&tasks.mtx);
+}
+#endif
+
+/*
+ * Read the input model, parsing ARPA files in several threads if
+ * requested.  Formats are tried in the same order as
+ * ngram_model_read() does.
+ */
+static ngram_model_t *
+read_model(cmd_ln_t *config, const char *file_name,
+           ngram_file_type_t file_type, logmath_t *lmath)
+{
+    int nthreads = ps_config_int(config, "nthreads");
+    ngram_model_t *lm;
+
+    if (nthreads <= 1 || file_type == NGRAM_BIN
+        || (file_type == NGRAM_AUTO
+            && ngram_file_name_to_type(file_name) == NGRAM_BIN))
+        return ngram_model_read(config, file_name, file_type, lmath);
+#ifndef _WIN32
+    if (file_type == NGRAM_AUTO
+        && (lm = ngram_model_trie_read_bin(config, file_name, lmath)) != NULL)
+        return lm;
+    if ((lm = ngram_model_trie_read_arpa_tasks(config, file_name, lmath,
+                                               nthreads, run_read_tasks,
+                                               &nthreads)) != NULL
+        || file_type == NGRAM_ARPA)
+        return lm;
+    return ngram_model_trie_read_dmp(config, file_name, lmath);
+#else
+    E_WARN("Threads are not supported, reading sequentially\n");
+    (void)lm;
+    return ngram_model_read(config, file_name, file_type, lmath);
+#endif
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -132,28 +344,36 @@ main(int argc, char *argv[])
 		E_FATAL("Failed to initialize log math\n");
 	}
 	
-	if (ps_config_str(config, "i") == NULL || ps_config_str(config, "i") == NULL) {
+	if ((ps_config_str(config, "i") == NULL
+             && ps_config_str(config, "lmctl") == NULL)
+            || ps_config_str(config, "o") == NULL) {
             E_ERROR("Please specify both input and output models\n");
             goto error_out;
         }	    
 	
 	/* Load the input language model. */
-        if (ps_config_str(config, "ifmt")) {
+        if (ps_config_str(config, "lmctl")) {
+            lm = read_merged_set(config, lmath);
+        }
+        else if (ps_config_str(config, "ifmt")) {
             if ((itype = ngram_str_to_type(ps_config_str(config, "ifmt")))
                 == NGRAM_INVALID) {
                 E_ERROR("Invalid input type %s\n", ps_config_str(config, "ifmt"));
                 goto error_out;
             }
-            lm = ngram_model_read(config, ps_config_str(config, "i"),
-                                  itype, lmath);
+            lm = read_model(config, ps_config_str(config, "i"),
+                            itype, lmath);
         }
         else {
-            lm = ngram_model_read(config, ps_config_str(config, "i"),
-                                  NGRAM_AUTO, lmath);
+            lm = read_model(config, ps_config_str(config, "i"),
+                            NGRAM_AUTO, lmath);
 	}
 
 	if (lm == NULL) {
-	    E_ERROR("Failed to read the model from the file '%s'\n", ps_config_str(config, "i"));
+	    E_ERROR("Failed to read the model from the file '%s'\n",
+                    ps_config_str(config, "lmctl")
+                    ? ps_config_str(config, "lmctl")
+                    : ps_config_str(config, "i"));
 	    goto error_out;
 	}
 
@@ -183,6 +403,32 @@ main(int argc, char *argv[])
             }
         }
 
+        /* Prune and requantize if requested. */
+        if (ps_config_float(config, "prune") > 0
+            || ps_config_int(config, "probbits") != LM_TRIE_QUANT_BITS
+            || ps_config_int(config, "bobits") != LM_TRIE_QUANT_BITS) {
+            ngram_model_t *small;
+            char const *lsnfn = ps_config_str(config, "lsn");
+            float64 ppl = 0;
+
+            if (lsnfn)
+                ppl = report_perplexity(lm, lsnfn, "Input");
+            if ((small = ngram_model_trie_rebuild
+                 (lm, ps_config_float(config, "prune"),
+                  ps_config_int(config, "probbits"),
+                  ps_config_int(config, "bobits"))) == NULL) {
+                E_ERROR("Failed to prune or quantize language model\n");
+                goto error_out;
+            }
+            ngram_model_free(lm);
+            lm = small;
+            if (lsnfn && ppl > 0) {
+                float64 new_ppl = report_perplexity(lm, lsnfn, "Output");
+                printf("Perplexity changed by %+.2f%%\n",
+                       (new_ppl - ppl) / ppl * 100);
+            }
+        }
+
         /* Write the output language model. */
         if (ngram_model_write(lm, ps_config_str(config, "o"), otype) != 0) {
             E_ERROR("Failed to write language model in format %s to %s\n",
@@ -119,119 +119,17 @@ static const ps_arg_t defn[] = {
 
 static int verbose;
 
-static int
-calc_entropy(ngram_model_t *lm, char **words, int32 n,
-	     int32 *out_n_ccs, int32 *out_n_oovs, int32 *out_lm_score)
-{
-	int32 *wids;
-	int32 startwid;
-	int32 i, ch, nccs, noovs, unk;
-
-        if (n == 0)
-            return 0;
-
-        unk = ngram_unknown_wid(lm);
-
-	/* Reverse this array into an array of word IDs. */
-	wids = ckd_calloc(n, sizeof(*wids));
-	for (i = 0; i < n; ++i)
-		wids[n-i-1] = ngram_wid(lm, words[i]);
-	/* Skip <s> as it's a context cue (HACK, this should be configurable). */
-	startwid = ngram_wid(lm, "<s>");
-
-	/* Now evaluate the list of words in reverse using the
-	 * remainder of the array as the history. */
-	ch = noovs = nccs = 0;
-	for (i = 0; i < n; ++i) {
-		int32 n_used;
-		int32 prob;
-
-		/* Skip <s> as it's a context cue (HACK, this should be configurable). */
-		if (wids[i] == startwid) {
-			++nccs;
-			continue;
-		}
-		/* Skip and count OOVs. */
-		if (wids[i] == NGRAM_INVALID_WID || wids[i] == unk) {
-			++noovs;
-			continue;
-		}
-		/* Sum up information for each N-gram */
-		prob = ngram_ng_score(lm,
-				      wids[i], wids + i + 1,
-				      n - i - 1, &n_used);
-                if (verbose) {
-                    int m;
-                    printf("log P(%s|", ngram_word(lm, wids[i]));
-                    m = i + ngram_model_get_size(lm) - 1;
-                    if (m >= n)
-                        m = n - 1;
-                    while (m > i) {
-                        printf("%s ", ngram_word(lm, wids[m--]));
-                    }
-                    printf(") = %d\n", prob);
-                }
-		ch -= prob;
-	}
-
-	if (out_n_ccs) *out_n_ccs = nccs;
-	if (out_n_oovs) *out_n_oovs = noovs;
-
-	/* Calculate cross-entropy CH = - 1/N sum log P(W|H) */
-        n -= (nccs + noovs);
-        if (n <= 0)
-            return 0;
-        if (out_lm_score)
-            *out_lm_score = -ch;
-	return ch / n;
-}
-
 static void
 evaluate_file(ngram_model_t *lm, logmath_t *lmath, const char *lsnfn)
 {
-	FILE *fh;
-        lineiter_t *litor;
 	int32 nccs, noovs, nwords, lscr;
-	float64 ch, log_to_log2;;
-
-	if ((fh = fopen(lsnfn, "r")) == NULL)
-		E_FATAL_SYSTEM("failed to open transcript file %s", lsnfn);
-
-	/* We have to keep ch in floating-point to avoid overflows, so
-	 * we might as well use log2. */
-	log_to_log2 = log(logmath_get_base(lmath)) / log(2);
-	lscr = nccs = noovs = nwords = 0;
-	ch = 0.0;
-        for (litor = lineiter_start(fh); litor; litor = lineiter_next(litor)) {
-		char **words;
-		int32 n, tmp_ch, tmp_noovs, tmp_nccs, tmp_lscr;
-
-		n = str2words(litor->buf, NULL, 0);
-		if (n < 0)
-			E_FATAL("str2words(line, NULL, 0) = %d, should not happen\n", n);
-		if (n == 0) /* Do nothing! */
-			continue;
-		words = ckd_calloc(n, sizeof(*words));
-		str2words(litor->buf, words, n);
-
-		/* Remove any utterance ID (FIXME: has to be a single "word") */
-		if (words[n-1][0] == '('
-		    && words[n-1][strlen(words[n-1])-1] == ')')
-			n = n - 1;
-
-		tmp_ch = calc_entropy(lm, words, n, &tmp_nccs,
-                                      &tmp_noovs, &tmp_lscr);
-
-		ch += (float64) tmp_ch * (n - tmp_nccs - tmp_noovs) * log_to_log2;
-		nccs += tmp_nccs;
-		noovs += tmp_noovs;
-                lscr += tmp_lscr;
-		nwords += n;
-		
-		ckd_free(words);
-	}
+	float64 ch;
 
-	ch /= (nwords - nccs - noovs);
+	(void)lmath;
+	ch = ngram_model_eval_file(lm, lsnfn, verbose ? stdout : NULL,
+				   &nwords, &nccs, &noovs, &lscr);
+	if (ch < 0)
+		E_FATAL("Failed to evaluate %s\n", lsnfn);
 	printf("cross-entropy: %f bits\n", ch);
 
 	/* Calculate perplexity pplx = exp CH */
@@ -261,7 +159,8 @@ evaluate_string(ngram_model_t *lm, logmath_t *lmath, const char *text)
 	words = ckd_calloc(n, sizeof(*words));
 	str2words(textfoo, words, n);
 
-	ch = calc_entropy(lm, words, n, &nccs, &noovs, &lscr);
+	ch = ngram_model_entropy(lm, words, n, verbose ? stdout : NULL,
+				 &nccs, &noovs, &lscr);
 
 	printf("input: %s\n", text);
 	printf("cross-entropy: %f bits\n",
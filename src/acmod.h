@@ -108,6 +108,8 @@ typedef struct ps_mgaufuncs_s {
     int (*transform)(ps_mgau_t *mgau,
                      ps_mllr_t *mllr);
     void (*free)(ps_mgau_t *mgau);
+    /** Change top-N and frame downsampling, or NULL if not supported. */
+    int (*set_approx)(ps_mgau_t *mgau, int topn, int ds_ratio);
 } ps_mgaufuncs_t;    
 
 struct ps_mgau_s {
@@ -123,6 +125,9 @@ struct ps_mgau_s {
     (*ps_mgau_base(mg)->vt->transform)(mg, mllr)
 #define ps_mgau_free(mg)                                  \
     (*ps_mgau_base(mg)->vt->free)(mg)
+#define ps_mgau_set_approx(mg, topn, ds_ratio)                          \
+    (ps_mgau_base(mg)->vt->set_approx                                   \
+     ? (*ps_mgau_base(mg)->vt->set_approx)(mg, topn, ds_ratio) : -1)
 
 /**
  * Acoustic model structure.
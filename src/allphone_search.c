@@ -48,6 +48,7 @@
 
 #include "pocketsphinx_internal.h"
 #include "allphone_search.h"
+#include "phone_loop_search.h"
 
 static ps_lattice_t *
 allphone_search_lattice(ps_search_t * search)
@@ -404,7 +405,8 @@ phmm_exit(allphone_search_t * allphs, int32 best)
 
                 if (hmm_bestscore(&(p->hmm)) >= th) {
 
-                    h = (history_t *) ckd_calloc(1, sizeof(*h));
+                    h = (history_t *) arena_calloc(ps_search_base(allphs)->arena,
+                                                   1, sizeof(*h));
                     h->ef = curfrm;
                     h->phmm = p;
                     h->hist = hmm_out_history(&(p->hmm));
@@ -473,6 +475,7 @@ phmm_trans(allphone_search_t * allphs, int32 best,
     history_t *h;
     phmm_t *from, *to;
     plink_t *l;
+    phone_loop_search_t *pls;
     int32 newscore, nf, curfrm;
     int32 *ci2lmwid;
     int32 hist_idx;
@@ -480,6 +483,7 @@ phmm_trans(allphone_search_t * allphs, int32 best,
     curfrm = allphs->frame;
     nf = curfrm + 1;
     ci2lmwid = allphs->ci2lmwid;
+    pls = (phone_loop_search_t *)ps_search_lookahead(allphs);
 
     /* Transition from exited nodes to initial states of HMMs */
     for (hist_idx = frame_history_start;
@@ -514,7 +518,9 @@ phmm_trans(allphone_search_t * allphs, int32 best,
             }
 
             newscore = h->score + tscore;
-            if ((newscore > best + allphs->beam)
+            /* Phoneme lookahead only affects pruning, not the score. */
+            if ((newscore + phone_loop_search_score(pls, to->ci)
+                 > best + allphs->beam)
                 && (newscore > hmm_in_score(&(to->hmm)))) {
                 hmm_enter(&(to->hmm), newscore, hist_idx, nf);
             }
@@ -660,8 +666,11 @@ allphone_search_free(ps_search_t * search)
         ngram_model_free(allphs->lm);
     if (allphs->ci2lmwid)
         ckd_free(allphs->ci2lmwid);
-    if (allphs->history)
+    if (allphs->history) {
+        /* History nodes belong to the search arena. */
+        blkarray_list_clear(allphs->history);
         blkarray_list_free(allphs->history);
+    }
 
     ckd_free(allphs);
 }
@@ -687,8 +696,9 @@ allphone_search_start(ps_search_t * search)
     allphs->n_hmm_eval = 0;
     allphs->n_sen_eval = 0;
 
-    /* Free history nodes, if any */
-    blkarray_list_reset(allphs->history);
+    /* Forget history nodes, if any (the decoder has already released
+     * them by resetting the search arena) */
+    blkarray_list_clear(allphs->history);
 
     /* Initialize start state of the SILENCE PHMM */
     allphs->frame = 0;
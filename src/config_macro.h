@@ -142,7 +142,15 @@
 { "pl_weight",                                                         \
       ARG_FLOATING,                                                      \
       "3.0",                                                            \
-      "Weight for phoneme lookahead penalties" }                        \
+      "Weight for phoneme lookahead penalties" },                       \
+{ "pl_search",                                                         \
+      ARG_STRING,                                                        \
+      "ngram",                                                          \
+      "Types of search which use phoneme lookahead (any of ngram, fsg, kws, allphone), each optionally followed by :weight to override -pl_weight" }, \
+{ "pl_cisen",                                                          \
+      ARG_BOOLEAN,                                                       \
+      "yes",                                                            \
+      "Compute only CI senones for phoneme lookahead, even with -compallsen" } \
 
 /** Options defining other parameters for tuning the search. */
 #define POCKETSPHINX_SEARCH_OPTIONS \
@@ -154,6 +162,10 @@
       ARG_BOOLEAN,                                                                              \
       "yes",                                                                                    \
       "Run forward lexicon-tree search (1st pass)" },                                           \
+{ "fwdtreela",                                                                                 \
+      ARG_INTEGER,                                                                              \
+      "0",                                                                                      \
+      "Order of language model lookahead in lexicon-tree search (0 for none, 1 or 2)" },        \
 { "fwdflat",                                                                                   \
       ARG_BOOLEAN,                                                                              \
       "yes",                                                                                    \
@@ -178,10 +190,26 @@
       ARG_INTEGER,                                                                                \
       "30000",                                                                                  \
       "Maximum number of active HMMs to maintain at each frame (or -1 for no pruning)" },       \
+{ "maxrtf",                                                                                    \
+      ARG_FLOATING,                                                                               \
+      "0",                                                                                      \
+      "Maximum real-time factor, degrading search to keep up with it (or 0 for no limit)" },     \
+{ "maxuspf",                                                                                   \
+      ARG_INTEGER,                                                                                \
+      "-1",                                                                                     \
+      "Maximum search time per frame in microseconds, limiting HMMs per frame to meet it (or -1 for no limit)" },\
 { "min_endfr",                                                                                 \
       ARG_INTEGER,                                                                                \
       "0",                                                                                      \
       "Nodes ignored in lattice construction if they persist for fewer than N frames" },        \
+{ "latbeam",                                                                                   \
+      ARG_FLOATING,                                                                             \
+      "0",                                                                                      \
+      "Beam for lattice links relative to the best path (0 for no pruning)" },                  \
+{ "latdensity",                                                                                \
+      ARG_FLOATING,                                                                             \
+      "0",                                                                                      \
+      "Maximum average number of lattice links per frame (0 for no limit)" },                   \
 { "fwdflatefwid",                                                                              \
       ARG_INTEGER,                                                                                \
       "4",                                                                     	                \
@@ -259,6 +287,10 @@
       ARG_STRING,									\
       NULL,									\
       "Which language model in -lmctl to use by default"},				\
+{ "lmindex",										\
+      ARG_BOOLEAN,									\
+      "no",										\
+      "Build an index of language model word IDs for faster lookup (uses more memory)"},	\
 { "lw",										\
       ARG_FLOATING,									\
       "6.5",										\
@@ -40,6 +40,8 @@
 #include "util/pio.h"
 #include "util/ckd_alloc.h"
 #include "util/strfuncs.h"
+#include "util/case.h"
+#include "util/byteorder.h"
 #include "dict.h"
 
 
@@ -73,6 +75,170 @@ dict_ciphone_str(dict_t * d, s3wid_t wid, int32 pos)
 }
 
 
+/*
+ * Minimal perfect hash for binary dictionaries, using the "hash,
+ * displace, and compress" scheme of Belazzougui, Botelho and
+ * Dietzfelbinger (without the compress part).  Words are divided
+ * into buckets of about DICT_MPH_LOAD entries, and each bucket gets
+ * a displacement such that all its words land on distinct free
+ * slots.  Lookup is then a single hash computation and string
+ * comparison.
+ */
+#define DICT_MPH_LOAD	4
+#define DICT_MPH_MAX_SALT	32
+#define DICT_MPH_MAX_D0	64
+
+static void
+dict_mph_hash(char const *word, uint32 salt, int nocase, uint32 *h)
+{
+    uint64 x = 14695981039346656037ULL ^ salt;
+
+    /* FNV-1a followed by the splitmix64 finalizer. */
+    for (; *word; ++word) {
+        unsigned char c = nocase ? UPPER_CASE(*word) : *word;
+        x = (x ^ c) * 1099511628211ULL;
+    }
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    h[0] = (uint32)x;
+    h[1] = (uint32)(x >> 32);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 31;
+    h[2] = (uint32)x;
+}
+
+static uint32
+dict_mph_slot(uint32 const *h, uint32 seed, uint32 m)
+{
+    uint64 d0 = seed / m, d1 = seed % m;
+    uint64 h2 = (m > 1) ? h[2] % (m - 1) + 1 : 0;
+    return (uint32)((h[1] % m + d0 * h2 + d1) % m);
+}
+
+static s3wid_t
+dict_mph_lookup(dict_t *d, const char *word)
+{
+    uint32 h[3];
+    s3wid_t w;
+
+    if (d->n_bin_word == 0)
+        return BAD_S3WID;
+    dict_mph_hash(word, d->mph_salt, d->nocase, h);
+    w = d->mph_slot[dict_mph_slot(h, d->mph_seed[h[0] % d->mph_nbucket],
+                                  d->n_bin_word)];
+    if ((d->nocase ? strcmp_nocase(word, d->word[w].word)
+         : strcmp(word, d->word[w].word)) != 0)
+        return BAD_S3WID;
+    return w;
+}
+
+/**
+ * Build a minimal perfect hash over all words in d.  Returns 0 for
+ * success, -1 if no suitable salt was found (in practice this means
+ * there are duplicate words).
+ */
+static int
+dict_mph_build(dict_t *d, uint32 *out_salt, int32 *out_nbucket,
+               uint32 **out_seed, int32 **out_slot)
+{
+    uint32 m = d->n_word, nb = d->n_word / DICT_MPH_LOAD + 1;
+    uint32 *hash, *seed, *bstart, *order, *border, *sizecount, *slots;
+    uint32 max_seed, salt, i, maxsize;
+    int32 *slot;
+
+    max_seed = (UINT32_MAX / m < DICT_MPH_MAX_D0)
+        ? UINT32_MAX : m * DICT_MPH_MAX_D0;
+    hash = ckd_calloc(m * 3, sizeof(*hash));
+    seed = ckd_calloc(nb, sizeof(*seed));
+    slot = ckd_calloc(m, sizeof(*slot));
+    bstart = ckd_calloc(nb + 1, sizeof(*bstart));
+    order = ckd_calloc(m, sizeof(*order));
+    border = ckd_calloc(nb, sizeof(*border));
+    slots = ckd_calloc(m, sizeof(*slots));
+
+    for (salt = 0; salt < DICT_MPH_MAX_SALT; ++salt) {
+        uint32 b;
+
+        /* Sort words by bucket. */
+        memset(bstart, 0, (nb + 1) * sizeof(*bstart));
+        for (i = 0; i < m; ++i) {
+            dict_mph_hash(d->word[i].word, salt, d->nocase, hash + i * 3);
+            ++bstart[hash[i * 3] % nb + 1];
+        }
+        maxsize = 0;
+        for (b = 0; b < nb; ++b) {
+            if (bstart[b + 1] > maxsize)
+                maxsize = bstart[b + 1];
+            bstart[b + 1] += bstart[b];
+        }
+        memcpy(border, bstart, nb * sizeof(*border));
+        for (i = 0; i < m; ++i)
+            order[border[hash[i * 3] % nb]++] = i;
+
+        /* Sort buckets by decreasing size. */
+        sizecount = ckd_calloc(maxsize + 2, sizeof(*sizecount));
+        for (b = 0; b < nb; ++b)
+            ++sizecount[maxsize - (bstart[b + 1] - bstart[b]) + 1];
+        for (i = 1; i <= maxsize + 1; ++i)
+            sizecount[i] += sizecount[i - 1];
+        for (b = 0; b < nb; ++b)
+            border[sizecount[maxsize - (bstart[b + 1] - bstart[b])]++] = b;
+        ckd_free(sizecount);
+
+        /* Find a displacement for each bucket. */
+        for (i = 0; i < m; ++i)
+            slot[i] = BAD_S3WID;
+        for (i = 0; i < nb; ++i) {
+            uint32 s, j, k, bsize;
+
+            b = border[i];
+            bsize = bstart[b + 1] - bstart[b];
+            if (bsize == 0)
+                break;
+            for (s = 0; s < max_seed; ++s) {
+                for (j = 0; j < bsize; ++j) {
+                    uint32 w = order[bstart[b] + j];
+                    slots[j] = dict_mph_slot(hash + w * 3, s, m);
+                    if (IS_S3WID(slot[slots[j]]))
+                        break;
+                    for (k = 0; k < j; ++k)
+                        if (slots[k] == slots[j])
+                            break;
+                    if (k < j)
+                        break;
+                }
+                if (j == bsize)
+                    break;
+            }
+            if (s == max_seed)
+                break;
+            seed[b] = s;
+            for (j = 0; j < bsize; ++j)
+                slot[slots[j]] = order[bstart[b] + j];
+        }
+        if (i == nb || bstart[border[i] + 1] == bstart[border[i]])
+            break;
+        E_INFO("Perfect hash failed with salt %u, retrying\n", salt);
+    }
+    ckd_free(hash);
+    ckd_free(bstart);
+    ckd_free(order);
+    ckd_free(border);
+    ckd_free(slots);
+    if (salt == DICT_MPH_MAX_SALT) {
+        E_ERROR("Failed to build perfect hash for %d words\n", m);
+        ckd_free(seed);
+        ckd_free(slot);
+        return -1;
+    }
+    *out_salt = salt;
+    *out_nbucket = nb;
+    *out_seed = seed;
+    *out_slot = slot;
+    return 0;
+}
+
 s3wid_t
 dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
 {
@@ -100,7 +266,7 @@ dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
         int32 w;
 
         /* Truncated to a baseword string; find its ID */
-        if (hash_table_lookup_int32(d->ht, wword, &w) < 0) {
+        if (NOT_S3WID(w = dict_wordid(d, wword))) {
             E_ERROR("Missing base word for: %s\n", word);
             ckd_free(wword);
             ckd_free(wordp->word);
@@ -119,7 +285,8 @@ dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
     ckd_free(wword);
 
     /* Associate word string with d->n_word in hash table */
-    if (hash_table_enter_int32(d->ht, wordp->word, d->n_word) != d->n_word) {
+    if (IS_S3WID(dict_mph_lookup(d, wordp->word))
+        || hash_table_enter_int32(d->ht, wordp->word, d->n_word) != d->n_word) {
         ckd_free(wordp->word);
         wordp->word = NULL;
         return BAD_S3WID;
@@ -214,13 +381,409 @@ dict_read(FILE * fp, dict_t * d)
     return 0;
 }
 
+void
+dict_context_sets(dict_t *d, s3wid_t start, int32 n_ciphone,
+                  bitvec_t *ldiph, bitvec_t *rdiph, bitvec_t *single)
+{
+    s3wid_t w;
+
+    for (w = start; w < dict_size(d); ++w) {
+        if (dict_pronlen(d, w) >= 2) {
+            bitvec_set(ldiph, dict_first_phone(d, w) * n_ciphone
+                       + dict_second_phone(d, w));
+            bitvec_set(rdiph, dict_last_phone(d, w) * n_ciphone
+                       + dict_second_last_phone(d, w));
+        }
+        else if (dict_pronlen(d, w) == 1)
+            bitvec_set(single, dict_first_phone(d, w));
+    }
+}
+
+#define DICT_BIN_MAGIC		"PSDICTB"
+#define DICT_BIN_NATIVE_ENDIAN	0x46444344 /* 'FDCD' in little-endian order */
+#define DICT_BIN_OTHER_ENDIAN	0x44434446 /* 'DCDF' in little-endian order */
+#define DICT_BIN_FORMAT_VERSION	1
+
+static const char dict_bin_format_desc[] =
+    "BEGIN FILE FORMAT DESCRIPTION\n"
+    "int32 n_word;       /**< Number of words (including fillers) */\n"
+    "int32 filler_start; /**< First filler word ID */\n"
+    "int32 filler_end;   /**< Last filler word ID */\n"
+    "int32 nocase;       /**< Word strings are case-insensitive */\n"
+    "int32 n_ciphone;    /**< Number of CI phones */\n"
+    "int32 mph_salt;     /**< Salt for perfect hash function */\n"
+    "int32 mph_nbucket;  /**< Number of perfect hash buckets */\n"
+    "int32 n_phone;      /**< Total length of all pronunciations */\n"
+    "int32 strtab_size;  /**< Size of word string table */\n"
+    "char ciphones[][];  /**< CI phone strings (null-terminated) */\n"
+    "char padding[];     /**< Padding to a 4-bytes boundary */\n"
+    "int32 word[n_word]; /**< Offset of each word in string table */\n"
+    "int32 pron[n_word + 1]; /**< Offset of each pronunciation */\n"
+    "int32 alt[n_word];  /**< Next alternative pronunciation */\n"
+    "int32 basewid[n_word]; /**< Base pronunciation */\n"
+    "int32 mph_seed[mph_nbucket]; /**< Perfect hash displacements */\n"
+    "int32 mph_slot[n_word]; /**< Word ID for each hash slot */\n"
+    "int32 ldiph[], rdiph[], single[]; /**< Diphone context bit vectors */\n"
+    "int16 phones[n_phone]; /**< Pronunciations */\n"
+    "char padding[];     /**< Padding to a 4-bytes boundary */\n"
+    "char strtab[strtab_size]; /**< Word strings (null-terminated) */\n"
+    "END FILE FORMAT DESCRIPTION\n";
+
+static int
+dict_write_bin(dict_t *d, char const *filename)
+{
+    FILE *fh;
+    int32 *slot, *off, nbucket, val, n_ci, n_phone, strtab_size, i;
+    uint32 salt, *seed;
+    bitvec_t *ldiph, *rdiph, *single;
+    size_t pad;
+
+    if (d->mdef == NULL) {
+        E_ERROR("Binary dictionary requires a model definition\n");
+        return -1;
+    }
+    if (dict_mph_build(d, &salt, &nbucket, &seed, &slot) < 0)
+        return -1;
+    if ((fh = fopen(filename, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open '%s'", filename);
+        ckd_free(seed);
+        ckd_free(slot);
+        return -1;
+    }
+    n_ci = bin_mdef_n_ciphone(d->mdef);
+    off = NULL;
+    ldiph = rdiph = single = NULL;
+
+    if (fwrite(DICT_BIN_MAGIC, 1, sizeof(DICT_BIN_MAGIC), fh)
+        != sizeof(DICT_BIN_MAGIC))
+        goto error_out;
+    val = DICT_BIN_NATIVE_ENDIAN;
+    if (fwrite(&val, 4, 1, fh) != 1)
+        goto error_out;
+    val = DICT_BIN_FORMAT_VERSION;
+    if (fwrite(&val, 4, 1, fh) != 1)
+        goto error_out;
+    /* Round the format descriptor size up to a 4-byte boundary. */
+    val = ((sizeof(dict_bin_format_desc) + 3) & ~3);
+    if (fwrite(&val, 4, 1, fh) != 1)
+        goto error_out;
+    if (fwrite(dict_bin_format_desc, 1, sizeof(dict_bin_format_desc), fh)
+        != sizeof(dict_bin_format_desc))
+        goto error_out;
+    i = 0;
+    if (fwrite(&i, 1, val - sizeof(dict_bin_format_desc), fh)
+        != val - sizeof(dict_bin_format_desc))
+        goto error_out;
+
+    n_phone = strtab_size = 0;
+    for (i = 0; i < d->n_word; ++i) {
+        n_phone += d->word[i].pronlen;
+        strtab_size += strlen(d->word[i].word) + 1;
+    }
+    val = d->nocase;
+    if (fwrite(&d->n_word, 4, 1, fh) != 1
+        || fwrite(&d->filler_start, 4, 1, fh) != 1
+        || fwrite(&d->filler_end, 4, 1, fh) != 1
+        || fwrite(&val, 4, 1, fh) != 1
+        || fwrite(&n_ci, 4, 1, fh) != 1
+        || fwrite(&salt, 4, 1, fh) != 1
+        || fwrite(&nbucket, 4, 1, fh) != 1
+        || fwrite(&n_phone, 4, 1, fh) != 1
+        || fwrite(&strtab_size, 4, 1, fh) != 1)
+        goto error_out;
+
+    /* Phone strings, so we can check them against the mdef. */
+    for (i = 0; i < n_ci; ++i) {
+        const char *ciname = bin_mdef_ciphone_str(d->mdef, i);
+        if (fwrite(ciname, 1, strlen(ciname) + 1, fh) != strlen(ciname) + 1)
+            goto error_out;
+    }
+    pad = ((ftell(fh) + 3) & ~3) - ftell(fh);
+    i = 0;
+    if (fwrite(&i, 1, pad, fh) != pad)
+        goto error_out;
+
+    /* Word entries. */
+    off = ckd_calloc(d->n_word + 1, sizeof(*off));
+    for (val = i = 0; i < d->n_word; ++i) {
+        off[i] = val;
+        val += strlen(d->word[i].word) + 1;
+    }
+    if (fwrite(off, 4, d->n_word, fh) != (size_t)d->n_word)
+        goto error_out;
+    for (val = i = 0; i < d->n_word; ++i) {
+        off[i] = val;
+        val += d->word[i].pronlen;
+    }
+    off[i] = val;
+    if (fwrite(off, 4, d->n_word + 1, fh) != (size_t)d->n_word + 1)
+        goto error_out;
+    for (i = 0; i < d->n_word; ++i)
+        if (fwrite(&d->word[i].alt, 4, 1, fh) != 1)
+            goto error_out;
+    for (i = 0; i < d->n_word; ++i)
+        if (fwrite(&d->word[i].basewid, 4, 1, fh) != 1)
+            goto error_out;
+
+    /* Perfect hash. */
+    if (fwrite(seed, 4, nbucket, fh) != (size_t)nbucket
+        || fwrite(slot, 4, d->n_word, fh) != (size_t)d->n_word)
+        goto error_out;
+
+    /* Diphone contexts for dict2pid. */
+    ldiph = bitvec_alloc(n_ci * n_ci);
+    rdiph = bitvec_alloc(n_ci * n_ci);
+    single = bitvec_alloc(n_ci);
+    dict_context_sets(d, 0, n_ci, ldiph, rdiph, single);
+    if (fwrite(ldiph, sizeof(bitvec_t), bitvec_size(n_ci * n_ci), fh)
+        != (size_t)bitvec_size(n_ci * n_ci)
+        || fwrite(rdiph, sizeof(bitvec_t), bitvec_size(n_ci * n_ci), fh)
+        != (size_t)bitvec_size(n_ci * n_ci)
+        || fwrite(single, sizeof(bitvec_t), bitvec_size(n_ci), fh)
+        != (size_t)bitvec_size(n_ci))
+        goto error_out;
+
+    /* Pronunciations and strings. */
+    for (i = 0; i < d->n_word; ++i)
+        if (fwrite(d->word[i].ciphone, sizeof(s3cipid_t),
+                   d->word[i].pronlen, fh) != (size_t)d->word[i].pronlen)
+            goto error_out;
+    pad = ((ftell(fh) + 3) & ~3) - ftell(fh);
+    i = 0;
+    if (fwrite(&i, 1, pad, fh) != pad)
+        goto error_out;
+    for (i = 0; i < d->n_word; ++i)
+        if (fwrite(d->word[i].word, 1, strlen(d->word[i].word) + 1, fh)
+            != strlen(d->word[i].word) + 1)
+            goto error_out;
+
+    ckd_free(off);
+    ckd_free(seed);
+    ckd_free(slot);
+    bitvec_free(ldiph);
+    bitvec_free(rdiph);
+    bitvec_free(single);
+    if (fclose(fh) != 0) {
+        E_ERROR_SYSTEM("Failed to write binary dictionary '%s'", filename);
+        remove(filename);
+        return -1;
+    }
+    E_INFO("Wrote %d words to binary dictionary %s\n", d->n_word, filename);
+    return 0;
+
+error_out:
+    E_ERROR_SYSTEM("Failed to write binary dictionary '%s'", filename);
+    ckd_free(off);
+    ckd_free(seed);
+    ckd_free(slot);
+    bitvec_free(ldiph);
+    bitvec_free(rdiph);
+    bitvec_free(single);
+    fclose(fh);
+    remove(filename);
+    return -1;
+}
+
+static int
+dict_is_bin(char const *filename)
+{
+    FILE *fh;
+    char magic[sizeof(DICT_BIN_MAGIC)];
+    int rv = FALSE;
+
+    if ((fh = fopen(filename, "rb")) == NULL)
+        return FALSE;
+    if (fread(magic, 1, sizeof(magic), fh) == sizeof(magic)
+        && 0 == memcmp(magic, DICT_BIN_MAGIC, sizeof(magic)))
+        rv = TRUE;
+    fclose(fh);
+    return rv;
+}
+
+static dict_t *
+dict_read_bin(ps_config_t *config, bin_mdef_t *mdef, char const *filename)
+{
+    FILE *fh;
+    dict_t *d;
+    char magic[sizeof(DICT_BIN_MAGIC)];
+    int32 hdr[9], val, swap, do_mmap, n_ci, n_phone, strtab_size, i;
+    int32 const *word_off, *pron_off, *alt, *basewid;
+    long pos, end;
+    char *base, *data, *strtab;
+    s3cipid_t *phones;
+
+    E_INFO("Reading binary dictionary: %s\n", filename);
+    if ((fh = fopen(filename, "rb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open dictionary file '%s' for reading", filename);
+        return NULL;
+    }
+    if (fread(magic, 1, sizeof(magic), fh) != sizeof(magic)
+        || fread(&val, 4, 1, fh) != 1) {
+        E_ERROR_SYSTEM("Failed to read header from %s", filename);
+        fclose(fh);
+        return NULL;
+    }
+    swap = 0;
+    if (val == DICT_BIN_OTHER_ENDIAN) {
+        swap = 1;
+        E_INFO("Must byte-swap %s\n", filename);
+    }
+    if (fread(&val, 4, 1, fh) != 1) {
+        E_ERROR_SYSTEM("Failed to read version from %s", filename);
+        fclose(fh);
+        return NULL;
+    }
+    if (swap)
+        SWAP_INT32(&val);
+    if (val > DICT_BIN_FORMAT_VERSION) {
+        E_ERROR("File format version %d for %s is newer than library\n",
+                val, filename);
+        fclose(fh);
+        return NULL;
+    }
+    if (fread(&val, 4, 1, fh) != 1) {
+        E_ERROR_SYSTEM("Failed to read header length from %s", filename);
+        fclose(fh);
+        return NULL;
+    }
+    if (swap)
+        SWAP_INT32(&val);
+    /* Skip format descriptor. */
+    fseek(fh, val, SEEK_CUR);
+    if (fread(hdr, 4, 9, fh) != 9) {
+        E_ERROR_SYSTEM("Failed to read header from %s", filename);
+        fclose(fh);
+        return NULL;
+    }
+    if (swap) {
+        for (i = 0; i < 9; ++i)
+            SWAP_INT32(hdr + i);
+    }
+    n_ci = hdr[4];
+    n_phone = hdr[7];
+    strtab_size = hdr[8];
+    if (mdef && n_ci != bin_mdef_n_ciphone(mdef)) {
+        E_ERROR("Binary dictionary %s has %d CI phones, model has %d\n",
+                filename, n_ci, bin_mdef_n_ciphone(mdef));
+        fclose(fh);
+        return NULL;
+    }
+
+    d = ckd_calloc(1, sizeof(*d));
+    d->refcnt = 1;
+    d->n_word = d->n_bin_word = hdr[0];
+    d->filler_start = hdr[1];
+    d->filler_end = hdr[2];
+    d->nocase = hdr[3];
+    d->mph_salt = hdr[5];
+    d->mph_nbucket = hdr[6];
+    if (config && d->nocase != ps_config_bool(config, "dictcase"))
+        E_WARN("Binary dictionary %s was written with -dictcase %s\n",
+               filename, d->nocase ? "yes" : "no");
+    if (mdef)
+        d->mdef = bin_mdef_retain(mdef);
+
+    /* Decide whether to read in the whole file or mmap it. */
+    do_mmap = config ? ps_config_bool(config, "mmap") : TRUE;
+    if (do_mmap && swap) {
+        E_WARN("-mmap specified, but %s is other-endian.  Will not memory-map.\n",
+               filename);
+        do_mmap = FALSE;
+    }
+    if (do_mmap) {
+        if ((d->filemap = mmio_file_read(filename)) == NULL)
+            E_ERROR_SYSTEM("-mmap specified, but memory mapping of %s failed",
+                           filename);
+    }
+    pos = ftell(fh);
+    fseek(fh, 0, SEEK_END);
+    end = ftell(fh);
+    fseek(fh, pos, SEEK_SET);
+    if (d->filemap)
+        data = (char *)mmio_file_ptr(d->filemap) + pos;
+    else {
+        d->bindata = data = ckd_malloc(end - pos);
+        if (fread(data, 1, end - pos, fh) != (size_t)(end - pos)) {
+            E_ERROR_SYSTEM("Failed to read %ld bytes of data from %s",
+                           end - pos, filename);
+            fclose(fh);
+            dict_free(d);
+            return NULL;
+        }
+    }
+    fclose(fh);
+    base = data;
+
+    /* Check the phone set. */
+    for (i = 0; i < n_ci; ++i) {
+        if (mdef && 0 != strcmp(data, bin_mdef_ciphone_str(mdef, i))) {
+            E_ERROR("CI phone %d in %s is %s, model has %s\n",
+                    i, filename, data, bin_mdef_ciphone_str(mdef, i));
+            dict_free(d);
+            return NULL;
+        }
+        data += strlen(data) + 1;
+    }
+    data = (char *)(((size_t)data + 3) & ~(size_t)3);
+
+    /* Locate everything. */
+    word_off = (int32 const *)data;
+    pron_off = word_off + d->n_word;
+    alt = pron_off + d->n_word + 1;
+    basewid = alt + d->n_word;
+    d->mph_seed = (uint32 const *)(basewid + d->n_word);
+    d->mph_slot = (int32 const *)(d->mph_seed + d->mph_nbucket);
+    d->ldiph = (bitvec_t const *)(d->mph_slot + d->n_word);
+    d->rdiph = d->ldiph + bitvec_size(n_ci * n_ci);
+    d->single = d->rdiph + bitvec_size(n_ci * n_ci);
+    phones = (s3cipid_t *)(d->single + bitvec_size(n_ci));
+    strtab = (char *)(((size_t)(phones + n_phone) + 3) & ~(size_t)3);
+    if (strtab + strtab_size - base > end - pos) {
+        E_ERROR("Binary dictionary %s is truncated\n", filename);
+        dict_free(d);
+        return NULL;
+    }
+    if (swap) {
+        int32 *ptr;
+        for (ptr = (int32 *)word_off; ptr < (int32 *)phones; ++ptr)
+            SWAP_INT32(ptr);
+        for (i = 0; i < n_phone; ++i)
+            SWAP_INT16(phones + i);
+    }
+
+    /* Word entries point into the binary data, no need to copy. */
+    d->max_words = d->n_word + S3DICT_INC_SZ;
+    d->word = ckd_calloc(d->max_words, sizeof(*d->word));
+    for (i = 0; i < d->n_word; ++i) {
+        dictword_t *wordp = d->word + i;
+        wordp->word = strtab + word_off[i];
+        wordp->pronlen = pron_off[i + 1] - pron_off[i];
+        wordp->ciphone = wordp->pronlen ? phones + pron_off[i] : NULL;
+        wordp->alt = alt[i];
+        wordp->basewid = basewid[i];
+    }
+    /* Only words added later go in the hash table. */
+    d->ht = hash_table_new(S3DICT_INC_SZ, d->nocase);
+    d->startwid = dict_wordid(d, S3_START_WORD);
+    d->finishwid = dict_wordid(d, S3_FINISH_WORD);
+    d->silwid = dict_wordid(d, S3_SILENCE_WORD);
+    E_INFO("%d words read\n", d->n_word);
+
+    return d;
+}
+
 int
 dict_write(dict_t *dict, char const *filename, char const *format)
 {
     FILE *fh;
     int i;
 
-    (void)format; /* FIXME */
+    if (format && 0 == strcmp(format, "bin"))
+        return dict_write_bin(dict, filename);
+    if (format && 0 != strcmp(format, "text")) {
+        E_ERROR("Unknown dictionary format '%s'\n", format);
+        return -1;
+    }
     if ((fh = fopen(filename, "w")) == NULL) {
         E_ERROR_SYSTEM("Failed to open '%s'", filename);
         return -1;
@@ -267,6 +830,14 @@ dict_init(ps_config_t *config, bin_mdef_t * mdef)
         fillerfile = ps_config_str(config, "fdict");
     }
 
+    /* Binary dictionaries already contain the filler words. */
+    if (dictfile && dict_is_bin(dictfile)) {
+        if (fillerfile)
+            E_INFO("Ignoring filler dictionary %s for binary dictionary\n",
+                   fillerfile);
+        return dict_read_bin(config, mdef, dictfile);
+    }
+
     /*
      * First obtain #words in dictionary (for hash table allocation).
      * Reason: The PC NT system doesn't like to grow memory gradually.  Better to allocate
@@ -407,6 +978,8 @@ dict_wordid(dict_t *d, const char *word)
     assert(d);
     assert(word);
 
+    if (IS_S3WID(w = dict_mph_lookup(d, word)))
+        return w;
     if (hash_table_lookup_int32(d->ht, word, &w) < 0)
         return (BAD_S3WID);
     return w;
@@ -479,8 +1052,9 @@ dict_free(dict_t * d)
     if (--d->refcnt > 0)
         return d->refcnt;
 
-    /* First Step, free all memory allocated for each word */
-    for (i = 0; i < d->n_word; i++) {
+    /* First Step, free all memory allocated for each word (except
+     * those in the binary dictionary) */
+    for (i = d->n_bin_word; i < d->n_word; i++) {
         word = (dictword_t *) & (d->word[i]);
         if (word->word)
             ckd_free((void *) word->word);
@@ -494,6 +1068,9 @@ dict_free(dict_t * d)
         hash_table_free(d->ht);
     if (d->mdef)
         bin_mdef_free(d->mdef);
+    if (d->filemap)
+        mmio_file_unmap(d->filemap);
+    ckd_free(d->bindata);
     ckd_free((void *) d);
 
     return 0;
@@ -47,6 +47,8 @@
 #include "s3types.h"
 #include "bin_mdef.h"
 #include "util/hash_table.h"
+#include "util/mmio.h"
+#include "util/bitvec.h"
 #include "pocketsphinx/export.h"
 
 #define S3DICT_INC_SZ 4096
@@ -88,6 +90,18 @@ typedef struct dict_s {
     s3wid_t finishwid;	/**< FOR INTERNAL-USE ONLY */
     s3wid_t silwid;	/**< FOR INTERNAL-USE ONLY */
     int nocase;
+
+    /* Binary dictionary data (words 0..n_bin_word-1 point into it) */
+    mmio_file_t *filemap;	/**< Memory-mapped binary dictionary, or NULL */
+    void *bindata;		/**< Binary dictionary read into memory, or NULL */
+    int32 n_bin_word;		/**< #Entries whose strings and phones live in binary data */
+    uint32 mph_salt;		/**< Hash salt for minimal perfect hash */
+    int32 mph_nbucket;		/**< Number of buckets in minimal perfect hash */
+    uint32 const *mph_seed;	/**< Displacement for each bucket */
+    int32 const *mph_slot;	/**< Word ID for each hash slot */
+    bitvec_t const *ldiph;	/**< Precomputed word-initial diphones (first, second) */
+    bitvec_t const *rdiph;	/**< Precomputed word-final diphones (last, second-last) */
+    bitvec_t const *single;	/**< Precomputed single-phone word phones */
 } dict_t;
 
 
@@ -108,9 +122,28 @@ dict_t *dict_init(ps_config_t *config, /**< Configuration (-dict, -fdict, -dictc
 
 /**
  * Write dictionary to a file.
+ *
+ * If format is "bin", a binary dictionary is written, which contains
+ * all words (including fillers), a minimal perfect hash for word
+ * lookup, and the diphone contexts needed by dict2pid_build().  It
+ * can be memory-mapped by dict_init() (it is detected automatically
+ * when passed as -dict) and requires the same CI phone set.
+ * Otherwise (format is NULL or "text") only the real words are
+ * written in the standard text format.
  */
 int dict_write(dict_t *dict, char const *filename, char const *format);
 
+/**
+ * Find the diphone contexts used by words in a dictionary.
+ *
+ * For each word from start onwards, sets bit (first * n_ciphone +
+ * second) in ldiph and (last * n_ciphone + second_last) in rdiph
+ * for multi-phone words, and bit (phone) in single for single-phone
+ * words.  Bits already set are left alone.
+ */
+void dict_context_sets(dict_t *d, s3wid_t start, int32 n_ciphone,
+                       bitvec_t *ldiph, bitvec_t *rdiph, bitvec_t *single);
+
 /** Return word id for given word string if present.  Otherwise return BAD_S3WID */
 POCKETSPHINX_EXPORT
 s3wid_t dict_wordid(dict_t *d, const char *word);
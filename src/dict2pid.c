@@ -80,125 +80,6 @@ compress_table(s3ssid_t * uncomp_tab, s3ssid_t * com_tab,
 }
 
 
-static void
-compress_right_context_tree(dict2pid_t * d2p,
-                            s3ssid_t ***rdiph_rc)
-{
-    int32 n_ci;
-    int32 b, l, r;
-    s3ssid_t *rmap;
-    s3ssid_t *tmpssid;
-    s3cipid_t *tmpcimap;
-    bin_mdef_t *mdef = d2p->mdef;
-    size_t alloc;
-
-    n_ci = mdef->n_ciphone;
-
-    tmpssid = ckd_calloc(n_ci, sizeof(s3ssid_t));
-    tmpcimap = ckd_calloc(n_ci, sizeof(s3cipid_t));
-
-    d2p->rssid =
-        (xwdssid_t **) ckd_calloc(mdef->n_ciphone, sizeof(xwdssid_t *));
-    alloc = mdef->n_ciphone * sizeof(xwdssid_t *);
-
-    for (b = 0; b < n_ci; b++) {
-        d2p->rssid[b] =
-            (xwdssid_t *) ckd_calloc(mdef->n_ciphone, sizeof(xwdssid_t));
-        alloc += mdef->n_ciphone * sizeof(xwdssid_t);
-
-        for (l = 0; l < n_ci; l++) {
-            rmap = rdiph_rc[b][l];
-            compress_table(rmap, tmpssid, tmpcimap, mdef->n_ciphone);
-
-            for (r = 0; r < mdef->n_ciphone && tmpssid[r] != BAD_S3SSID;
-                 r++);
-
-            if (tmpssid[0] != BAD_S3SSID) {
-                d2p->rssid[b][l].ssid = ckd_calloc(r, sizeof(s3ssid_t));
-                memcpy(d2p->rssid[b][l].ssid, tmpssid,
-                       r * sizeof(s3ssid_t));
-                d2p->rssid[b][l].cimap =
-                    ckd_calloc(mdef->n_ciphone, sizeof(s3cipid_t));
-                memcpy(d2p->rssid[b][l].cimap, tmpcimap,
-                       (mdef->n_ciphone) * sizeof(s3cipid_t));
-                d2p->rssid[b][l].n_ssid = r;
-            }
-            else {
-                d2p->rssid[b][l].ssid = NULL;
-                d2p->rssid[b][l].cimap = NULL;
-                d2p->rssid[b][l].n_ssid = 0;
-            }
-        }
-    }
-
-    E_INFO("Allocated %d bytes (%d KiB) for word-final triphones\n",
-           (int)alloc, (int)alloc / 1024);
-    ckd_free(tmpssid);
-    ckd_free(tmpcimap);
-}
-
-static void
-compress_left_right_context_tree(dict2pid_t * d2p)
-{
-    int32 n_ci;
-    int32 b, l, r;
-    s3ssid_t *rmap;
-    s3ssid_t *tmpssid;
-    s3cipid_t *tmpcimap;
-    bin_mdef_t *mdef = d2p->mdef;
-    size_t alloc;
-
-    n_ci = mdef->n_ciphone;
-
-    tmpssid = ckd_calloc(n_ci, sizeof(s3ssid_t));
-    tmpcimap = ckd_calloc(n_ci, sizeof(s3cipid_t));
-
-    assert(d2p->lrdiph_rc);
-
-    d2p->lrssid =
-        (xwdssid_t **) ckd_calloc(mdef->n_ciphone, sizeof(xwdssid_t *));
-    alloc = mdef->n_ciphone * sizeof(xwdssid_t *);
-
-    for (b = 0; b < n_ci; b++) {
-
-        d2p->lrssid[b] =
-            (xwdssid_t *) ckd_calloc(mdef->n_ciphone, sizeof(xwdssid_t));
-        alloc += mdef->n_ciphone * sizeof(xwdssid_t);
-
-        for (l = 0; l < n_ci; l++) {
-            rmap = d2p->lrdiph_rc[b][l];
-
-            compress_table(rmap, tmpssid, tmpcimap, mdef->n_ciphone);
-
-            for (r = 0; r < mdef->n_ciphone && tmpssid[r] != BAD_S3SSID;
-                 r++);
-
-            if (tmpssid[0] != BAD_S3SSID) {
-                d2p->lrssid[b][l].ssid = ckd_calloc(r, sizeof(s3ssid_t));
-                memcpy(d2p->lrssid[b][l].ssid, tmpssid,
-                       r * sizeof(s3ssid_t));
-                d2p->lrssid[b][l].cimap =
-                    ckd_calloc(mdef->n_ciphone, sizeof(s3cipid_t));
-                memcpy(d2p->lrssid[b][l].cimap, tmpcimap,
-                       (mdef->n_ciphone) * sizeof(s3cipid_t));
-                d2p->lrssid[b][l].n_ssid = r;
-            }
-            else {
-                d2p->lrssid[b][l].ssid = NULL;
-                d2p->lrssid[b][l].cimap = NULL;
-                d2p->lrssid[b][l].n_ssid = 0;
-            }
-        }
-    }
-
-    /* Try to compress lrdiph_rc into lrdiph_rc_compressed */
-    ckd_free(tmpssid);
-    ckd_free(tmpcimap);
-
-    E_INFO("Allocated %d bytes (%d KiB) for single-phone word triphones\n",
-           (int)alloc, (int)alloc / 1024);
-}
-
 /**
    ARCHAN, A duplicate of get_rc_npid in ctxt_table.h.  I doubt whether it is correct
    because the compressed map has not been checked. 
@@ -261,32 +142,103 @@ free_compress_map(xwdssid_t ** tree, int32 n_ci)
             ckd_free(tree[b][l].ssid);
             ckd_free(tree[b][l].cimap);
         }
-        ckd_free(tree[b]);
     }
-    ckd_free(tree);
+    ckd_free_2d(tree);
+}
+
+/**
+ * Compress a right context map into an xwdssid_t, replacing
+ * whatever was there.
+ */
+static void
+fill_xwdssid(xwdssid_t *xwd, s3ssid_t *rmap, int32 n_ci)
+{
+    int32 r;
+
+    ckd_free(xwd->ssid);
+    ckd_free(xwd->cimap);
+    xwd->ssid = ckd_calloc(n_ci, sizeof(*xwd->ssid));
+    xwd->cimap = ckd_calloc(n_ci, sizeof(*xwd->cimap));
+    compress_table(rmap, xwd->ssid, xwd->cimap, n_ci);
+    for (r = 0; r < n_ci && xwd->ssid[r] != BAD_S3SSID; r++)
+        ;
+    xwd->n_ssid = r;
+}
+
+/**
+ * Fill in word-initial triphones b(?,r) for multi-phone words.
+ */
+static void
+populate_ldiph(dict2pid_t *d2p, s3cipid_t b, s3cipid_t r)
+{
+    bin_mdef_t *mdef = d2p->mdef;
+    int32 n_ci = bin_mdef_n_ciphone(mdef);
+    s3cipid_t l;
+
+    if (bitvec_is_set(d2p->ldiph_done, b * n_ci + r))
+        return;
+    E_DEBUG("Filling in left-context diphones for %s(?,%s)\n",
+            bin_mdef_ciphone_str(mdef, b), bin_mdef_ciphone_str(mdef, r));
+    for (l = 0; l < n_ci; l++) {
+        s3pid_t p = bin_mdef_phone_id_nearest(mdef, b, l, r,
+                                              WORD_POSN_BEGIN);
+        d2p->ldiph_lc[b][r][l] = bin_mdef_pid2ssid(mdef, p);
+    }
+    bitvec_set(d2p->ldiph_done, b * n_ci + r);
 }
 
+/**
+ * Fill in word-final triphones b(l,?) for multi-phone words.
+ */
 static void
-populate_lrdiph(dict2pid_t *d2p, s3ssid_t ***rdiph_rc, s3cipid_t b)
+populate_rdiph(dict2pid_t *d2p, s3cipid_t b, s3cipid_t l)
 {
     bin_mdef_t *mdef = d2p->mdef;
-    s3cipid_t l, r;
+    int32 n_ci = bin_mdef_n_ciphone(mdef);
+    s3ssid_t *rmap;
+    s3cipid_t r;
 
-    for (l = 0; l < bin_mdef_n_ciphone(mdef); l++) {
-        for (r = 0; r < bin_mdef_n_ciphone(mdef); r++) {
+    if (bitvec_is_set(d2p->rdiph_done, b * n_ci + l))
+        return;
+    E_DEBUG("Filling in right-context diphones for %s(%s,?)\n",
+            bin_mdef_ciphone_str(mdef, b), bin_mdef_ciphone_str(mdef, l));
+    rmap = ckd_calloc(n_ci, sizeof(*rmap));
+    for (r = 0; r < n_ci; r++) {
+        s3pid_t p = bin_mdef_phone_id_nearest(mdef, b, l, r,
+                                              WORD_POSN_END);
+        rmap[r] = bin_mdef_pid2ssid(mdef, p);
+    }
+    fill_xwdssid(&d2p->rssid[b][l], rmap, n_ci);
+    ckd_free(rmap);
+    bitvec_set(d2p->rdiph_done, b * n_ci + l);
+}
+
+/**
+ * Fill in left and right context triphones b(?,?) for single-phone
+ * words.  These also provide ldiph_lc[b][sil] (the left context
+ * table used for single-phone words) unless a multi-phone word
+ * already filled it in.
+ */
+static void
+populate_lrdiph(dict2pid_t *d2p, s3cipid_t b)
+{
+    bin_mdef_t *mdef = d2p->mdef;
+    int32 n_ci = bin_mdef_n_ciphone(mdef);
+    s3cipid_t l, r, sil = bin_mdef_silphone(mdef);
+    int set_ldiph;
+
+    if (bitvec_is_set(d2p->single_done, b))
+        return;
+    E_DEBUG("Filling in context triphones for %s(?,?)\n",
+            bin_mdef_ciphone_str(mdef, b));
+    set_ldiph = bitvec_is_clear(d2p->ldiph_done, b * n_ci + sil);
+    for (l = 0; l < n_ci; l++) {
+        for (r = 0; r < n_ci; r++) {
             s3pid_t p;
-            p = bin_mdef_phone_id_nearest(mdef, (s3cipid_t) b,
-                                          (s3cipid_t) l,
-                                          (s3cipid_t) r,
-                                          WORD_POSN_SINGLE);
-            d2p->lrdiph_rc[b][l][r]
-                = bin_mdef_pid2ssid(mdef, p);
-            if (r == bin_mdef_silphone(mdef))
-                d2p->ldiph_lc[b][r][l]
-                    = bin_mdef_pid2ssid(mdef, p);
-            if (rdiph_rc && l == bin_mdef_silphone(mdef))
-                rdiph_rc[b][l][r]
-                    = bin_mdef_pid2ssid(mdef, p);
+            p = bin_mdef_phone_id_nearest(mdef, b, l, r, WORD_POSN_SINGLE);
+            d2p->lrdiph_rc[b][l][r] = bin_mdef_pid2ssid(mdef, p);
+            if (set_ldiph && r == sil)
+                d2p->ldiph_lc[b][r][l] = bin_mdef_pid2ssid(mdef, p);
             assert(IS_S3SSID(bin_mdef_pid2ssid(mdef, p)));
             E_DEBUG("%s(%s,%s) => %d / %d\n",
                     bin_mdef_ciphone_str(mdef, b),
@@ -294,73 +246,27 @@ populate_lrdiph(dict2pid_t *d2p, s3ssid_t ***rdiph_rc, s3cipid_t b)
                     bin_mdef_ciphone_str(mdef, r),
                     p, bin_mdef_pid2ssid(mdef, p));
         }
+        fill_xwdssid(&d2p->lrssid[b][l], d2p->lrdiph_rc[b][l], n_ci);
     }
+    bitvec_set(d2p->single_done, b);
 }
 
 int
 dict2pid_add_word(dict2pid_t *d2p,
                   int32 wid)
 {
-    bin_mdef_t *mdef = d2p->mdef;
     dict_t *d = d2p->dict;
 
     if (dict_pronlen(d, wid) > 1) {
-        s3cipid_t l;
         /* Make sure we have left and right context diphones for this
          * word. */
-        if (d2p->ldiph_lc[dict_first_phone(d, wid)][dict_second_phone(d, wid)][0]
-            == BAD_S3SSID) {
-            E_DEBUG("Filling in left-context diphones for %s(?,%s)\n",
-                   bin_mdef_ciphone_str(mdef, dict_first_phone(d, wid)),
-                   bin_mdef_ciphone_str(mdef, dict_second_phone(d, wid)));
-            for (l = 0; l < bin_mdef_n_ciphone(mdef); l++) {
-                int p
-                    = bin_mdef_phone_id_nearest(mdef,
-                                                dict_first_phone(d, wid), l,
-                                                dict_second_phone(d, wid),
-                                                WORD_POSN_BEGIN);
-                d2p->ldiph_lc[dict_first_phone(d, wid)][dict_second_phone(d, wid)][l]
-                    = bin_mdef_pid2ssid(mdef, p);
-            }
-        }
-        if (d2p->rssid[dict_last_phone(d, wid)][dict_second_last_phone(d, wid)].n_ssid
-            == 0) {
-            s3ssid_t *rmap;
-            s3ssid_t *tmpssid;
-            s3cipid_t *tmpcimap;
-            s3cipid_t r;
-
-            E_DEBUG("Filling in right-context diphones for %s(%s,?)\n",
-                   bin_mdef_ciphone_str(mdef, dict_last_phone(d, wid)),
-                   bin_mdef_ciphone_str(mdef, dict_second_last_phone(d, wid)));
-            rmap = ckd_calloc(bin_mdef_n_ciphone(mdef), sizeof(*rmap));
-            for (r = 0; r < bin_mdef_n_ciphone(mdef); r++) {
-                int p
-                    = bin_mdef_phone_id_nearest(mdef,
-                                                dict_last_phone(d, wid),
-                                                dict_second_last_phone(d, wid), r,
-                                                WORD_POSN_END);
-                rmap[r] = bin_mdef_pid2ssid(mdef, p);
-            }
-            tmpssid = ckd_calloc(bin_mdef_n_ciphone(mdef), sizeof(*tmpssid));
-            tmpcimap = ckd_calloc(bin_mdef_n_ciphone(mdef), sizeof(*tmpcimap));
-            compress_table(rmap, tmpssid, tmpcimap, bin_mdef_n_ciphone(mdef));
-            for (r = 0; r < mdef->n_ciphone && tmpssid[r] != BAD_S3SSID; r++)
-                ;
-            d2p->rssid[dict_last_phone(d, wid)][dict_second_last_phone(d, wid)].ssid = tmpssid;
-            d2p->rssid[dict_last_phone(d, wid)][dict_second_last_phone(d, wid)].cimap = tmpcimap;
-            d2p->rssid[dict_last_phone(d, wid)][dict_second_last_phone(d, wid)].n_ssid = r;
-            ckd_free(rmap);
-        }
+        populate_ldiph(d2p, dict_first_phone(d, wid), dict_second_phone(d, wid));
+        populate_rdiph(d2p, dict_last_phone(d, wid), dict_second_last_phone(d, wid));
     }
-    else {
+    else if (dict_pronlen(d, wid) == 1) {
         /* Make sure we have a left-right context triphone entry for
          * this word. */
-        E_INFO("Filling in context triphones for %s(?,?)\n",
-               bin_mdef_ciphone_str(mdef, dict_first_phone(d, wid)));
-        if (d2p->lrdiph_rc[dict_first_phone(d, wid)][0][0] == BAD_S3SSID) {
-            populate_lrdiph(d2p, NULL, dict_first_phone(d, wid));
-        }
+        populate_lrdiph(d2p, dict_first_phone(d, wid));
     }
 
     return 0;
@@ -388,112 +294,79 @@ dict2pid_internal(dict2pid_t *d2p,
 }
 
 dict2pid_t *
-dict2pid_build(bin_mdef_t * mdef, dict_t * dict)
+dict2pid_init(bin_mdef_t * mdef, dict_t * dict)
 {
     dict2pid_t *dict2pid;
-    s3ssid_t ***rdiph_rc;
-    bitvec_t *ldiph, *rdiph, *single;
-    int32 pronlen;
-    int32 b, l, r, w, p;
+    int32 b, l, r, n_ci;
 
-    E_INFO("Building PID tables for dictionary\n");
     assert(mdef);
     assert(dict);
 
+    n_ci = bin_mdef_n_ciphone(mdef);
     dict2pid = (dict2pid_t *) ckd_calloc(1, sizeof(dict2pid_t));
     dict2pid->refcount = 1;
     dict2pid->mdef = bin_mdef_retain(mdef);
     dict2pid->dict = dict_retain(dict);
     E_INFO("Allocating %d^3 * %d bytes (%d KiB) for word-initial triphones\n",
-           mdef->n_ciphone, sizeof(s3ssid_t),
-           mdef->n_ciphone * mdef->n_ciphone * mdef->n_ciphone * sizeof(s3ssid_t) / 1024);
+           n_ci, sizeof(s3ssid_t),
+           n_ci * n_ci * n_ci * sizeof(s3ssid_t) / 1024);
     dict2pid->ldiph_lc =
-        (s3ssid_t ***) ckd_calloc_3d(mdef->n_ciphone, mdef->n_ciphone,
-                                     mdef->n_ciphone, sizeof(s3ssid_t));
-    /* Only used internally to generate rssid */
-    rdiph_rc =
-        (s3ssid_t ***) ckd_calloc_3d(mdef->n_ciphone, mdef->n_ciphone,
-                                     mdef->n_ciphone, sizeof(s3ssid_t));
-
-    dict2pid->lrdiph_rc = (s3ssid_t ***) ckd_calloc_3d(mdef->n_ciphone,
-                                                       mdef->n_ciphone,
-                                                       mdef->n_ciphone,
-                                                       sizeof
-                                                       (s3ssid_t));
+        (s3ssid_t ***) ckd_calloc_3d(n_ci, n_ci, n_ci, sizeof(s3ssid_t));
+    dict2pid->lrdiph_rc =
+        (s3ssid_t ***) ckd_calloc_3d(n_ci, n_ci, n_ci, sizeof(s3ssid_t));
     /* Actually could use memset for this, if BAD_S3SSID is guaranteed
      * to be 65535... */
-    for (b = 0; b < mdef->n_ciphone; ++b) {
-        for (r = 0; r < mdef->n_ciphone; ++r) {
-            for (l = 0; l < mdef->n_ciphone; ++l) {
+    for (b = 0; b < n_ci; ++b) {
+        for (r = 0; r < n_ci; ++r) {
+            for (l = 0; l < n_ci; ++l) {
                 dict2pid->ldiph_lc[b][r][l] = BAD_S3SSID;
                 dict2pid->lrdiph_rc[b][l][r] = BAD_S3SSID;
-                rdiph_rc[b][l][r] = BAD_S3SSID;
             }
         }
     }
+    dict2pid->rssid =
+        (xwdssid_t **) ckd_calloc_2d(n_ci, n_ci, sizeof(xwdssid_t));
+    dict2pid->lrssid =
+        (xwdssid_t **) ckd_calloc_2d(n_ci, n_ci, sizeof(xwdssid_t));
 
-    /* Track which diphones / ciphones have been seen. */
-    ldiph = bitvec_alloc(mdef->n_ciphone * mdef->n_ciphone);
-    rdiph = bitvec_alloc(mdef->n_ciphone * mdef->n_ciphone);
-    single = bitvec_alloc(mdef->n_ciphone);
-
-    for (w = 0; w < dict_size(dict2pid->dict); w++) {
-        pronlen = dict_pronlen(dict, w);
-
-        if (pronlen >= 2) {
-            b = dict_first_phone(dict, w);
-            r = dict_second_phone(dict, w);
-            /* Populate ldiph_lc */
-            if (bitvec_is_clear(ldiph, b * mdef->n_ciphone + r)) {
-                /* Mark this diphone as done */
-                bitvec_set(ldiph, b * mdef->n_ciphone + r);
-
-                /* Record all possible ssids for b(?,r) */
-                for (l = 0; l < bin_mdef_n_ciphone(mdef); l++) {
-                    p = bin_mdef_phone_id_nearest(mdef, (s3cipid_t) b,
-                                              (s3cipid_t) l, (s3cipid_t) r,
-                                              WORD_POSN_BEGIN);
-                    dict2pid->ldiph_lc[b][r][l] = bin_mdef_pid2ssid(mdef, p);
-                }
-            }
+    /* Track which diphones / ciphones have been filled in. */
+    dict2pid->ldiph_done = bitvec_alloc(n_ci * n_ci);
+    dict2pid->rdiph_done = bitvec_alloc(n_ci * n_ci);
+    dict2pid->single_done = bitvec_alloc(n_ci);
 
+    return dict2pid;
+}
 
-            /* Populate rdiph_rc */
-            l = dict_second_last_phone(dict, w);
-            b = dict_last_phone(dict, w);
-            if (bitvec_is_clear(rdiph, b * mdef->n_ciphone + l)) {
-                /* Mark this diphone as done */
-                bitvec_set(rdiph, b * mdef->n_ciphone + l);
+dict2pid_t *
+dict2pid_build(bin_mdef_t * mdef, dict_t * dict)
+{
+    dict2pid_t *dict2pid;
+    int32 b, r, w, n_ci;
 
-                for (r = 0; r < bin_mdef_n_ciphone(mdef); r++) {
-                    p = bin_mdef_phone_id_nearest(mdef, (s3cipid_t) b,
-                                              (s3cipid_t) l, (s3cipid_t) r,
-                                              WORD_POSN_END);
-                    rdiph_rc[b][l][r] = bin_mdef_pid2ssid(mdef, p);
-                }
-            }
-        }
-        else if (pronlen == 1) {
-            b = dict_pron(dict, w, 0);
-            E_DEBUG("Building tables for single phone word %s phone %d = %s\n",
-                       dict_wordstr(dict, w), b, bin_mdef_ciphone_str(mdef, b));
-            /* Populate lrdiph_rc (and also ldiph_lc, rdiph_rc if needed) */
-            if (bitvec_is_clear(single, b)) {
-                populate_lrdiph(dict2pid, rdiph_rc, b);
-                bitvec_set(single, b);
+    E_INFO("Building PID tables for dictionary\n");
+    dict2pid = dict2pid_init(mdef, dict);
+    n_ci = bin_mdef_n_ciphone(mdef);
+
+    /* Binary dictionaries already know which contexts are used. */
+    w = 0;
+    if (dict->n_bin_word && dict->mdef
+        && bin_mdef_n_ciphone(dict->mdef) == n_ci) {
+        for (b = 0; b < n_ci; ++b) {
+            for (r = 0; r < n_ci; ++r) {
+                if (bitvec_is_set(dict->ldiph, b * n_ci + r))
+                    populate_ldiph(dict2pid, b, r);
+                /* Note that r is the left context here */
+                if (bitvec_is_set(dict->rdiph, b * n_ci + r))
+                    populate_rdiph(dict2pid, b, r);
             }
         }
+        for (b = 0; b < n_ci; ++b)
+            if (bitvec_is_set(dict->single, b))
+                populate_lrdiph(dict2pid, b);
+        w = dict->n_bin_word;
     }
-
-    bitvec_free(ldiph);
-    bitvec_free(rdiph);
-    bitvec_free(single);
-
-    /* Try to compress rdiph_rc into rdiph_rc_compressed */
-    compress_right_context_tree(dict2pid, rdiph_rc);
-    compress_left_right_context_tree(dict2pid);
-
-    ckd_free_3d(rdiph_rc);
+    for (; w < dict_size(dict); w++)
+        dict2pid_add_word(dict2pid, w);
 
     return dict2pid;
 }
@@ -525,6 +398,10 @@ dict2pid_free(dict2pid_t * d2p)
     if (d2p->lrssid)
         free_compress_map(d2p->lrssid, bin_mdef_n_ciphone(d2p->mdef));
 
+    bitvec_free(d2p->ldiph_done);
+    bitvec_free(d2p->rdiph_done);
+    bitvec_free(d2p->single_done);
+
     bin_mdef_free(d2p->mdef);
     dict_free(d2p->dict);
     ckd_free(d2p);
@@ -45,6 +45,7 @@
 #include "s3types.h"
 #include "bin_mdef.h"
 #include "dict.h"
+#include "util/bitvec.h"
 
 /** \file dict2pid.h
  * \brief Building triphones for a dictionary. 
@@ -55,6 +56,11 @@
  * words.  For single-phone words, both its contexts are from other
  * words, simultaneously.  As these words are not known beforehand,
  * life gets complicated.
+ *
+ * The context tables are filled in lazily: dict2pid_init() creates
+ * empty tables, and each search calls dict2pid_add_word() for the
+ * words in its vocabulary before using them.  dict2pid_build() fills
+ * them in for the entire dictionary.
  */
 
 #ifdef __cplusplus
@@ -108,6 +114,10 @@ typedef struct dict2pid_s {
                                     First dimension: base phone,
                                     Second dimension: left context. 
                                  */
+
+    bitvec_t *ldiph_done;       /**< Word-initial diphones (base, rc) filled in */
+    bitvec_t *rdiph_done;       /**< Word-final diphones (base, lc) filled in */
+    bitvec_t *single_done;      /**< Single-phone word base phones filled in */
 } dict2pid_t;
 
 /** Access macros; not designed for arbitrary use */
@@ -116,7 +126,18 @@ typedef struct dict2pid_s {
 #define dict2pid_lrdiph_rc(d,b,l,r) ((d)->lrdiph_rc[b][l][r])
 
 /**
- * Build the dict2pid structure for the given model/dictionary
+ * Create an empty dict2pid structure for the given model/dictionary.
+ *
+ * No context tables are filled in; use dict2pid_add_word() for each
+ * word which will be searched.
+ */
+dict2pid_t *dict2pid_init(bin_mdef_t *mdef,   /**< A  model definition*/
+                          dict_t *dict        /**< An initialized dictionary */
+    );
+
+/**
+ * Build the dict2pid structure for the given model/dictionary,
+ * including context tables for all words in the dictionary.
  */
 dict2pid_t *dict2pid_build(bin_mdef_t *mdef,   /**< A  model definition*/
                            dict_t *dict        /**< An initialized dictionary */
@@ -141,7 +162,12 @@ s3ssid_t dict2pid_internal(dict2pid_t *d2p,
                            int pos);
 
 /**
- * Add a word to the dict2pid structure (after adding it to dict).
+ * Make sure the context tables needed for a word are filled in.
+ *
+ * This must be called for each word in a search's vocabulary before
+ * using the access macros above on its phones (and after adding it
+ * to dict, for new words).  It does nothing if they are already
+ * filled in.
  */
 int dict2pid_add_word(dict2pid_t *d2p,
                       int32 wid);
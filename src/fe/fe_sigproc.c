@@ -712,7 +712,7 @@ fe_compute_melcosine(melfb_t * mel_fb)
     /* And liftering weights */
     if (mel_fb->lifter_val) {
         mel_fb->lifter =
-            calloc(mel_fb->num_cepstra, sizeof(*mel_fb->lifter));
+            ckd_calloc(mel_fb->num_cepstra, sizeof(*mel_fb->lifter));
         for (i = 0; i < mel_fb->num_cepstra; ++i) {
             mel_fb->lifter[i] = FLOAT2MFCC(1 + mel_fb->lifter_val / 2
                                            * sin(i * M_PI /
@@ -86,7 +86,6 @@ void
 fsg_history_free(fsg_history_t *h)
 {
     int32 s, lc, ns, np;
-    gnode_t *gn;
 
     if (h->fsg) {
         ns = fsg_model_n_state(h->fsg);
@@ -94,14 +93,12 @@ fsg_history_free(fsg_history_t *h)
 
         for (s = 0; s < ns; s++) {
             for (lc = 0; lc < np; lc++) {
-                for (gn = h->frame_entries[s][lc]; gn; gn = gnode_next(gn)) {
-                    ckd_free(gnode_ptr(gn));
-                }
                 glist_free(h->frame_entries[s][lc]);
             }
         }
     }
     ckd_free_2d(h->frame_entries);
+    blkarray_list_clear(h->entries);
     blkarray_list_free(h->entries);
     ckd_free(h);
 }
@@ -112,7 +109,7 @@ fsg_history_set_fsg(fsg_history_t *h, fsg_model_t *fsg, dict_t *dict)
 {
     if (blkarray_list_n_valid(h->entries) != 0) {
         E_WARN("Switching FSG while history not empty; history cleared\n");
-        blkarray_list_reset(h->entries);
+        blkarray_list_clear(h->entries);
     }
 
     if (h->frame_entries)
@@ -143,7 +140,7 @@ fsg_history_entry_add(fsg_history_t * h,
     /* Skip the optimization for the initial dummy entries; always enter them */
     if (frame < 0) {
         new_entry =
-            (fsg_hist_entry_t *) ckd_calloc(1, sizeof(fsg_hist_entry_t));
+            (fsg_hist_entry_t *) arena_calloc(h->arena, 1, sizeof(fsg_hist_entry_t));
         new_entry->fsglink = link;
         new_entry->frame = frame;
         new_entry->score = score;
@@ -174,7 +171,7 @@ fsg_history_entry_add(fsg_history_t * h,
 
     /* Create new entry after prev_gn (if prev_gn is NULL, at head) */
     new_entry =
-        (fsg_hist_entry_t *) ckd_calloc(1, sizeof(fsg_hist_entry_t));
+        (fsg_hist_entry_t *) arena_calloc(h->arena, 1, sizeof(fsg_hist_entry_t));
     new_entry->fsglink = link;
     new_entry->frame = frame;
     new_entry->score = score;
@@ -198,8 +195,8 @@ fsg_history_entry_add(fsg_history_t * h,
         entry = (fsg_hist_entry_t *) gnode_ptr(gn);
 
         if (FSG_PNODE_CTXT_SUB(&(entry->rc), &rc) == 0) {
-            /* rc set of entry reduced to 0; can prune this entry */
-            ckd_free((void *) entry);
+            /* rc set of entry reduced to 0; can prune this entry
+             * (its memory goes back with the arena) */
             gn = gnode_free(gn, prev_gn);
         }
         else {
@@ -248,7 +245,7 @@ fsg_history_entry_get(fsg_history_t * h, int32 id)
 void
 fsg_history_reset(fsg_history_t * h)
 {
-    blkarray_list_reset(h->entries);
+    blkarray_list_clear(h->entries);
 }
 
 
@@ -259,10 +256,11 @@ fsg_history_n_entries(fsg_history_t * h)
 }
 
 void
-fsg_history_utt_start(fsg_history_t * h)
+fsg_history_utt_start(fsg_history_t * h, arena_t *arena)
 {
     int32 s, lc, ns, np;
 
+    h->arena = arena;
     assert(blkarray_list_n_valid(h->entries) == 0);
     assert(h->frame_entries);
 
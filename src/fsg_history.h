@@ -79,6 +79,7 @@
 
 #include "lm/fsg_model.h"
 #include "util/blkarray_list.h"
+#include "util/arena.h"
 #include "fsg_lextree.h"
 #include "dict.h"
 
@@ -151,6 +152,8 @@ typedef struct fsg_history_s {
 				   entry is the first element of the list */
     glist_t **frame_entries;
     int n_ciphone;
+    arena_t *arena;		/* Allocator for entries (not retained), which
+				   owns them and is reset between utterances */
 } fsg_history_t;
 
 
@@ -160,7 +163,12 @@ typedef struct fsg_history_s {
  */
 fsg_history_t *fsg_history_init(fsg_model_t *fsg, dict_t *dict);
 
-void fsg_history_utt_start(fsg_history_t *h);
+/*
+ * Start a new utterance, allocating history entries from the given
+ * arena.  The caller is responsible for resetting it, which releases
+ * all entries at once.
+ */
+void fsg_history_utt_start(fsg_history_t *h, arena_t *arena);
 
 void fsg_history_utt_end(fsg_history_t *h);
 
@@ -191,7 +199,7 @@ void fsg_history_entry_add (fsg_history_t *h,
 void fsg_history_end_frame (fsg_history_t *h);
 
 
-/* Clear the history table */
+/* Clear the history table (entries are released with their arena) */
 void fsg_history_reset (fsg_history_t *h);
 
 
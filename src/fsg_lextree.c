@@ -230,6 +230,13 @@ fsg_lextree_init(fsg_model_t * fsg, dict_t *dict, dict2pid_t *d2p,
     lextree->wip = wip;
     lextree->pip = pip;
 
+    /* Make sure context tables exist for all words in the FSG. */
+    for (s = 0; s < fsg_model_n_word(fsg); s++) {
+        s3wid_t dictwid = dict_wordid(dict, fsg_model_word_str(fsg, s));
+        if (IS_S3WID(dictwid))
+            dict2pid_add_word(d2p, dictwid);
+    }
+
     /* Compute lc and rc for fsg. */
     fsg_lextree_lc_rc(lextree);
 
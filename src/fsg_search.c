@@ -61,12 +61,17 @@
 #include "fsg_search_internal.h"
 #include "fsg_history.h"
 #include "fsg_lextree.h"
+#include "phone_loop_search.h"
 
 /* Turn this on for detailed debugging dump */
 #define __FSG_DBG__		0
 #define __FSG_DBG_CHAN__	0
 #define __FSG_ALLOW_BESTPATH__	1
 
+/* Narrowest beams allowed by histogram pruning, relative to the
+ * configured ones. */
+#define FSG_MIN_BEAM_FACTOR	0.1f
+
 static ps_seg_t *fsg_search_seg_iter(ps_search_t *search);
 static ps_lattice_t *fsg_search_lattice(ps_search_t *search);
 static int fsg_search_prob(ps_search_t *search);
@@ -206,6 +211,7 @@ fsg_search_init(const char *name,
     fsgs->wbeam = fsgs->wbeam_orig
         = (int32) logmath_log(acmod->lmath, ps_config_float(config, "wbeam"))
         >> SENSCR_SHIFT;
+    histprune_init(&fsgs->hprune, config);
 
     /* LM related weights/penalties */
     fsgs->lw = ps_config_float(config, "lw");
@@ -339,7 +345,7 @@ fsg_search_hmm_eval(fsg_search_t *fsgs)
     fsg_pnode_t *pnode;
     hmm_t *hmm;
     int32 bestscore;
-    int32 n, maxhmmpf;
+    int32 n, budget;
 
     bestscore = WORST_SCORE;
 
@@ -376,29 +382,27 @@ fsg_search_hmm_eval(fsg_search_t *fsgs)
 #endif
     fsgs->n_hmm_eval += n;
 
-    /* Adjust beams if #active HMMs larger than absolute threshold */
-    maxhmmpf = ps_config_int(ps_search_config(fsgs), "maxhmmpf");
-    if (maxhmmpf != -1 && n > maxhmmpf) {
-        /*
-         * Too many HMMs active; reduce the beam factor applied to the default
-         * beams, but not if the factor is already at a floor (0.1).
-         */
-        if (fsgs->beam_factor > 0.1) {        /* Hack!!  Hardwired constant 0.1 */
-            fsgs->beam_factor *= 0.9f;        /* Hack!!  Hardwired constant 0.9 */
-            fsgs->beam =
-                (int32) (fsgs->beam_orig * fsgs->beam_factor);
-            fsgs->pbeam =
-                (int32) (fsgs->pbeam_orig * fsgs->beam_factor);
-            fsgs->wbeam =
-                (int32) (fsgs->wbeam_orig * fsgs->beam_factor);
+    /* Narrow beams if the governor says so, or if #active HMMs
+     * larger than the budget */
+    fsgs->beam_factor = ps_search_beam_scale(fsgs);
+    budget = histprune_budget(&fsgs->hprune);
+    if (budget != -1 && n > budget) {
+        histprune_reset(&fsgs->hprune,
+                        (int32) (fsgs->beam_orig * fsgs->beam_factor));
+        for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
+            hmm = fsg_pnode_hmmptr((fsg_pnode_t *) gnode_ptr(gn));
+            histprune_add(&fsgs->hprune, bestscore - hmm_bestscore(hmm));
         }
+        fsgs->beam_factor = (float32)histprune_beam(&fsgs->hprune, budget)
+            / fsgs->beam_orig;
+        /* If the best bin alone is over budget the beam is 0, which
+         * would leave nothing but ties with the best HMM. */
+        if (fsgs->beam_factor < FSG_MIN_BEAM_FACTOR)
+            fsgs->beam_factor = FSG_MIN_BEAM_FACTOR;
     }
-    else {
-        fsgs->beam_factor = 1.0f;
-        fsgs->beam = fsgs->beam_orig;
-        fsgs->pbeam = fsgs->pbeam_orig;
-        fsgs->wbeam = fsgs->wbeam_orig;
-    }
+    fsgs->beam = (int32) (fsgs->beam_orig * fsgs->beam_factor);
+    fsgs->pbeam = (int32) (fsgs->pbeam_orig * fsgs->beam_factor);
+    fsgs->wbeam = (int32) (fsgs->wbeam_orig * fsgs->beam_factor);
 
     if (n > fsg_lextree_n_pnode(fsgs->lextree))
         E_FATAL("PANIC! Frame %d: #HMM evaluated(%d) > #PNodes(%d)\n",
@@ -413,6 +417,7 @@ fsg_search_pnode_trans(fsg_search_t *fsgs, fsg_pnode_t * pnode)
 {
     fsg_pnode_t *child;
     hmm_t *hmm;
+    phone_loop_search_t *pls;
     int32 newscore, thresh, nf;
 
     assert(pnode);
@@ -420,6 +425,7 @@ fsg_search_pnode_trans(fsg_search_t *fsgs, fsg_pnode_t * pnode)
 
     nf = fsgs->frame + 1;
     thresh = fsgs->bestscore + fsgs->beam;
+    pls = (phone_loop_search_t *)ps_search_lookahead(fsgs);
 
     hmm = fsg_pnode_hmmptr(pnode);
 
@@ -427,7 +433,9 @@ fsg_search_pnode_trans(fsg_search_t *fsgs, fsg_pnode_t * pnode)
          child; child = fsg_pnode_sibling(child)) {
         newscore = hmm_out_score(hmm) + child->logs2prob;
 
-        if ((newscore BETTER_THAN thresh)
+        /* Phoneme lookahead only affects pruning, not the score. */
+        if ((newscore + phone_loop_search_score(pls, child->ci_ext)
+             BETTER_THAN thresh)
             && (newscore BETTER_THAN hmm_in_score(&child->hmm))) {
             /* Incoming score > pruning threshold and > target's existing score */
             if (hmm_frame(&child->hmm) < nf) {
@@ -621,12 +629,14 @@ fsg_search_word_trans(fsg_search_t *fsgs)
     fsg_link_t *l;
     int32 score, newscore, thresh, nf, d;
     fsg_pnode_t *root;
+    phone_loop_search_t *pls;
     int32 lc, rc;
 
     n_entries = fsg_history_n_entries(fsgs->history);
 
     thresh = fsgs->bestscore + fsgs->beam;
     nf = fsgs->frame + 1;
+    pls = (phone_loop_search_t *)ps_search_lookahead(fsgs);
 
     for (bpidx = fsgs->bpidx_start; bpidx < n_entries; bpidx++) {
         hist_entry = fsg_history_entry_get(fsgs->history, bpidx);
@@ -658,7 +668,10 @@ fsg_search_word_trans(fsg_search_t *fsgs)
                  */
                 newscore = score + root->logs2prob;
 
-                if ((newscore BETTER_THAN thresh)
+                /* Fillers present SIL as their context, so they
+                 * are looked ahead as silence. */
+                if ((newscore + phone_loop_search_score(pls, root->ci_ext)
+                     BETTER_THAN thresh)
                     && (newscore BETTER_THAN hmm_in_score(&root->hmm))) {
                     if (hmm_frame(&root->hmm) < nf) {
                         /* Newly activated node; add to active list */
@@ -696,7 +709,9 @@ fsg_search_step(ps_search_t *search, int frame_idx)
     gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
+    int32 n_hmm;
 
+    histprune_frame_start(&fsgs->hprune);
     /* Activate our HMMs for the current frame if need be. */
     if (!acmod->compallsen)
         fsg_search_sen_active(fsgs);
@@ -709,7 +724,9 @@ fsg_search_step(ps_search_t *search, int frame_idx)
     fsgs->bpidx_start = fsg_history_n_entries(fsgs->history);
 
     /* Evaluate all active pnodes (HMMs) */
+    n_hmm = fsgs->n_hmm_eval;
     fsg_search_hmm_eval(fsgs);
+    n_hmm = fsgs->n_hmm_eval - n_hmm;
 
     /*
      * Prune and propagate the HMMs evaluated; create history entries for
@@ -759,6 +776,7 @@ fsg_search_step(ps_search_t *search, int frame_idx)
     fsgs->pnode_active_next = NULL;
 
     /* End of this frame; ready for the next */
+    histprune_frame_end(&fsgs->hprune, n_hmm);
     ++fsgs->frame;
 
     return 1;
@@ -790,7 +808,7 @@ fsg_search_start(ps_search_t *search)
     assert(fsgs->pnode_active_next == NULL);
 
     fsg_history_reset(fsgs->history);
-    fsg_history_utt_start(fsgs->history);
+    fsg_history_utt_start(fsgs->history, ps_search_base(fsgs)->arena);
     fsgs->final = FALSE;
 
     /* Dummy context structure that allows all right contexts to use this entry */
@@ -1563,6 +1581,8 @@ fsg_search_lattice(ps_search_t *search)
 	
 	ps_lattice_penalize_fillers(dag, silpen, fillpen);
     }
+    /* Limit its size if requested (grammar scores are in the links). */
+    ps_lattice_prune_config(dag, NULL, 1.0);
     search->dag = dag;
 
     return dag;
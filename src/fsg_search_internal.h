@@ -47,6 +47,7 @@
 #include "lm/fsg_model.h"
 #include "pocketsphinx_internal.h"
 #include "hmm.h"
+#include "histprune.h"
 #include "fsg_history.h"
 #include "fsg_lextree.h"
 
@@ -90,6 +91,7 @@ typedef struct fsg_search_s {
                                      beams to determine actual effective beams.
                                      For implementing absolute pruning. */
     int32 beam, pbeam, wbeam;	/**< Effective beams after applying beam_factor */
+    histprune_t hprune;         /**< Limits the number of HMMs per frame */
     float32 lw;         /**< Language weight */
     int32 pip, wip;     /**< Log insertion penalties */
   
@@ -0,0 +1,157 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+/**
+ * @file histprune.c
+ * @brief Histogram pruning of active HMMs to a per-frame budget
+ */
+
+#include <string.h>
+
+#include <pocketsphinx.h>
+
+#include "histprune.h"
+
+/* Weight of the most recent frame in the estimate of time per HMM. */
+#define HISTPRUNE_DECAY 0.1
+
+void
+histprune_init(histprune_t *hp, ps_config_t *config)
+{
+    memset(hp, 0, sizeof(*hp));
+    hp->maxhmmpf = ps_config_int(config, "maxhmmpf");
+    hp->maxuspf = ps_config_int(config, "maxuspf");
+    hp->bw = 1;
+    ptmr_init(&hp->tmr);
+}
+
+void
+histprune_frame_start(histprune_t *hp)
+{
+    if (hp->maxuspf == -1)
+        return;
+    ptmr_reset(&hp->tmr);
+    ptmr_start(&hp->tmr);
+}
+
+void
+histprune_frame_end(histprune_t *hp, int32 n_hmm)
+{
+    if (hp->maxuspf == -1)
+        return;
+    ptmr_stop(&hp->tmr);
+    if (n_hmm <= 0)
+        return;
+    histprune_update(hp, n_hmm, hp->tmr.t_elapsed * 1e6);
+}
+
+void
+histprune_update(histprune_t *hp, int32 n_hmm, float64 us)
+{
+    float64 var, cov;
+
+    if (hp->m_n == 0.0) {
+        hp->m_n = n_hmm;
+        hp->m_t = us;
+        hp->m_nn = (float64)n_hmm * n_hmm;
+        hp->m_nt = n_hmm * us;
+    }
+    else {
+        hp->m_n += HISTPRUNE_DECAY * (n_hmm - hp->m_n);
+        hp->m_t += HISTPRUNE_DECAY * (us - hp->m_t);
+        hp->m_nn += HISTPRUNE_DECAY * ((float64)n_hmm * n_hmm - hp->m_nn);
+        hp->m_nt += HISTPRUNE_DECAY * (n_hmm * us - hp->m_nt);
+    }
+    /* Fit time = us_fixed + n_hmm * us_per_hmm to recent frames.  If
+     * the number of HMMs hasn't varied enough to tell the two apart,
+     * keep the last fit, or failing that assume no fixed cost. */
+    var = hp->m_nn - hp->m_n * hp->m_n;
+    cov = hp->m_nt - hp->m_n * hp->m_t;
+    if (var > 0.01 * hp->m_n * hp->m_n && cov > 0.0) {
+        hp->us_per_hmm = cov / var;
+        hp->us_fixed = hp->m_t - hp->us_per_hmm * hp->m_n;
+        if (hp->us_fixed < 0.0) {
+            hp->us_per_hmm = hp->m_t / hp->m_n;
+            hp->us_fixed = 0.0;
+        }
+    }
+    else if (hp->us_per_hmm == 0.0) {
+        hp->us_per_hmm = hp->m_t / hp->m_n;
+        hp->us_fixed = 0.0;
+    }
+}
+
+int32
+histprune_budget(histprune_t *hp)
+{
+    int32 budget = hp->maxhmmpf;
+
+    if (hp->maxuspf != -1 && hp->us_per_hmm > 0.0) {
+        float64 n_hmm = (hp->maxuspf - hp->us_fixed) / hp->us_per_hmm;
+        if (n_hmm < HISTPRUNE_MIN_HMM)
+            n_hmm = HISTPRUNE_MIN_HMM;
+        if (budget == -1 || n_hmm < budget)
+            budget = (int32)n_hmm;
+    }
+    return budget;
+}
+
+void
+histprune_reset(histprune_t *hp, int32 beam)
+{
+    /* Bins go from zero (best score) to edge of beam. */
+    hp->bw = -beam / HISTPRUNE_NBINS;
+    if (hp->bw < 1)
+        hp->bw = 1;
+    memset(hp->bins, 0, sizeof(hp->bins));
+}
+
+int32
+histprune_beam(histprune_t *hp, int32 budget)
+{
+    int32 i, n_hmm;
+
+    /* Walk down the bins to find the new beam. */
+    for (i = n_hmm = 0; i < HISTPRUNE_NBINS; ++i) {
+        n_hmm += hp->bins[i];
+        if (n_hmm > budget)
+            break;
+    }
+    if (i < HISTPRUNE_NBINS)
+        ++hp->n_narrowed;
+    return -(i * hp->bw);
+}
@@ -0,0 +1,147 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+/**
+ * @file histprune.h
+ * @brief Histogram pruning of active HMMs to a per-frame budget
+ *
+ * Each search prunes its HMMs with a fixed beam, but in noisy audio
+ * or with a large vocabulary the number of HMMs inside the beam can
+ * grow without bound.  This narrows the beam, frame by frame, so that
+ * only about -maxhmmpf HMMs survive.  If -maxuspf is given, the budget
+ * is also limited to the number of HMMs which can be searched in that
+ * many microseconds, as estimated from the time taken by recent
+ * frames.  Part of that time (computing senone scores, for instance)
+ * does not depend on the number of HMMs, so it is estimated
+ * separately, and the time limit never reduces the budget below
+ * HISTPRUNE_MIN_HMM.
+ *
+ * The histogram is only built on frames which are over budget, by
+ * binning the score of each evaluated HMM relative to the best one.
+ */
+
+#ifndef __HISTPRUNE_H__
+#define __HISTPRUNE_H__
+
+#include <pocketsphinx.h>
+
+#include "util/profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Number of bins in the score histogram. */
+#define HISTPRUNE_NBINS 256
+/** Smallest budget which -maxuspf can impose. */
+#define HISTPRUNE_MIN_HMM 100
+
+/**
+ * Histogram pruning controller.
+ */
+typedef struct histprune_s {
+    int32 maxhmmpf;     /**< Maximum HMMs per frame, or -1 for no limit. */
+    int32 maxuspf;      /**< Maximum microseconds per frame, or -1. */
+    float64 us_per_hmm; /**< Estimated time per HMM evaluated. */
+    float64 us_fixed;   /**< Estimated time per frame besides HMMs. */
+    float64 m_n, m_t, m_nn, m_nt; /**< Running moments of HMMs and time. */
+    int32 bw;           /**< Width of histogram bins. */
+    int32 bins[HISTPRUNE_NBINS]; /**< Histogram of scores below the best. */
+    int32 n_narrowed;   /**< Number of frames in which the beam was narrowed. */
+    ptmr_t tmr;         /**< Timer for the current frame. */
+} histprune_t;
+
+/**
+ * Initialize a histogram pruning controller from -maxhmmpf and -maxuspf.
+ */
+void histprune_init(histprune_t *hp, ps_config_t *config);
+
+/**
+ * Start timing a frame.
+ */
+void histprune_frame_start(histprune_t *hp);
+
+/**
+ * Stop timing a frame and update the estimate of time per HMM.
+ */
+void histprune_frame_end(histprune_t *hp, int32 n_hmm);
+
+/**
+ * Update the estimates of time per HMM and per frame.
+ * @param n_hmm Number of HMMs evaluated in a frame.
+ * @param us Microseconds taken by that frame.
+ */
+void histprune_update(histprune_t *hp, int32 n_hmm, float64 us);
+
+/**
+ * Get the number of HMMs to keep in the current frame.
+ * @return Maximum number of HMMs, or -1 for no limit.
+ */
+int32 histprune_budget(histprune_t *hp);
+
+/**
+ * Clear the histogram for a beam.
+ * @param beam Beam (as a negative log-probability) to be narrowed.
+ */
+void histprune_reset(histprune_t *hp, int32 beam);
+
+/**
+ * Add an HMM to the histogram.
+ * @param diff Best score in the frame minus the score of this HMM.
+ */
+#define histprune_add(hp,diff)                                          \
+    do {                                                                \
+        int32 __b = (diff) / (hp)->bw;                                  \
+        ++(hp)->bins[__b < 0 ? 0                                        \
+                     : __b >= HISTPRUNE_NBINS ? HISTPRUNE_NBINS - 1 : __b]; \
+    } while (0)
+
+/**
+ * Find the beam which keeps a given number of HMMs.
+ * @return Narrowed beam, such that approximately budget HMMs in the
+ *         histogram are inside it.
+ */
+int32 histprune_beam(histprune_t *hp, int32 budget);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __HISTPRUNE_H__ */
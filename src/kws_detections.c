@@ -41,13 +41,9 @@
 void
 kws_detections_reset(kws_detections_t *detections)
 {
-    gnode_t *gn;
-
     if (!detections->detect_list)
         return;
 
-    for (gn = detections->detect_list; gn; gn = gnode_next(gn))
-        ckd_free(gnode_ptr(gn));
     glist_free(detections->detect_list);
     detections->detect_list = NULL;
 }
@@ -71,7 +67,8 @@ kws_detections_add(kws_detections_t *detections, const char* keyphrase, int sf,
     }
 
     /* Nothing found */
-    detection = (kws_detection_t *)ckd_calloc(1, sizeof(*detection));
+    detection = (kws_detection_t *)arena_calloc(detections->arena,
+                                                1, sizeof(*detection));
     detection->sf = sf;
     detection->ef = ef;
     detection->keyphrase = keyphrase;
@@ -40,6 +40,7 @@
 #define __KWS_DETECTIONS_H__
 
 #include "util/glist.h"
+#include "util/arena.h"
 #include "pocketsphinx_internal.h"
 #include "hmm.h"
 
@@ -60,10 +61,12 @@ typedef struct kws_detection_s {
 
 typedef struct kws_detections_s {
     glist_t detect_list;
+    arena_t *arena;   /**< Allocator for detections (not retained). */
 } kws_detections_t;
 
 /**
- * Reset history structure.
+ * Reset history structure.  Detections themselves are released along
+ * with the arena they were allocated from.
  */
 void kws_detections_reset(kws_detections_t *detections);
 
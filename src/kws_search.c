@@ -47,6 +47,7 @@
 #include "util/pio.h"
 #include "pocketsphinx_internal.h"
 #include "kws_search.h"
+#include "phone_loop_search.h"
 
 /** Access macros */
 #define hmm_is_active(hmm) ((hmm)->frame > 0)
@@ -190,10 +191,10 @@ kws_search_sen_active(kws_search_t * kwss)
 * Evaluate all the active HMMs.
 * (Executed once per frame.)
 */
-static void
+static int32
 kws_search_hmm_eval(kws_search_t * kwss, int16 const *senscr)
 {
-    int32 i;
+    int32 i, n;
     gnode_t *gn;
     int32 bestscore = WORST_SCORE;
 
@@ -209,6 +210,7 @@ kws_search_hmm_eval(kws_search_t * kwss, int16 const *senscr)
             bestscore = score;
     }
     /* evaluate hmms for active nodes */
+    n = 0;
     for (gn = kwss->keyphrases; gn; gn = gnode_next(gn)) {
         kws_keyphrase_t *keyphrase = gnode_ptr(gn);
         for (i = 0; i < keyphrase->n_hmms; i++) {
@@ -219,11 +221,13 @@ kws_search_hmm_eval(kws_search_t * kwss, int16 const *senscr)
                 score = hmm_vit_eval(hmm);
                 if (score BETTER_THAN bestscore)
                     bestscore = score;
+                ++n;
             }
         }
     }
 
     kwss->bestscore = bestscore;
+    return n;
 }
 
 /*
@@ -231,12 +235,28 @@ kws_search_hmm_eval(kws_search_t * kwss, int16 const *senscr)
 * active. Executed once per frame.
 */
 static void
-kws_search_hmm_prune(kws_search_t * kwss)
+kws_search_hmm_prune(kws_search_t * kwss, int32 n_hmm)
 {
-    int32 thresh, i;
+    int32 beam, thresh, budget, i;
     gnode_t *gn;
 
-    thresh = kwss->bestscore + kwss->beam;
+    beam = (int32)(kwss->beam * ps_search_beam_scale(kwss));
+    thresh = kwss->bestscore + beam;
+    /* Narrow the beam if too many keyphrase HMMs are active. */
+    budget = histprune_budget(&kwss->hprune);
+    if (budget != -1 && n_hmm > budget) {
+        histprune_reset(&kwss->hprune, beam);
+        for (gn = kwss->keyphrases; gn; gn = gnode_next(gn)) {
+            kws_keyphrase_t *keyphrase = gnode_ptr(gn);
+            for (i = 0; i < keyphrase->n_hmms; i++) {
+                hmm_t *hmm = kws_nth_hmm(keyphrase, i);
+                if (hmm_is_active(hmm))
+                    histprune_add(&kwss->hprune,
+                                  kwss->bestscore - hmm_bestscore(hmm));
+            }
+        }
+        thresh = kwss->bestscore + histprune_beam(&kwss->hprune, budget);
+    }
 
     for (gn = kwss->keyphrases; gn; gn = gnode_next(gn)) {
         kws_keyphrase_t *keyphrase = gnode_ptr(gn);
@@ -256,7 +276,9 @@ static void
 kws_search_trans(kws_search_t * kwss)
 {
     hmm_t *pl_best_hmm = NULL;
+    phone_loop_search_t *pls;
     int32 best_out_score = WORST_SCORE;
+    int32 thresh;
     int i;
     gnode_t *gn;
 
@@ -306,6 +328,11 @@ kws_search_trans(kws_search_t * kwss)
         }
     }
 
+    /* Don't enter keyphrase phones which the phoneme lookahead
+     * says are unlikely to survive. */
+    pls = (phone_loop_search_t *)ps_search_lookahead(kwss);
+    thresh = kwss->bestscore + kwss->beam;
+
     /* Activate new keyphrase nodes, enter their hmms */
     for (gn = kwss->keyphrases; gn; gn = gnode_next(gn)) {
         kws_keyphrase_t *keyphrase = gnode_ptr(gn);
@@ -318,6 +345,10 @@ kws_search_trans(kws_search_t * kwss)
             hmm_t *hmm = kws_nth_hmm(keyphrase, i);
 
             if (hmm_is_active(pred_hmm)) {    
+                if (pls && hmm_out_score(pred_hmm)
+                    + phone_loop_search_score(pls, keyphrase->ciphones[i])
+                    WORSE_THAN thresh)
+                    continue;
                 if (!hmm_is_active(hmm)
                     || hmm_out_score(pred_hmm) BETTER_THAN
                     hmm_in_score(hmm))
@@ -327,6 +358,10 @@ kws_search_trans(kws_search_t * kwss)
         }
 
         /* Enter keyphrase start node from phone loop */
+        if (pls && hmm_out_score(pl_best_hmm)
+            + phone_loop_search_score(pls, keyphrase->ciphones[0])
+            WORSE_THAN thresh)
+            continue;
         if (hmm_out_score(pl_best_hmm) BETTER_THAN
             hmm_in_score(kws_nth_hmm(keyphrase, 0)))
                 hmm_enter(kws_nth_hmm(keyphrase, 0), hmm_out_score(pl_best_hmm),
@@ -397,6 +432,7 @@ kws_search_init(const char *name,
     kwss->beam =
         (int32) logmath_log(acmod->lmath,
                             ps_config_float(config, "beam")) >> SENSCR_SHIFT;
+    histprune_init(&kwss->hprune, config);
 
     kwss->plp =
         (int32) logmath_log(acmod->lmath,
@@ -468,6 +504,7 @@ kws_search_free(ps_search_t * search)
     for (gn = kwss->keyphrases; gn; gn = gnode_next(gn)) {
 	kws_keyphrase_t *keyphrase = gnode_ptr(gn);
         ckd_free(keyphrase->hmms);
+        ckd_free(keyphrase->ciphones);
         ckd_free(keyphrase->word);
         ckd_free(keyphrase);
     }
@@ -551,6 +588,9 @@ kws_search_reinit(ps_search_t * search, dict_t * dict, dict2pid_t * d2p)
         if (keyphrase->hmms)
             ckd_free(keyphrase->hmms);
         keyphrase->hmms = (hmm_t *) ckd_calloc(n_hmms, sizeof(hmm_t));
+        ckd_free(keyphrase->ciphones);
+        keyphrase->ciphones = (s3cipid_t *) ckd_calloc(n_hmms,
+                                                       sizeof(s3cipid_t));
         keyphrase->n_hmms = n_hmms;
 
         /* fill node array */
@@ -558,6 +598,7 @@ kws_search_reinit(ps_search_t * search, dict_t * dict, dict2pid_t * d2p)
         for (i = 0; i < n_wrds; i++) {
             wid = dict_wordid(dict, wrdptr[i]);
             pronlen = dict_pronlen(dict, wid);
+            dict2pid_add_word(d2p, wid);
             for (p = 0; p < pronlen; p++) {
                 int32 ci = dict_pron(dict, wid, p);
                 if (p == 0) {
@@ -580,6 +621,7 @@ kws_search_reinit(ps_search_t * search, dict_t * dict, dict2pid_t * d2p)
                 tmatid = bin_mdef_pid2tmatid(mdef, ci);
                 hmm_init(kwss->hmmctx, &keyphrase->hmms[j], FALSE, ssid,
                          tmatid);
+                keyphrase->ciphones[j] = ci;
                 j++;
             }
         }
@@ -602,6 +644,7 @@ kws_search_start(ps_search_t * search)
     kwss->frame = 0;
     kwss->bestscore = 0;
     kws_detections_reset(kwss->detections);
+    kwss->detections->arena = search->arena;
 
     /* Reset and enter all phone-loop HMMs. */
     for (i = 0; i < kwss->n_pl; ++i) {
@@ -622,7 +665,9 @@ kws_search_step(ps_search_t * search, int frame_idx)
     int16 const *senscr;
     kws_search_t *kwss = (kws_search_t *) search;
     acmod_t *acmod = search->acmod;
+    int32 n_hmm;
 
+    histprune_frame_start(&kwss->hprune);
     /* Activate senones */
     if (!acmod->compallsen)
         kws_search_sen_active(kwss);
@@ -631,13 +676,14 @@ kws_search_step(ps_search_t * search, int frame_idx)
     senscr = acmod_score(acmod, &frame_idx);
 
     /* Evaluate hmms in phone loop and in active keyphrase nodes */
-    kws_search_hmm_eval(kwss, senscr);
+    n_hmm = kws_search_hmm_eval(kwss, senscr);
 
     /* Prune hmms with low prob */
-    kws_search_hmm_prune(kwss);
+    kws_search_hmm_prune(kwss, n_hmm);
 
     /* Do hmms transitions */
     kws_search_trans(kwss);
+    histprune_frame_end(&kwss->hprune, n_hmm);
 
     ++kwss->frame;
     return 0;
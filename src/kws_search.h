@@ -45,6 +45,7 @@
 #include "pocketsphinx_internal.h"
 #include "kws_detections.h"
 #include "hmm.h"
+#include "histprune.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -69,6 +70,7 @@ typedef struct kws_keyphrase_s {
     int32 threshold;
     hmm_t* hmms;
     int32 n_hmms;
+    s3cipid_t *ciphones;  /**< CI phone of each HMM, for lookahead */
 } kws_keyphrase_t;
 
 /**
@@ -85,6 +87,7 @@ typedef struct kws_search_s {
     frame_idx_t frame;            /**< Frame index */
 
     int32 beam;
+    histprune_t hprune;           /**< Limits the number of HMMs per frame */
 
     int32 plp;                    /**< Phone loop probability */
     int32 bestscore;              /**< For beam pruning */
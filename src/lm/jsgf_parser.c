@@ -887,25 +887,25 @@ yydestruct (const char *yymsg,
     {
     case YYSYMBOL_TOKEN: /* TOKEN  */
 #line 79 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.y"
-            { free(((*yyvaluep).name)); }
+            { ckd_free(((*yyvaluep).name)); }
 #line 892 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.c"
         break;
 
     case YYSYMBOL_RULENAME: /* RULENAME  */
 #line 79 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.y"
-            { free(((*yyvaluep).name)); }
+            { ckd_free(((*yyvaluep).name)); }
 #line 898 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.c"
         break;
 
     case YYSYMBOL_TAG: /* TAG  */
 #line 79 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.y"
-            { free(((*yyvaluep).name)); }
+            { ckd_free(((*yyvaluep).name)); }
 #line 904 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.c"
         break;
 
     case YYSYMBOL_grammar_header: /* grammar_header  */
 #line 79 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.y"
-            { free(((*yyvaluep).name)); }
+            { ckd_free(((*yyvaluep).name)); }
 #line 910 "/home/dhd/work/pocketsphinx/src/lm/jsgf_parser.c"
         break;
 
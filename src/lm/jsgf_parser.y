@@ -76,7 +76,7 @@ void yyerror(yyscan_t lex, jsgf_t *jsgf, const char *s);
 
 %token           HEADER GRAMMAR IMPORT PUBLIC
 %token <name>    TOKEN RULENAME TAG
-%destructor { free($$); } <name>
+%destructor { ckd_free($$); } <name>
 %token <weight>  WEIGHT
 %type  <atom>    rule_atom rule_item tagged_rule_item
 %type  <rhs>     rule_expansion alternate_list
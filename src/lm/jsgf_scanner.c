@@ -605,6 +605,7 @@ static const flex_int32_t yy_rule_can_match_eol[23] =
 /* YOU MUST USE FLEX 2.6.1 OR NEWER TO PROCESS THIS FILE!!! */
 #line 39 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
 
+#include "util/ckd_alloc.h"
 #include "lm/jsgf_internal.h"
 #include "lm/jsgf_parser.h"
 
@@ -1026,24 +1027,24 @@ case 14:
 /* rule 14 can match eol */
 YY_RULE_SETUP
 #line 76 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
-{ BEGIN(DECL); yylval->name = strdup(yytext); return RULENAME; }
+{ BEGIN(DECL); yylval->name = ckd_salloc(yytext); return RULENAME; }
 	YY_BREAK
 case 15:
 /* rule 15 can match eol */
 YY_RULE_SETUP
 #line 77 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
-{ yylval->name = strdup(yytext); return RULENAME; }
+{ yylval->name = ckd_salloc(yytext); return RULENAME; }
 	YY_BREAK
 case 16:
 /* rule 16 can match eol */
 YY_RULE_SETUP
 #line 79 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
-{ yylval->name = strdup(yytext); return TAG; }
+{ yylval->name = ckd_salloc(yytext); return TAG; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
 #line 80 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
-{ yylval->name = strdup(yytext); return TOKEN; }
+{ yylval->name = ckd_salloc(yytext); return TOKEN; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
@@ -1054,7 +1055,7 @@ case 19:
 /* rule 19 can match eol */
 YY_RULE_SETUP
 #line 82 "/home/dhd/work/pocketsphinx/src/lm/_jsgf_scanner.l"
-{ yylval->name = strdup(yytext); return TOKEN; }
+{ yylval->name = ckd_salloc(yytext); return TOKEN; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
@@ -48,12 +48,12 @@
 
 #include "util/byteorder.h"
 #include "util/ckd_alloc.h"
-#include "util/priority_queue.h"
 
 #include "lm/lm_trie.h"
 #include "lm/lm_trie_quant.h"
 
 static void lm_trie_alloc_ngram(lm_trie_t * trie, uint32 * counts, int order);
+static void base_free_index(base_t * base);
 
 static uint32
 base_size(uint32 entries, uint32 max_vocab, uint8 remaining_bits)
@@ -178,40 +178,51 @@ unigram_next(lm_trie_t * trie, int order)
         insert_index;
 }
 
+/**
+ * Find the next ngram to insert in ngram_ord_comparator() order.
+ * Each order is already sorted, so this is the smallest of the
+ * ngrams which ptrs point at in each order, or first if it is
+ * smaller.  The ngrams are streamed from where they are rather than
+ * being copied into a queue.
+ * @return the next ngram, or NULL if there are none left.
+ */
+static ngram_raw_t *
+next_raw_ngram(ngram_raw_t ** raw_ngrams, uint32 * counts, uint32 * ptrs,
+               int order, ngram_raw_t * first)
+{
+    ngram_raw_t *top = first;
+    int i;
+
+    for (i = 2; i <= order; ++i) {
+        ngram_raw_t *head;
+
+        if (ptrs[i - 2] >= counts[i - 1])
+            continue;
+        head = &raw_ngrams[i - 2][ptrs[i - 2]];
+        if (top == NULL || ngram_ord_comparator(head, top) < 0)
+            top = head;
+    }
+    return top;
+}
+
 void
 lm_trie_fix_counts(ngram_raw_t ** raw_ngrams, uint32 * counts,
                    uint32 * fixed_counts, int order)
 {
-    priority_queue_t *ngrams =
-        priority_queue_create(order - 1, &ngram_ord_comparator);
     uint32 raw_ngram_ptrs[NGRAM_MAX_ORDER - 1];
     uint32 words[NGRAM_MAX_ORDER];
     int i;
 
     memset(words, -1, sizeof(words));
+    memset(raw_ngram_ptrs, 0, sizeof(raw_ngram_ptrs));
     memcpy(fixed_counts, counts, order * sizeof(*fixed_counts));
-    for (i = 2; i <= order; i++) {
-        ngram_raw_t *tmp_ngram;
-
-        if (counts[i - 1] <= 0)
-            continue;
-
-        raw_ngram_ptrs[i - 2] = 0;
-
-        tmp_ngram =
-            (ngram_raw_t *) ckd_calloc(1, sizeof(*tmp_ngram));
-        *tmp_ngram = raw_ngrams[i - 2][0];
-        tmp_ngram->order = i;
-        priority_queue_add(ngrams, tmp_ngram);
-    }
-
     for (;;) {
         int32 to_increment = TRUE;
         ngram_raw_t *top;
-        if (priority_queue_size(ngrams) == 0) {
+
+        if ((top = next_raw_ngram(raw_ngrams, counts, raw_ngram_ptrs,
+                                  order, NULL)) == NULL)
             break;
-        }
-        top = (ngram_raw_t *) priority_queue_poll(ngrams);
         if (top->order == 2) {
             memcpy(words, top->words, 2 * sizeof(*words));
         }
@@ -232,17 +243,7 @@ lm_trie_fix_counts(ngram_raw_t ** raw_ngrams, uint32 * counts,
         if (to_increment) {
             raw_ngram_ptrs[top->order - 2]++;
         }
-        if (raw_ngram_ptrs[top->order - 2] < counts[top->order - 1]) {
-            *top = raw_ngrams[top->order - 2][raw_ngram_ptrs[top->order - 2]];
-            priority_queue_add(ngrams, top);
-        }
-        else {
-            ckd_free(top);
-        }
     }
-
-    assert(priority_queue_size(ngrams) == 0);
-    priority_queue_free(ngrams, NULL);
 }
 
 
@@ -254,48 +255,28 @@ recursive_insert(lm_trie_t * trie, ngram_raw_t ** raw_ngrams,
     uint32 *words;
     float *probs;
     const uint32 unigram_count = (uint32) counts[0];
-    priority_queue_t *ngrams =
-        priority_queue_create(order, &ngram_ord_comparator);
-    ngram_raw_t *ngram;
+    ngram_raw_t unigram;
     uint32 *raw_ngrams_ptr;
     int i;
 
     words = (uint32 *) ckd_calloc(order, sizeof(*words));
     probs = (float *) ckd_calloc(order - 1, sizeof(*probs));
-    ngram = (ngram_raw_t *) ckd_calloc(1, sizeof(*ngram));
-    ngram->order = 1;
-    ngram->words = &unigram_idx;
-    priority_queue_add(ngrams, ngram);
+    unigram.order = 1;
+    unigram.words = &unigram_idx;
     raw_ngrams_ptr =
         (uint32 *) ckd_calloc(order - 1, sizeof(*raw_ngrams_ptr));
-    for (i = 2; i <= order; ++i) {
-        ngram_raw_t *tmp_ngram;
-
-        if (counts[i - 1] <= 0)
-            continue;
-
-        raw_ngrams_ptr[i - 2] = 0;
-        tmp_ngram =
-            (ngram_raw_t *) ckd_calloc(1, sizeof(*tmp_ngram));
-        *tmp_ngram = raw_ngrams[i - 2][0];
-        tmp_ngram->order = i;
-
-        priority_queue_add(ngrams, tmp_ngram);
-    }
 
     for (;;) {
         ngram_raw_t *top =
-            (ngram_raw_t *) priority_queue_poll(ngrams);
+            next_raw_ngram(raw_ngrams, counts, raw_ngrams_ptr,
+                           order, &unigram);
 
         if (top->order == 1) {
             trie->unigrams[unigram_idx].next = unigram_next(trie, order);
             words[0] = unigram_idx;
             probs[0] = trie->unigrams[unigram_idx].prob;
-            if (++unigram_idx == unigram_count + 1) {
-                ckd_free(top);
+            if (++unigram_idx == unigram_count + 1)
                 break;
-            }
-            priority_queue_add(ngrams, top);
         }
         else {
             for (i = 0; (uint32)i < top->order - 1; i++) {
@@ -338,19 +319,8 @@ recursive_insert(lm_trie_t * trie, ngram_raw_t ** raw_ngrams,
                                      top->prob, top->backoff);
             }
             raw_ngrams_ptr[top->order - 2]++;
-            if (raw_ngrams_ptr[top->order - 2] < counts[top->order - 1]) {
-        	*top = raw_ngrams[top->order -
-                               2][raw_ngrams_ptr[top->order - 2]];
-
-                priority_queue_add(ngrams, top);
-            }
-            else {
-                ckd_free(top);
-            }
         }
     }
-    assert(priority_queue_size(ngrams) == 0);
-    priority_queue_free(ngrams, NULL);
     ckd_free(raw_ngrams_ptr);
     ckd_free(words);
     ckd_free(probs);
@@ -362,8 +332,6 @@ lm_trie_init(uint32 unigram_count)
     lm_trie_t *trie;
 
     trie = (lm_trie_t *) ckd_calloc(1, sizeof(*trie));
-    memset(trie->hist_cache, -1, sizeof(trie->hist_cache)); /* prepare request history */
-    memset(trie->backoff_cache, 0, sizeof(trie->backoff_cache));
     trie->unigrams =
         (unigram_t *) ckd_calloc((unigram_count + 1),
                                  sizeof(*trie->unigrams));
@@ -376,10 +344,28 @@ lm_trie_create(uint32 unigram_count, int order)
 {
     lm_trie_t *trie = lm_trie_init(unigram_count);
     trie->quant =
-        (order > 1) ? lm_trie_quant_create(order) : 0;
+        (order > 1) ? lm_trie_quant_create(order, LM_TRIE_QUANT_BITS,
+                                           LM_TRIE_QUANT_BITS) : 0;
     return trie;
 }
 
+int
+lm_trie_set_quant_bits(lm_trie_t * trie, int order, int prob_bits,
+                       int bo_bits)
+{
+    lm_trie_quant_t *quant;
+
+    assert(trie->ngram_mem == NULL);
+    if (order < 2)
+        return 0;
+    if ((quant = lm_trie_quant_create(order, prob_bits, bo_bits)) == NULL)
+        return -1;
+    if (trie->quant)
+        lm_trie_quant_free(trie->quant);
+    trie->quant = quant;
+    return 0;
+}
+
 static size_t
 lm_trie_read_ug(lm_trie_t * trie, uint32 * counts, FILE * fp)
 {
@@ -400,7 +386,10 @@ lm_trie_t *
 lm_trie_read_bin(uint32 * counts, int order, FILE * fp)
 {
     lm_trie_t *trie = lm_trie_init(counts[0]);
-    trie->quant = (order > 1) ? lm_trie_quant_read_bin(fp, order) : NULL;
+    if (order > 1 && (trie->quant = lm_trie_quant_read_bin(fp, order)) == NULL) {
+        lm_trie_free(trie);
+        return NULL;
+    }
     E_INFO("pos after quant: %ld\n", ftell(fp));
     lm_trie_read_ug(trie, counts, fp);
     E_INFO("pos after ug: %ld\n", ftell(fp));
@@ -451,6 +440,10 @@ void
 lm_trie_free(lm_trie_t * trie)
 {
     if (trie->ngram_mem) {
+        middle_t *middle;
+        for (middle = trie->middle_begin; middle < trie->middle_end; ++middle)
+            base_free_index(&middle->base);
+        base_free_index(&trie->longest->base);
         ckd_free(trie->ngram_mem);
         ckd_free(trie->middle_begin);
         ckd_free(trie->longest);
@@ -560,6 +553,98 @@ calc_pivot(uint32 off, uint32 range, uint32 width)
     return (size_t) ((off * width) / (range + 1));
 }
 
+static void
+base_build_index(base_t * base, uint32 entries)
+{
+    bitarr_address_t address;
+    uint32 i;
+
+    base->words = (uint32 *) ckd_calloc(entries + 1, sizeof(*base->words));
+    base->heads = (uint32 *) ckd_calloc(entries / LM_TRIE_BLOCK_SIZE + 1,
+                                        sizeof(*base->heads));
+    address.base = base->base;
+    for (i = 0; i < entries; ++i) {
+        address.offset = i * base->total_bits;
+        base->words[i] =
+            bitarr_read_int25(address, base->word_bits, base->word_mask);
+        if (i % LM_TRIE_BLOCK_SIZE == 0)
+            base->heads[i / LM_TRIE_BLOCK_SIZE] = base->words[i];
+    }
+}
+
+static void
+base_free_index(base_t * base)
+{
+    ckd_free(base->words);
+    ckd_free(base->heads);
+    base->words = base->heads = NULL;
+}
+
+size_t
+lm_trie_build_index(lm_trie_t * trie, uint32 * counts, int order)
+{
+    size_t size = 0;
+    int i;
+
+    if (order < 2)
+        return 0;
+    for (i = 2; i < order; ++i) {
+        base_t *base = &trie->middle_begin[i - 2].base;
+        base_free_index(base);
+        base_build_index(base, counts[i - 1]);
+        size += (counts[i - 1] + 1) * sizeof(*base->words)
+            + (counts[i - 1] / LM_TRIE_BLOCK_SIZE + 1) * sizeof(*base->heads);
+    }
+    base_free_index(&trie->longest->base);
+    base_build_index(&trie->longest->base, counts[order - 1]);
+    size += (counts[order - 1] + 1) * sizeof(uint32)
+        + (counts[order - 1] / LM_TRIE_BLOCK_SIZE + 1) * sizeof(uint32);
+    return size;
+}
+
+/**
+ * Find a word among the children [begin, end) of a history using the
+ * index: binary search over block heads, then scan within one block.
+ */
+static uint8
+index_find(base_t * base, uint32 begin, uint32 end, uint32 key,
+           uint32 * out)
+{
+    const uint32 *words = base->words;
+
+    if (end - begin > LM_TRIE_BLOCK_SIZE) {
+        /* Blocks whose first word is inside the range. */
+        uint32 lo = begin / LM_TRIE_BLOCK_SIZE + 1;
+        uint32 hi = (end - 1) / LM_TRIE_BLOCK_SIZE + 1;
+
+        if (base->heads[lo] > key) {
+            end = lo * LM_TRIE_BLOCK_SIZE;
+        }
+        else {
+            /* Find the last block starting at or before key. */
+            while (hi - lo > 1) {
+                uint32 mid = lo + (hi - lo) / 2;
+                if (base->heads[mid] <= key)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            begin = lo * LM_TRIE_BLOCK_SIZE;
+            if (end > begin + LM_TRIE_BLOCK_SIZE)
+                end = begin + LM_TRIE_BLOCK_SIZE;
+        }
+    }
+    for (; begin < end; ++begin) {
+        if (words[begin] >= key) {
+            if (words[begin] != key)
+                return FALSE;
+            *out = begin;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 static uint8
 uniform_find(void *base, uint8 total_bits, uint8 key_bits, uint32 key_mask,
              uint32 before_it, uint32 before_v,
@@ -604,7 +689,10 @@ middle_find(middle_t * middle, uint32 word, node_range_t * range)
     bitarr_address_t address;
 
     /* finding BitPacked with uniform find */
-    if (!uniform_find
+    if (middle->base.words
+        ? !index_find(&middle->base, range->begin, range->end, word,
+                      &at_pointer)
+        : !uniform_find
         ((void *) middle->base.base, middle->base.total_bits,
          middle->base.word_bits, middle->base.word_mask, range->begin - 1,
          0, range->end, middle->base.max_vocab, word, &at_pointer)) {
@@ -636,7 +724,10 @@ longest_find(longest_t * longest, uint32 word, node_range_t * range)
     bitarr_address_t address;
 
     /* finding BitPacked with uniform find */
-    if (!uniform_find
+    if (longest->base.words
+        ? !index_find(&longest->base, range->begin, range->end, word,
+                      &at_pointer)
+        : !uniform_find
         ((void *) longest->base.base, longest->base.total_bits,
          longest->base.word_bits, longest->base.word_mask,
          range->begin - 1, 0, range->end, longest->base.max_vocab, word,
@@ -740,11 +831,34 @@ lm_trie_nobo_score(lm_trie_t * trie, int32 wid, int32 * hist,
     return prob + get_available_backoff(trie, *n_used, hist, n_hist);
 }
 
+static void
+get_hist_backoff(lm_trie_t * trie, int32 * hist, int32 n_hist,
+                 float *backoff)
+{
+    int i;
+    node_range_t node;
+    bitarr_address_t address;
+
+    memset(backoff, 0, n_hist * sizeof(*backoff));
+    backoff[0] = unigram_find(trie->unigrams, hist[0], &node)->bo;
+    for (i = 1; i < n_hist; i++) {
+        address = middle_find(&trie->middle_begin[i - 1], hist[i], &node);
+        if (address.base == NULL) {
+            break;
+        }
+        backoff[i] = lm_trie_quant_mboread(trie->quant, address, i - 1);
+    }
+}
+
+/**
+ * Score a word with a full-length history.  If backoff is NULL, the
+ * history's backoff weights are looked up only if needed.
+ */
 static float
 lm_trie_hist_score(lm_trie_t * trie, int32 wid, int32 * hist, int32 n_hist,
-                   int32 * n_used)
+                   float *backoff, int32 * n_used)
 {
-    float prob;
+    float prob, local_backoff[NGRAM_MAX_ORDER];
     int i, j;
     node_range_t node;
     bitarr_address_t address;
@@ -756,8 +870,12 @@ lm_trie_hist_score(lm_trie_t * trie, int32 wid, int32 * hist, int32 n_hist,
     for (i = 0; i < n_hist - 1; i++) {
         address = middle_find(&trie->middle_begin[i], hist[i], &node);
         if (address.base == NULL) {
+            if (backoff == NULL) {
+                backoff = local_backoff;
+                get_hist_backoff(trie, hist, n_hist, backoff);
+            }
             for (j = i; j < n_hist; j++) {
-                prob += trie->backoff_cache[j];
+                prob += backoff[j];
             }
             return prob;
         }
@@ -768,7 +886,11 @@ lm_trie_hist_score(lm_trie_t * trie, int32 wid, int32 * hist, int32 n_hist,
     }
     address = longest_find(trie->longest, hist[n_hist - 1], &node);
     if (address.base == NULL) {
-        return prob + trie->backoff_cache[n_hist - 1];
+        if (backoff == NULL) {
+            backoff = local_backoff;
+            get_hist_backoff(trie, hist, n_hist, backoff);
+        }
+        return prob + backoff[n_hist - 1];
     }
     else {
         (*n_used)++;
@@ -776,38 +898,6 @@ lm_trie_hist_score(lm_trie_t * trie, int32 wid, int32 * hist, int32 n_hist,
     }
 }
 
-static uint8
-history_matches(int32 * hist, int32 * prev_hist, int32 n_hist)
-{
-    int i;
-    for (i = 0; i < n_hist; i++) {
-        if (hist[i] != prev_hist[i]) {
-            return FALSE;
-        }
-    }
-    return TRUE;
-}
-
-static void
-update_backoff(lm_trie_t * trie, int32 * hist, int32 n_hist)
-{
-    int i;
-    node_range_t node;
-    bitarr_address_t address;
-
-    memset(trie->backoff_cache, 0, sizeof(trie->backoff_cache));
-    trie->backoff_cache[0] = unigram_find(trie->unigrams, hist[0], &node)->bo;
-    for (i = 1; i < n_hist; i++) {
-        address = middle_find(&trie->middle_begin[i - 1], hist[i], &node);
-        if (address.base == NULL) {
-            break;
-        }
-        trie->backoff_cache[i] =
-            lm_trie_quant_mboread(trie->quant, address, i - 1);
-    }
-    memcpy(trie->hist_cache, hist, n_hist * sizeof(*hist));
-}
-
 float
 lm_trie_score(lm_trie_t * trie, int order, int32 wid, int32 * hist,
               int32 n_hist, int32 * n_used)
@@ -817,10 +907,48 @@ lm_trie_score(lm_trie_t * trie, int order, int32 wid, int32 * hist,
     }
     else {
         assert(n_hist == order - 1);
-        if (!history_matches(hist, (int32 *) trie->hist_cache, n_hist)) {
-            update_backoff(trie, hist, n_hist);
+        return lm_trie_hist_score(trie, wid, hist, n_hist, NULL, n_used);
+    }
+}
+
+void
+lm_trie_score_words(lm_trie_t * trie, int order, int32 * wids,
+                    int32 n_wids, int32 * hist, int32 n_hist,
+                    int32 * out_scores)
+{
+    float backoff[NGRAM_MAX_ORDER];
+    node_range_t node;
+    int32 i, j, n_used;
+
+    if (n_hist < order - 1) {
+        for (i = 0; i < n_wids; ++i)
+            out_scores[i] = (int32) lm_trie_nobo_score(trie, wids[i], hist,
+                                                       order, n_hist,
+                                                       &n_used);
+        return;
+    }
+    assert(n_hist == order - 1);
+    if (n_hist == 0) {
+        for (i = 0; i < n_wids; ++i)
+            out_scores[i] = (int32) trie->unigrams[wids[i]].prob;
+        return;
+    }
+    /* Look up the history's backoff weights once for all words. */
+    get_hist_backoff(trie, hist, n_hist, backoff);
+    for (i = 0; i < n_wids; ++i) {
+        float prob = unigram_find(trie->unigrams, wids[i], &node)->prob;
+        /* Most words start no N-Grams at all, so skip the descent
+         * and back off all the way (in the same order as
+         * lm_trie_hist_score(), so results are identical). */
+        if (node.begin == node.end) {
+            for (j = 0; j < n_hist; ++j)
+                prob += backoff[j];
+            out_scores[i] = (int32) prob;
         }
-        return lm_trie_hist_score(trie, wid, hist, n_hist, n_used);
+        else
+            out_scores[i] = (int32) lm_trie_hist_score(trie, wids[i], hist,
+                                                       n_hist, backoff,
+                                                       &n_used);
     }
 }
 
@@ -904,6 +1032,7 @@ lm_trie_fill_raw_ngram(lm_trie_t * trie,
                 raw_ngram->backoff = backoff;
             }
             raw_ngram->prob = prob;
+            raw_ngram->order = order;
             raw_ngram->words =
                 (uint32 *) ckd_calloc(order, sizeof(*raw_ngram->words));
             for (i = 0; i <= n_hist; i++) {
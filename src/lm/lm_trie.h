@@ -54,6 +54,12 @@ typedef struct node_range_s {
     uint32 end;
 } node_range_t;
 
+/**
+ * Number of word ids in a search block of the optional index, one
+ * 64-byte cache line.
+ */
+#define LM_TRIE_BLOCK_SIZE 16
+
 typedef struct base_s {
     uint8 word_bits;
     uint8 total_bits;
@@ -61,6 +67,8 @@ typedef struct base_s {
     uint8 *base;
     uint32 insert_index;
     uint32 max_vocab;
+    uint32 *words;  /**< Optional unpacked copy of word ids, for searching. */
+    uint32 *heads;  /**< First word id of each block of words. */
 } base_t;
 
 typedef struct middle_s {
@@ -83,9 +91,6 @@ typedef struct lm_trie_s {
     middle_t *middle_end;
     longest_t *longest;
     lm_trie_quant_t *quant;
-
-    float backoff_cache[NGRAM_MAX_ORDER];
-    uint32 hist_cache[NGRAM_MAX_ORDER - 1];
 } lm_trie_t;
 
 /**
@@ -93,6 +98,14 @@ typedef struct lm_trie_s {
  */
 lm_trie_t *lm_trie_create(uint32 unigram_count, int order);
 
+/**
+ * Change the number of bits used to quantize weights.  This must be
+ * done before lm_trie_build().
+ * @return 0, or -1 if bits are out of range (trie is unchanged)
+ */
+int lm_trie_set_quant_bits(lm_trie_t * trie, int order, int prob_bits,
+                           int bo_bits);
+
 lm_trie_t *lm_trie_read_bin(uint32 * counts, int order, FILE * fp);
 
 void lm_trie_write_bin(lm_trie_t * trie, uint32 unigram_count, FILE * fp);
@@ -102,12 +115,44 @@ void lm_trie_free(lm_trie_t * trie);
 void lm_trie_build(lm_trie_t * trie, ngram_raw_t ** raw_ngrams,
                    uint32 * counts, uint32 *out_counts, int order);
 
+/**
+ * Build an index for faster lookup of N-Grams.
+ *
+ * The word ids of N-Grams of each order are copied out of the
+ * bit-packed trie into a separate array, where the children of each
+ * history can be searched a cache line at a time, starting from a
+ * sparse array of the first word in each cache-line-sized block.
+ * This adds 4.25 bytes per N-Gram to the memory used by the model.
+ *
+ * @param counts Number of N-Grams of each order.
+ * @return Number of bytes used by the index.
+ */
+size_t lm_trie_build_index(lm_trie_t * trie, uint32 * counts, int order);
+
 void lm_trie_fill_raw_ngram(lm_trie_t * trie,
 			    ngram_raw_t * raw_ngrams, uint32 * raw_ngram_idx,
             	            uint32 * counts, node_range_t range, uint32 * hist,
     	                    int n_hist, int order, int max_order);
 
+/**
+ * Score a word following a history.
+ *
+ * This does not modify the trie, so it is safe to call concurrently
+ * from several threads.
+ */
 float lm_trie_score(lm_trie_t * trie, int order, int32 wid, int32 * hist,
                     int32 n_hist, int32 * n_used);
 
+/**
+ * Score several words following the same history.
+ *
+ * The backoff weights for the history are looked up only once, and
+ * words with no higher-order N-Grams skip the trie descent entirely.
+ * Scores are identical to those from lm_trie_score(), truncated to
+ * integers.  wids and out_scores may be the same array.
+ */
+void lm_trie_score_words(lm_trie_t * trie, int order, int32 * wids,
+                         int32 n_wids, int32 * hist, int32 n_hist,
+                         int32 * out_scores);
+
 #endif                          /* __LM_TRIE_H__ */
@@ -112,10 +112,8 @@ bins_decode(bins_t * bins, size_t off)
 }
 
 static size_t
-quant_size(int order)
+quant_size(int order, int prob_bits, int bo_bits)
 {
-    int prob_bits = 16;
-    int bo_bits = 16;
     size_t longest_table = (1U << prob_bits);
     size_t middle_table = (1U << bo_bits) + longest_table;
     /* unigrams are currently not quantized so no need for a table. */
@@ -123,18 +121,25 @@ quant_size(int order)
 }
 
 lm_trie_quant_t *
-lm_trie_quant_create(int order)
+lm_trie_quant_create(int order, int prob_bits, int bo_bits)
 {
     float32 *start;
     int i;
-    lm_trie_quant_t *quant =
-        (lm_trie_quant_t *) ckd_calloc(1, sizeof(*quant));
-    quant->nvalues = quant_size(order);
+    lm_trie_quant_t *quant;
+
+    if (prob_bits < 1 || prob_bits > LM_TRIE_QUANT_BITS
+        || bo_bits < 1 || bo_bits > LM_TRIE_QUANT_BITS) {
+        E_ERROR("Quantization bits must be between 1 and %d\n",
+                LM_TRIE_QUANT_BITS);
+        return NULL;
+    }
+    quant = (lm_trie_quant_t *) ckd_calloc(1, sizeof(*quant));
+    quant->nvalues = quant_size(order, prob_bits, bo_bits);
     quant->values =
         (float32 *) ckd_calloc(quant->nvalues, sizeof(*quant->values));
 
-    quant->prob_bits = 16;
-    quant->bo_bits = 16;
+    quant->prob_bits = prob_bits;
+    quant->bo_bits = bo_bits;
     quant->prob_mask = (1U << quant->prob_bits) - 1;
     quant->bo_mask = (1U << quant->bo_bits) - 1;
 
@@ -154,11 +159,30 @@ lm_trie_quant_create(int order)
 lm_trie_quant_t *
 lm_trie_quant_read_bin(FILE * fp, int order)
 {
-    int dummy;
+    int32 header;
+    int prob_bits, bo_bits;
     lm_trie_quant_t *quant;
 
-    fread(&dummy, sizeof(dummy), 1, fp);
-    quant = lm_trie_quant_create(order);
+    if (fread(&header, sizeof(header), 1, fp) != 1) {
+        E_ERROR("Failed to read quantization header\n");
+        return NULL;
+    }
+    if (SWAP_LM_TRIE)
+        SWAP_INT32(&header);
+    /* Old files just have 1 here, in either byte order. */
+    if (header == 1 || header == 0x01000000) {
+        prob_bits = bo_bits = LM_TRIE_QUANT_BITS;
+    }
+    else if ((header >> 16) == 2) {
+        prob_bits = (header >> 8) & 0xff;
+        bo_bits = header & 0xff;
+    }
+    else {
+        E_ERROR("Unknown quantization type %d\n", header);
+        return NULL;
+    }
+    if ((quant = lm_trie_quant_create(order, prob_bits, bo_bits)) == NULL)
+        return NULL;
     if (fread(quant->values, sizeof(*quant->values),
               quant->nvalues, fp) != quant->nvalues) {
         E_ERROR("Failed to read %d quantization values\n",
@@ -178,9 +202,15 @@ lm_trie_quant_read_bin(FILE * fp, int order)
 void
 lm_trie_quant_write_bin(lm_trie_quant_t * quant, FILE * fp)
 {
-    /* Before it was quantization type */
-    int dummy = 1;
-    fwrite(&dummy, sizeof(dummy), 1, fp);
+    /* Quantization type, then bits (unless they are the default, to
+     * stay readable by older versions). */
+    int32 header = 1;
+    if (quant->prob_bits != LM_TRIE_QUANT_BITS
+        || quant->bo_bits != LM_TRIE_QUANT_BITS)
+        header = (2 << 16) | (quant->prob_bits << 8) | quant->bo_bits;
+    if (SWAP_LM_TRIE)
+        SWAP_INT32(&header);
+    fwrite(&header, sizeof(header), 1, fp);
     if (SWAP_LM_TRIE) {
         size_t i;
         for (i = 0; i < quant->nvalues; ++i) {
@@ -212,15 +242,13 @@ lm_trie_quant_free(lm_trie_quant_t * quant)
 uint8
 lm_trie_quant_msize(lm_trie_quant_t * quant)
 {
-    (void)quant;
-    return 32;
+    return quant->prob_bits + quant->bo_bits;
 }
 
 uint8
 lm_trie_quant_lsize(lm_trie_quant_t * quant)
 {
-    (void)quant;
-    return 16;
+    return quant->prob_bits;
 }
 
 static int
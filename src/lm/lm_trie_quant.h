@@ -53,12 +53,21 @@
 #endif
 
 
+/**
+ * Default (and maximum) number of bits for quantized weights.
+ */
+#define LM_TRIE_QUANT_BITS 16
+
 typedef struct lm_trie_quant_s lm_trie_quant_t;
 
 /**
  * Create qunatizing
+ * @param prob_bits bits per quantized probability, at most LM_TRIE_QUANT_BITS
+ * @param bo_bits bits per quantized backoff, at most LM_TRIE_QUANT_BITS
+ * @return new quantizer, or NULL if bits are out of range
  */
-lm_trie_quant_t *lm_trie_quant_create(int order);
+lm_trie_quant_t *lm_trie_quant_create(int order, int prob_bits,
+                                      int bo_bits);
 
 /**
  * Write quant data to binary file
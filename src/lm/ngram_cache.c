@@ -0,0 +1,262 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file ngram_cache.c
+ * @brief Direct-mapped cache of N-Gram scores
+ */
+
+#include <string.h>
+
+#include <pocketsphinx/err.h>
+
+#include "util/ckd_alloc.h"
+#include "lm/ngram_model.h"
+#include "lm/ngram_cache.h"
+
+#define NGRAM_CACHE_DEFAULT_SIZE (1 << 16)
+
+/**
+ * One cache slot.  A slot is valid only if its generation matches
+ * that of the cache, which lets us invalidate everything at once.
+ */
+typedef struct ngram_cache_ent_s {
+    int32 wid;       /**< Word being scored. */
+    int32 hist[2];   /**< Most recent history words. */
+    int32 score;     /**< Cached score. */
+    uint32 gen;      /**< Generation in which this slot was filled. */
+    int16 n_hist;    /**< Length of history in the key. */
+    int16 n_used;    /**< N-Gram order used to compute score. */
+} ngram_cache_ent_t;
+
+struct ngram_cache_s {
+    ngram_model_t *model;   /**< Language model being cached. */
+    ngram_cache_ent_t *ent; /**< Slots. */
+    uint32 mask;            /**< Number of slots minus one. */
+    uint32 gen;             /**< Current generation (never 0). */
+    int32 n_hit;            /**< Number of lookups found in the cache. */
+    int32 n_miss;           /**< Number of lookups passed to the model. */
+    int32 *miss_idx;        /**< Batch positions of words not found. */
+    int32 *miss_wid;        /**< Words not found in a batch. */
+    int32 *miss_scr;        /**< Scores for miss_wid. */
+    int32 n_miss_alloc;     /**< Allocated size of the miss arrays. */
+};
+
+ngram_cache_t *
+ngram_cache_init(ngram_model_t *model, int32 n_ent)
+{
+    ngram_cache_t *cache;
+    uint32 size;
+
+    if (n_ent <= 0)
+        n_ent = NGRAM_CACHE_DEFAULT_SIZE;
+    for (size = 1; size < (uint32)n_ent; size <<= 1)
+        ;
+    cache = ckd_calloc(1, sizeof(*cache));
+    cache->model = ngram_model_retain(model);
+    cache->ent = ckd_calloc(size, sizeof(*cache->ent));
+    cache->mask = size - 1;
+    cache->gen = 1;
+    return cache;
+}
+
+void
+ngram_cache_free(ngram_cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+    ngram_model_free(cache->model);
+    ckd_free(cache->ent);
+    ckd_free(cache->miss_idx);
+    ckd_free(cache->miss_wid);
+    ckd_free(cache->miss_scr);
+    ckd_free(cache);
+}
+
+void
+ngram_cache_reset(ngram_cache_t *cache)
+{
+    /* On wraparound, old slots could look valid again, so clear them. */
+    if (++cache->gen == 0) {
+        memset(cache->ent, 0, (cache->mask + 1) * sizeof(*cache->ent));
+        cache->gen = 1;
+    }
+    cache->n_hit = cache->n_miss = 0;
+}
+
+ngram_model_t *
+ngram_cache_model(ngram_cache_t *cache)
+{
+    return cache->model;
+}
+
+static ngram_cache_ent_t *
+ngram_cache_slot(ngram_cache_t *cache, int32 wid, int32 *hist, int32 n_hist)
+{
+    uint32 h;
+
+    h = (uint32)wid * 0x9e3779b1U
+        ^ (uint32)hist[0] * 0x85ebca77U
+        ^ (uint32)hist[1] * 0xc2b2ae3dU
+        ^ (uint32)n_hist;
+    h ^= h >> 16;
+    return cache->ent + (h & cache->mask);
+}
+
+#define ngram_cache_match(cache,ent,w,h,nh)             \
+    ((ent)->gen == (cache)->gen                         \
+     && (ent)->wid == (w)                               \
+     && (ent)->hist[0] == (h)[0]                        \
+     && (ent)->hist[1] == (h)[1]                        \
+     && (ent)->n_hist == (nh))
+
+static int32
+ngram_cache_score(ngram_cache_t *cache, int32 wid,
+                  int32 *hist, int32 n_hist, int32 *n_used)
+{
+    ngram_cache_ent_t *ent;
+
+    ent = ngram_cache_slot(cache, wid, hist, n_hist);
+    /* Entries filled by ngram_cache_tg_score_words() don't know
+     * which order was used, so they can't answer this. */
+    if (ngram_cache_match(cache, ent, wid, hist, n_hist)
+        && ent->n_used != 0) {
+        ++cache->n_hit;
+        *n_used = ent->n_used;
+        return ent->score;
+    }
+    ++cache->n_miss;
+    ent->gen = cache->gen;
+    ent->wid = wid;
+    ent->hist[0] = hist[0];
+    ent->hist[1] = hist[1];
+    ent->n_hist = n_hist;
+    /* ngram_ng_score() may rewrite class words in the history, so
+     * the key is copied above before calling it. */
+    ent->score = ngram_ng_score(cache->model, wid, hist, n_hist, n_used);
+    ent->n_used = *n_used;
+    return ent->score;
+}
+
+int32
+ngram_cache_tg_score(ngram_cache_t *cache,
+                     int32 w3, int32 w2, int32 w1,
+                     int32 *n_used)
+{
+    int32 hist[2];
+    hist[0] = w2;
+    hist[1] = w1;
+    return ngram_cache_score(cache, w3, hist, 2, n_used);
+}
+
+int32
+ngram_cache_bg_score(ngram_cache_t *cache,
+                     int32 w2, int32 w1,
+                     int32 *n_used)
+{
+    int32 hist[2];
+    hist[0] = w1;
+    hist[1] = NGRAM_INVALID_WID;
+    return ngram_cache_score(cache, w2, hist, 1, n_used);
+}
+
+void
+ngram_cache_tg_score_words(ngram_cache_t *cache,
+                           int32 const *wids, int32 n_wids,
+                           int32 w2, int32 w1,
+                           int32 *out_scores)
+{
+    int32 hist[2], key[2];
+    int32 i, n_miss;
+
+    if (n_wids > cache->n_miss_alloc) {
+        cache->n_miss_alloc = n_wids;
+        cache->miss_idx = ckd_realloc(cache->miss_idx,
+                                      n_wids * sizeof(*cache->miss_idx));
+        cache->miss_wid = ckd_realloc(cache->miss_wid,
+                                      n_wids * sizeof(*cache->miss_wid));
+        cache->miss_scr = ckd_realloc(cache->miss_scr,
+                                      n_wids * sizeof(*cache->miss_scr));
+    }
+    /* Take what we can from the cache. */
+    hist[0] = w2;
+    hist[1] = w1;
+    for (i = n_miss = 0; i < n_wids; ++i) {
+        ngram_cache_ent_t *ent
+            = ngram_cache_slot(cache, wids[i], hist, 2);
+        if (ngram_cache_match(cache, ent, wids[i], hist, 2))
+            out_scores[i] = ent->score;
+        else {
+            cache->miss_idx[n_miss] = i;
+            cache->miss_wid[n_miss] = wids[i];
+            ++n_miss;
+        }
+    }
+    cache->n_hit += n_wids - n_miss;
+    cache->n_miss += n_miss;
+    if (n_miss == 0)
+        return;
+
+    /* Score the rest at once and remember them (the model may
+     * rewrite class words in the history, so give it a copy). */
+    key[0] = hist[0];
+    key[1] = hist[1];
+    ngram_ng_score_words(cache->model, cache->miss_wid, n_miss,
+                         key, 2, cache->miss_scr);
+    for (i = 0; i < n_miss; ++i) {
+        int32 wid = wids[cache->miss_idx[i]];
+        ngram_cache_ent_t *ent = ngram_cache_slot(cache, wid, hist, 2);
+        ent->gen = cache->gen;
+        ent->wid = wid;
+        ent->hist[0] = hist[0];
+        ent->hist[1] = hist[1];
+        ent->n_hist = 2;
+        ent->n_used = 0;
+        ent->score = cache->miss_scr[i];
+        out_scores[cache->miss_idx[i]] = cache->miss_scr[i];
+    }
+}
+
+int32
+ngram_cache_stats(ngram_cache_t *cache,
+                  int32 *out_n_hit, int32 *out_n_miss)
+{
+    if (out_n_hit)
+        *out_n_hit = cache->n_hit;
+    if (out_n_miss)
+        *out_n_miss = cache->n_miss;
+    return cache->n_hit + cache->n_miss;
+}
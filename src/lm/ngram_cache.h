@@ -0,0 +1,139 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file ngram_cache.h
+ * @brief Direct-mapped cache of N-Gram scores
+ *
+ * The search calls ngram_tg_score() for the same (word, history)
+ * tuples over and over again, from word transitions in every frame
+ * and again when scoring the backpointer table.  This cache sits in
+ * front of a language model (usually a set) and remembers the most
+ * recent score for each slot.  It is owned by the caller, not the
+ * model, so that several decoders can share one model.
+ */
+
+#ifndef __NGRAM_CACHE_H__
+#define __NGRAM_CACHE_H__
+
+#include <pocketsphinx/prim_type.h>
+#include <pocketsphinx/model.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/**
+ * N-Gram score cache object.
+ */
+typedef struct ngram_cache_s ngram_cache_t;
+
+/**
+ * Create a score cache for a language model.
+ *
+ * @param model Language model to cache scores from.  A reference is
+ *              retained.
+ * @param n_ent Number of cache entries, rounded up to a power of
+ *              two, or 0 for a default size.
+ */
+ngram_cache_t *ngram_cache_init(ngram_model_t *model, int32 n_ent);
+
+/**
+ * Free a score cache and release its language model.
+ */
+void ngram_cache_free(ngram_cache_t *cache);
+
+/**
+ * Invalidate all entries in a score cache, in constant time.
+ *
+ * This must be called whenever the scores of the underlying model
+ * may have changed, e.g. after changing weights, adding words, or
+ * selecting a different model from a set.  Also resets statistics.
+ */
+void ngram_cache_reset(ngram_cache_t *cache);
+
+/**
+ * Get the language model behind a score cache.
+ */
+ngram_model_t *ngram_cache_model(ngram_cache_t *cache);
+
+/**
+ * Cached equivalent of ngram_tg_score().
+ */
+int32 ngram_cache_tg_score(ngram_cache_t *cache,
+                           int32 w3, int32 w2, int32 w1,
+                           int32 *n_used);
+
+/**
+ * Cached equivalent of ngram_bg_score().
+ */
+int32 ngram_cache_bg_score(ngram_cache_t *cache,
+                           int32 w2, int32 w1,
+                           int32 *n_used);
+
+/**
+ * Cached equivalent of ngram_ng_score_words() with a two-word
+ * history.  Words not found in the cache are scored in one call to
+ * the model.
+ *
+ * @param wids Words to score.
+ * @param n_wids Number of words in wids.
+ * @param w2 Most recent history word.
+ * @param w1 History word before w2.
+ * @param out_scores Output: score for each word in wids.
+ */
+void ngram_cache_tg_score_words(ngram_cache_t *cache,
+                                int32 const *wids, int32 n_wids,
+                                int32 w2, int32 w1,
+                                int32 *out_scores);
+
+/**
+ * Get hit and miss counts since the last ngram_cache_reset().
+ *
+ * @return Number of lookups.
+ */
+int32 ngram_cache_stats(ngram_cache_t *cache,
+                        int32 *out_n_hit, int32 *out_n_miss);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NGRAM_CACHE_H__ */
@@ -46,6 +46,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 
 #include <pocketsphinx/err.h>
 #include <pocketsphinx/logmath.h>
@@ -176,6 +177,9 @@ ngram_model_read(cmd_ln_t * config,
             wip = ps_config_float(config, "wip");
 
         ngram_model_apply_weights(model, lw, wip);
+        if (ps_config_typeof(config, "lmindex")
+            && ps_config_bool(config, "lmindex"))
+            ngram_model_trie_index(model);
     }
 
     return model;
@@ -416,6 +420,38 @@ ngram_ng_score(ngram_model_t * model, int32 wid, int32 * history,
     return score + class_weight;
 }
 
+int32
+ngram_ng_score_words(ngram_model_t * model, int32 * wids, int32 n_wids,
+                     int32 * history, int32 n_hist, int32 * out_scores)
+{
+    int32 hist[NGRAM_MAX_ORDER];
+    int32 i, n_used;
+
+    /* "Declassify" history once for all words */
+    if (n_hist > NGRAM_MAX_ORDER)
+        n_hist = NGRAM_MAX_ORDER;
+    for (i = 0; i < n_hist; ++i) {
+        if (history[i] != NGRAM_INVALID_WID
+            && NGRAM_IS_CLASSWID(history[i]))
+            hist[i] = model->classes[NGRAM_CLASSID(history[i])]->tag_wid;
+        else
+            hist[i] = history[i];
+    }
+    if (model->funcs->score_words) {
+        for (i = 0; i < n_wids; ++i)
+            if (wids[i] == NGRAM_INVALID_WID || NGRAM_IS_CLASSWID(wids[i]))
+                break;
+        if (i == n_wids
+            && (*model->funcs->score_words) (model, wids, n_wids,
+                                              hist, n_hist,
+                                              out_scores) >= 0)
+            return n_wids;
+    }
+    for (i = 0; i < n_wids; ++i)
+        out_scores[i] = ngram_ng_score(model, wids[i], hist, n_hist, &n_used);
+    return n_wids;
+}
+
 int32
 ngram_score(ngram_model_t * model, const char *word, ...)
 {
@@ -703,6 +739,8 @@ ngram_class_new(ngram_model_t * model, int32 tag_wid, int32 start_wid,
     lmclass->prob1 = ckd_calloc(lmclass->n_words, sizeof(*lmclass->prob1));
     lmclass->nword_hash = NULL;
     lmclass->n_hash = 0;
+    lmclass->members = NULL;
+    lmclass->n_members = 0;
     tprob = 0.0;
     for (gn = classwords; gn; gn = gnode_next(gn)) {
         tprob += gnode_float32(gn);
@@ -720,69 +758,79 @@ ngram_class_new(ngram_model_t * model, int32 tag_wid, int32 start_wid,
     return lmclass;
 }
 
-int32
-ngram_class_add_word(ngram_class_t * lmclass, int32 wid, int32 lweight)
+/*
+ * Insert a word in a class's hash table, which must have a free
+ * bucket.  Collisions are chained through the next free bucket.
+ */
+static int32
+ngram_class_hash_insert(ngram_class_t * lmclass, int32 wid, int32 lweight)
 {
-    int32 hash;
+    int32 hash, next;
 
-    if (lmclass->nword_hash == NULL) {
-        /* Initialize everything in it to -1 */
-        lmclass->nword_hash =
-            ckd_malloc(NGRAM_HASH_SIZE * sizeof(*lmclass->nword_hash));
-        memset(lmclass->nword_hash, 0xff,
-               NGRAM_HASH_SIZE * sizeof(*lmclass->nword_hash));
-        lmclass->n_hash = NGRAM_HASH_SIZE;
-        lmclass->n_hash_inuse = 0;
-    }
     /* Stupidest possible hash function.  This will work pretty well
      * when this function is called repeatedly with contiguous word
      * IDs, though... */
     hash = wid & (lmclass->n_hash - 1);
     if (lmclass->nword_hash[hash].wid == -1) {
         /* Good, no collision. */
-        lmclass->nword_hash[hash].wid = wid;
-        lmclass->nword_hash[hash].prob1 = lweight;
-        ++lmclass->n_hash_inuse;
-        return hash;
+        next = hash;
     }
     else {
-        int32 next; /**< Next available bucket. */
         /* Collision... Find the end of the hash chain. */
         while (lmclass->nword_hash[hash].next != -1)
             hash = lmclass->nword_hash[hash].next;
-        assert(hash != -1);
-        /* Does we has any more bukkit? */
-        if (lmclass->n_hash_inuse == lmclass->n_hash) {
-            /* Oh noes!  Ok, we makes more. */
-            lmclass->nword_hash = ckd_realloc(lmclass->nword_hash,
-                                              lmclass->n_hash * 2 *
-                                              sizeof(*lmclass->
-                                                     nword_hash));
-            memset(lmclass->nword_hash + lmclass->n_hash, 0xff,
-                   lmclass->n_hash * sizeof(*lmclass->nword_hash));
-            /* Just use the next allocated one (easy) */
-            next = lmclass->n_hash;
-            lmclass->n_hash *= 2;
-        }
-        else {
-            /* Look for any available bucket.  We hope this doesn't happen. */
-            for (next = 0; next < lmclass->n_hash; ++next)
-                if (lmclass->nword_hash[next].wid == -1)
-                    break;
-            /* This should absolutely not happen. */
-            assert(next != lmclass->n_hash);
-        }
-        lmclass->nword_hash[next].wid = wid;
-        lmclass->nword_hash[next].prob1 = lweight;
+        /* Look for any available bucket.  We hope this doesn't happen. */
+        for (next = 0; next < lmclass->n_hash; ++next)
+            if (lmclass->nword_hash[next].wid == -1)
+                break;
+        /* This should absolutely not happen. */
+        assert(next != lmclass->n_hash);
         lmclass->nword_hash[hash].next = next;
-        ++lmclass->n_hash_inuse;
-        return next;
     }
+    lmclass->nword_hash[next].wid = wid;
+    lmclass->nword_hash[next].prob1 = lweight;
+    ++lmclass->n_hash_inuse;
+    return next;
+}
+
+int32
+ngram_class_add_word(ngram_class_t * lmclass, int32 wid, int32 lweight)
+{
+    if (lmclass->nword_hash == NULL) {
+        /* Initialize everything in it to -1 */
+        lmclass->nword_hash =
+            ckd_malloc(NGRAM_HASH_SIZE * sizeof(*lmclass->nword_hash));
+        memset(lmclass->nword_hash, 0xff,
+               NGRAM_HASH_SIZE * sizeof(*lmclass->nword_hash));
+        lmclass->n_hash = NGRAM_HASH_SIZE;
+        lmclass->n_hash_inuse = 0;
+    }
+    /* Does we has any more bukkit? */
+    if (lmclass->n_hash_inuse == lmclass->n_hash) {
+        struct ngram_hash_s *old_hash = lmclass->nword_hash;
+        int32 i, n_old = lmclass->n_hash;
+
+        /* Oh noes!  Ok, we makes more, and puts everything back
+         * where lookups with the bigger hash will find it. */
+        lmclass->n_hash *= 2;
+        lmclass->nword_hash = ckd_malloc(lmclass->n_hash *
+                                         sizeof(*lmclass->nword_hash));
+        memset(lmclass->nword_hash, 0xff,
+               lmclass->n_hash * sizeof(*lmclass->nword_hash));
+        lmclass->n_hash_inuse = 0;
+        for (i = 0; i < n_old; ++i)
+            if (old_hash[i].wid != -1)
+                ngram_class_hash_insert(lmclass, old_hash[i].wid,
+                                        old_hash[i].prob1);
+        ckd_free(old_hash);
+    }
+    return ngram_class_hash_insert(lmclass, wid, lweight);
 }
 
 void
 ngram_class_free(ngram_class_t * lmclass)
 {
+    ckd_free(lmclass->members);
     ckd_free(lmclass->nword_hash);
     ckd_free(lmclass->prob1);
     ckd_free(lmclass);
@@ -827,13 +875,23 @@ ngram_model_add_class_word(ngram_model_t * model,
     fprob = weight * 1.0f / (lmclass->n_words + lmclass->n_hash_inuse + 1);
     /* Now normalize everything else to fit it in.  This is
      * accomplished by simply scaling all the other probabilities
-     * by (1-fprob). */
+     * by (1-fprob), except for words which are not current members
+     * (these have a "probability" of 1). */
     scale = logmath_log(model->lmath, 1.0 - fprob);
     for (i = 0; i < lmclass->n_words; ++i)
-        lmclass->prob1[i] += scale;
+        if (lmclass->prob1[i] != 1)
+            lmclass->prob1[i] += scale;
     for (i = 0; i < lmclass->n_hash; ++i)
-        if (lmclass->nword_hash[i].wid != -1)
+        if (lmclass->nword_hash[i].wid != -1
+            && lmclass->nword_hash[i].prob1 != 1)
             lmclass->nword_hash[i].prob1 += scale;
+    /* If membership is being tracked, the new word is a member. */
+    if (lmclass->members) {
+        lmclass->members = ckd_realloc(lmclass->members,
+                                       (lmclass->n_members + 1)
+                                       * sizeof(*lmclass->members));
+        lmclass->members[lmclass->n_members++] = wid;
+    }
 
     /* Now add it to the class hash table. */
     return ngram_class_add_word(lmclass, wid,
@@ -891,28 +949,171 @@ ngram_model_add_class(ngram_model_t * model,
     return classid;
 }
 
-int32
-ngram_class_prob(ngram_class_t * lmclass, int32 wid)
+/* Find the probability entry for a word in a class. */
+static int32 *
+ngram_class_prob_entry(ngram_class_t * lmclass, int32 wid)
 {
     int32 base_wid = NGRAM_BASEWID(wid);
 
     if (base_wid < lmclass->start_wid
-        || base_wid > lmclass->start_wid + lmclass->n_words) {
+        || base_wid >= lmclass->start_wid + lmclass->n_words) {
         int32 hash;
 
-        /* Look it up in the hash table. */
+        if (lmclass->nword_hash == NULL)
+            return NULL;
         hash = wid & (lmclass->n_hash - 1);
         while (hash != -1 && lmclass->nword_hash[hash].wid != wid)
             hash = lmclass->nword_hash[hash].next;
         if (hash == -1)
-            return 1;
-        return lmclass->nword_hash[hash].prob1;
+            return NULL;
+        return &lmclass->nword_hash[hash].prob1;
     }
     else {
-        return lmclass->prob1[base_wid - lmclass->start_wid];
+        return &lmclass->prob1[base_wid - lmclass->start_wid];
     }
 }
 
+static int
+compare_wids(const void *a, const void *b)
+{
+    int32 wa = *(const int32 *)a, wb = *(const int32 *)b;
+    return (wa > wb) - (wa < wb);
+}
+
+/* Look up and validate new members of a class, without changing it. */
+static int32 *
+ngram_class_new_members(ngram_model_t * model, const char *classname,
+                        const char **words, const float32 * weights,
+                        int32 n_words, ngram_class_t ** out_lmclass,
+                        float32 * out_total)
+{
+    ngram_class_t *lmclass;
+    int32 classid, tag_wid, i;
+    int32 *members, *sorted;
+    float32 total;
+
+    tag_wid = ngram_wid(model, classname);
+    for (classid = 0; classid < model->n_classes; ++classid) {
+        if (model->classes[classid]->tag_wid == tag_wid)
+            break;
+    }
+    if (classid == model->n_classes) {
+        E_ERROR("Word %s is not a class tag\n", classname);
+        return NULL;
+    }
+    lmclass = model->classes[classid];
+
+    members = ckd_calloc(n_words ? n_words : 1, sizeof(*members));
+    total = 0.0;
+    for (i = 0; i < n_words; ++i) {
+        int32 wid = ngram_wid(model, words[i]);
+        if (wid == NGRAM_INVALID_WID || !NGRAM_IS_CLASSWID(wid)
+            || NGRAM_CLASSID(wid) != classid
+            || ngram_class_prob_entry(lmclass, wid) == NULL) {
+            E_ERROR("Word %s is not in class %s\n", words[i], classname);
+            ckd_free(members);
+            return NULL;
+        }
+        members[i] = wid;
+        total += weights ? weights[i] : 1.0f;
+    }
+    if (n_words && total <= 0.0) {
+        E_ERROR("Total weight of class %s must be positive\n", classname);
+        ckd_free(members);
+        return NULL;
+    }
+    /* A word listed twice would be counted twice in the total but
+     * only get one probability, so the class would not sum to one. */
+    sorted = ckd_calloc(n_words ? n_words : 1, sizeof(*sorted));
+    memcpy(sorted, members, n_words * sizeof(*sorted));
+    qsort(sorted, n_words, sizeof(*sorted), compare_wids);
+    for (i = 1; i < n_words; ++i) {
+        if (sorted[i] == sorted[i - 1]) {
+            E_ERROR("Word %s is listed more than once in class %s\n",
+                    ngram_word(model, sorted[i]), classname);
+            ckd_free(sorted);
+            ckd_free(members);
+            return NULL;
+        }
+    }
+    ckd_free(sorted);
+
+    *out_lmclass = lmclass;
+    *out_total = total;
+    return members;
+}
+
+int32
+ngram_model_check_class(ngram_model_t * model,
+                        const char *classname,
+                        const char **words,
+                        const float32 * weights, int32 n_words)
+{
+    ngram_class_t *lmclass;
+    int32 *members;
+    float32 total;
+
+    if ((members = ngram_class_new_members(model, classname, words,
+                                           weights, n_words,
+                                           &lmclass, &total)) == NULL)
+        return -1;
+    ckd_free(members);
+    return n_words;
+}
+
+int32
+ngram_model_update_class(ngram_model_t * model,
+                         const char *classname,
+                         const char **words,
+                         const float32 * weights, int32 n_words)
+{
+    ngram_class_t *lmclass;
+    int32 i;
+    int32 *members, *prob;
+    float32 total;
+
+    /* Look up the new members before changing anything. */
+    if ((members = ngram_class_new_members(model, classname, words,
+                                           weights, n_words,
+                                           &lmclass, &total)) == NULL)
+        return -1;
+
+    /* Remove the old members.  The first time around, that means
+     * every word in the class. */
+    if (lmclass->members == NULL) {
+        for (i = 0; i < lmclass->n_words; ++i)
+            lmclass->prob1[i] = 1;
+        for (i = 0; i < lmclass->n_hash; ++i)
+            if (lmclass->nword_hash[i].wid != -1)
+                lmclass->nword_hash[i].prob1 = 1;
+    }
+    else {
+        for (i = 0; i < lmclass->n_members; ++i)
+            *ngram_class_prob_entry(lmclass, lmclass->members[i]) = 1;
+        ckd_free(lmclass->members);
+    }
+
+    /* And add the new ones. */
+    for (i = 0; i < n_words; ++i) {
+        prob = ngram_class_prob_entry(lmclass, members[i]);
+        *prob = logmath_log(model->lmath,
+                            (weights ? weights[i] : 1.0f) / total);
+    }
+    lmclass->members = members;
+    lmclass->n_members = n_words;
+
+    return n_words;
+}
+
+int32
+ngram_class_prob(ngram_class_t * lmclass, int32 wid)
+{
+    int32 *prob = ngram_class_prob_entry(lmclass, wid);
+
+    /* 1 means "not in class" as no real log-probability is positive. */
+    return prob ? *prob : 1;
+}
+
 int32
 read_classdef_file(hash_table_t * classes, const char *file_name)
 {
@@ -1074,3 +1275,129 @@ ngram_model_read_classdef(ngram_model_t * model, const char *file_name)
     hash_table_free(classes);
     return rv;
 }
+
+int32
+ngram_model_entropy(ngram_model_t *lm, char **words, int32 n,
+                    FILE *trace, int32 *out_n_ccs, int32 *out_n_oovs,
+                    int32 *out_lm_score)
+{
+    int32 *wids;
+    int32 startwid;
+    int32 i, ch, nccs, noovs, unk;
+
+    if (n == 0)
+        return 0;
+
+    unk = ngram_unknown_wid(lm);
+
+    /* Reverse this array into an array of word IDs. */
+    wids = ckd_calloc(n, sizeof(*wids));
+    for (i = 0; i < n; ++i)
+        wids[n - i - 1] = ngram_wid(lm, words[i]);
+    /* Skip <s> as it's a context cue (HACK, this should be configurable). */
+    startwid = ngram_wid(lm, "<s>");
+
+    /* Now evaluate the list of words in reverse using the
+     * remainder of the array as the history. */
+    ch = noovs = nccs = 0;
+    for (i = 0; i < n; ++i) {
+        int32 n_used;
+        int32 prob;
+
+        /* Skip <s> as it's a context cue (HACK, this should be configurable). */
+        if (wids[i] == startwid) {
+            ++nccs;
+            continue;
+        }
+        /* Skip and count OOVs. */
+        if (wids[i] == NGRAM_INVALID_WID || wids[i] == unk) {
+            ++noovs;
+            continue;
+        }
+        /* Sum up information for each N-gram */
+        prob = ngram_ng_score(lm, wids[i], wids + i + 1,
+                              n - i - 1, &n_used);
+        if (trace) {
+            int m;
+            fprintf(trace, "log P(%s|", ngram_word(lm, wids[i]));
+            m = i + ngram_model_get_size(lm) - 1;
+            if (m >= n)
+                m = n - 1;
+            while (m > i) {
+                fprintf(trace, "%s ", ngram_word(lm, wids[m--]));
+            }
+            fprintf(trace, ") = %d\n", prob);
+        }
+        ch -= prob;
+    }
+    ckd_free(wids);
+
+    if (out_n_ccs) *out_n_ccs = nccs;
+    if (out_n_oovs) *out_n_oovs = noovs;
+
+    /* Calculate cross-entropy CH = - 1/N sum log P(W|H) */
+    if (out_lm_score)
+        *out_lm_score = -ch;
+    n -= (nccs + noovs);
+    if (n <= 0)
+        return 0;
+    return ch / n;
+}
+
+float64
+ngram_model_eval_file(ngram_model_t *lm, const char *lsnfn, FILE *trace,
+                      int32 *out_n_words, int32 *out_n_ccs,
+                      int32 *out_n_oovs, int32 *out_lm_score)
+{
+    FILE *fh;
+    lineiter_t *litor;
+    int32 nccs, noovs, nwords, lscr;
+    float64 ch, log_to_log2;
+
+    if ((fh = fopen(lsnfn, "r")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open transcript file %s", lsnfn);
+        return -1;
+    }
+
+    /* We have to keep ch in floating-point to avoid overflows, so
+     * we might as well use log2. */
+    log_to_log2 = log(logmath_get_base(lm->lmath)) / log(2);
+    lscr = nccs = noovs = nwords = 0;
+    ch = 0.0;
+    for (litor = lineiter_start(fh); litor; litor = lineiter_next(litor)) {
+        char **words;
+        int32 n, tmp_ch, tmp_noovs, tmp_nccs, tmp_lscr;
+
+        n = str2words(litor->buf, NULL, 0);
+        if (n <= 0) /* Do nothing! */
+            continue;
+        words = ckd_calloc(n, sizeof(*words));
+        str2words(litor->buf, words, n);
+
+        /* Remove any utterance ID (FIXME: has to be a single "word") */
+        if (words[n - 1][0] == '('
+            && words[n - 1][strlen(words[n - 1]) - 1] == ')')
+            n = n - 1;
+
+        tmp_lscr = 0;
+        tmp_ch = ngram_model_entropy(lm, words, n, trace, &tmp_nccs,
+                                     &tmp_noovs, &tmp_lscr);
+
+        ch += (float64) tmp_ch * (n - tmp_nccs - tmp_noovs) * log_to_log2;
+        nccs += tmp_nccs;
+        noovs += tmp_noovs;
+        lscr += tmp_lscr;
+        nwords += n;
+
+        ckd_free(words);
+    }
+    fclose(fh);
+
+    if (out_n_words) *out_n_words = nwords;
+    if (out_n_ccs) *out_n_ccs = nccs;
+    if (out_n_oovs) *out_n_oovs = noovs;
+    if (out_lm_score) *out_lm_score = lscr;
+    if (nwords - nccs - noovs <= 0)
+        return 0.0;
+    return ch / (nwords - nccs - noovs);
+}
@@ -43,6 +43,8 @@
 #ifndef __NGRAM_MODEL_H__
 #define __NGRAM_MODEL_H__
 
+#include <stdio.h>
+
 #include <pocketsphinx/model.h>
 
 #ifdef __cplusplus
@@ -53,6 +55,63 @@ extern "C" {
 }
 #endif
 
+/**
+ * Score a list of words following the same history.
+ *
+ * This gives the same results as calling ngram_ng_score() for each
+ * word in turn, but lets the model share the work of looking up the
+ * history.  Words may be class words or NGRAM_INVALID_WID.
+ *
+ * @param wids Words to score.  May be the same array as out_scores.
+ * @param out_scores Output: language model score for each word.
+ * @return n_wids.
+ */
+int32 ngram_ng_score_words(ngram_model_t *model,
+                           int32 *wids, int32 n_wids,
+                           int32 *history, int32 n_hist,
+                           int32 *out_scores);
+
+/**
+ * Check that ngram_model_update_class() would succeed, without
+ * changing the model.
+ *
+ * @return n_words, or <0 for error.
+ */
+int32 ngram_model_check_class(ngram_model_t *model,
+                              const char *classname,
+                              const char **words,
+                              const float32 *weights,
+                              int32 n_words);
+
+/**
+ * Compute the cross-entropy of a sentence under a language model.
+ *
+ * The &lt;s&gt; context cue and out-of-vocabulary words are skipped.
+ *
+ * @param words Words of the sentence, in order.
+ * @param trace If not NULL, print log P(w|h) for each word here.
+ * @param out_n_ccs Output: number of context cues skipped.
+ * @param out_n_oovs Output: number of OOVs skipped.
+ * @param out_lm_score Output: total language model score.
+ * @return Cross-entropy per word, in the model's log base.
+ */
+int32 ngram_model_entropy(ngram_model_t *lm, char **words, int32 n,
+                          FILE *trace, int32 *out_n_ccs,
+                          int32 *out_n_oovs, int32 *out_lm_score);
+
+/**
+ * Compute the cross-entropy of a transcription file under a language
+ * model, as ngram_model_entropy() for each line.  Lines may end with
+ * an utterance ID in parentheses.
+ *
+ * @param out_n_words Output: number of words read.
+ * @return Cross-entropy per word in bits, or -1 on error.
+ */
+float64 ngram_model_eval_file(ngram_model_t *lm, const char *lsnfn,
+                              FILE *trace, int32 *out_n_words,
+                              int32 *out_n_ccs, int32 *out_n_oovs,
+                              int32 *out_lm_score);
+
 #ifdef __cplusplus
 }
 #endif
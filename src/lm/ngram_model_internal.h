@@ -93,6 +93,12 @@ struct ngram_class_s {
     } *nword_hash;
     int32 n_hash;       /**< Number of buckets in nword_hash (power of 2) */
     int32 n_hash_inuse; /**< Number of words in nword_hash */
+    /**
+     * Current members, if set with ngram_model_update_class().  Words
+     * of the class not in this list have no probability.
+     */
+    int32 *members;
+    int32 n_members;    /**< Number of words in members */
 };
 
 #define NGRAM_MAX_ORDER 5
@@ -146,6 +152,17 @@ typedef struct ngram_funcs_s {
      * Implementation-specific function for purging N-Gram cache
      */
     void (*flush) (ngram_model_t * model);
+    /**
+     * Implementation-specific function for scoring a list of words
+     * following the same history (optional).  Words are never class
+     * words or NGRAM_INVALID_WID.
+     *
+     * @return n_wids, or -1 to fall back to scoring one word at a time.
+     */
+     int32(*score_words) (ngram_model_t * model,
+                          int32 * wids, int32 n_wids,
+                          int32 * history, int32 n_hist,
+                          int32 * out_scores);
 } ngram_funcs_t;
 
 /**
@@ -48,6 +48,7 @@
 #include "util/filename.h"
 
 #include "lm/ngram_model_set.h"
+#include "lm/ngram_model_trie.h"
 
 static ngram_funcs_t ngram_model_set_funcs;
 
@@ -174,9 +175,6 @@ ngram_model_set_init(ps_config_t * config,
         if (models[i]->n > n)
             n = models[i]->n;
     }
-    /* Allocate the history mapping table. */
-    model->maphist = ckd_calloc(n - 1, sizeof(*model->maphist));
-
     /* Now build the word-ID mapping and merged vocabulary. */
     build_widmap(base, lmath, n);
     return base;
@@ -410,6 +408,12 @@ ngram_model_set_iter_model(ngram_model_set_iter_t * itor,
     return itor->set->lms[itor->cur];
 }
 
+int
+ngram_model_is_set(ngram_model_t * model)
+{
+    return model->funcs == &ngram_model_set_funcs;
+}
+
 ngram_model_t *
 ngram_model_set_lookup(ngram_model_t * base, const char *name)
 {
@@ -521,6 +525,131 @@ ngram_model_set_interp(ngram_model_t * base,
     return base;
 }
 
+ngram_model_t *
+ngram_model_set_merge(ngram_model_t * base)
+{
+    ngram_model_set_t *set = (ngram_model_set_t *) base;
+    ngram_model_t *merged = NULL;
+    ngram_raw_t ***sub_raw;
+    ngram_raw_t **raw = NULL;
+    uint32 counts[NGRAM_MAX_ORDER];
+    float32 *ug_prob = NULL, *ug_bo = NULL;
+    int32 **inv;
+    int32 i, k, cur, n_used, n_bad;
+    uint32 j;
+
+    memset(counts, 0, sizeof(counts));
+    sub_raw = ckd_calloc(set->n_models, sizeof(*sub_raw));
+    inv = ckd_calloc(set->n_models, sizeof(*inv));
+    for (i = 0; i < set->n_models; ++i) {
+        ngram_model_t *lm = set->lms[i];
+        int32 w;
+
+        if (lm->n_classes > 0) {
+            E_ERROR("Cannot merge class-based language model %s\n",
+                    set->names[i]);
+            goto done;
+        }
+        if ((sub_raw[i] = ngram_model_trie_get_raw(lm)) == NULL) {
+            E_ERROR("Cannot merge language model %s\n", set->names[i]);
+            goto done;
+        }
+        /* Map submodel word IDs back to the set. */
+        inv[i] = ckd_calloc(lm->n_words, sizeof(**inv));
+        for (w = 0; w < lm->n_words; ++w)
+            inv[i][w] = ngram_wid(base, lm->word_str[w]);
+    }
+
+    /* Probabilities are those of the interpolated set. */
+    cur = set->cur;
+    set->cur = -1;
+    E_INFO("Merging %d language models\n", set->n_models);
+
+    counts[0] = base->n_words;
+    ug_prob = ckd_calloc(counts[0], sizeof(*ug_prob));
+    ug_bo = ckd_calloc(counts[0], sizeof(*ug_bo));
+    for (j = 0; j < counts[0]; ++j)
+        ug_prob[j] = (float32) ngram_ng_prob(base, j, NULL, 0, &n_used);
+
+    /* Take the union of N-Grams in all models and interpolate their
+     * probabilities exactly. */
+    raw = ckd_calloc(NGRAM_MAX_ORDER - 1, sizeof(*raw));
+    for (k = 2; k <= base->n; ++k) {
+        uint32 total = 0, n;
+
+        for (i = 0; i < set->n_models; ++i)
+            if (set->lms[i]->n >= k)
+                total += set->lms[i]->n_counts[k - 1];
+        raw[k - 2] = ckd_calloc(total + 1, sizeof(**raw));
+        n = 0;
+        for (i = 0; i < set->n_models; ++i) {
+            if (set->lms[i]->n < k)
+                continue;
+            for (j = 0; j < set->lms[i]->n_counts[k - 1]; ++j) {
+                ngram_raw_t *in = &sub_raw[i][k - 2][j];
+                ngram_raw_t *out = &raw[k - 2][n++];
+                int32 m;
+
+                out->order = k;
+                out->words = ckd_calloc(k, sizeof(*out->words));
+                /* Extracted N-Grams are in ARPA order. */
+                for (m = 0; m < k; ++m)
+                    out->words[m] = inv[i][in->words[k - 1 - m]];
+            }
+        }
+        ngrams_raw_sort(raw[k - 2], n, counts[0]);
+        /* Remove duplicates. */
+        counts[k - 1] = 0;
+        for (j = 0; j < n; ++j) {
+            ngram_raw_t *prev = &raw[k - 2][counts[k - 1] - 1];
+            if (counts[k - 1] > 0
+                && ngram_ord_comparator(prev, &raw[k - 2][j]) == 0)
+                ckd_free(raw[k - 2][j].words);
+            else
+                raw[k - 2][counts[k - 1]++] = raw[k - 2][j];
+        }
+        E_INFO("%d unique %d-grams\n", counts[k - 1], k);
+
+        for (j = 0; j < counts[k - 1]; ++j) {
+            ngram_raw_t *ng = &raw[k - 2][j];
+            int32 hist[NGRAM_MAX_ORDER];
+
+            memcpy(hist, ng->words + 1, (k - 1) * sizeof(*hist));
+            ng->prob = (float32) ngram_ng_prob(base, ng->words[0],
+                                               hist, k - 1, &n_used);
+            ng->backoff = 0.0f;
+        }
+    }
+
+    /* Recompute backoff weights so every history is normalized. */
+    n_bad = ngrams_raw_normalize(raw, counts, base->n, ug_prob, ug_bo,
+                                 base->lmath);
+    if (n_bad)
+        E_WARN("%d histories have no probability mass left to back off\n",
+               n_bad);
+
+    merged = ngram_model_trie_create(base->lmath, base->n, counts,
+                                     base->word_str, ug_prob, ug_bo, raw,
+                                     LM_TRIE_QUANT_BITS,
+                                     LM_TRIE_QUANT_BITS);
+    set->cur = cur;
+
+done:
+    if (raw)
+        ngrams_raw_free(raw, counts, base->n);
+    for (i = 0; i < set->n_models; ++i) {
+        if (sub_raw[i])
+            ngrams_raw_free(sub_raw[i], set->lms[i]->n_counts,
+                            set->lms[i]->n);
+        ckd_free(inv[i]);
+    }
+    ckd_free(sub_raw);
+    ckd_free(inv);
+    ckd_free(ug_prob);
+    ckd_free(ug_bo);
+    return merged;
+}
+
 ngram_model_t *
 ngram_model_set_add(ngram_model_t * base,
                     ngram_model_t * model,
@@ -537,12 +666,8 @@ ngram_model_set_add(ngram_model_t * base,
     set->names =
         ckd_realloc(set->names, set->n_models * sizeof(*set->names));
     set->names[set->n_models - 1] = ckd_salloc(name);
-    /* Expand the history mapping table if necessary. */
-    if (model->n > base->n) {
+    if (model->n > base->n)
         base->n = model->n;
-        set->maphist = ckd_realloc(set->maphist,
-                                   (model->n - 1) * sizeof(*set->maphist));
-    }
 
     /* Renormalize the interpolation weights. */
     fprob = weight * 1.0f / set->n_models;
@@ -620,7 +745,6 @@ ngram_model_set_remove(ngram_model_t * base,
     /* There's no need to shrink these arrays. */
     set->lms[set->n_models] = NULL;
     set->lweights[set->n_models] = base->log_zero;
-    /* No need to shrink maphist either. */
 
     /* Reuse the existing word ID mapping if requested. */
     if (reuse_widmap) {
@@ -686,6 +810,7 @@ ngram_model_set_score(ngram_model_t * base, int32 wid,
                       int32 * history, int32 n_hist, int32 * n_used)
 {
     ngram_model_set_t *set = (ngram_model_set_t *) base;
+    int32 maphist[NGRAM_MAX_ORDER];
     int32 mapwid;
     int32 score;
     int32 i;
@@ -703,14 +828,14 @@ ngram_model_set_score(ngram_model_t * base, int32 wid,
             mapwid = set->widmap[wid][i];
             for (j = 0; j < n_hist; ++j) {
                 if (history[j] == NGRAM_INVALID_WID)
-                    set->maphist[j] = NGRAM_INVALID_WID;
+                    maphist[j] = NGRAM_INVALID_WID;
                 else
-                    set->maphist[j] = set->widmap[history[j]][i];
+                    maphist[j] = set->widmap[history[j]][i];
             }
             score = logmath_add(base->lmath, score,
                                 set->lweights[i] +
                                 ngram_ng_score(set->lms[i],
-                                               mapwid, set->maphist,
+                                               mapwid, maphist,
                                                n_hist, n_used));
         }
     }
@@ -720,22 +845,53 @@ ngram_model_set_score(ngram_model_t * base, int32 wid,
         mapwid = set->widmap[wid][set->cur];
         for (j = 0; j < n_hist; ++j) {
             if (history[j] == NGRAM_INVALID_WID)
-                set->maphist[j] = NGRAM_INVALID_WID;
+                maphist[j] = NGRAM_INVALID_WID;
             else
-                set->maphist[j] = set->widmap[history[j]][set->cur];
+                maphist[j] = set->widmap[history[j]][set->cur];
         }
         score = ngram_ng_score(set->lms[set->cur],
-                               mapwid, set->maphist, n_hist, n_used);
+                               mapwid, maphist, n_hist, n_used);
     }
 
     return score;
 }
 
+static int32
+ngram_model_set_score_words(ngram_model_t * base, int32 * wids,
+                            int32 n_wids, int32 * history, int32 n_hist,
+                            int32 * out_scores)
+{
+    ngram_model_set_t *set = (ngram_model_set_t *) base;
+    int32 maphist[NGRAM_MAX_ORDER];
+    int32 i;
+
+    /* Interpolation has to be done one word at a time. */
+    if (set->cur == -1)
+        return -1;
+
+    /* Truncate the history. */
+    if (n_hist > base->n - 1)
+        n_hist = base->n - 1;
+    for (i = 0; i < n_hist; ++i) {
+        if (history[i] == NGRAM_INVALID_WID)
+            maphist[i] = NGRAM_INVALID_WID;
+        else
+            maphist[i] = set->widmap[history[i]][set->cur];
+    }
+    /* Map words in place in the output, the submodel will
+     * overwrite them with scores. */
+    for (i = 0; i < n_wids; ++i)
+        out_scores[i] = set->widmap[wids[i]][set->cur];
+    return ngram_ng_score_words(set->lms[set->cur], out_scores, n_wids,
+                                maphist, n_hist, out_scores);
+}
+
 static int32
 ngram_model_set_raw_score(ngram_model_t * base, int32 wid,
                           int32 * history, int32 n_hist, int32 * n_used)
 {
     ngram_model_set_t *set = (ngram_model_set_t *) base;
+    int32 maphist[NGRAM_MAX_ORDER];
     int32 mapwid;
     int32 score;
     int32 i;
@@ -753,14 +909,14 @@ ngram_model_set_raw_score(ngram_model_t * base, int32 wid,
             mapwid = set->widmap[wid][i];
             for (j = 0; j < n_hist; ++j) {
                 if (history[j] == NGRAM_INVALID_WID)
-                    set->maphist[j] = NGRAM_INVALID_WID;
+                    maphist[j] = NGRAM_INVALID_WID;
                 else
-                    set->maphist[j] = set->widmap[history[j]][i];
+                    maphist[j] = set->widmap[history[j]][i];
             }
             score = logmath_add(base->lmath, score,
                                 set->lweights[i] +
                                 ngram_ng_prob(set->lms[i],
-                                              mapwid, set->maphist, n_hist,
+                                              mapwid, maphist, n_hist,
                                               n_used));
         }
     }
@@ -770,12 +926,12 @@ ngram_model_set_raw_score(ngram_model_t * base, int32 wid,
         mapwid = set->widmap[wid][set->cur];
         for (j = 0; j < n_hist; ++j) {
             if (history[j] == NGRAM_INVALID_WID)
-                set->maphist[j] = NGRAM_INVALID_WID;
+                maphist[j] = NGRAM_INVALID_WID;
             else
-                set->maphist[j] = set->widmap[history[j]][set->cur];
+                maphist[j] = set->widmap[history[j]][set->cur];
         }
         score = ngram_ng_prob(set->lms[set->cur],
-                              mapwid, set->maphist, n_hist, n_used);
+                              mapwid, maphist, n_hist, n_used);
     }
 
     return score;
@@ -854,7 +1010,6 @@ ngram_model_set_free(ngram_model_t * base)
         ckd_free(set->names[i]);
     ckd_free(set->names);
     ckd_free(set->lweights);
-    ckd_free(set->maphist);
     ckd_free_2d((void **) set->widmap);
 }
 
@@ -864,5 +1019,6 @@ static ngram_funcs_t ngram_model_set_funcs = {
     ngram_model_set_score,      /* score */
     ngram_model_set_raw_score,  /* raw_score */
     ngram_model_set_add_ug,     /* add_ug */
-    NULL                        /* flush */
+    NULL,                       /* flush */
+    ngram_model_set_score_words /* score_words */
 };
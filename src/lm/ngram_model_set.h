@@ -56,7 +56,6 @@ typedef struct ngram_model_set_s {
     char **names;        /**< Names for language models. */
     int32 *lweights;     /**< Log interpolation weights. */
     int32 **widmap;      /**< Word ID mapping for submodels. */
-    int32 *maphist;      /**< Word ID mapping for N-Gram history. */
 } ngram_model_set_t;
 
 /**
@@ -67,4 +66,9 @@ struct ngram_model_set_iter_s {
     int32 cur;
 };
 
+/**
+ * Check whether a language model is a set of language models.
+ */
+int ngram_model_is_set(ngram_model_t *model);
+
 #endif                          /* __NGRAM_MODEL_SET_H__ */
@@ -49,6 +49,7 @@
 #include "util/strfuncs.h"
 #include "util/ckd_alloc.h"
 #include "util/byteorder.h"
+#include "util/mmio.h"
 #include "lm/ngram_model_trie.h"
 
 static const char trie_hdr[] = "Trie Language Model";
@@ -169,9 +170,62 @@ read_1grams_arpa(lineiter_t ** li, uint32 count, ngram_model_t * base,
     return 0;
 }
 
+/**
+ * Read the ngrams following the unigrams from a memory map of the
+ * file, whose first lineno lines were already read by the line
+ * iterator.
+ * @return FALSE if the file could not be mapped, in which case the
+ *         file position is unchanged, TRUE otherwise.
+ */
+static int
+read_ngrams_arpa_mmap(const char *path, FILE *fp, int32 lineno,
+                      ngram_model_t *base, uint32 *counts, int order,
+                      int n_chunks, ngram_run_tasks_fn run, void *udata,
+                      ngram_raw_t ***out_raw_ngrams)
+{
+    mmio_file_t *mf;
+    char const *data, *pos, *end;
+    long cur, size;
+    int32 i;
+
+    if ((cur = ftell(fp)) < 0
+        || fseek(fp, 0, SEEK_END) < 0
+        || (size = ftell(fp)) < 0
+        || fseek(fp, cur, SEEK_SET) < 0)
+        return FALSE;
+    if (size == 0 || (mf = mmio_file_read(path)) == NULL)
+        return FALSE;
+    /* Skip the lines already read, rather than trusting ftell() in
+     * text mode. */
+    data = (char const *) mmio_file_ptr(mf);
+    end = data + size;
+    for (pos = data, i = 0; pos && pos < end && i < lineno; ++i) {
+        if ((pos = memchr(pos, '\n', end - pos)) != NULL)
+            ++pos;
+    }
+    if (pos == NULL)
+        pos = end;
+    *out_raw_ngrams =
+        ngrams_raw_read_arpa_mem(pos, end - pos, lineno, base->lmath,
+                                 counts, order, base->wid,
+                                 n_chunks, run, udata);
+    mmio_file_unmap(mf);
+    return TRUE;
+}
+
 ngram_model_t *
 ngram_model_trie_read_arpa(ps_config_t * config,
                            const char *path, logmath_t * lmath)
+{
+    return ngram_model_trie_read_arpa_tasks(config, path, lmath,
+                                            1, NULL, NULL);
+}
+
+ngram_model_t *
+ngram_model_trie_read_arpa_tasks(ps_config_t * config,
+                                 const char *path, logmath_t * lmath,
+                                 int n_chunks, ngram_run_tasks_fn run,
+                                 void *udata)
 {
     FILE *fp;
     lineiter_t *li = NULL;
@@ -215,9 +269,14 @@ ngram_model_trie_read_arpa(ps_config_t * config,
     }
 
     if (order > 1) {
-        raw_ngrams =
-            ngrams_raw_read_arpa(&li, base->lmath, counts, order,
-                                 base->wid);
+        /* Compressed files can only be read through the line iterator. */
+        if (is_pipe
+            || !read_ngrams_arpa_mmap(path, fp, li->lineno, base, counts,
+                                      order, n_chunks, run, udata,
+                                      &raw_ngrams))
+            raw_ngrams =
+                ngrams_raw_read_arpa(&li, base->lmath, counts, order,
+                                     base->wid);
         if (raw_ngrams == NULL) {
             goto error_out;
         }
@@ -237,6 +296,141 @@ error_out:
     return NULL;
 }
 
+ngram_model_t *
+ngram_model_trie_create(logmath_t * lmath, int order, uint32 * counts,
+                        char **word_str, float32 * ug_prob,
+                        float32 * ug_bo, ngram_raw_t ** raw_ngrams,
+                        int prob_bits, int bo_bits)
+{
+    ngram_model_trie_t *model;
+    ngram_model_t *base;
+    uint32 i;
+
+    model = (ngram_model_trie_t *) ckd_calloc(1, sizeof(*model));
+    base = &model->base;
+    if (ngram_model_init(base, &ngram_model_trie_funcs, lmath, order,
+                         (int32)counts[0]) != 0) {
+        ckd_free(model);
+        return NULL;
+    }
+    base->writable = TRUE;
+
+    model->trie = lm_trie_create(counts[0], order);
+    if (lm_trie_set_quant_bits(model->trie, order, prob_bits, bo_bits) < 0) {
+        ngram_model_free(base);
+        return NULL;
+    }
+    for (i = 0; i < counts[0]; i++) {
+        model->trie->unigrams[i].prob = ug_prob[i];
+        model->trie->unigrams[i].bo = ug_bo[i];
+        base->word_str[i] = ckd_salloc(word_str[i]);
+        if ((hash_table_enter
+             (base->wid, base->word_str[i],
+              (void *) (size_t) i)) != (void *) (size_t) i) {
+            E_WARN("Duplicate word in dictionary: %s\n",
+                   base->word_str[i]);
+        }
+    }
+    if (order > 1)
+        lm_trie_build(model->trie, raw_ngrams, counts, base->n_counts, order);
+
+    return base;
+}
+
+ngram_raw_t **
+ngram_model_trie_get_raw(ngram_model_t * base)
+{
+    ngram_model_trie_t *model = (ngram_model_trie_t *) base;
+    ngram_raw_t **raw_ngrams;
+    int i;
+
+    if (base->funcs != &ngram_model_trie_funcs)
+        return NULL;
+    raw_ngrams = (ngram_raw_t **) ckd_calloc(NGRAM_MAX_ORDER - 1,
+                                             sizeof(*raw_ngrams));
+    for (i = 2; i <= base->n; ++i) {
+        uint32 raw_ngram_idx;
+        uint32 hist[NGRAM_MAX_ORDER];
+        node_range_t range;
+
+        raw_ngrams[i - 2] =
+            (ngram_raw_t *) ckd_calloc((size_t) base->n_counts[i - 1],
+                                       sizeof(**raw_ngrams));
+        raw_ngram_idx = 0;
+        range.begin = range.end = 0;
+        /* we need to iterate over a trie here. recursion should do the job */
+        lm_trie_fill_raw_ngram(model->trie, raw_ngrams[i - 2],
+                               &raw_ngram_idx, base->n_counts, range, hist,
+                               0, i, base->n);
+        assert(raw_ngram_idx == base->n_counts[i - 1]);
+        ngrams_raw_sort(raw_ngrams[i - 2], base->n_counts[i - 1],
+                        base->n_words);
+    }
+    return raw_ngrams;
+}
+
+int
+ngram_model_trie_index(ngram_model_t * base)
+{
+    ngram_model_trie_t *model = (ngram_model_trie_t *) base;
+    size_t size;
+
+    if (base->funcs != &ngram_model_trie_funcs)
+        return -1;
+    size = lm_trie_build_index(model->trie, base->n_counts, base->n);
+    E_INFO("Built %lu bytes of N-Gram index\n", (unsigned long) size);
+    return 0;
+}
+
+ngram_model_t *
+ngram_model_trie_rebuild(ngram_model_t * base, float64 prune_threshold,
+                         int prob_bits, int bo_bits)
+{
+    ngram_model_trie_t *model = (ngram_model_trie_t *) base;
+    ngram_model_t *rebuilt;
+    ngram_raw_t **raw_ngrams;
+    uint32 counts[NGRAM_MAX_ORDER];
+    float32 *ug_prob, *ug_bo;
+    uint32 i, j;
+    int k;
+
+    if ((raw_ngrams = ngram_model_trie_get_raw(base)) == NULL)
+        return NULL;
+    memcpy(counts, base->n_counts, base->n * sizeof(*counts));
+    ug_prob = ckd_calloc(counts[0], sizeof(*ug_prob));
+    ug_bo = ckd_calloc(counts[0], sizeof(*ug_bo));
+    for (i = 0; i < counts[0]; ++i) {
+        ug_prob[i] = model->trie->unigrams[i].prob;
+        ug_bo[i] = model->trie->unigrams[i].bo;
+    }
+    /* Put words back in the order the trie is built in. */
+    for (k = 2; k <= base->n; ++k) {
+        for (i = 0; i < counts[k - 1]; ++i) {
+            uint32 *words = raw_ngrams[k - 2][i].words;
+            for (j = 0; j < (uint32) k / 2; ++j) {
+                uint32 tmp = words[j];
+                words[j] = words[k - 1 - j];
+                words[k - 1 - j] = tmp;
+            }
+        }
+        ngrams_raw_sort(raw_ngrams[k - 2], counts[k - 1], counts[0]);
+    }
+    if (prune_threshold > 0 && base->n > 1) {
+        uint32 n_pruned = ngrams_raw_prune(raw_ngrams, counts, base->n,
+                                           ug_prob, ug_bo, base->lmath,
+                                           prune_threshold);
+        E_INFO("Pruned %u N-Grams with threshold %g\n",
+               n_pruned, prune_threshold);
+    }
+    rebuilt = ngram_model_trie_create(base->lmath, base->n, counts,
+                                      base->word_str, ug_prob, ug_bo,
+                                      raw_ngrams, prob_bits, bo_bits);
+    ngrams_raw_free(raw_ngrams, counts, base->n);
+    ckd_free(ug_prob);
+    ckd_free(ug_bo);
+    return rebuilt;
+}
+
 int
 ngram_model_trie_write_arpa(ngram_model_t * base, const char *path)
 {
@@ -270,41 +464,27 @@ ngram_model_trie_write_arpa(ngram_model_t * base, const char *path)
     }
     /* Write ngrams */
     if (base->n > 1) {
+        ngram_raw_t **raw_ngrams = ngram_model_trie_get_raw(base);
+
         for (i = 2; i <= base->n; ++i) {
-            ngram_raw_t *raw_ngrams =
-                (ngram_raw_t *) ckd_calloc((size_t) base->n_counts[i - 1],
-                                           sizeof(*raw_ngrams));
-            uint32 raw_ngram_idx;
+            ngram_raw_t *raw = raw_ngrams[i - 2];
             uint32 j;
-            uint32 hist[NGRAM_MAX_ORDER];
-            node_range_t range;
-            raw_ngram_idx = 0;
-            range.begin = range.end = 0;
-
-            /* we need to iterate over a trie here. recursion should do the job */
-            lm_trie_fill_raw_ngram(model->trie, raw_ngrams,
-                           &raw_ngram_idx, base->n_counts, range, hist, 0,
-                           i, base->n);
-            assert(raw_ngram_idx == base->n_counts[i - 1]);
-            qsort(raw_ngrams, (size_t) base->n_counts[i - 1],
-                  sizeof(ngram_raw_t), &ngram_ord_comparator);
 
             fprintf(fp, "\n\\%d-grams:\n", i);
             for (j = 0; j < base->n_counts[i - 1]; j++) {
                 int k;
-                fprintf(fp, "%.4f", logmath_log_float_to_log10(base->lmath, raw_ngrams[j].prob));
+                fprintf(fp, "%.4f", logmath_log_float_to_log10(base->lmath, raw[j].prob));
                 for (k = 0; k < i; k++) {
                     fprintf(fp, "\t%s",
-                            base->word_str[raw_ngrams[j].words[k]]);
+                            base->word_str[raw[j].words[k]]);
                 }
-                ckd_free(raw_ngrams[j].words);
                 if (i < base->n) {
-                    fprintf(fp, "\t%.4f", logmath_log_float_to_log10(base->lmath, raw_ngrams[j].backoff));
+                    fprintf(fp, "\t%.4f", logmath_log_float_to_log10(base->lmath, raw[j].backoff));
                 }
                 fprintf(fp, "\n");
             }
-            ckd_free(raw_ngrams);
         }
+        ngrams_raw_free(raw_ngrams, base->n_counts, base->n);
     }
     fprintf(fp, "\n\\end\\\n");
     return fclose(fp);
@@ -360,7 +540,7 @@ read_word_str(ngram_model_t * base, FILE * fp, int do_swap)
                 base->n_counts[0]);
         goto error_out;
     }
-    free(tmp_word_str);
+    ckd_free(tmp_word_str);
     return 0;
 
 error_out:
@@ -427,7 +607,8 @@ ngram_model_trie_read_bin(ps_config_t * config,
         base->n_counts[i] = counts[i];
     }
 
-    model->trie = lm_trie_read_bin(counts, order, fp);
+    if ((model->trie = lm_trie_read_bin(counts, order, fp)) == NULL)
+        goto error_out;
     if (read_word_str(base, fp, SWAP_LM_TRIE) != 0)
         goto error_out;
 
@@ -694,7 +875,8 @@ static void
 ngram_model_trie_free(ngram_model_t * base)
 {
     ngram_model_trie_t *model = (ngram_model_trie_t *) base;
-    lm_trie_free(model->trie);
+    if (model->trie)
+        lm_trie_free(model->trie);
 }
 
 static int
@@ -741,6 +923,30 @@ ngram_model_trie_score(ngram_model_t * base, int32 wid, int32 * hist,
                                                    n_used));
 }
 
+static int32
+ngram_model_trie_score_words(ngram_model_t * base, int32 * wids,
+                             int32 n_wids, int32 * hist, int32 n_hist,
+                             int32 * out_scores)
+{
+    int32 i;
+    ngram_model_trie_t *model = (ngram_model_trie_t *) base;
+
+    if (n_hist > model->base.n - 1)
+        n_hist = model->base.n - 1;
+    for (i = 0; i < n_hist; i++) {
+        if (hist[i] < 0) {
+            n_hist = i;
+            break;
+        }
+    }
+
+    lm_trie_score_words(model->trie, model->base.n, wids, n_wids,
+                        hist, n_hist, out_scores);
+    for (i = 0; i < n_wids; ++i)
+        out_scores[i] = weight_score(base, out_scores[i]);
+    return n_wids;
+}
+
 static int32
 lm_trie_add_ug(ngram_model_t * base, int32 wid, int32 lweight)
 {
@@ -775,21 +981,12 @@ lm_trie_add_ug(ngram_model_t * base, int32 wid, int32 lweight)
     return (int32) weight_score(base, lweight);
 }
 
-static void
-lm_trie_flush(ngram_model_t * base)
-{
-    ngram_model_trie_t *model = (ngram_model_trie_t *) base;
-    lm_trie_t *trie = model->trie;
-    memset(trie->hist_cache, -1, sizeof(trie->hist_cache));
-    memset(trie->backoff_cache, 0, sizeof(trie->backoff_cache));
-    return;
-}
-
 static ngram_funcs_t ngram_model_trie_funcs = {
     ngram_model_trie_free,      /* free */
     trie_apply_weights,         /* apply_weights */
     ngram_model_trie_score,     /* score */
     ngram_model_trie_raw_score, /* raw_score */
     lm_trie_add_ug,             /* add_ug */
-    lm_trie_flush               /* flush */
+    NULL,                       /* flush */
+    ngram_model_trie_score_words /* score_words */
 };
@@ -52,6 +52,74 @@ ngram_model_t *ngram_model_trie_read_arpa(ps_config_t * config,
                                           const char *path,
                                           logmath_t * lmath);
 
+/**
+ * Read N-Gram model from an ARPABO text file, parsing and sorting the
+ * N-Grams in several tasks run by run.  Uncompressed files are
+ * memory-mapped, compressed ones are read line by line as
+ * ngram_model_trie_read_arpa() does.
+ * @param n_chunks number of chunks to parse each order in
+ * @param run      function which runs tasks, or NULL to run them in turn
+ * @param udata    data passed to run
+ */
+ngram_model_t *ngram_model_trie_read_arpa_tasks(ps_config_t * config,
+                                                const char *path,
+                                                logmath_t * lmath,
+                                                int n_chunks,
+                                                ngram_run_tasks_fn run,
+                                                void *udata);
+
+/**
+ * Create an N-Gram model from unigram weights and sorted raw N-Grams.
+ *
+ * @param counts Number of N-Grams of each order.
+ * @param word_str Word strings, copied.
+ * @param ug_prob Unigram log-probabilities.
+ * @param ug_bo Unigram log-backoff weights.
+ * @param raw_ngrams N-Grams of order 2 and up, word first and then
+ *                   history, most recent first, sorted with
+ *                   ngram_ord_comparator(), not freed.
+ * @param prob_bits Bits per quantized probability (LM_TRIE_QUANT_BITS
+ *                  by default).
+ * @param bo_bits Bits per quantized backoff weight.
+ */
+ngram_model_t *ngram_model_trie_create(logmath_t * lmath, int order,
+                                       uint32 * counts, char **word_str,
+                                       float32 * ug_prob, float32 * ug_bo,
+                                       ngram_raw_t ** raw_ngrams,
+                                       int prob_bits, int bo_bits);
+
+/**
+ * Extract all N-Grams of order 2 and up from a trie model, sorted
+ * with ngram_ord_comparator().  Note that words are in ARPA order,
+ * i.e. the reverse of what ngram_model_trie_create() expects.
+ *
+ * @return Raw N-Grams, to be freed with ngrams_raw_free() using the
+ *         model's N-Gram counts, or NULL if this is not a trie model.
+ */
+ngram_raw_t **ngram_model_trie_get_raw(ngram_model_t * base);
+
+/**
+ * Index a trie model for faster lookup, see lm_trie_build_index().
+ *
+ * @return 0 for success, or -1 if this is not a trie model.
+ */
+int ngram_model_trie_index(ngram_model_t * base);
+
+/**
+ * Build a smaller copy of a trie model, optionally pruning N-Grams
+ * with ngrams_raw_prune() and quantizing weights with fewer bits.
+ *
+ * @param prune_threshold Relative perplexity increase below which
+ *                        N-Grams are pruned, or 0 to keep them all.
+ * @param prob_bits Bits per quantized probability.
+ * @param bo_bits Bits per quantized backoff weight.
+ * @return New model, or NULL if this is not a trie model or bits are
+ *         out of range.
+ */
+ngram_model_t *ngram_model_trie_rebuild(ngram_model_t * base,
+                                        float64 prune_threshold,
+                                        int prob_bits, int bo_bits);
+
 /**
  * Write N-Gram model stored in trie structure in ARPABO format
  */
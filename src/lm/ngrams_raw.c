@@ -36,6 +36,8 @@
  */
 
 #include <string.h>
+#include <assert.h>
+#include <math.h>
 
 #include <pocketsphinx/err.h>
 
@@ -43,6 +45,7 @@
 #include "util/strfuncs.h"
 #include "util/ckd_alloc.h"
 #include "util/byteorder.h"
+#include "util/hash_table.h"
 #include "lm/ngram_model_internal.h"
 #include "lm/ngrams_raw.h"
 
@@ -67,28 +70,171 @@ ngram_ord_comparator(const void *a_raw, const void *b_raw)
     return a->order - b->order;
 }
 
+void
+ngrams_raw_sort(ngram_raw_t * raw_ngrams, uint32 count, uint32 n_words)
+{
+    ngram_raw_t *src, *dst, *tmp;
+    uint32 *offsets;
+    uint32 i;
+    int pos;
+
+    if (count < 2)
+        return;
+    tmp = (ngram_raw_t *) ckd_calloc(count, sizeof(*tmp));
+    offsets = (uint32 *) ckd_calloc(n_words + 1, sizeof(*offsets));
+    src = raw_ngrams;
+    dst = tmp;
+    /* Least significant word (the oldest history word) first. */
+    for (pos = (int) raw_ngrams[0].order - 1; pos >= 0; --pos) {
+        ngram_raw_t *swap;
+
+        memset(offsets, 0, (n_words + 1) * sizeof(*offsets));
+        for (i = 0; i < count; i++) {
+            assert(src[i].words[pos] < n_words);
+            ++offsets[src[i].words[pos] + 1];
+        }
+        for (i = 1; i <= n_words; i++)
+            offsets[i] += offsets[i - 1];
+        for (i = 0; i < count; i++)
+            dst[offsets[src[i].words[pos]]++] = src[i];
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != raw_ngrams)
+        memcpy(raw_ngrams, src, count * sizeof(*raw_ngrams));
+    ckd_free(offsets);
+    ckd_free(tmp);
+}
+
+/* Powers of ten which are exactly representable as doubles. */
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * Convert a decimal number without atof_c(), which is not thread-safe.
+ * Only numbers with at most 15 significant digits and a decimal
+ * exponent of at most 22 are accepted.  Both the digits and the power
+ * of ten are then exact doubles, so one correctly rounded
+ * multiplication or division gives the same result as atof_c().
+ * @return 0, or -1 if str has to be converted with atof_c() instead.
+ */
 static int
-ngrams_raw_read_line(lineiter_t *li, hash_table_t *wid,
-                    logmath_t *lmath, int order, int order_max,
-                    ngram_raw_t *raw_ngram)
+parse_weight_fast(char const *str, double *out_val)
+{
+    char const *p = str;
+    double mant = 0.0;
+    int neg = FALSE, n_digits = 0, any = FALSE, exp10 = 0;
+
+    if (*p == '-' || *p == '+')
+        neg = (*p++ == '-');
+    for (; *p >= '0' && *p <= '9'; ++p) {
+        any = TRUE;
+        if (n_digits == 0 && *p == '0')
+            continue;
+        if (++n_digits > 15)
+            return -1;
+        mant = mant * 10 + (*p - '0');
+    }
+    if (*p == '.') {
+        for (++p; *p >= '0' && *p <= '9'; ++p) {
+            any = TRUE;
+            --exp10;
+            if (n_digits == 0 && *p == '0')
+                continue;
+            if (++n_digits > 15)
+                return -1;
+            mant = mant * 10 + (*p - '0');
+        }
+    }
+    if (!any)
+        return -1;
+    if (*p == 'e' || *p == 'E') {
+        int eneg, e = 0;
+
+        ++p;
+        eneg = (*p == '-');
+        if (*p == '-' || *p == '+')
+            ++p;
+        if (!(*p >= '0' && *p <= '9'))
+            return -1;
+        for (; *p >= '0' && *p <= '9'; ++p)
+            if (e < 1000)
+                e = e * 10 + (*p - '0');
+        exp10 += eneg ? -e : e;
+    }
+    if (*p != '\0')
+        return -1;
+    if (mant != 0.0) {
+        if (exp10 < -22 || exp10 > 22)
+            return -1;
+        if (exp10 < 0)
+            mant /= exact_pow10[-exp10];
+        else
+            mant *= exact_pow10[exp10];
+    }
+    *out_val = neg ? -mant : mant;
+    return 0;
+}
+
+static int
+parse_weight(char const *str, int exact, float *out_weight)
+{
+    double val;
+
+    if (exact) {
+        *out_weight = atof_c(str);
+        return 0;
+    }
+    if (parse_weight_fast(str, &val) < 0)
+        return -1;
+    *out_weight = val;
+    return 0;
+}
+
+/**
+ * Fill in an ngram from a line of an ARPA file, which is modified.
+ * If exact is FALSE, nothing is logged, atof_c() is not used and
+ * nothing needs to be shared with other threads.  Lines which would
+ * need either of those are left alone and 1 is returned, so that they
+ * can be read again later with exact set to TRUE.
+ * @return 0 for success, -1 for a malformed line, 1 to read again.
+ */
+static int
+ngrams_raw_fill(char *line, int32 lineno, hash_table_t *wid,
+                logmath_t *lmath, int order, int order_max, int exact,
+                ngram_raw_t *raw_ngram)
 {
     int n, i;
     int words_expected;
     char *wptr[NGRAM_MAX_ORDER + 1];
     uint32 *word_out;
+    float weight, backoff;
 
     words_expected = order + 1;
     if ((n =
-         str2words(li->buf, wptr,
+         str2words(line, wptr,
                    NGRAM_MAX_ORDER + 1)) < words_expected) {
-        E_ERROR("Format error; %d-gram ignored at line %d\n", order, li->lineno);
+        if (!exact)
+            return 1;
+        E_ERROR("Format error; %d-gram ignored at line %d\n", order, lineno);
         return -1;
     }
+    if (parse_weight(wptr[0], exact, &weight) < 0)
+        return 1;
+    if (weight > 0 && !exact)
+        return 1;
+    backoff = 0.0f;
+    if (order < order_max && n != order + 1
+        && parse_weight(wptr[order + 1], exact, &backoff) < 0)
+        return 1;
 
     raw_ngram->order = order;
 
     if (order == order_max) {
-        raw_ngram->prob = atof_c(wptr[0]);
+        raw_ngram->prob = weight;
         if (raw_ngram->prob > 0) {
             E_WARN("%d-gram '%s' has positive probability\n", order, wptr[1]);
             raw_ngram->prob = 0.0f;
@@ -97,9 +243,6 @@ ngrams_raw_read_line(lineiter_t *li, hash_table_t *wid,
             logmath_log10_to_log_float(lmath, raw_ngram->prob);
     }
     else {
-        float weight, backoff;
-
-        weight = atof_c(wptr[0]);
         if (weight > 0) {
             E_WARN("%d-gram '%s' has positive probability\n", order, wptr[1]);
             raw_ngram->prob = 0.0f;
@@ -113,7 +256,6 @@ ngrams_raw_read_line(lineiter_t *li, hash_table_t *wid,
             raw_ngram->backoff = 0.0f;
         }
         else {
-            backoff = atof_c(wptr[order + 1]);
             raw_ngram->backoff =
                 logmath_log10_to_log_float(lmath, backoff);
         }
@@ -127,10 +269,19 @@ ngrams_raw_read_line(lineiter_t *li, hash_table_t *wid,
     return 0;
 }
 
+static int
+ngrams_raw_read_line(lineiter_t *li, hash_table_t *wid,
+                    logmath_t *lmath, int order, int order_max,
+                    ngram_raw_t *raw_ngram)
+{
+    return ngrams_raw_fill(li->buf, li->lineno, wid, lmath,
+                           order, order_max, TRUE, raw_ngram);
+}
+
 static int
 ngrams_raw_read_section(ngram_raw_t ** raw_ngrams, lineiter_t ** li,
                       hash_table_t * wid, logmath_t * lmath, uint32 *count,
-                      int order, int order_max)
+                      uint32 n_words, int order, int order_max)
 {
     char expected_header[20];
     uint32 i, cur;
@@ -159,7 +310,7 @@ ngrams_raw_read_section(ngram_raw_t ** raw_ngrams, lineiter_t ** li,
         }
     }
     *count = cur;
-    qsort(*raw_ngrams, *count, sizeof(ngram_raw_t), &ngram_ord_comparator);
+    ngrams_raw_sort(*raw_ngrams, *count, n_words);
     return 0;
 }
 
@@ -175,17 +326,19 @@ ngrams_raw_read_arpa(lineiter_t ** li, logmath_t * lmath, uint32 * counts,
 
     for (order_it = 2; order_it <= order; order_it++) {
         if (ngrams_raw_read_section(&raw_ngrams[order_it - 2], li, wid, lmath,
-                              counts + order_it - 1, order_it, order) < 0)
+                              counts + order_it - 1, counts[0],
+                              order_it, order) < 0)
         break;
     }
 
     /* Check if we found ARPA end-mark */
+    if (*li != NULL)
+        *li = lineiter_next(*li);
     if (*li == NULL) {
         E_ERROR("ARPA file ends without end-mark\n");
 	ngrams_raw_free(raw_ngrams, counts, order);
         return NULL;
     } else {
-        *li = lineiter_next(*li);
 	if (strcmp((*li)->buf, "\\end\\") != 0) {
     	    E_WARN
         	("Finished reading ARPA file. Expecting end mark but found '%s'\n",
@@ -196,6 +349,303 @@ ngrams_raw_read_arpa(lineiter_t ** li, logmath_t * lmath, uint32 * counts,
     return raw_ngrams;
 }
 
+/* A line to read again with ngrams_raw_fill() after the tasks are done. */
+typedef struct arpa_line_s {
+    char const *line;
+    size_t len;
+    int32 lineno;
+    uint32 idx;
+} arpa_line_t;
+
+/* Part of an ARPA section parsed by one task. */
+typedef struct arpa_chunk_s {
+    char const *pos;            /* Start of the first line. */
+    char const *end;            /* End of the data. */
+    int32 lineno;               /* Line number before pos. */
+    uint32 n_ngrams;            /* Number of ngram lines to read. */
+    ngram_raw_t *out;           /* Where the first one goes. */
+    hash_table_t *wid;
+    logmath_t *lmath;
+    int order, order_max;
+    char *buf;                  /* Copy of the current line. */
+    size_t bsiz;
+    arpa_line_t *deferred;      /* Lines to read again. */
+    uint32 n_deferred, n_deferred_alloc;
+} arpa_chunk_t;
+
+/* One order of ngrams to sort. */
+typedef struct arpa_sort_s {
+    ngram_raw_t *raw_ngrams;
+    uint32 count;
+    uint32 n_words;
+} arpa_sort_t;
+
+static int
+is_trim_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f';
+}
+
+/**
+ * Find the next line in [pos, end) which lineiter_next() would return
+ * for a clean line iterator, i.e. which is neither empty nor a comment
+ * once surrounding whitespace is trimmed.
+ * @return the position after that line, or NULL if there is none.
+ */
+static char const *
+arpa_next_line(char const *pos, char const *end, int32 *lineno,
+               char const **out_line, size_t *out_len)
+{
+    while (pos < end) {
+        char const *eol = memchr(pos, '\n', end - pos);
+        char const *next = eol ? eol + 1 : end;
+        char const *s = pos, *e = eol ? eol : end;
+
+        ++*lineno;
+        while (s < e && is_trim_space(*s))
+            ++s;
+        while (e > s && is_trim_space(e[-1]))
+            --e;
+        pos = next;
+        if (s < e && *s != '#') {
+            *out_line = s;
+            *out_len = e - s;
+            return pos;
+        }
+    }
+    return NULL;
+}
+
+static char *
+arpa_copy_line(char **buf, size_t *bsiz, char const *line, size_t len)
+{
+    if (len + 1 > *bsiz) {
+        *bsiz = len + 1;
+        *buf = ckd_realloc(*buf, *bsiz);
+    }
+    memcpy(*buf, line, len);
+    (*buf)[len] = '\0';
+    return *buf;
+}
+
+static void
+arpa_parse_chunk(void *arg)
+{
+    arpa_chunk_t *chunk = (arpa_chunk_t *) arg;
+    char const *pos = chunk->pos;
+    int32 lineno = chunk->lineno;
+    uint32 i;
+
+    for (i = 0; i < chunk->n_ngrams; ++i) {
+        char const *line;
+        size_t len;
+
+        /* All of these lines were found before the tasks started. */
+        pos = arpa_next_line(pos, chunk->end, &lineno, &line, &len);
+        assert(pos != NULL);
+        arpa_copy_line(&chunk->buf, &chunk->bsiz, line, len);
+        if (ngrams_raw_fill(chunk->buf, lineno, chunk->wid, chunk->lmath,
+                            chunk->order, chunk->order_max, FALSE,
+                            chunk->out + i) != 0) {
+            arpa_line_t *dl;
+
+            if (chunk->n_deferred == chunk->n_deferred_alloc) {
+                chunk->n_deferred_alloc = chunk->n_deferred_alloc
+                    ? chunk->n_deferred_alloc * 2 : 16;
+                chunk->deferred =
+                    ckd_realloc(chunk->deferred, chunk->n_deferred_alloc
+                                * sizeof(*chunk->deferred));
+            }
+            dl = chunk->deferred + chunk->n_deferred++;
+            dl->line = line;
+            dl->len = len;
+            dl->lineno = lineno;
+            dl->idx = i;
+        }
+    }
+}
+
+static void
+arpa_sort_order(void *arg)
+{
+    arpa_sort_t *sort = (arpa_sort_t *) arg;
+
+    ngrams_raw_sort(sort->raw_ngrams, sort->count, sort->n_words);
+}
+
+static void
+arpa_run_tasks(ngram_task_fn fn, void **args, int n_args,
+               ngram_run_tasks_fn run, void *udata)
+{
+    int i;
+
+    if (run) {
+        run(fn, args, n_args, udata);
+        return;
+    }
+    for (i = 0; i < n_args; ++i)
+        fn(args[i]);
+}
+
+/**
+ * Read one section of an ARPA file in memory.  The lines are located
+ * here, then parsed in chunks by the tasks, then whatever the tasks
+ * could not parse on their own is parsed in order of appearance, so
+ * that the result and messages are the same as from
+ * ngrams_raw_read_section().
+ */
+static int
+ngrams_raw_read_section_mem(ngram_raw_t ** raw_ngrams, char const **pos,
+                            char const *end, int32 *lineno,
+                            hash_table_t * wid, logmath_t * lmath,
+                            uint32 *count, int order, int order_max,
+                            arpa_chunk_t *chunks, int n_chunks,
+                            ngram_run_tasks_fn run, void *udata)
+{
+    char expected_header[20];
+    size_t header_len;
+    char const *line;
+    size_t len;
+    uint32 i, cur, per_chunk;
+    void **args;
+    int c;
+
+    sprintf(expected_header, "\\%d-grams:", order);
+    header_len = strlen(expected_header);
+    while ((*pos = arpa_next_line(*pos, end, lineno, &line, &len)) != NULL) {
+        if (len == header_len
+            && memcmp(line, expected_header, header_len) == 0)
+            break;
+    }
+    if (*pos == NULL) {
+        E_ERROR("Failed to find '%s', language model file truncated\n",
+                expected_header);
+        return -1;
+    }
+
+    *raw_ngrams = (ngram_raw_t *) ckd_calloc(*count, sizeof(ngram_raw_t));
+    if ((uint32)n_chunks > *count)
+        n_chunks = *count ? *count : 1;
+    per_chunk = (*count + n_chunks - 1) / n_chunks;
+    for (i = 0, c = 0; i < *count; i++) {
+        if (i % per_chunk == 0) {
+            c = i / per_chunk;
+            chunks[c].pos = *pos;
+            chunks[c].end = end;
+            chunks[c].lineno = *lineno;
+            chunks[c].n_ngrams = 0;
+            chunks[c].out = *raw_ngrams + i;
+            chunks[c].wid = wid;
+            chunks[c].lmath = lmath;
+            chunks[c].order = order;
+            chunks[c].order_max = order_max;
+            chunks[c].n_deferred = 0;
+        }
+        if ((*pos = arpa_next_line(*pos, end, lineno, &line, &len)) == NULL) {
+            E_ERROR("Unexpected end of ARPA file. Failed to read %d-gram\n",
+                    order);
+            return -1;
+        }
+        ++chunks[c].n_ngrams;
+    }
+    n_chunks = *count ? c + 1 : 0;
+
+    args = ckd_calloc(n_chunks ? n_chunks : 1, sizeof(*args));
+    for (c = 0; c < n_chunks; ++c)
+        args[c] = chunks + c;
+    arpa_run_tasks(arpa_parse_chunk, args, n_chunks, run, udata);
+    ckd_free(args);
+
+    for (c = 0; c < n_chunks; ++c) {
+        for (i = 0; i < chunks[c].n_deferred; ++i) {
+            arpa_line_t *dl = chunks[c].deferred + i;
+
+            arpa_copy_line(&chunks[c].buf, &chunks[c].bsiz,
+                           dl->line, dl->len);
+            ngrams_raw_fill(chunks[c].buf, dl->lineno, wid, lmath,
+                            order, order_max, TRUE,
+                            chunks[c].out + dl->idx);
+        }
+    }
+    /* Malformed lines were left empty, remove them. */
+    for (i = 0, cur = 0; i < *count; i++) {
+        if ((*raw_ngrams)[i].words == NULL)
+            continue;
+        if (cur != i)
+            (*raw_ngrams)[cur] = (*raw_ngrams)[i];
+        cur++;
+    }
+    *count = cur;
+    return 0;
+}
+
+ngram_raw_t **
+ngrams_raw_read_arpa_mem(char const *data, size_t size, int32 lineno,
+                         logmath_t * lmath, uint32 * counts, int order,
+                         hash_table_t * wid, int n_chunks,
+                         ngram_run_tasks_fn run, void *udata)
+{
+    ngram_raw_t **raw_ngrams;
+    arpa_chunk_t *chunks;
+    arpa_sort_t *sorts;
+    void **args;
+    char const *pos, *end, *line;
+    size_t len;
+    int order_it, c, rv = 0;
+
+    if (n_chunks < 1)
+        n_chunks = 1;
+    pos = data;
+    end = data + size;
+    raw_ngrams =
+        (ngram_raw_t **) ckd_calloc(order - 1, sizeof(*raw_ngrams));
+    chunks = (arpa_chunk_t *) ckd_calloc(n_chunks, sizeof(*chunks));
+    for (order_it = 2; order_it <= order; order_it++) {
+        if ((rv = ngrams_raw_read_section_mem(&raw_ngrams[order_it - 2],
+                                              &pos, end, &lineno, wid,
+                                              lmath, counts + order_it - 1,
+                                              order_it, order, chunks,
+                                              n_chunks, run, udata)) < 0)
+            break;
+    }
+    for (c = 0; c < n_chunks; ++c) {
+        ckd_free(chunks[c].buf);
+        ckd_free(chunks[c].deferred);
+    }
+    ckd_free(chunks);
+
+    if (rv < 0
+        || (pos = arpa_next_line(pos, end, &lineno, &line, &len)) == NULL) {
+        E_ERROR("ARPA file ends without end-mark\n");
+        ngrams_raw_free(raw_ngrams, counts, order);
+        return NULL;
+    }
+    if (len != 5 || memcmp(line, "\\end\\", 5) != 0) {
+        char *found = ckd_calloc(len + 1, 1);
+
+        memcpy(found, line, len);
+        E_WARN
+            ("Finished reading ARPA file. Expecting end mark but found '%s'\n",
+             found);
+        ckd_free(found);
+    }
+
+    /* Each order is sorted separately. */
+    sorts = (arpa_sort_t *) ckd_calloc(order - 1, sizeof(*sorts));
+    args = ckd_calloc(order - 1, sizeof(*args));
+    for (order_it = 2; order_it <= order; order_it++) {
+        sorts[order_it - 2].raw_ngrams = raw_ngrams[order_it - 2];
+        sorts[order_it - 2].count = counts[order_it - 1];
+        sorts[order_it - 2].n_words = counts[0];
+        args[order_it - 2] = sorts + order_it - 2;
+    }
+    arpa_run_tasks(arpa_sort_order, args, order - 1, run, udata);
+    ckd_free(args);
+    ckd_free(sorts);
+
+    return raw_ngrams;
+}
+
 static void
 read_dmp_weight_array(FILE * fp, logmath_t * lmath, uint8 do_swap,
                       int32 counts, ngram_raw_t * raw_ngrams,
@@ -362,11 +812,9 @@ ngrams_raw_read_dmp(FILE * fp, logmath_t * lmath, uint32 * counts,
     ckd_free(bigrams_next);
 
     /* sort raw ngrams for reverse trie */
-    qsort(raw_ngrams[0], (size_t) counts[1], sizeof(*raw_ngrams[0]),
-          &ngram_ord_comparator);
+    ngrams_raw_sort(raw_ngrams[0], counts[1], counts[0]);
     if (order > 2) {
-        qsort(raw_ngrams[1], (size_t) counts[2], sizeof(*raw_ngrams[1]),
-              &ngram_ord_comparator);
+        ngrams_raw_sort(raw_ngrams[1], counts[2], counts[0]);
     }
     return raw_ngrams;
 }
@@ -378,6 +826,8 @@ ngrams_raw_free(ngram_raw_t ** raw_ngrams, uint32 * counts, int order)
     int order_it;
 
     for (order_it = 0; order_it < order - 1; order_it++) {
+        if (raw_ngrams[order_it] == NULL)
+            continue;
         for (num = 0; num < counts[order_it + 1]; num++) {
             ckd_free(raw_ngrams[order_it][num].words);
         }
@@ -385,3 +835,271 @@ ngrams_raw_free(ngram_raw_t ** raw_ngrams, uint32 * counts, int order)
     }
     ckd_free(raw_ngrams);
 }
+
+/**
+ * Index of raw ngrams by their words, for computing backed-off
+ * probabilities while editing a model.
+ */
+typedef struct raw_index_s {
+    hash_table_t *ngrams[NGRAM_MAX_ORDER];
+    float32 *ug_prob;
+    float32 *ug_bo;
+} raw_index_t;
+
+static void
+raw_index_init(raw_index_t * idx, ngram_raw_t ** raw_ngrams,
+               uint32 * counts, int order, float32 * ug_prob,
+               float32 * ug_bo)
+{
+    int i;
+    uint32 j;
+
+    memset(idx, 0, sizeof(*idx));
+    idx->ug_prob = ug_prob;
+    idx->ug_bo = ug_bo;
+    for (i = 2; i <= order; i++) {
+        idx->ngrams[i - 1] = hash_table_new(counts[i - 1], HASH_CASE_YES);
+        for (j = 0; j < counts[i - 1]; j++) {
+            ngram_raw_t *ngram = &raw_ngrams[i - 2][j];
+            hash_table_enter_bkey(idx->ngrams[i - 1], (char *) ngram->words,
+                                  i * sizeof(*ngram->words), ngram);
+        }
+    }
+}
+
+static void
+raw_index_free(raw_index_t * idx)
+{
+    int i;
+
+    for (i = 0; i < NGRAM_MAX_ORDER; i++)
+        hash_table_free(idx->ngrams[i]);
+}
+
+static ngram_raw_t *
+raw_index_find(raw_index_t * idx, uint32 * words, int order)
+{
+    void *val;
+
+    if (hash_table_lookup_bkey(idx->ngrams[order - 1], (char *) words,
+                               order * sizeof(*words), &val) == 0)
+        return (ngram_raw_t *) val;
+    return NULL;
+}
+
+/**
+ * Backoff weight of a history of given length.
+ */
+static float32
+raw_index_backoff(raw_index_t * idx, uint32 * hist, int order)
+{
+    ngram_raw_t *ngram;
+
+    if (order == 1)
+        return idx->ug_bo[hist[0]];
+    if ((ngram = raw_index_find(idx, hist, order)) != NULL)
+        return ngram->backoff;
+    return 0.0f;
+}
+
+/**
+ * Backed-off probability of a word (words[0]) given its history.
+ */
+static float32
+raw_index_prob(raw_index_t * idx, uint32 * words, int order)
+{
+    ngram_raw_t *ngram;
+
+    if (order == 1)
+        return idx->ug_prob[words[0]];
+    if ((ngram = raw_index_find(idx, words, order)) != NULL)
+        return ngram->prob;
+    return raw_index_backoff(idx, words + 1, order - 1)
+        + raw_index_prob(idx, words, order - 1);
+}
+
+/**
+ * Order ngrams by their history, then by word.
+ */
+static int
+ngram_context_comparator(const void *a_ptr, const void *b_ptr)
+{
+    const ngram_raw_t *a = *(const ngram_raw_t **) a_ptr;
+    const ngram_raw_t *b = *(const ngram_raw_t **) b_ptr;
+    uint32 i;
+
+    for (i = 1; i < a->order; ++i)
+        if (a->words[i] != b->words[i])
+            return a->words[i] < b->words[i] ? -1 : 1;
+    if (a->words[0] != b->words[0])
+        return a->words[0] < b->words[0] ? -1 : 1;
+    return 0;
+}
+
+static ngram_raw_t **
+sort_by_context(ngram_raw_t * raw_ngrams, uint32 count)
+{
+    ngram_raw_t **sorted;
+    uint32 i;
+
+    sorted = (ngram_raw_t **) ckd_calloc(count + 1, sizeof(*sorted));
+    for (i = 0; i < count; i++)
+        sorted[i] = &raw_ngrams[i];
+    qsort(sorted, count, sizeof(*sorted), &ngram_context_comparator);
+    return sorted;
+}
+
+/**
+ * Find the end of the run of ngrams sharing the history of sorted[start].
+ */
+static uint32
+context_end(ngram_raw_t ** sorted, uint32 start, uint32 count)
+{
+    uint32 *hist = sorted[start]->words + 1;
+    uint32 n_hist = sorted[start]->order - 1;
+    uint32 end;
+
+    for (end = start + 1; end < count
+             && memcmp(sorted[end]->words + 1, hist,
+                       n_hist * sizeof(*hist)) == 0; ++end)
+        ;
+    return end;
+}
+
+int32
+ngrams_raw_normalize(ngram_raw_t ** raw_ngrams, uint32 * counts, int order,
+                     float32 * ug_prob, float32 * ug_bo, logmath_t * lmath)
+{
+    raw_index_t idx;
+    int32 n_bad = 0;
+    int k;
+
+    raw_index_init(&idx, raw_ngrams, counts, order, ug_prob, ug_bo);
+    /* Shortest histories first since longer ones back off to them. */
+    for (k = 1; k < order; ++k) {
+        ngram_raw_t **sorted;
+        uint32 start, end, i;
+
+        sorted = sort_by_context(raw_ngrams[k - 1], counts[k]);
+        for (start = 0; start < counts[k]; start = end) {
+            float64 numer = 1.0, denom = 1.0;
+            uint32 *hist = sorted[start]->words + 1;
+            int32 bo;
+
+            end = context_end(sorted, start, counts[k]);
+            for (i = start; i < end; ++i) {
+                numer -= logmath_exp(lmath, (int32) sorted[i]->prob);
+                denom -= logmath_exp(lmath,
+                                     (int32) raw_index_prob(&idx,
+                                                            sorted[i]->words,
+                                                            k));
+            }
+            if (numer > 0 && denom > 0)
+                bo = logmath_log(lmath, numer / denom);
+            else {
+                ++n_bad;
+                bo = 0;
+            }
+            if (k == 1)
+                ug_bo[hist[0]] = (float32) bo;
+            else {
+                ngram_raw_t *ctx = raw_index_find(&idx, hist, k);
+                if (ctx)
+                    ctx->backoff = (float32) bo;
+            }
+        }
+        ckd_free(sorted);
+    }
+    raw_index_free(&idx);
+    return n_bad;
+}
+
+uint32
+ngrams_raw_prune(ngram_raw_t ** raw_ngrams, uint32 * counts, int order,
+                 float32 * ug_prob, float32 * ug_bo, logmath_t * lmath,
+                 float64 threshold)
+{
+    uint32 n_pruned = 0;
+    int k;
+
+    for (k = order; k >= 2; --k) {
+        raw_index_t idx;
+        ngram_raw_t **sorted;
+        uint8 *keep;
+        uint32 start, end, i, j;
+
+        raw_index_init(&idx, raw_ngrams, counts, order, ug_prob, ug_bo);
+        keep = (uint8 *) ckd_calloc(counts[k - 1] + 1, sizeof(*keep));
+        /* Histories of higher-order ngrams can't be pruned. */
+        if (k < order) {
+            for (i = 0; i < counts[k]; ++i) {
+                ngram_raw_t *ctx = raw_index_find(&idx,
+                                                  raw_ngrams[k - 1][i].words
+                                                  + 1, k);
+                if (ctx)
+                    keep[ctx - raw_ngrams[k - 2]] = TRUE;
+            }
+        }
+        sorted = sort_by_context(raw_ngrams[k - 2], counts[k - 1]);
+        for (start = 0; start < counts[k - 1]; start = end) {
+            float64 numer = 1.0, denom = 1.0, p_hist = 1.0;
+            uint32 *hist = sorted[start]->words + 1;
+
+            end = context_end(sorted, start, counts[k - 1]);
+            for (i = start; i < end; ++i) {
+                numer -= logmath_exp(lmath, (int32) sorted[i]->prob);
+                denom -= logmath_exp(lmath,
+                                     (int32) raw_index_prob(&idx,
+                                                            sorted[i]->words,
+                                                            k - 1));
+            }
+            if (numer <= 0 || denom <= 0) {
+                for (i = start; i < end; ++i)
+                    keep[sorted[i] - raw_ngrams[k - 2]] = TRUE;
+                continue;
+            }
+            for (i = 0; i < (uint32) k - 1; ++i)
+                p_hist *= logmath_exp(lmath,
+                                      (int32) raw_index_prob(&idx, hist + i,
+                                                             k - 1 - i));
+            /* Relative change in training set perplexity from
+             * removing each ngram and backing off instead (Stolcke,
+             * 1998), computed independently for each ngram. */
+            for (i = start; i < end; ++i) {
+                float64 p, p_lo, bo, new_bo, delta;
+
+                if (keep[sorted[i] - raw_ngrams[k - 2]])
+                    continue;
+                p = logmath_exp(lmath, (int32) sorted[i]->prob);
+                p_lo = logmath_exp(lmath,
+                                   (int32) raw_index_prob(&idx,
+                                                          sorted[i]->words,
+                                                          k - 1));
+                bo = numer / denom;
+                new_bo = (numer + p) / (denom + p_lo);
+                delta = -p_hist * (p * (log(p_lo * new_bo) - log(p))
+                                   + numer * (log(new_bo) - log(bo)));
+                if (exp(delta) - 1.0 >= threshold)
+                    keep[sorted[i] - raw_ngrams[k - 2]] = TRUE;
+            }
+        }
+        ckd_free(sorted);
+        raw_index_free(&idx);
+
+        for (i = j = 0; i < counts[k - 1]; ++i) {
+            if (keep[i])
+                raw_ngrams[k - 2][j++] = raw_ngrams[k - 2][i];
+            else
+                ckd_free(raw_ngrams[k - 2][i].words);
+        }
+        E_INFO("Pruned %u of %u %d-grams\n", counts[k - 1] - j,
+               counts[k - 1], k);
+        n_pruned += counts[k - 1] - j;
+        counts[k - 1] = j;
+        ckd_free(keep);
+
+        ngrams_raw_normalize(raw_ngrams, counts, order, ug_prob, ug_bo,
+                             lmath);
+    }
+    return n_pruned;
+}
@@ -60,6 +60,19 @@ typedef union {
  */
 int ngram_ord_comparator(const void *a_raw, const void *b_raw);
 
+/**
+ * Sort raw ngrams of a single order in the same order as
+ * ngram_ord_comparator() would, using a stable radix sort on word
+ * ids.  This takes O(order * (count + n_words)) time, which is much
+ * faster than qsort() for the tens of millions of ngrams in large
+ * models.
+ * @param raw_ngrams [in,out] ngrams to sort, all of the same order
+ * @param count      [in] number of ngrams
+ * @param n_words    [in] number of words, all word ids are below it
+ */
+void ngrams_raw_sort(ngram_raw_t * raw_ngrams, uint32 count,
+                     uint32 n_words);
+
 /**
  * Read ngrams of order > 1 from ARPA file
  * @param li     [in] sphinxbase file line iterator that point to bigram description in ARPA file
@@ -73,6 +86,47 @@ ngram_raw_t **ngrams_raw_read_arpa(lineiter_t ** li, logmath_t * lmath,
                                    uint32 * counts, int order,
                                    hash_table_t * wid);
 
+/**
+ * Task run by an ngram_run_tasks_fn.
+ */
+typedef void (*ngram_task_fn)(void *arg);
+
+/**
+ * Run a set of independent tasks, possibly in parallel.
+ * This must call fn(args[i]) exactly once for each i and return only
+ * when all of the calls have finished.  The library itself never
+ * creates threads, so programs which want to parse in parallel supply
+ * one of these (see pocketsphinx_lm_convert).
+ */
+typedef void (*ngram_run_tasks_fn)(ngram_task_fn fn, void **args,
+                                   int n_args, void *udata);
+
+/**
+ * Read ngrams of order > 1 from an ARPA file in memory.
+ * This gives the same result as ngrams_raw_read_arpa(), but each
+ * section is split into chunks which are parsed as separate tasks,
+ * and the sorting of each order is a separate task too.
+ * @param data     [in] text following the unigram section of the file
+ * @param size     [in] size of data in bytes
+ * @param lineno   [in] line number of the last line before data
+ * @param lmath    [in] log math used for log conversions
+ * @param counts   [in,out] amount of ngrams for each order, updated
+ *                          if some ngrams are malformed
+ * @param order    [in] maximum order of ngrams
+ * @param wid      [in] hashtable that maps word strings to ids
+ * @param n_chunks [in] number of chunks to split each section into
+ * @param run      [in] function to run tasks with, or NULL to run them
+ *                      one after the other
+ * @param udata    [in] data passed to run
+ * @return              raw ngrams of order bigger than 1, or NULL on error
+ */
+ngram_raw_t **ngrams_raw_read_arpa_mem(char const *data, size_t size,
+                                       int32 lineno, logmath_t * lmath,
+                                       uint32 * counts, int order,
+                                       hash_table_t * wid, int n_chunks,
+                                       ngram_run_tasks_fn run,
+                                       void *udata);
+
 /**
  * Reads ngrams of order > 1 from DMP file.
  * @param fp           [in] file to read from. Position in file corresponds to start of bigram description
@@ -90,4 +144,34 @@ ngram_raw_t **ngrams_raw_read_dmp(FILE * fp, logmath_t * lmath,
 void ngrams_raw_free(ngram_raw_t ** raw_ngrams, uint32 * counts,
                      int order);
 
+/**
+ * Recompute backoff weights so that the probabilities following
+ * every history sum to one.
+ * @param raw_ngrams [in,out] sorted ngrams of order 2 and up, backoffs are updated
+ * @param counts     [in] amount of ngrams for each order
+ * @param order      [in] maximum order of ngrams
+ * @param ug_prob    [in] unigram log probabilities
+ * @param ug_bo      [in,out] unigram log backoffs, updated
+ * @param lmath      [in] log math used for all weights
+ * @return                number of histories with no probability mass left
+ *                        to back off with (their backoff is set to 0)
+ */
+int32 ngrams_raw_normalize(ngram_raw_t ** raw_ngrams, uint32 * counts,
+                           int order, float32 * ug_prob, float32 * ug_bo,
+                           logmath_t * lmath);
+
+/**
+ * Remove ngrams whose removal raises training set perplexity by less
+ * than a relative threshold, using the relative entropy criterion of
+ * Stolcke (1998), then recompute backoff weights.  Unigrams and
+ * histories of remaining ngrams are never pruned.
+ * @param raw_ngrams [in,out] sorted ngrams of order 2 and up, pruned in place
+ * @param counts     [in,out] amount of ngrams for each order, updated
+ * @param threshold  [in] relative perplexity increase, e.g. 1e-8
+ * @return                number of ngrams removed
+ */
+uint32 ngrams_raw_prune(ngram_raw_t ** raw_ngrams, uint32 * counts,
+                        int order, float32 * ug_prob, float32 * ug_bo,
+                        logmath_t * lmath, float64 threshold);
+
 #endif                          /* __LM_NGRAMS_RAW_H__ */
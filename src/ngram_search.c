@@ -88,6 +88,23 @@ ngram_search_update_widmap(ngram_search_t *ngs)
     ckd_free(words);
 }
 
+/*
+ * Fill in triphone context tables for words we can recognize (those
+ * in the LM, plus fillers and sentence markers).
+ */
+static void
+ngram_search_update_d2p(ngram_search_t *ngs)
+{
+    dict_t *dict = ps_search_dict(ngs);
+    int32 w;
+
+    for (w = 0; w < ps_search_n_words(ngs); ++w) {
+        if (!dict_real_word(dict, w)
+            || ngram_model_set_known_wid(ngs->lmset, dict_basewid(dict, w)))
+            dict2pid_add_word(ps_search_dict2pid(ngs), w);
+    }
+}
+
 static void
 ngram_search_calc_beams(ngram_search_t *ngs)
 {
@@ -108,7 +125,15 @@ ngram_search_calc_beams(ngram_search_t *ngs)
 
     /* Absolute pruning parameters. */
     ngs->maxwpf = ps_config_int(config, "maxwpf");
-    ngs->maxhmmpf = ps_config_int(config, "maxhmmpf");
+    histprune_init(&ngs->hprune, config);
+
+    /* Language model lookahead in the HMM tree. */
+    ngs->la_order = ps_config_int(config, "fwdtreela");
+    if (ngs->la_order < 0 || ngs->la_order > 2) {
+        E_WARN("Unsupported LM lookahead order %d, using %d\n",
+               ngs->la_order, ngs->la_order < 0 ? 0 : 2);
+        ngs->la_order = ngs->la_order < 0 ? 0 : 2;
+    }
 
     /* Various penalties which may or may not be useful. */
     ngs->wip = logmath_log(acmod->lmath, ps_config_float(config, "wip")) >>SENSCR_SHIFT;
@@ -139,16 +164,43 @@ ngram_search_init(const char *name,
                   dict_t *dict,
                   dict2pid_t *d2p)
 {
-    ngram_search_t *ngs;
-    static char *lmname = "default";
+    ps_search_t *search;
+
+    if ((search = ngram_search_prepare(name, lm, config,
+                                       acmod, dict, d2p)) == NULL)
+        return NULL;
+    ngram_search_commit(search);
+    return search;
+}
+
+void
+ngram_search_commit(ps_search_t *search)
+{
+    ngram_search_t *ngs = (ngram_search_t *)search;
+    cmd_ln_t *config = ps_search_config(ngs);
 
     /* Make the acmod's feature buffer growable if we are doing two-pass
      * search. */
-    acmod_set_grow(acmod, ps_config_bool(config, "fwdflat") &&
-                          ps_config_bool(config, "fwdtree"));
+    acmod_set_grow(ps_search_acmod(ngs), ps_config_bool(config, "fwdflat") &&
+                   ps_config_bool(config, "fwdtree"));
+    ps_search_base_commit(search);
+    ngram_search_update_d2p(ngs);
+}
+
+ps_search_t *
+ngram_search_prepare(const char *name,
+                     ngram_model_t *lm,
+                     cmd_ln_t *config,
+                     acmod_t *acmod,
+                     dict_t *dict,
+                     dict2pid_t *d2p)
+{
+    ngram_search_t *ngs;
+    static char *lmname = "default";
 
     ngs = ckd_calloc(1, sizeof(*ngs));
-    ps_search_init(&ngs->base, &ngram_funcs, PS_SEARCH_TYPE_NGRAM, name, config, acmod, dict, d2p);
+    ps_search_init_borrowed(&ngs->base, &ngram_funcs, PS_SEARCH_TYPE_NGRAM,
+                            name, config, acmod, dict, d2p);
 
     ngs->hmmctx = hmm_context_init(bin_mdef_n_emit_state(acmod->mdef),
                                    acmod->tmat->tp, NULL, acmod->mdef->sseq);
@@ -171,6 +223,12 @@ ngram_search_init(const char *name,
     ngs->word_active = bitvec_alloc(dict_size(dict));
     ngs->last_ltrans = ckd_calloc(dict_size(dict),
                                   sizeof(*ngs->last_ltrans));
+    ngs->lm_batch_wid = ckd_calloc(dict_size(dict),
+                                   sizeof(*ngs->lm_batch_wid));
+    ngs->lm_batch_scr = ckd_calloc(dict_size(dict),
+                                   sizeof(*ngs->lm_batch_scr));
+    ngs->lm_batch_exit = ckd_calloc(dict_size(dict),
+                                    sizeof(*ngs->lm_batch_exit));
 
     /* FIXME: All these structures need to be made dynamic with
      * garbage collection. */
@@ -201,8 +259,10 @@ ngram_search_init(const char *name,
                 "recognition will fail\n");
         goto error_out;
     }
+    ngs->lmcache = ngram_cache_init(ngs->lmset, 0);
 
-    /* Create word mappings. */
+    /* Create word mappings.  Triphone context tables are shared
+     * with the decoder and filled in by ngram_search_commit(). */
     ngram_search_update_widmap(ngs);
 
     /* Initialize fwdtree, fwdflat, bestpath modules if necessary. */
@@ -246,10 +306,16 @@ ngram_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
         ckd_free(ngs->word_lat_idx);
         ckd_free(ngs->word_active);
         ckd_free(ngs->last_ltrans);
+        ckd_free(ngs->lm_batch_wid);
+        ckd_free(ngs->lm_batch_scr);
+        ckd_free(ngs->lm_batch_exit);
         ckd_free_2d(ngs->active_word_list);
         ngs->word_lat_idx = ckd_calloc(search->n_words, sizeof(*ngs->word_lat_idx));
         ngs->word_active = bitvec_alloc(search->n_words);
         ngs->last_ltrans = ckd_calloc(search->n_words, sizeof(*ngs->last_ltrans));
+        ngs->lm_batch_wid = ckd_calloc(search->n_words, sizeof(*ngs->lm_batch_wid));
+        ngs->lm_batch_scr = ckd_calloc(search->n_words, sizeof(*ngs->lm_batch_scr));
+        ngs->lm_batch_exit = ckd_calloc(search->n_words, sizeof(*ngs->lm_batch_exit));
         ngs->active_word_list
             = ckd_calloc_2d(2, search->n_words,
                             sizeof(**ngs->active_word_list));
@@ -264,8 +330,12 @@ ngram_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
     /* Update beam widths. */
     ngram_search_calc_beams(ngs);
 
+    /* Scores may have changed along with the vocabulary. */
+    ngram_cache_reset(ngs->lmcache);
+
     /* Update word mappings. */
     ngram_search_update_widmap(ngs);
+    ngram_search_update_d2p(ngs);
 
     /* Now rebuild lextrees. */
     if (ngs->fwdtree) {
@@ -306,6 +376,7 @@ ngram_search_free(ps_search_t *search)
     listelem_alloc_free(ngs->chan_alloc);
     listelem_alloc_free(ngs->root_chan_alloc);
     listelem_alloc_free(ngs->latnode_alloc);
+    ngram_cache_free(ngs->lmcache);
     ngram_model_free(ngs->lmset);
 
     ckd_free(ngs->word_chan);
@@ -315,11 +386,82 @@ ngram_search_free(ps_search_t *search)
     ckd_free(ngs->bscore_stack);
     if (ngs->bp_table_idx != NULL)
         ckd_free(ngs->bp_table_idx - 1);
+    ckd_free(ngs->latcand);
+    ckd_free(ngs->latcand_sf);
     ckd_free_2d(ngs->active_word_list);
     ckd_free(ngs->last_ltrans);
+    ckd_free(ngs->lm_batch_wid);
+    ckd_free(ngs->lm_batch_scr);
+    ckd_free(ngs->lm_batch_exit);
     ckd_free(ngs);
 }
 
+void
+ngram_search_reset_bptable(ngram_search_t *ngs)
+{
+    ngs->bpidx = 0;
+    ngs->bss_head = 0;
+    ngs->n_latcand = 0;
+    ngs->latcand_bpidx = 0;
+    if (ngs->latcand_sf)
+        memset(ngs->latcand_sf, -1,
+               ngs->n_frame_alloc * sizeof(*ngs->latcand_sf));
+}
+
+/**
+ * Add backpointer table entries up to end_bpidx to the lattice nodes.
+ *
+ * This is the incremental equivalent of scanning the entire
+ * backpointer table for unique <wid,sf> pairs.  The final </s> is
+ * left for ngram_search_lattice() to find, since we do not know
+ * which frame is final until the lattice is built.
+ */
+static void
+add_latcand(ngram_search_t *ngs, int32 end_bpidx)
+{
+    for (; ngs->latcand_bpidx < end_bpidx; ++ngs->latcand_bpidx) {
+        bptbl_t *bp_ptr = ngs->bp_table + ngs->latcand_bpidx;
+        latcand_t *cand;
+        int32 sf, wid, i;
+
+        /* Skip invalid backpointers (these result from -maxwpf pruning) */
+        if (!bp_ptr->valid)
+            continue;
+        wid = bp_ptr->wid;
+        if (wid == ps_search_finish_wid(ngs))
+            continue;
+        /* Skip if word not in LM */
+        if ((!dict_filler_word(ps_search_dict(ngs), wid))
+            && (!ngram_model_set_known_wid(ngs->lmset,
+                                           dict_basewid(ps_search_dict(ngs), wid))))
+            continue;
+
+        sf = (bp_ptr->bp < 0) ? 0 : ngs->bp_table[bp_ptr->bp].frame + 1;
+        for (i = ngs->latcand_sf[sf]; i != -1; i = ngs->latcand[i].next) {
+            if (ngs->latcand[i].wid == wid)
+                break;
+        }
+        if (i != -1) {
+            ngs->latcand[i].lef = ngs->latcand_bpidx;
+            continue;
+        }
+
+        if (ngs->n_latcand == ngs->n_latcand_alloc) {
+            ngs->n_latcand_alloc = ngs->n_latcand_alloc
+                ? ngs->n_latcand_alloc * 2 : 256;
+            ngs->latcand = ckd_realloc(ngs->latcand,
+                                       ngs->n_latcand_alloc
+                                       * sizeof(*ngs->latcand));
+        }
+        cand = ngs->latcand + ngs->n_latcand;
+        cand->wid = wid;
+        cand->sf = sf;
+        cand->fef = cand->lef = ngs->latcand_bpidx;
+        cand->next = ngs->latcand_sf[sf];
+        ngs->latcand_sf[sf] = ngs->n_latcand++;
+    }
+}
+
 int
 ngram_search_mark_bptable(ngram_search_t *ngs, int frame_idx)
 {
@@ -333,9 +475,27 @@ ngram_search_mark_bptable(ngram_search_t *ngs, int frame_idx)
                                             ngs->n_frame_alloc
                                             * sizeof(*ngs->frm_wordlist));
         }
+        if (ngs->latcand_sf) {
+            ngs->latcand_sf = ckd_realloc(ngs->latcand_sf,
+                                          ngs->n_frame_alloc
+                                          * sizeof(*ngs->latcand_sf));
+            memset(ngs->latcand_sf + ngs->n_frame_alloc / 2, -1,
+                   ngs->n_frame_alloc / 2 * sizeof(*ngs->latcand_sf));
+        }
         ++ngs->bp_table_idx; /* Make bptableidx[-1] valid */
     }
     ngs->bp_table_idx[frame_idx] = ngs->bpidx;
+    /* Word exits before the previous frame can no longer change, nor
+     * can they be in the final frame, so they can go in the lattice. */
+    if (frame_idx > 0) {
+        if (ngs->latcand_sf == NULL) {
+            ngs->latcand_sf = ckd_malloc(ngs->n_frame_alloc
+                                         * sizeof(*ngs->latcand_sf));
+            memset(ngs->latcand_sf, -1,
+                   ngs->n_frame_alloc * sizeof(*ngs->latcand_sf));
+        }
+        add_latcand(ngs, ngs->bp_table_idx[frame_idx - 1]);
+    }
     return ngs->bpidx;
 }
 
@@ -708,11 +868,11 @@ ngram_compute_seg_score(ngram_search_t *ngs, bptbl_t *be, float32 lwf,
     }
     else {
         int32 n_used;
-        *out_lscr = ngram_tg_score(ngs->lmset,
-                                   be->real_wid,
-                                   pbe->real_wid,
-                                   pbe->prev_real_wid,
-                                   &n_used)>>SENSCR_SHIFT;
+        *out_lscr = ngram_cache_tg_score(ngs->lmcache,
+                                         be->real_wid,
+                                         pbe->real_wid,
+                                         pbe->prev_real_wid,
+                                         &n_used)>>SENSCR_SHIFT;
         *out_lscr = *out_lscr * lwf;
     }
     *out_ascr = be->score - start_score - *out_lscr;
@@ -725,6 +885,7 @@ ngram_search_start(ps_search_t *search)
 
     ngs->done = FALSE;
     ngram_model_flush(ngs->lmset);
+    ngram_cache_reset(ngs->lmcache);
     if (ngs->fwdtree)
         ngram_fwdtree_start(ngs);
     else if (ngs->fwdflat)
@@ -812,6 +973,17 @@ ngram_search_finish(ps_search_t *search)
     else if (ngs->fwdflat) {
         ngram_fwdflat_finish(ngs);
     }
+    {
+        int32 n_hit, n_lookup;
+        if ((n_lookup = ngram_cache_stats(ngs->lmcache, &n_hit, NULL)) > 0)
+            E_INFO("%8d LM score lookups, %d cached (%.1f%%)\n",
+                   n_lookup, n_hit, 100.0 * n_hit / n_lookup);
+    }
+
+    /* A lattice built in mid-utterance does not include the last
+     * frame, and may not even be from the same pass. */
+    ps_lattice_free(search->dag);
+    search->dag = NULL;
 
     /* Mark the current utterance as done. */
     ngs->done = TRUE;
@@ -916,11 +1088,11 @@ ngram_search_bp2itor(ps_seg_t *seg, int bp)
             seg->lscr = ngs->fillpen;
         }
         else {
-            seg->lscr = ngram_tg_score(ngs->lmset,
-                                       be->real_wid,
-                                       pbe->real_wid,
-                                       pbe->prev_real_wid,
-                                       &seg->lback)>>SENSCR_SHIFT;
+            seg->lscr = ngram_cache_tg_score(ngs->lmcache,
+                                             be->real_wid,
+                                             pbe->real_wid,
+                                             pbe->prev_real_wid,
+                                             &seg->lback)>>SENSCR_SHIFT;
             seg->lscr = (int32)(seg->lscr * seg->lwf);
         }
         seg->ascr = be->score - start_score - seg->lscr;
@@ -1063,14 +1235,55 @@ ngram_search_prob(ps_search_t *search)
     }
 }
 
-static void
-create_dag_nodes(ngram_search_t *ngs, ps_lattice_t *dag)
+static ps_latnode_t *
+new_dag_node(ps_lattice_t *dag, int32 wid, int32 sf, int32 fef, int32 lef)
+{
+    ps_latnode_t *node;
+
+    node = listelem_malloc(dag->latnode_alloc);
+    node->wid = wid;
+    node->sf = sf; /* This is a frame index. */
+    node->fef = fef; /* These are backpointer indices (argh) */
+    node->lef = lef;
+    node->reachable = FALSE;
+    node->entries = NULL;
+    node->exits = NULL;
+    node->alt = NULL;
+
+    /* NOTE: This creates the list of nodes in reverse topological
+     * order, i.e. a node always precedes its antecedents in this
+     * list. */
+    node->next = dag->nodes;
+    dag->nodes = node;
+    ++dag->n_nodes;
+
+    return node;
+}
+
+/**
+ * Create lattice nodes, returning them in order of creation.
+ *
+ * Most of them were already found by add_latcand() during the
+ * search, so we need only look at the last frame or two.
+ */
+static ps_latnode_t **
+create_dag_nodes(ngram_search_t *ngs, ps_lattice_t *dag, int32 *out_n_nodes)
 {
+    ps_latnode_t **nodes;
     bptbl_t *bp_ptr;
-    int32 i;
+    int32 i, n_nodes;
+
+    nodes = ckd_calloc(ngs->n_latcand + ngs->bpidx - ngs->latcand_bpidx + 1,
+                       sizeof(*nodes));
+    for (n_nodes = 0; n_nodes < ngs->n_latcand; ++n_nodes) {
+        latcand_t *cand = ngs->latcand + n_nodes;
+        nodes[n_nodes] = new_dag_node(dag, cand->wid, cand->sf,
+                                      cand->fef, cand->lef);
+    }
 
-    for (i = 0, bp_ptr = ngs->bp_table; i < ngs->bpidx; ++i, ++bp_ptr) {
-        int32 sf, ef, wid;
+    for (i = ngs->latcand_bpidx, bp_ptr = ngs->bp_table + i;
+         i < ngs->bpidx; ++i, ++bp_ptr) {
+        int32 sf, ef, wid, j;
         ps_latnode_t *node;
 
         /* Skip invalid backpointers (these result from -maxwpf pruning) */
@@ -1093,32 +1306,29 @@ create_dag_nodes(ngram_search_t *ngs, ps_lattice_t *dag)
             continue;
 
         /* See if bptbl entry <wid,sf> already in lattice */
-        for (node = dag->nodes; node; node = node->next) {
-            if ((node->wid == wid) && (node->sf == sf))
-                break;
+        node = NULL;
+        if (ngs->latcand_sf) {
+            for (j = ngs->latcand_sf[sf]; j != -1; j = ngs->latcand[j].next) {
+                if (ngs->latcand[j].wid == wid) {
+                    node = nodes[j];
+                    break;
+                }
+            }
+        }
+        for (j = ngs->n_latcand; node == NULL && j < n_nodes; ++j) {
+            if ((nodes[j]->wid == wid) && (nodes[j]->sf == sf))
+                node = nodes[j];
         }
 
         /* For the moment, store bptbl indices in node.{fef,lef} */
         if (node)
             node->lef = i;
-        else {
-            /* New node; link to head of list */
-            node = listelem_malloc(dag->latnode_alloc);
-            node->wid = wid;
-            node->sf = sf; /* This is a frame index. */
-            node->fef = node->lef = i; /* These are backpointer indices (argh) */
-            node->reachable = FALSE;
-            node->entries = NULL;
-            node->exits = NULL;
-
-            /* NOTE: This creates the list of nodes in reverse
-             * topological order, i.e. a node always precedes its
-             * antecedents in this list. */
-            node->next = dag->nodes;
-            dag->nodes = node;
-            ++dag->n_nodes;
-        }
+        else
+            nodes[n_nodes++] = new_dag_node(dag, wid, sf, i, i);
     }
+
+    *out_n_nodes = n_nodes;
+    return nodes;
 }
 
 static ps_latnode_t *
@@ -1178,8 +1388,8 @@ find_end_node(ngram_search_t *ngs, ps_lattice_t *dag, float32 lwf)
             bestbp = bp;
             break;
         }
-        l_scr = ngram_tg_score(ngs->lmset, ps_search_finish_wid(ngs),
-                               wid, prev_wid, &n_used) >>SENSCR_SHIFT;
+        l_scr = ngram_cache_tg_score(ngs->lmcache, ps_search_finish_wid(ngs),
+                                     wid, prev_wid, &n_used) >>SENSCR_SHIFT;
         l_scr = l_scr * lwf;
         if (ngs->bp_table[bp].score + l_scr BETTER_THAN bestscore) {
             bestscore = ngs->bp_table[bp].score + l_scr;
@@ -1212,9 +1422,10 @@ ps_lattice_t *
 ngram_search_lattice(ps_search_t *search)
 {
     int32 i, score, ascr, lscr;
-    ps_latnode_t *node, *from, *to;
+    ps_latnode_t *node, *from, *to, **nodes;
     ngram_search_t *ngs;
     ps_lattice_t *dag;
+    int32 n_nodes, end_idx, j, *max_lef;
     int min_endfr, nlink;
     float lwf;
 
@@ -1234,10 +1445,16 @@ ngram_search_lattice(ps_search_t *search)
     /* Nope, create a new one. */
     ps_lattice_free(search->dag);
     search->dag = NULL;
+    /* In the middle of an utterance, the end of the last frame has
+     * not been marked yet. */
+    if (!ngs->done)
+        ngram_search_mark_bptable(ngs, ngs->n_frame);
     dag = ps_lattice_init_search(search, ngs->n_frame);
     /* Compute these such that they agree with the fwdtree language weight. */
-    lwf = ngs->fwdflat ? ngs->fwdflat_fwdtree_lw_ratio : 1.0;
-    create_dag_nodes(ngs, dag);
+    lwf = (ngs->fwdflat && (ngs->done || !ngs->fwdtree))
+        ? ngs->fwdflat_fwdtree_lw_ratio : 1.0;
+    nodes = create_dag_nodes(ngs, dag, &n_nodes);
+    max_lef = NULL;
     if ((dag->start = find_start_node(ngs, dag)) == NULL)
         goto error_out;
     if ((dag->end = find_end_node(ngs, dag, ngs->bestpath_fwdtree_lw_ratio)) == NULL)
@@ -1271,11 +1488,28 @@ ngram_search_lattice(ps_search_t *search)
         ++i;
     }
     E_INFO("Eliminated %d nodes before end node\n", i);
+    end_idx = n_nodes - 1 - i;
+    assert(nodes[end_idx] == dag->end);
+
+    /* Since nodes are created in order of their first exit, a node
+     * can only be preceded by those created before it.  The ones
+     * created long before it have also, for the most part, stopped
+     * exiting long before it, so track the latest exit over each
+     * prefix of nodes in order to stop looking for predecessors
+     * early. */
+    max_lef = ckd_calloc(end_idx + 1, sizeof(*max_lef));
+    for (j = 0; j <= end_idx; ++j) {
+        max_lef[j] = ngs->bp_table[nodes[j]->lef].frame;
+        if (j > 0 && max_lef[j - 1] > max_lef[j])
+            max_lef[j] = max_lef[j - 1];
+    }
+
     dag->end->reachable = TRUE;
     nlink = 0;
-    for (to = dag->end; to; to = to->next) {
-        int fef, lef;
+    for (j = end_idx; j >= 0; --j) {
+        int fef, lef, k;
 
+        to = nodes[j];
         /* Skip if not reachable; it will never be reachable from dag->end */
         if (!to->reachable)
             continue;
@@ -1290,9 +1524,10 @@ ngram_search_lattice(ps_search_t *search)
         }
 
         /* Find predecessors of to : from->fef+1 <= to->sf <= from->lef+1 */
-        for (from = to->next; from; from = from->next) {
+        for (k = j - 1; k >= 0 && max_lef[k] + 1 >= to->sf; --k) {
             bptbl_t *from_bpe;
 
+            from = nodes[k];
             fef = ngs->bp_table[from->fef].frame;
             lef = ngs->bp_table[from->lef].frame;
 
@@ -1303,8 +1538,11 @@ ngram_search_lattice(ps_search_t *search)
                 continue;
             }
 
-            /* Find bptable entry for "from" that exactly precedes "to" */
-            i = from->fef;
+            /* Find bptable entry for "from" that exactly precedes
+             * "to", starting from the first one in that frame */
+            i = ngs->bp_table_idx[to->sf - 1];
+            if (i < from->fef)
+                i = from->fef;
             from_bpe = ngs->bp_table + i;
             for (; i <= from->lef; i++, from_bpe++) {
                 if (from_bpe->wid != from->wid)
@@ -1348,6 +1586,10 @@ ngram_search_lattice(ps_search_t *search)
             }
         }
     }
+    ckd_free(max_lef);
+    max_lef = NULL;
+    ckd_free(nodes);
+    nodes = NULL;
 
     /* There must be at least one path between dag->start and dag->end */
     if (!dag->start->reachable) {
@@ -1389,10 +1631,15 @@ ngram_search_lattice(ps_search_t *search)
     /* Add silprob and fillprob to corresponding links */
     ps_lattice_penalize_fillers(dag, ngs->silpen, ngs->fillpen);
 
+    /* Limit its size if requested. */
+    ps_lattice_prune_config(dag, ngs->lmset, ngs->bestpath_fwdtree_lw_ratio);
+
     search->dag = dag;
     return dag;
 
 error_out:
+    ckd_free(max_lef);
+    ckd_free(nodes);
     ps_lattice_free(dag);
     return NULL;
 }
@@ -45,9 +45,11 @@
 #include <pocketsphinx.h>
 
 #include "lm/ngram_model.h"
+#include "lm/ngram_cache.h"
 #include "util/listelem_alloc.h"
 #include "pocketsphinx_internal.h"
 #include "hmm.h"
+#include "histprune.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -81,6 +83,8 @@ typedef struct chan_s {
 				   only within HMM tree.  -1 if none */
 	int32 rc_id;		/**< right-context id for last phone of words */
     } info;
+    int32    la_id;		/**< index of this node in LM lookahead tables */
+    int32    lascr;		/**< LM lookahead score of paths entering this node */
 } chan_t;
 
 /**
@@ -104,6 +108,7 @@ typedef struct root_chan_s {
 				   node begin with this ciphone */
     int16    ci2phone;		/**< second ciphone of this node; one root HMM for each
                                    unique right context */
+    int32    lascr;		/**< LM lookahead score of paths entering this node */
 } root_chan_t;
 
 /**
@@ -123,6 +128,21 @@ typedef struct bptbl_s {
     int16    last2_phone;       /**< next-to-last phone of this word */
 } bptbl_t;
 
+/**
+ * Lattice node gathered from the backpointer table.
+ *
+ * These are collected as each frame of the backpointer table is
+ * finalized, so that ngram_search_lattice() need not scan the entire
+ * table at the end of the utterance.
+ */
+typedef struct latcand_s {
+    int32 wid;          /**< Word index */
+    int32 sf;           /**< Start frame */
+    int32 fef;          /**< First backpointer index for this node */
+    int32 lef;          /**< Last backpointer index for this node */
+    int32 next;         /**< Previous node with the same start frame, or -1 */
+} latcand_t;
+
 /**
  * Segmentation "iterator" for backpointer table results.
  */
@@ -177,6 +197,11 @@ typedef struct bestbp_rc_s {
 
 #define NO_BP		-1
 
+/**
+ * Number of histories for which LM lookahead tables are kept.
+ */
+#define LA_CACHE_SIZE	64
+
 /**
  * Various statistics for profiling.
  */
@@ -191,6 +216,7 @@ typedef struct ngram_search_stats_s {
     int32 n_fwdflat_words;
     int32 n_fwdflat_word_transition;
     int32 n_senone_active_utt;
+    int32 n_la_table;
 } ngram_search_stats_t;
 
 
@@ -200,6 +226,7 @@ typedef struct ngram_search_stats_s {
 struct ngram_search_s {
     ps_search_t base;
     ngram_model_t *lmset;  /**< Set of language models. */
+    ngram_cache_t *lmcache; /**< Score cache for lmset. */
     hmm_context_t *hmmctx; /**< HMM context. */
 
     /* Flags to quickly indicate which passes are enabled. */
@@ -296,10 +323,34 @@ struct ngram_search_s {
     lastphn_cand_t *lastphn_cand;
     int32 n_lastphn_cand;
     last_ltrans_t *last_ltrans;      /* one per word */
+    int32 *lm_batch_wid;             /**< LM word IDs to score together */
+    int32 *lm_batch_scr;             /**< LM scores for lm_batch_wid */
+    int32 *lm_batch_exit;            /**< Exit scores of all candidates */
     int32 cand_sf_alloc;
     cand_sf_t *cand_sf;
     bestbp_rc_t *bestbp_rc;
 
+    /**
+     * Language model lookahead for the HMM tree.
+     *
+     * For a given history, each node in the tree gets the best LM
+     * score of all words below it, which is added to the scores of
+     * channels when pruning them, so that paths leading only to
+     * unlikely words are pruned before reaching the word end.  Root
+     * channels are numbered first, then non-root channels.  Tables
+     * are computed on demand and kept for the LA_CACHE_SIZE most
+     * recently computed histories.
+     */
+    int32 la_order;     /**< 0 for no lookahead, 1 for unigram, 2 for bigram */
+    int32 n_la_nodes;   /**< Number of nodes in each table. */
+    int32 n_la_words;   /**< Number of words in the HMM tree. */
+    int32 *la_wid;      /**< Words in the HMM tree. */
+    int32 *la_wscr;     /**< LM score for each word in the current history. */
+    int32 **la_table;   /**< Lookahead score for each node, for each history. */
+    int32 *la_hist;     /**< History word of each table, -1 for none. */
+    int32 *la_slot;     /**< Table for each history word (offset by 1). */
+    int32 la_next;      /**< Next table to be replaced. */
+
     bptbl_t *bp_table;       /* Forward pass lattice */
     int32 bpidx;             /* First free BPTable entry */
     int32 bp_table_size;
@@ -313,6 +364,12 @@ struct ngram_search_s {
     int32 *word_lat_idx; /* BPTable index for any word in current frame;
                             cleared before each frame */
 
+    latcand_t *latcand;   /**< Lattice nodes found so far, in order of creation. */
+    int32 n_latcand;      /**< Number of entries in latcand. */
+    int32 n_latcand_alloc; /**< Number of entries allocated in latcand. */
+    int32 *latcand_sf;    /**< Last entry in latcand for each start frame, or -1. */
+    int32 latcand_bpidx;  /**< First BPTable entry not yet in latcand. */
+
     /*
      * Flat lexicon (2nd pass) search stuff.
      */
@@ -356,7 +413,7 @@ struct ngram_search_s {
     int32 nwpen;
     int32 pip;
     int32 maxwpf;
-    int32 maxhmmpf;
+    histprune_t hprune;  /**< Limits the number of HMMs per frame. */
 };
 typedef struct ngram_search_s ngram_search_t;
 
@@ -370,14 +427,44 @@ ps_search_t *ngram_search_init(const char *name,
                                dict_t *dict,
                                dict2pid_t *d2p);
 
+/**
+ * Build the N-Gram search module without modifying anything shared
+ * with the decoder.
+ *
+ * This does not change the acoustic model, dictionary, or
+ * dictionary-to-phone mappings, nor their reference counts, so it
+ * can run in another thread while they are in use.
+ * ngram_search_commit() must be called before searching with it.
+ */
+ps_search_t *ngram_search_prepare(const char *name,
+                                  ngram_model_t *lm,
+                                  cmd_ln_t *config,
+                                  acmod_t *acmod,
+                                  dict_t *dict,
+                                  dict2pid_t *d2p);
+
+/**
+ * Update the acoustic model and dictionary-to-phone mappings for a
+ * search created by ngram_search_prepare().
+ */
+void ngram_search_commit(ps_search_t *search);
+
 /**
  * Finalize the N-Gram search module.
  */
 void ngram_search_free(ps_search_t *ngs);
 
+/**
+ * Empty the backpointer table at the start of a search pass.
+ */
+void ngram_search_reset_bptable(ngram_search_t *ngs);
+
 /**
  * Record the current frame's index in the backpointer table.
  *
+ * This also adds the word exits from frames which can no longer
+ * change to the lattice nodes used by ngram_search_lattice().
+ *
  * @return the current backpointer index.
  */
 int ngram_search_mark_bptable(ngram_search_t *ngs, int frame_idx);
@@ -378,8 +378,7 @@ ngram_fwdflat_start(ngram_search_t *ngs)
     build_fwdflat_wordlist(ngs);
     build_fwdflat_chan(ngs);
 
-    ngs->bpidx = 0;
-    ngs->bss_head = 0;
+    ngram_search_reset_bptable(ngs);
 
     for (i = 0; i < ps_search_n_words(ngs); i++)
         ngs->word_lat_idx[i] = NO_BP;
@@ -642,7 +641,7 @@ get_expand_wordlist(ngram_search_t *ngs, int32 frm, int32 win)
 static void
 fwdflat_word_transition(ngram_search_t *ngs, int frame_idx)
 {
-    int32 cf, nf, b, thresh, pip, i, nw, w, newscore;
+    int32 cf, nf, b, thresh, pip, i, nw, w, newscore, n_lm;
     int32 best_silrc_score = 0, best_silrc_bp = 0;      /* FIXME: good defaults? */
     bptbl_t *bp;
     int32 *rcss;
@@ -683,27 +682,31 @@ fwdflat_word_transition(ngram_search_t *ngs, int frame_idx)
         else
             rssid = dict2pid_rssid(d2p, bp->last_phone, bp->last2_phone);
 
-        /* Transition to all successor words. */
-        for (i = 0; ngs->expand_word_list[i] >= 0; i++) {
-            int32 n_used;
-
+        /* Get the exit score we recorded in save_bwd_ptr(), or
+         * something approximating it, for each successor word, and
+         * score the ones which can follow this exit all at once. */
+        for (i = n_lm = 0; ngs->expand_word_list[i] >= 0; i++) {
             w = ngs->expand_word_list[i];
-
-            /* Get the exit score we recorded in save_bwd_ptr(), or
-             * something approximating it. */
             if (rssid)
                 newscore = rcss[rssid->cimap[dict_first_phone(dict, w)]];
             else
                 newscore = bp->score;
+            ngs->lm_batch_exit[i] = newscore;
+            if (newscore != WORST_SCORE)
+                ngs->lm_batch_wid[n_lm++] = dict_basewid(dict, w);
+        }
+        ngram_cache_tg_score_words(ngs->lmcache, ngs->lm_batch_wid, n_lm,
+                                   bp->real_wid, bp->prev_real_wid,
+                                   ngs->lm_batch_scr);
+
+        /* Transition to all successor words. */
+        for (i = n_lm = 0; ngs->expand_word_list[i] >= 0; i++) {
+            w = ngs->expand_word_list[i];
+            newscore = ngs->lm_batch_exit[i];
             if (newscore == WORST_SCORE)
                 continue;
             /* FIXME: Floating point... */
-            newscore += lwf
-                * (ngram_tg_score(ngs->lmset,
-                                  dict_basewid(dict, w),
-                                  bp->real_wid,
-                                  bp->prev_real_wid,
-                                  &n_used) >> SENSCR_SHIFT);
+            newscore += lwf * (ngs->lm_batch_scr[n_lm++] >> SENSCR_SHIFT);
             newscore += pip;
 
             /* Enter the next word */
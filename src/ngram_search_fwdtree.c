@@ -59,6 +59,9 @@
 #define chan_v_eval(chan) hmm_vit_eval(&(chan)->hmm)
 #endif
 
+/* Marks an unused LM lookahead table (-1 is the empty history). */
+#define LA_NO_HIST -2
+
 /*
  * Allocate that part of the search channel tree structure that is independent of the
  * LM in use.
@@ -157,9 +160,153 @@ init_nonroot_chan(ngram_search_t *ngs, chan_t * hmm, int32 ph, int32 ci, int32 t
     hmm->alt = NULL;
     hmm->info.penult_phn_wid = -1;
     hmm->ciphone = ci;
+    hmm->la_id = ngs->n_root_chan_alloc + ngs->n_nonroot_chan;
+    hmm->lascr = 0;
     hmm_init(ngs->hmmctx, &hmm->hmm, FALSE, ph, tmatid);
 }
 
+/*
+ * Set up LM lookahead tables for the HMM tree, once it has been
+ * created.  They are filled in on demand by la_get_table().
+ */
+static void
+init_lookahead(ngram_search_t *ngs)
+{
+    dict_t *dict = ps_search_dict(ngs);
+    int32 i, w, n_words;
+
+    ckd_free(ngs->la_wid);
+    ckd_free(ngs->la_wscr);
+    ckd_free(ngs->la_hist);
+    ckd_free(ngs->la_slot);
+    ckd_free_2d(ngs->la_table);
+    ngs->la_wid = ngs->la_wscr = ngs->la_hist = ngs->la_slot = NULL;
+    ngs->la_table = NULL;
+    if (ngs->la_order == 0)
+        return;
+
+    n_words = ps_search_n_words(ngs);
+    ngs->la_wid = ckd_calloc(n_words, sizeof(*ngs->la_wid));
+    ngs->n_la_words = 0;
+    for (w = 0; w < n_words; w++) {
+        if (dict_is_single_phone(dict, w))
+            continue;
+        if (!ngram_model_set_known_wid(ngs->lmset, dict_basewid(dict, w)))
+            continue;
+        ngs->la_wid[ngs->n_la_words++] = w;
+    }
+    ngs->la_wscr = ckd_calloc(n_words, sizeof(*ngs->la_wscr));
+    ngs->n_la_nodes = ngs->n_root_chan_alloc + ngs->n_nonroot_chan;
+    ngs->la_table = ckd_calloc_2d(LA_CACHE_SIZE, ngs->n_la_nodes,
+                                  sizeof(**ngs->la_table));
+    ngs->la_hist = ckd_calloc(LA_CACHE_SIZE, sizeof(*ngs->la_hist));
+    ngs->la_slot = ckd_calloc(n_words + 1, sizeof(*ngs->la_slot));
+    for (i = 0; i < LA_CACHE_SIZE; ++i)
+        ngs->la_hist[i] = LA_NO_HIST;
+    for (w = 0; w <= n_words; ++w)
+        ngs->la_slot[w] = -1;
+    ngs->la_next = 0;
+}
+
+/*
+ * Forget all LM lookahead tables (for instance, because the LM has
+ * changed).
+ */
+static void
+reset_lookahead(ngram_search_t *ngs)
+{
+    int32 i;
+
+    if (ngs->la_order == 0)
+        return;
+    for (i = 0; i < LA_CACHE_SIZE; ++i) {
+        if (ngs->la_hist[i] != LA_NO_HIST)
+            ngs->la_slot[ngs->la_hist[i] + 1] = -1;
+        ngs->la_hist[i] = LA_NO_HIST;
+    }
+    ngs->la_next = 0;
+}
+
+/*
+ * Fill in the best LM score of the words below each node of the
+ * subtree starting at hmm.
+ */
+static int32
+la_fill_subtree(ngram_search_t *ngs, int32 *la, chan_t *hmm)
+{
+    chan_t *child;
+    int32 w, best;
+
+    best = WORST_SCORE;
+    for (w = hmm->info.penult_phn_wid; w >= 0; w = ngs->homophone_set[w])
+        if (ngs->la_wscr[w] BETTER_THAN best)
+            best = ngs->la_wscr[w];
+    for (child = hmm->next; child; child = child->alt) {
+        int32 score = la_fill_subtree(ngs, la, child);
+        if (score BETTER_THAN best)
+            best = score;
+    }
+    la[hmm->la_id] = best;
+    return best;
+}
+
+/*
+ * Get the LM lookahead table for paths entering the tree from
+ * backpointer bp, computing it if it is not in the cache.
+ *
+ * @return NULL if LM lookahead is not enabled.
+ */
+static int32 const *
+la_get_table(ngram_search_t *ngs, int32 bp)
+{
+    dict_t *dict = ps_search_dict(ngs);
+    root_chan_t *rhmm;
+    chan_t *hmm;
+    int32 *la, hist, n_hist, slot, i, w;
+
+    if (ngs->la_order == 0)
+        return NULL;
+    /* Unigram lookahead has a single table for all histories. */
+    hist = -1;
+    if (ngs->la_order > 1 && bp != NO_BP)
+        hist = ngs->bp_table[bp].real_wid;
+    if ((slot = ngs->la_slot[hist + 1]) != -1)
+        return ngs->la_table[slot];
+
+    /* Replace the oldest table. */
+    slot = ngs->la_next;
+    ngs->la_next = (ngs->la_next + 1) % LA_CACHE_SIZE;
+    if (ngs->la_hist[slot] != LA_NO_HIST)
+        ngs->la_slot[ngs->la_hist[slot] + 1] = -1;
+    ngs->la_hist[slot] = hist;
+    ngs->la_slot[hist + 1] = slot;
+    ++ngs->st.n_la_table;
+
+    /* Score all words in the tree, then propagate the best ones
+     * towards the roots. */
+    for (i = 0; i < ngs->n_la_words; ++i)
+        ngs->lm_batch_wid[i] = dict_basewid(dict, ngs->la_wid[i]);
+    n_hist = (hist == -1) ? 0 : 1;
+    ngram_ng_score_words(ngs->lmset, ngs->lm_batch_wid, ngs->n_la_words,
+                         &hist, n_hist, ngs->lm_batch_scr);
+    for (i = 0; i < ngs->n_la_words; ++i)
+        ngs->la_wscr[ngs->la_wid[i]] = ngs->lm_batch_scr[i] >> SENSCR_SHIFT;
+    la = ngs->la_table[slot];
+    for (i = 0, rhmm = ngs->root_chan; i < ngs->n_root_chan; i++, rhmm++) {
+        int32 best = WORST_SCORE;
+        for (w = rhmm->penult_phn_wid; w >= 0; w = ngs->homophone_set[w])
+            if (ngs->la_wscr[w] BETTER_THAN best)
+                best = ngs->la_wscr[w];
+        for (hmm = rhmm->next; hmm; hmm = hmm->alt) {
+            int32 score = la_fill_subtree(ngs, la, hmm);
+            if (score BETTER_THAN best)
+                best = score;
+        }
+        la[i] = best;
+    }
+    return la;
+}
+
 /*
  * Allocate and initialize search channel-tree structure.
  * At this point, all the root-channels have been allocated and partly initialized
@@ -333,6 +480,8 @@ create_search_channels(ngram_search_t *ngs)
 
     if (ngs->n_root_chan + ngs->n_1ph_words == 0)
 	E_ERROR("No word from the language model has pronunciation in the dictionary\n");
+
+    init_lookahead(ngs);
 }
 
 static void
@@ -444,6 +593,16 @@ ngram_fwdtree_deinit(ngram_search_t *ngs)
     ngs->bestbp_rc = NULL;
     ckd_free(ngs->lastphn_cand);
     ngs->lastphn_cand = NULL;
+    ckd_free(ngs->la_wid);
+    ngs->la_wid = NULL;
+    ckd_free(ngs->la_wscr);
+    ngs->la_wscr = NULL;
+    ckd_free(ngs->la_hist);
+    ngs->la_hist = NULL;
+    ckd_free(ngs->la_slot);
+    ngs->la_slot = NULL;
+    ckd_free_2d(ngs->la_table);
+    ngs->la_table = NULL;
 }
 
 int
@@ -481,8 +640,7 @@ ngram_fwdtree_start(ngram_search_t *ngs)
     ptmr_start(&ngs->fwdtree_perf);
 
     /* Reset backpointer table. */
-    ngs->bpidx = 0;
-    ngs->bss_head = 0;
+    ngram_search_reset_bptable(ngs);
 
     /* Reset word lattice. */
     for (i = 0; i < n_words; ++i)
@@ -501,6 +659,9 @@ ngram_fwdtree_start(ngram_search_t *ngs)
         ngs->last_ltrans[i].sf = -1;
     ngs->n_frame = 0;
 
+    /* LM scores may have changed since the last utterance. */
+    reset_lookahead(ngs);
+
     /* Clear the hypothesis string. */
     ckd_free(base->hyp_str);
     base->hyp_str = NULL;
@@ -611,7 +772,7 @@ eval_root_chan(ngram_search_t *ngs, int frame_idx)
     bestscore = WORST_SCORE;
     for (i = ngs->n_root_chan, rhmm = ngs->root_chan; i > 0; --i, rhmm++) {
         if (hmm_frame(&rhmm->hmm) == frame_idx) {
-            int32 score = chan_v_eval(rhmm);
+            int32 score = chan_v_eval(rhmm) + rhmm->lascr;
             if (score BETTER_THAN bestscore)
                 bestscore = score;
             ++ngs->st.n_root_chan_eval;
@@ -632,7 +793,7 @@ eval_nonroot_chan(ngram_search_t *ngs, int frame_idx)
     ngs->st.n_nonroot_chan_eval += i;
 
     for (hmm = *(acl++); i > 0; --i, hmm = *(acl++)) {
-        int32 score = chan_v_eval(hmm);
+        int32 score = chan_v_eval(hmm) + hmm->lascr;
         assert(hmm_frame(&hmm->hmm) == frame_idx);
         if (score BETTER_THAN bestscore)
             bestscore = score;
@@ -729,6 +890,7 @@ prune_root_chan(ngram_search_t *ngs, int frame_idx)
     chan_t **nacl;              /* next active list */
     lastphn_cand_t *candp;
     phone_loop_search_t *pls;
+    int32 const *la;
 
     nf = frame_idx + 1;
     thresh = ngs->best_score + ngs->dynamic_beam;
@@ -744,19 +906,24 @@ prune_root_chan(ngram_search_t *ngs, int frame_idx)
         if (hmm_frame(&rhmm->hmm) < frame_idx)
             continue;
 
-        if (hmm_bestscore(&rhmm->hmm) BETTER_THAN thresh) {
+        if (hmm_bestscore(&rhmm->hmm) + rhmm->lascr BETTER_THAN thresh) {
             hmm_frame(&rhmm->hmm) = nf;  /* rhmm will be active in next frame */
             E_DEBUG("Preserving root channel %d score %d\n", i, hmm_bestscore(&rhmm->hmm));
             /* transitions out of this root channel */
             /* transition to all next-level channels in the HMM tree */
             newphone_score = hmm_out_score(&rhmm->hmm) + ngs->pip;
+            la = la_get_table(ngs, hmm_out_history(&rhmm->hmm));
             if (pls != NULL || newphone_score BETTER_THAN newphone_thresh) {
                 for (hmm = rhmm->next; hmm; hmm = hmm->alt) {
-                    int32 pl_newphone_score = newphone_score
+                    int32 lascr = la ? la[hmm->la_id] : 0;
+                    int32 pl_newphone_score = newphone_score + lascr
                         + phone_loop_search_score(pls, hmm->ciphone);
                     if (pl_newphone_score BETTER_THAN newphone_thresh) {
                         if ((hmm_frame(&hmm->hmm) < frame_idx)
                             || (newphone_score BETTER_THAN hmm_in_score(&hmm->hmm))) {
+                            if (hmm_frame(&hmm->hmm) < frame_idx
+                                || lascr BETTER_THAN hmm->lascr)
+                                hmm->lascr = lascr;
                             hmm_enter(&hmm->hmm, newphone_score,
                                       hmm_out_history(&rhmm->hmm), nf);
                             *(nacl++) = hmm;
@@ -771,9 +938,10 @@ prune_root_chan(ngram_search_t *ngs, int frame_idx)
              * Remember to remove the temporary newword_penalty.
              */
             if (pls != NULL || newphone_score BETTER_THAN lastphn_thresh) {
+                int32 lascr = la ? la[i] : 0;
                 for (w = rhmm->penult_phn_wid; w >= 0;
                      w = ngs->homophone_set[w]) {
-                    int32 pl_newphone_score = newphone_score
+                    int32 pl_newphone_score = newphone_score + lascr
                         + phone_loop_search_score
                         (pls, dict_last_phone(ps_search_dict(ngs),w));
                     E_DEBUG("word %s newphone_score %d\n", dict_wordstr(ps_search_dict(ngs), w), newphone_score);
@@ -805,6 +973,7 @@ prune_nonroot_chan(ngram_search_t *ngs, int frame_idx)
     chan_t **acl, **nacl;       /* active list, next active list */
     lastphn_cand_t *candp;
     phone_loop_search_t *pls;
+    int32 const *la;
 
     nf = frame_idx + 1;
 
@@ -820,7 +989,7 @@ prune_nonroot_chan(ngram_search_t *ngs, int frame_idx)
          --i, hmm = *(acl++)) {
         assert(hmm_frame(&hmm->hmm) >= frame_idx);
 
-        if (hmm_bestscore(&hmm->hmm) BETTER_THAN thresh) {
+        if (hmm_bestscore(&hmm->hmm) + hmm->lascr BETTER_THAN thresh) {
             /* retain this channel in next frame */
             if (hmm_frame(&hmm->hmm) != nf) {
                 hmm_frame(&hmm->hmm) = nf;
@@ -829,14 +998,19 @@ prune_nonroot_chan(ngram_search_t *ngs, int frame_idx)
 
             /* transition to all next-level channel in the HMM tree */
             newphone_score = hmm_out_score(&hmm->hmm) + ngs->pip;
+            la = la_get_table(ngs, hmm_out_history(&hmm->hmm));
             if (pls != NULL || newphone_score BETTER_THAN newphone_thresh) {
                 for (nexthmm = hmm->next; nexthmm; nexthmm = nexthmm->alt) {
-                    int32 pl_newphone_score = newphone_score
+                    int32 lascr = la ? la[nexthmm->la_id] : 0;
+                    int32 pl_newphone_score = newphone_score + lascr
                         + phone_loop_search_score(pls, nexthmm->ciphone);
                     if ((pl_newphone_score BETTER_THAN newphone_thresh)
                         && ((hmm_frame(&nexthmm->hmm) < frame_idx)
                             || (newphone_score
                                 BETTER_THAN hmm_in_score(&nexthmm->hmm)))) {
+                        if (hmm_frame(&nexthmm->hmm) < frame_idx
+                            || lascr BETTER_THAN nexthmm->lascr)
+                            nexthmm->lascr = lascr;
                         if (hmm_frame(&nexthmm->hmm) != nf) {
                             /* Keep this HMM on the active list */
                             *(nacl++) = nexthmm;
@@ -853,9 +1027,10 @@ prune_nonroot_chan(ngram_search_t *ngs, int frame_idx)
              * Remember to remove the temporary newword_penalty.
              */
             if (pls != NULL || newphone_score BETTER_THAN lastphn_thresh) {
+                int32 lascr = la ? la[hmm->la_id] : 0;
                 for (w = hmm->info.penult_phn_wid; w >= 0;
                      w = ngs->homophone_set[w]) {
-                    int32 pl_newphone_score = newphone_score
+                    int32 pl_newphone_score = newphone_score + lascr
                         + phone_loop_search_score
                         (pls, dict_last_phone(ps_search_dict(ngs),w));
                     if (pl_newphone_score BETTER_THAN lastphn_thresh) {
@@ -979,11 +1154,11 @@ last_phone_transition(ngram_search_t *ngs, int frame_idx)
                     (ngs, bpe, dict_first_phone(ps_search_dict(ngs), candp->wid));
                 if (dscr BETTER_THAN WORST_SCORE) {
                     assert(!dict_filler_word(ps_search_dict(ngs), candp->wid));
-                    dscr += ngram_tg_score(ngs->lmset,
-                                           dict_basewid(ps_search_dict(ngs), candp->wid),
-                                           bpe->real_wid,
-                                           bpe->prev_real_wid,
-                                           &n_used)>>SENSCR_SHIFT;
+                    dscr += ngram_cache_tg_score(ngs->lmcache,
+                                                 dict_basewid(ps_search_dict(ngs), candp->wid),
+                                                 bpe->real_wid,
+                                                 bpe->prev_real_wid,
+                                                 &n_used)>>SENSCR_SHIFT;
                 }
 
                 if (dscr BETTER_THAN ngs->last_ltrans[candp->wid].dscr) {
@@ -1127,51 +1302,37 @@ prune_word_chan(ngram_search_t *ngs, int frame_idx)
 }
 
 static void
-prune_channels(ngram_search_t *ngs, int frame_idx)
+prune_channels(ngram_search_t *ngs, int frame_idx, int32 n_hmm)
 {
+    int32 budget;
+
     /* Clear last phone candidate list. */
     ngs->n_lastphn_cand = 0;
-    /* Set the dynamic beam based on maxhmmpf here. */
-    ngs->dynamic_beam = ngs->beam;
-    if (ngs->maxhmmpf != -1
-        && ngs->st.n_root_chan_eval + ngs->st.n_nonroot_chan_eval > ngs->maxhmmpf) {
+    /* Set the dynamic beam based on the governor and maxhmmpf here. */
+    ngs->dynamic_beam = (int32)(ngs->beam * ps_search_beam_scale(ngs));
+    budget = histprune_budget(&ngs->hprune);
+    if (budget != -1 && n_hmm > budget) {
         /* Build a histogram to approximately prune them. */
-        int32 bins[256], bw, nhmms, i;
+        int32 i;
         root_chan_t *rhmm;
         chan_t **acl, *hmm;
 
-        /* Bins go from zero (best score) to edge of beam. */
-        bw = -ngs->beam / 256;
-        memset(bins, 0, sizeof(bins));
+        histprune_reset(&ngs->hprune, ngs->dynamic_beam);
         /* For each active root channel. */
         for (i = 0, rhmm = ngs->root_chan; i < ngs->n_root_chan; i++, rhmm++) {
-            int32 b;
-
-            /* Put it in a bin according to its bestscore. */
-            b = (ngs->best_score - hmm_bestscore(&rhmm->hmm)) / bw;
-            if (b >= 256)
-                b = 255;
-            ++bins[b];
+            if (hmm_frame(&rhmm->hmm) < frame_idx)
+                continue;
+            histprune_add(&ngs->hprune, ngs->best_score
+                          - hmm_bestscore(&rhmm->hmm) - rhmm->lascr);
         }
         /* For each active non-root channel. */
         acl = ngs->active_chan_list[frame_idx & 0x1];       /* currently active HMMs in tree */
         for (i = ngs->n_active_chan[frame_idx & 0x1], hmm = *(acl++);
              i > 0; --i, hmm = *(acl++)) {
-            int32 b;
-
-            /* Put it in a bin according to its bestscore. */
-            b = (ngs->best_score - hmm_bestscore(&hmm->hmm)) / bw;
-            if (b >= 256)
-                b = 255;
-            ++bins[b];
+            histprune_add(&ngs->hprune, ngs->best_score
+                          - hmm_bestscore(&hmm->hmm) - hmm->lascr);
         }
-        /* Walk down the bins to find the new beam. */
-        for (i = nhmms = 0; i < 256; ++i) {
-            nhmms += bins[i];
-            if (nhmms > ngs->maxhmmpf)
-                break;
-        }
-        ngs->dynamic_beam = -(i * bw);
+        ngs->dynamic_beam = histprune_beam(&ngs->hprune, budget);
     }
 
     prune_root_chan(ngs, frame_idx);
@@ -1309,14 +1470,24 @@ word_transition(ngram_search_t *ngs, int frame_idx)
      * Main dictionary, multi-phone words transition to HMM-trees roots.
      */
     for (i = ngs->n_root_chan, rhmm = ngs->root_chan; i > 0; --i, rhmm++) {
+        int32 lascr = 0;
+
         bestbp_rc_ptr = &(ngs->bestbp_rc[rhmm->ciphone]);
 
         newscore = bestbp_rc_ptr->score + ngs->nwpen + ngs->pip;
         pl_newscore = newscore
             + phone_loop_search_score(pls, rhmm->ciphone);
+        if (ngs->la_order && pl_newscore BETTER_THAN thresh) {
+            lascr = la_get_table(ngs, bestbp_rc_ptr->path)
+                [rhmm - ngs->root_chan];
+            pl_newscore += lascr;
+        }
         if (pl_newscore BETTER_THAN thresh) {
             if ((hmm_frame(&rhmm->hmm) < frame_idx)
                 || (newscore BETTER_THAN hmm_in_score(&rhmm->hmm))) {
+                if (hmm_frame(&rhmm->hmm) < frame_idx
+                    || lascr BETTER_THAN rhmm->lascr)
+                    rhmm->lascr = lascr;
                 hmm_enter(&rhmm->hmm, newscore,
                           bestbp_rc_ptr->path, nf);
                 /* DICT2PID: Another place where mpx ssids are entered. */
@@ -1337,23 +1508,32 @@ word_transition(ngram_search_t *ngs, int frame_idx)
         ngs->last_ltrans[w].dscr = MAX_NEG_INT32;
     }
     for (bp = ngs->bp_table_idx[frame_idx]; bp < ngs->bpidx; bp++) {
+        int32 n_lm;
+
         bpe = &(ngs->bp_table[bp]);
         if (!bpe->valid)
             continue;
 
-        for (i = 0; i < ngs->n_1ph_LMwords; i++) {
-            int32 n_used;
+        /* Score all single-phone words which can follow this exit
+         * at once. */
+        for (i = n_lm = 0; i < ngs->n_1ph_LMwords; i++) {
             w = ngs->single_phone_wid[i];
             newscore = ngram_search_exit_score
                 (ngs, bpe, dict_first_phone(dict, w));
+            ngs->lm_batch_exit[i] = newscore;
+            if (newscore != WORST_SCORE)
+                ngs->lm_batch_wid[n_lm++] = dict_basewid(dict, w);
+        }
+        ngram_cache_tg_score_words(ngs->lmcache, ngs->lm_batch_wid, n_lm,
+                                   bpe->real_wid, bpe->prev_real_wid,
+                                   ngs->lm_batch_scr);
+        for (i = n_lm = 0; i < ngs->n_1ph_LMwords; i++) {
+            w = ngs->single_phone_wid[i];
+            newscore = ngs->lm_batch_exit[i];
             E_DEBUG("initial newscore for %s: %d\n",
                     dict_wordstr(dict, w), newscore);
             if (newscore != WORST_SCORE)
-                newscore += ngram_tg_score(ngs->lmset,
-                                           dict_basewid(dict, w),
-                                           bpe->real_wid,
-                                           bpe->prev_real_wid,
-                                           &n_used)>>SENSCR_SHIFT;
+                newscore += ngs->lm_batch_scr[n_lm++] >> SENSCR_SHIFT;
 
             /* FIXME: Not sure how WORST_SCORE could be better, but it
              * apparently happens. */
@@ -1454,7 +1634,9 @@ int
 ngram_fwdtree_search(ngram_search_t *ngs, int frame_idx)
 {
     int16 const *senscr;
+    int32 n_hmm;
 
+    histprune_frame_start(&ngs->hprune);
     /* Activate our HMMs for the current frame if need be. */
     if (!ps_search_acmod(ngs)->compallsen)
         compute_sen_active(ngs, frame_idx);
@@ -1479,15 +1661,22 @@ ngram_fwdtree_search(ngram_search_t *ngs, int frame_idx)
     }
 
     /* Evaluate HMMs */
+    /* Only count the tree HMMs, since word-final ones are pruned
+     * with -lponlybeam and not -beam. */
+    n_hmm = ngs->st.n_root_chan_eval + ngs->st.n_nonroot_chan_eval
+        - ngs->st.n_last_chan_eval;
     evaluate_channels(ngs, senscr, frame_idx);
+    n_hmm = ngs->st.n_root_chan_eval + ngs->st.n_nonroot_chan_eval
+        - ngs->st.n_last_chan_eval - n_hmm;
     /* Prune HMMs and do phone transitions. */
-    prune_channels(ngs, frame_idx);
+    prune_channels(ngs, frame_idx, n_hmm);
     /* Do absolute pruning on word exits. */
     bptable_maxwpf(ngs, frame_idx);
     /* Do word transitions. */
     word_transition(ngs, frame_idx);
     /* Deactivate pruned HMMs. */
     deactivate_channels(ngs, frame_idx);
+    histprune_frame_end(&ngs->hprune, n_hmm);
 
     ++ngs->n_frame;
     /* Return the number of frames processed. */
@@ -1558,6 +1747,8 @@ ngram_fwdtree_finish(ngram_search_t *ngs)
                ngs->st.n_word_lastchan_eval / (cf + 1));
         E_INFO("%8d candidate words for entering last phone (%d/fr)\n",
                ngs->st.n_lastphn_cand_utt, ngs->st.n_lastphn_cand_utt / (cf + 1));
+        if (ngs->la_order)
+            E_INFO("%8d LM lookahead tables computed\n", ngs->st.n_la_table);
         E_INFO("fwdtree %.2f CPU %.3f xRT\n",
                ngs->fwdtree_perf.t_cpu,
                ngs->fwdtree_perf.t_cpu / n_speech);
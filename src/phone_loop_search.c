@@ -107,6 +107,7 @@ phone_loop_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
                  bin_mdef_pid2tmatid(acmod->mdef, i));
     }
     pls->penalty_weight = ps_config_float(config, "pl_weight");
+    pls->cisen = ps_config_bool(config, "pl_cisen");
     pls->beam = logmath_log(acmod->lmath, ps_config_float(config, "pl_beam")) >> SENSCR_SHIFT;
     pls->pbeam = logmath_log(acmod->lmath, ps_config_float(config, "pl_pbeam")) >> SENSCR_SHIFT;
     pls->pip = logmath_log(acmod->lmath, ps_config_float(config, "pl_pip")) >> SENSCR_SHIFT;
@@ -304,17 +305,28 @@ phone_loop_search_step(ps_search_t *search, int frame_idx)
     phone_loop_search_t *pls = (phone_loop_search_t *)search;
     acmod_t *acmod = ps_search_acmod(search);
     int16 const *senscr;
-    int i;
-
-    /* All CI senones are active all the time. */
-    if (!ps_search_acmod(pls)->compallsen) {
-        acmod_clear_active(ps_search_acmod(pls));
+    int compallsen, i;
+
+    /* All CI senones are active all the time.  The main search does
+     * not use the scores computed here, since they are for a frame
+     * ahead of it, so there is no need to compute the others even
+     * with -compallsen (unless they are read from a file). */
+    compallsen = acmod->compallsen;
+    if (pls->cisen && !acmod->insenfh)
+        acmod->compallsen = FALSE;
+    if (!acmod->compallsen) {
+        acmod_clear_active(acmod);
         for (i = 0; i < pls->n_phones; ++i)
             acmod_activate_hmm(acmod, (hmm_t *)&pls->hmms[i]);
     }
 
     /* Calculate senone scores for current frame. */
     senscr = acmod_score(acmod, &frame_idx);
+    if (compallsen && !acmod->compallsen) {
+        /* Don't let the main search reuse these partial scores. */
+        acmod->compallsen = compallsen;
+        acmod->senscr_frame = -1;
+    }
 
     /* Renormalize, if necessary. */
     if (pls->best_score + (2 * pls->beam) WORSE_THAN WORST_SCORE) {
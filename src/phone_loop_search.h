@@ -83,6 +83,7 @@ struct phone_loop_search_s {
     int16 pen_buf_ptr;                 /**< Pointer for frame to fill in penalty buffer */
     int32 *penalties;                  /**< Penalties for CI phones in current frame */
     float64 penalty_weight;            /**< Weighting factor for penalties */
+    int cisen;                         /**< Compute only CI senones, even if acmod computes all */
 
     int32 best_score;                  /**< Best Viterbi score in current frame. */
     int32 beam;                        /**< HMM pruning beam width. */
@@ -49,6 +49,7 @@
 #include "util/filename.h"
 #include "util/pio.h"
 #include "lm/jsgf.h"
+#include "lm/ngram_model_set.h"
 #include "util/hash_table.h"
 #include "pocketsphinx_internal.h"
 #include "ps_lattice_internal.h"
@@ -61,6 +62,7 @@
 #include "ngram_search_fwdflat.h"
 #include "allphone_search.h"
 #include "state_align_search.h"
+#include "ps_governor.h"
 #include "fe/fe_internal.h"
 
 /* I'm not sure what the portable way to do this is. */
@@ -141,9 +143,12 @@ ps_free_searches(ps_decoder_t *ps)
         }
         hash_table_free(ps->searches);
     }
+    if (ps->pending_search)
+        ps_search_free(ps->pending_search);
 
     ps->searches = NULL;
     ps->search = NULL;
+    ps->pending_search = NULL;
 }
 
 static ps_search_t *
@@ -229,6 +234,48 @@ ps_reinit_feat(ps_decoder_t *ps, ps_config_t *config)
     return acmod_reinit_feat(ps->acmod, NULL, NULL);
 }
 
+/**
+ * Find the weight of phoneme lookahead penalties for a type of
+ * search, from the entries of -pl_search, each of which is a search
+ * type followed optionally by a colon and a weight to use instead of
+ * -pl_weight.  Returns 1 if the type is listed, 0 if it is not (or if
+ * type is NULL, which just checks the weights), and -1 if an entry
+ * has an invalid weight.
+ */
+static int
+lookahead_weight(ps_config_t *config, char const *type,
+                 float64 *out_weight)
+{
+    char const *types;
+
+    if ((types = ps_config_str(config, "pl_search")) == NULL)
+        return 0;
+    while (*types) {
+        size_t n = strcspn(types, ", ");
+        size_t n_type = strcspn(types, ":, ");
+        float64 weight = ps_config_float(config, "pl_weight");
+
+        if (n_type < n) {
+            char *str = ckd_calloc(n - n_type, 1);
+            memcpy(str, types + n_type + 1, n - n_type - 1);
+            if ((weight = atof_c(str)) <= 0) {
+                E_ERROR("Invalid lookahead weight in -pl_search: %s\n", str);
+                ckd_free(str);
+                return -1;
+            }
+            ckd_free(str);
+        }
+        if (type && n_type == strlen(type)
+            && 0 == strncmp(types, type, n_type)) {
+            *out_weight = weight;
+            return 1;
+        }
+        types += n;
+        types += strspn(types, ", ");
+    }
+    return 0;
+}
+
 int
 ps_reinit(ps_decoder_t *ps, ps_config_t *config)
 {
@@ -312,7 +359,24 @@ ps_reinit(ps_decoder_t *ps, ps_config_t *config)
     if ((ps->acmod = acmod_init(ps->config, ps->lmath, NULL, NULL)) == NULL)
         return -1;
 
+    /* Real-time governor (keeping any callback already set). */
+    if (ps_config_float(ps->config, "maxrtf") > 0) {
+        ps_governor_t *gov = ps_governor_init(ps->config);
+        if (ps->governor)
+            ps_governor_set_cb(gov, ps->governor->cb, ps->governor->cb_data);
+        ps_governor_free(ps->governor);
+        ps->governor = gov;
+    }
+    else {
+        ps_governor_free(ps->governor);
+        ps->governor = NULL;
+    }
+
     if (ps_config_int(ps->config, "pl_window") > 0) {
+        float64 weight;
+
+        if (lookahead_weight(ps->config, NULL, &weight) < 0)
+            return -1;
         /* Initialize an auxiliary phone loop search, which will run in
          * "parallel" with FSG or N-Gram search. */
         if ((ps->phone_loop =
@@ -327,7 +391,8 @@ ps_reinit(ps_decoder_t *ps, ps_config_t *config)
     /* FIXME: pass config, change arguments, implement LTS, etc. */
     if ((ps->dict = dict_init(ps->config, ps->acmod->mdef)) == NULL)
         return -1;
-    if ((ps->d2p = dict2pid_build(ps->acmod->mdef, ps->dict)) == NULL)
+    /* Searches fill in the context tables for their own vocabulary. */
+    if ((ps->d2p = dict2pid_init(ps->acmod->mdef, ps->dict)) == NULL)
         return -1;
 
     lw = ps_config_float(ps->config, "lw");
@@ -431,6 +496,7 @@ ps_init(ps_config_t *config)
     
     ps = ckd_calloc(1, sizeof(*ps));
     ps->refcount = 1;
+    ps->arena = arena_init(0);
     if (config) {
         if (ps_reinit(ps, config) < 0) {
             ps_free(ps);
@@ -455,6 +521,8 @@ ps_free(ps_decoder_t *ps)
     if (--ps->refcount > 0)
         return ps->refcount;
     ps_free_searches(ps);
+    ps_governor_free(ps->governor);
+    arena_free(ps->arena);
     dict_free(ps->dict);
     dict2pid_free(ps->d2p);
     acmod_free(ps->acmod);
@@ -512,7 +580,7 @@ ps_activate_search(ps_decoder_t *ps, const char *name)
 
     ps->search = search;
     /* Set pl window depending on the search */
-    if (!strcmp(PS_SEARCH_TYPE_NGRAM, ps_search_type(search))) {
+    if (ps_search_lookahead(search)) {
         ps->pl_window = ps_config_int(ps->config, "pl_window");
     } else {
         ps->pl_window = 0;
@@ -530,6 +598,7 @@ ps_current_search(ps_decoder_t *ps)
         search_it = hash_table_iter_next(search_it)) {
         if (hash_entry_val(search_it->ent) == ps->search) {
             name = hash_entry_key(search_it->ent);
+            hash_table_iter_free(search_it);
             break;
         }
     }
@@ -583,6 +652,79 @@ ps_get_lm(ps_decoder_t *ps, const char *name)
     return ((ngram_search_t *) search)->lmset;
 }
 
+/**
+ * Check (if update is FALSE) or update the members of a class in
+ * every model of a possibly nested set that has it.  Returns the
+ * number of models with the class, or <0 for error.
+ */
+static int
+update_lm_class(ngram_model_t *lm, const char *classname,
+                const char **words, const float32 *weights,
+                int32 n_words, int update)
+{
+    ngram_model_set_iter_t *itor;
+    int n_models = 0;
+
+    if (!ngram_model_is_set(lm)) {
+        if (ngram_wid(lm, classname) == ngram_unknown_wid(lm))
+            return 0;
+        if (update) {
+            if (ngram_model_update_class(lm, classname, words,
+                                         weights, n_words) < 0)
+                return -1;
+        }
+        else if (ngram_model_check_class(lm, classname, words,
+                                         weights, n_words) < 0)
+            return -1;
+        return 1;
+    }
+    for (itor = ngram_model_set_iter(lm); itor;
+         itor = ngram_model_set_iter_next(itor)) {
+        int rv = update_lm_class(ngram_model_set_iter_model(itor, NULL),
+                                 classname, words, weights, n_words,
+                                 update);
+        if (rv < 0) {
+            ngram_model_set_iter_free(itor);
+            return -1;
+        }
+        n_models += rv;
+    }
+    return n_models;
+}
+
+int
+ps_update_lm_class(ps_decoder_t *ps, const char *name,
+                   const char *classname, const char **words,
+                   const float32 *weights, int32 n_words)
+{
+    ngram_model_t *lmset;
+    int n_models;
+
+    if ((lmset = ps_get_lm(ps, name)) == NULL) {
+        E_ERROR("No such language model search: %s\n",
+                name ? name : "(current)");
+        return -1;
+    }
+    /* Check the class in every model of the set that has it first, so
+     * that an error does not leave the set half updated.  The search
+     * wraps the model it was given in a set, so that may be a set
+     * too. */
+    if ((n_models = update_lm_class(lmset, classname, words,
+                                    weights, n_words, FALSE)) < 0)
+        return -1;
+    if (n_models == 0) {
+        E_ERROR("No class %s in language model\n", classname);
+        return -1;
+    }
+    /* Then update it.  Since word IDs do not change, the search does
+     * not need to be reinitialized.  This cannot fail, as it was
+     * checked above. */
+    if (update_lm_class(lmset, classname, words,
+                        weights, n_words, TRUE) < 0)
+        return -1;
+    return n_words;
+}
+
 fsg_model_t *
 ps_get_fsg(ps_decoder_t *ps, const char *name)
 {
@@ -623,7 +765,17 @@ set_search_internal(ps_decoder_t *ps, ps_search_t *search)
     if (!search)
 	return -1;
 
-    search->pls = ps->phone_loop;
+    /* The weights were checked in ps_reinit(). */
+    if (ps->phone_loop
+        && lookahead_weight(ps->config, ps_search_type(search),
+                            &search->pl_weight) > 0)
+        search->pls = ps->phone_loop;
+    else
+        search->pls = NULL;
+    if (search->arena != ps->arena) {
+        arena_free(search->arena);
+        search->arena = arena_retain(ps->arena);
+    }
     old_search = (ps_search_t *) hash_table_replace(ps->searches, ps_search_name(search), search);
     if (old_search != search)
         ps_search_free(old_search);
@@ -654,6 +806,95 @@ ps_add_lm_file(ps_decoder_t *ps, const char *name, const char *path)
   return result;
 }
 
+ps_search_t *
+ps_build_lm(ps_decoder_t *ps, const char *name, ngram_model_t *lm)
+{
+    return ngram_search_prepare(name, lm, ps->config, ps->acmod,
+                                ps->dict, ps->d2p);
+}
+
+ps_search_t *
+ps_build_lm_file(ps_decoder_t *ps, const char *name, const char *path)
+{
+    ps_search_t *search;
+    ngram_model_t *lm;
+
+    /* Language models do not retain the logmath (which is read-only
+     * once created), so it is safe to share it here. */
+    lm = ngram_model_read(ps->config, path, NGRAM_AUTO, ps->lmath);
+    if (!lm)
+        return NULL;
+
+    search = ps_build_lm(ps, name, lm);
+    ngram_model_free(lm);
+    return search;
+}
+
+int
+ps_swap_search(ps_decoder_t *ps, ps_search_t *search)
+{
+    if (search == NULL)
+        return -1;
+    if (ps->pending_search)
+        ps_search_free(ps->pending_search);
+    ps->pending_search = search;
+    return 0;
+}
+
+void
+ps_discard_search(ps_search_t *search)
+{
+    if (search)
+        ps_search_free(search);
+}
+
+/*
+ * Install a search passed to ps_swap_search(), replacing any search
+ * with the same name.  The decoder owns the pending search, along
+ * with its language model set, so it is freed here if it cannot be
+ * installed.
+ */
+static int
+swap_pending_search(ps_decoder_t *ps)
+{
+    ps_search_t *search = ps->pending_search;
+    ps_search_t *old_search;
+    int activate;
+
+    ps->pending_search = NULL;
+    /* The dictionary may have changed since the search was built, in
+     * which case the borrowed references to it are no longer valid. */
+    assert(search->borrowed);
+    if (search->dict != ps->dict || search->d2p != ps->d2p
+        || search->n_words != dict_size(ps->dict)) {
+        search->dict = NULL;
+        search->d2p = NULL;
+        search->borrowed = FALSE;
+        if (ps_search_reinit(search, ps->dict, ps->d2p) < 0) {
+            E_ERROR("Failed to update search %s for the current dictionary\n",
+                    ps_search_name(search));
+            ps_search_free(search);
+            return -1;
+        }
+    }
+    if (0 == strcmp(PS_SEARCH_TYPE_NGRAM, ps_search_type(search)))
+        ngram_search_commit(search);
+    else
+        ps_search_base_commit(search);
+
+    old_search = ps_find_search(ps, ps_search_name(search));
+    activate = (ps->search == NULL || ps->search == old_search);
+    if (old_search == ps->search)
+        ps->search = NULL;
+    /* This only fails for a NULL search.  From here on the search
+     * belongs to ps->searches, even if it can't be activated. */
+    set_search_internal(ps, search);
+    E_INFO("Swapped in search %s\n", ps_search_name(search));
+    if (activate)
+        return ps_activate_search(ps, ps_search_name(search));
+    return 0;
+}
+
 int
 ps_add_allphone(ps_decoder_t *ps, const char *name, ngram_model_t *lm)
 {
@@ -904,7 +1145,7 @@ ps_load_dict(ps_decoder_t *ps, char const *dictfile,
     }
 
     /* Reinit the dict2pid. */
-    if ((d2p = dict2pid_build(ps->acmod->mdef, dict)) == NULL) {
+    if ((d2p = dict2pid_init(ps->acmod->mdef, dict)) == NULL) {
         ps_config_free(newconfig);
         return -1;
     }
@@ -1099,6 +1340,9 @@ ps_start_utt(ps_decoder_t *ps)
 	return -1;
     }
 
+    if (ps->pending_search && swap_pending_search(ps) < 0)
+        return -1;
+
     if (ps->search == NULL) {
         E_ERROR("No search module is selected, did you forget to "
                 "specify a language model or grammar?\n");
@@ -1118,6 +1362,8 @@ ps_start_utt(ps_decoder_t *ps)
     ps->search->post = 0;
     ckd_free(ps->search->hyp_str);
     ps->search->hyp_str = NULL;
+    /* Release everything the searches allocated for the last one. */
+    arena_reset(ps->arena);
     if ((rv = acmod_start_utt(ps->acmod)) < 0)
         return rv;
 
@@ -1162,9 +1408,17 @@ ps_start_utt(ps_decoder_t *ps)
         acmod_set_senfh(ps->acmod, senfh);
     }
 
-    /* Start auxiliary phone loop search. */
-    if (ps->phone_loop)
+    /* Start auxiliary phone loop search, weighting its penalties
+     * for the current search. */
+    if (ps->phone_loop) {
+        if (ps_search_lookahead(ps->search))
+            ((phone_loop_search_t *)ps->phone_loop)->penalty_weight
+                = ps->search->pl_weight;
         ps_search_start(ps->phone_loop);
+    }
+    /* Carry over any degradation from the last utterance. */
+    if (ps->governor)
+        ps_governor_apply(ps->governor, ps->search);
 
     return ps_search_start(ps->search);
 }
@@ -1182,6 +1436,8 @@ ps_search_forward(ps_decoder_t *ps)
     nfr = 0;
     while (ps->acmod->n_feat_frame > 0) {
         int k;
+        if (ps->governor)
+            ps_governor_frame_start(ps->governor);
         if (ps->pl_window > 0)
             if ((k = ps_search_step(ps->phone_loop, ps->acmod->output_frame)) < 0)
                 return k;
@@ -1189,6 +1445,8 @@ ps_search_forward(ps_decoder_t *ps)
             if ((k = ps_search_step(ps->search,
                                     ps->acmod->output_frame - ps->pl_window)) < 0)
                 return k;
+        if (ps->governor)
+            ps_governor_frame_end(ps->governor, ps->search);
         acmod_advance(ps->acmod);
         ++ps->n_frame;
         ++nfr;
@@ -1564,12 +1822,59 @@ ps_get_all_time(ps_decoder_t *ps, double *out_nspeech,
     *out_nwall = ps->perf.t_tot_elapsed;
 }
 
+int
+ps_get_lm_cache_stats(ps_decoder_t *ps, int32 *out_n_lookup,
+                      int32 *out_n_hit)
+{
+    ngram_search_t *ngs;
+    int32 n_lookup;
+
+    if (ps->search == NULL
+        || 0 != strcmp(ps_search_type(ps->search), PS_SEARCH_TYPE_NGRAM))
+        return -1;
+    ngs = (ngram_search_t *)ps->search;
+    n_lookup = ngram_cache_stats(ngs->lmcache, out_n_hit, NULL);
+    if (out_n_lookup)
+        *out_n_lookup = n_lookup;
+    return 0;
+}
+
+int
+ps_set_governor_cb(ps_decoder_t *ps, ps_governor_cb_t cb, void *user_data)
+{
+    if (ps->governor == NULL) {
+        E_ERROR("Real-time governor is not enabled (use -maxrtf)\n");
+        return -1;
+    }
+    ps_governor_set_cb(ps->governor, cb, user_data);
+    return 0;
+}
+
+ps_governor_stats_t const *
+ps_get_governor_stats(ps_decoder_t *ps)
+{
+    if (ps->governor == NULL)
+        return NULL;
+    return &ps->governor->stats;
+}
+
 void
 ps_search_init(ps_search_t *search, ps_searchfuncs_t *vt,
 	       const char *type,
 	       const char *name,
                ps_config_t *config, acmod_t *acmod, dict_t *dict,
                dict2pid_t *d2p)
+{
+    ps_search_init_borrowed(search, vt, type, name, config, acmod, dict, d2p);
+    ps_search_base_commit(search);
+}
+
+void
+ps_search_init_borrowed(ps_search_t *search, ps_searchfuncs_t *vt,
+                        const char *type,
+                        const char *name,
+                        ps_config_t *config, acmod_t *acmod, dict_t *dict,
+                        dict2pid_t *d2p)
 {
     search->vt = vt;
     search->name = ckd_salloc(name);
@@ -1577,12 +1882,14 @@ ps_search_init(ps_search_t *search, ps_searchfuncs_t *vt,
 
     search->config = config;
     search->acmod = acmod;
-    if (d2p)
-        search->d2p = dict2pid_retain(d2p);
-    else
-        search->d2p = NULL;
+    search->beam_scale = 1.0f;
+    /* Replaced with the decoder's own in set_search_internal(). */
+    search->arena = arena_init(0);
+    /* Retained by ps_search_base_commit(). */
+    search->borrowed = TRUE;
+    search->d2p = d2p;
     if (dict) {
-        search->dict = dict_retain(dict);
+        search->dict = dict;
         search->start_wid = dict_startwid(dict);
         search->finish_wid = dict_finishwid(dict);
         search->silence_wid = dict_silwid(dict);
@@ -1595,6 +1902,18 @@ ps_search_init(ps_search_t *search, ps_searchfuncs_t *vt,
     }
 }
 
+void
+ps_search_base_commit(ps_search_t *search)
+{
+    if (!search->borrowed)
+        return;
+    if (search->dict)
+        dict_retain(search->dict);
+    if (search->d2p)
+        dict2pid_retain(search->d2p);
+    search->borrowed = FALSE;
+}
+
 void
 ps_search_base_free(ps_search_t *search)
 {
@@ -1602,18 +1921,24 @@ ps_search_base_free(ps_search_t *search)
      * point we will free them here too. */
     ckd_free(search->name);
     ckd_free(search->type);
-    dict_free(search->dict);
-    dict2pid_free(search->d2p);
+    if (!search->borrowed) {
+        dict_free(search->dict);
+        dict2pid_free(search->d2p);
+    }
     ckd_free(search->hyp_str);
     ps_lattice_free(search->dag);
+    arena_free(search->arena);
 }
 
 void
 ps_search_base_reinit(ps_search_t *search, dict_t *dict,
                       dict2pid_t *d2p)
 {
-    dict_free(search->dict);
-    dict2pid_free(search->d2p);
+    if (!search->borrowed) {
+        dict_free(search->dict);
+        dict2pid_free(search->d2p);
+    }
+    search->borrowed = FALSE;
     /* FIXME: _retain() should just return NULL if passed NULL. */
     if (dict) {
         search->dict = dict_retain(dict);
@@ -48,6 +48,7 @@
 #include "feat/feat.h"
 #include "util/cmd_ln.h"
 #include "util/hash_table.h"
+#include "util/arena.h"
 #include "util/profile.h"
 
 #include "acmod.h"
@@ -109,16 +110,23 @@ struct ps_search_s {
      * Phoneme loop for lookahead.  Reference (not retained) to
      * phone_loop in the parent ps_decoder_t. */
     ps_search_t *pls;
+    float64 pl_weight;     /**< Weight of lookahead penalties for this search. */
+    /**
+     * Allocator for per-utterance data, shared with the parent
+     * ps_decoder_t, which resets it at the start of each utterance. */
+    arena_t *arena;
     cmd_ln_t *config;      /**< Configuration. */
     acmod_t *acmod;        /**< Acoustic model. */
     dict_t *dict;        /**< Pronunciation dictionary. */
     dict2pid_t *d2p;       /**< Dictionary to senone mappings. */
+    uint8 borrowed;        /**< dict and d2p are not (yet) retained. */
     char *hyp_str;         /**< Current hypothesis string. */
     ps_lattice_t *dag;	   /**< Current hypothesis word graph. */
     ps_latlink_t *last_link; /**< Final link in best path. */
     int32 post;            /**< Utterance posterior probability. */
     int32 n_words;         /**< Number of words known to search (may
                               be less than in the dictionary) */
+    float32 beam_scale;    /**< Scaling of beams imposed by the governor. */
 
     /* Magical word IDs that must exist in the dictionary: */
     int32 start_wid;       /**< Start word ID. */
@@ -135,6 +143,7 @@ struct ps_search_s {
 #define ps_search_last_link(s) ps_search_base(s)->last_link
 #define ps_search_post(s) ps_search_base(s)->post
 #define ps_search_lookahead(s) ps_search_base(s)->pls
+#define ps_search_beam_scale(s) ps_search_base(s)->beam_scale
 #define ps_search_n_words(s) ps_search_base(s)->n_words
 
 #define ps_search_type(s) ps_search_base(s)->type
@@ -163,6 +172,23 @@ void ps_search_init(ps_search_t *search, ps_searchfuncs_t *vt,
                     dict2pid_t *d2p);
 
 
+/**
+ * Initialize base structure without retaining the dictionary or
+ * dict2pid, so that this can be done while the decoder is using them
+ * in another thread.  ps_search_base_commit() must be called (from the
+ * decoder's thread) before using the search.
+ */
+void ps_search_init_borrowed(ps_search_t *search, ps_searchfuncs_t *vt,
+                             const char *type, const char *name,
+                             cmd_ln_t *config, acmod_t *acmod, dict_t *dict,
+                             dict2pid_t *d2p);
+
+/**
+ * Retain the dictionary and dict2pid for a search initialized with
+ * ps_search_init_borrowed().
+ */
+void ps_search_base_commit(ps_search_t *search);
+
 /**
  * Free search
  */
@@ -224,6 +250,8 @@ struct ps_decoder_s {
     ps_search_t *search;     /**< Currently active search module. */
     ps_search_t *phone_loop; /**< Phone loop search for lookahead. */
     int pl_window;           /**< Window size for phoneme lookahead. */
+    arena_t *arena;          /**< Per-utterance allocator for searches. */
+    ps_search_t *pending_search; /**< Search to swap in at next utterance. */
 
     /* Utterance-processing related stuff. */
     uint32 uttno;       /**< Utterance counter. */
@@ -232,6 +260,7 @@ struct ps_decoder_s {
     char const *mfclogdir; /**< Log directory for MFCC files. */
     char const *rawlogdir; /**< Log directory for audio files. */
     char const *senlogdir; /**< Log directory for senone score files. */
+    struct ps_governor_s *governor; /**< Real-time governor, or NULL. */
 };
 
 
@@ -151,6 +151,7 @@ ps_alignment_populate(ps_alignment_t *al)
         int len = dict_pronlen(dict, wid);
         int j, rc;
 
+        dict2pid_add_word(d2p, wid);
         if (i < al->word.n_ent - 1)
             rc = dict_first_phone(dict, al->word.seq[i+1].id.wid);
         else
@@ -0,0 +1,405 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+/**
+ * @file ps_confnet.c
+ * @brief Word confusion networks built from lattice posteriors
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pocketsphinx.h>
+
+#include "util/ckd_alloc.h"
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "dict.h"
+
+/**
+ * Arc in a confusion network.
+ */
+typedef struct confarc_s {
+    int32 wid;   /**< Base word ID, or BAD_S3WID for the empty arc. */
+    int32 prob;  /**< Log posterior probability. */
+} confarc_t;
+
+/**
+ * Slot in a confusion network.
+ */
+typedef struct confslot_s {
+    int32 sf;        /**< First frame. */
+    int32 ef;        /**< Last frame. */
+    int32 first_arc; /**< Index of first arc in ps_confnet_t::arcs. */
+    int32 n_arcs;    /**< Number of arcs. */
+} confslot_t;
+
+struct ps_confnet_s {
+    int refcount;      /**< Reference count. */
+    dict_t *dict;      /**< Dictionary for word strings. */
+    logmath_t *lmath;  /**< Log-math object for probabilities. */
+    int32 n_slots;     /**< Number of slots. */
+    confslot_t *slots; /**< Slots, in time order. */
+    confarc_t *arcs;   /**< Arcs for all slots, best first in each. */
+    char *hyp;         /**< Consensus hypothesis, created on demand. */
+};
+
+/**
+ * Word hypothesis from the lattice, used while building the network.
+ *
+ * Words are placed in "virtual" slots: odd numbers 2i+1 are the words
+ * of the pivot path, and even numbers 2i are the gaps before them.
+ */
+typedef struct confword_s {
+    int32 slot; /**< Virtual slot index. */
+    int32 wid;  /**< Base word ID. */
+    int32 sf;   /**< First frame. */
+    int32 ef;   /**< Last frame. */
+    int32 prob; /**< Log posterior probability. */
+} confword_t;
+
+static int
+confword_cmp(const void *a, const void *b)
+{
+    confword_t const *wa = (confword_t const *)a;
+    confword_t const *wb = (confword_t const *)b;
+
+    if (wa->slot != wb->slot)
+        return wa->slot - wb->slot;
+    return wa->wid - wb->wid;
+}
+
+static int
+confarc_cmp(const void *a, const void *b)
+{
+    confarc_t const *aa = (confarc_t const *)a;
+    confarc_t const *ab = (confarc_t const *)b;
+
+    if (aa->prob != ab->prob)
+        return aa->prob > ab->prob ? -1 : 1;
+    return aa->wid - ab->wid;
+}
+
+/*
+ * Find the virtual slot for a word from sf to ef, given the times of
+ * the words on the pivot path, which are in order and do not overlap.
+ */
+static int32
+find_slot(int32 *piv_sf, int32 *piv_ef, int32 n_pivot, int32 sf, int32 ef)
+{
+    int32 lo, hi, i, best, best_overlap;
+
+    /* Find the first pivot word ending at or after sf. */
+    lo = 0;
+    hi = n_pivot;
+    while (lo < hi) {
+        int32 mid = (lo + hi) / 2;
+        if (piv_ef[mid] < sf)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    /* Take the one overlapping most, if any. */
+    best = -1;
+    best_overlap = 0;
+    for (i = lo; i < n_pivot && piv_sf[i] <= ef; ++i) {
+        int32 overlap = (piv_ef[i] < ef ? piv_ef[i] : ef)
+            - (piv_sf[i] > sf ? piv_sf[i] : sf) + 1;
+        if (overlap > best_overlap) {
+            best_overlap = overlap;
+            best = i;
+        }
+    }
+    if (best == -1)
+        return 2 * lo;
+    return 2 * best + 1;
+}
+
+ps_confnet_t *
+ps_lattice_confnet(ps_lattice_t *dag, int32 beam)
+{
+    ps_confnet_t *cn;
+    latlink_list_t *x;
+    ps_latlink_t *link, *bestend;
+    confword_t *words;
+    int32 *piv_sf, *piv_ef;
+    int32 n_pivot, n_words, n_arcs, i, j;
+
+    /* Find the end of the best path, as ps_lattice_posterior() does. */
+    bestend = NULL;
+    for (x = dag->end->entries; x; x = x->next) {
+        if (bestend == NULL
+            || x->link->path_scr BETTER_THAN bestend->path_scr)
+            bestend = x->link;
+    }
+    if (bestend == NULL) {
+        E_ERROR("Lattice has no path to the final node\n");
+        return NULL;
+    }
+
+    /* Collect the times of the words on it, which are the pivots. */
+    n_pivot = 0;
+    for (link = bestend; link; link = link->best_prev)
+        if (dict_real_word(dag->dict, link->from->basewid))
+            ++n_pivot;
+    piv_sf = ckd_calloc(n_pivot + 1, sizeof(*piv_sf));
+    piv_ef = ckd_calloc(n_pivot + 1, sizeof(*piv_ef));
+    i = n_pivot;
+    for (link = bestend; link; link = link->best_prev) {
+        if (dict_real_word(dag->dict, link->from->basewid)) {
+            --i;
+            piv_sf[i] = link->from->sf;
+            piv_ef[i] = link->ef;
+        }
+    }
+
+    /* Place every word in the lattice in a slot. */
+    ps_lattice_compile(dag);
+    words = ckd_calloc(dag->n_link_list + 1, sizeof(*words));
+    n_words = 0;
+    for (i = 0; i < dag->n_link_list; ++i) {
+        confword_t *w = words + n_words;
+        int32 post;
+
+        link = dag->link_list[i];
+        if (!dict_real_word(dag->dict, link->from->basewid))
+            continue;
+        post = link->alpha + link->beta - dag->norm;
+        if (post < beam)
+            continue;
+        w->wid = link->from->basewid;
+        w->sf = link->from->sf;
+        w->ef = link->ef;
+        w->prob = post;
+        w->slot = find_slot(piv_sf, piv_ef, n_pivot, w->sf, w->ef);
+        ++n_words;
+    }
+
+    /* Merge instances of the same word in each slot. */
+    qsort(words, n_words, sizeof(*words), confword_cmp);
+    for (i = j = 0; i < n_words; ++i) {
+        if (j > 0 && words[j - 1].slot == words[i].slot
+            && words[j - 1].wid == words[i].wid) {
+            confword_t *w = words + j - 1;
+            w->prob = logmath_add(dag->lmath, w->prob, words[i].prob);
+            if (words[i].sf < w->sf)
+                w->sf = words[i].sf;
+            if (words[i].ef > w->ef)
+                w->ef = words[i].ef;
+        }
+        else
+            words[j++] = words[i];
+    }
+    n_words = j;
+    /* Rounding errors can make posteriors slightly greater than one. */
+    for (i = 0; i < n_words; ++i)
+        if (words[i].prob > 0)
+            words[i].prob = 0;
+
+    /* Now build the slots, adding empty arcs where needed. */
+    cn = ckd_calloc(1, sizeof(*cn));
+    cn->refcount = 1;
+    cn->dict = dict_retain(dag->dict);
+    cn->lmath = logmath_retain(dag->lmath);
+    cn->slots = ckd_calloc(n_words + 1, sizeof(*cn->slots));
+    cn->arcs = ckd_calloc(2 * n_words + 1, sizeof(*cn->arcs));
+    n_arcs = 0;
+    for (i = 0; i < n_words; i = j) {
+        confslot_t *slot = cn->slots + cn->n_slots++;
+        float64 total = 0;
+
+        slot->first_arc = n_arcs;
+        slot->sf = words[i].sf;
+        slot->ef = words[i].ef;
+        for (j = i; j < n_words && words[j].slot == words[i].slot; ++j) {
+            cn->arcs[n_arcs].wid = words[j].wid;
+            cn->arcs[n_arcs].prob = words[j].prob;
+            ++n_arcs;
+            total += logmath_exp(dag->lmath, words[j].prob);
+            if (words[j].sf < slot->sf)
+                slot->sf = words[j].sf;
+            if (words[j].ef > slot->ef)
+                slot->ef = words[j].ef;
+        }
+        /* Slots on the pivot path take its times. */
+        if (words[i].slot & 1) {
+            slot->sf = piv_sf[words[i].slot / 2];
+            slot->ef = piv_ef[words[i].slot / 2];
+        }
+        if (total < 1.0) {
+            int32 prob = logmath_log(dag->lmath, 1.0 - total);
+            if (prob BETTER_THAN logmath_get_zero(dag->lmath)) {
+                cn->arcs[n_arcs].wid = BAD_S3WID;
+                cn->arcs[n_arcs].prob = prob;
+                ++n_arcs;
+            }
+        }
+        slot->n_arcs = n_arcs - slot->first_arc;
+        qsort(cn->arcs + slot->first_arc, slot->n_arcs,
+              sizeof(*cn->arcs), confarc_cmp);
+    }
+    E_INFO("Confusion network: %d slots, %d arcs from %d links\n",
+           cn->n_slots, n_arcs, dag->n_link_list);
+
+    ckd_free(words);
+    ckd_free(piv_sf);
+    ckd_free(piv_ef);
+    return cn;
+}
+
+ps_confnet_t *
+ps_confnet_retain(ps_confnet_t *cn)
+{
+    ++cn->refcount;
+    return cn;
+}
+
+int
+ps_confnet_free(ps_confnet_t *cn)
+{
+    if (cn == NULL)
+        return 0;
+    if (--cn->refcount > 0)
+        return cn->refcount;
+    dict_free(cn->dict);
+    logmath_free(cn->lmath);
+    ckd_free(cn->slots);
+    ckd_free(cn->arcs);
+    ckd_free(cn->hyp);
+    ckd_free(cn);
+    return 0;
+}
+
+logmath_t *
+ps_confnet_get_logmath(ps_confnet_t *cn)
+{
+    return cn->lmath;
+}
+
+int
+ps_confnet_n_slots(ps_confnet_t *cn)
+{
+    return cn->n_slots;
+}
+
+int
+ps_confnet_slot(ps_confnet_t *cn, int slot, int *out_sf, int *out_ef)
+{
+    if (slot < 0 || slot >= cn->n_slots)
+        return -1;
+    if (out_sf) *out_sf = cn->slots[slot].sf;
+    if (out_ef) *out_ef = cn->slots[slot].ef;
+    return cn->slots[slot].n_arcs;
+}
+
+char const *
+ps_confnet_word(ps_confnet_t *cn, int slot, int arc, int32 *out_prob)
+{
+    confarc_t *ca;
+
+    if (slot < 0 || slot >= cn->n_slots
+        || arc < 0 || arc >= cn->slots[slot].n_arcs)
+        return NULL;
+    ca = cn->arcs + cn->slots[slot].first_arc + arc;
+    if (out_prob) *out_prob = ca->prob;
+    if (ca->wid == BAD_S3WID)
+        return NULL;
+    return dict_wordstr(cn->dict, ca->wid);
+}
+
+char const *
+ps_confnet_hyp(ps_confnet_t *cn)
+{
+    size_t len;
+    char *c;
+    int32 i;
+
+    if (cn->hyp)
+        return cn->hyp;
+    len = 0;
+    for (i = 0; i < cn->n_slots; ++i) {
+        char const *word = ps_confnet_word(cn, i, 0, NULL);
+        if (word != NULL)
+            len += strlen(word) + 1;
+    }
+    cn->hyp = c = ckd_calloc(1, len + 1);
+    for (i = 0; i < cn->n_slots; ++i) {
+        char const *word = ps_confnet_word(cn, i, 0, NULL);
+        if (word != NULL) {
+            if (c > cn->hyp)
+                *c++ = ' ';
+            len = strlen(word);
+            memcpy(c, word, len);
+            c += len;
+        }
+    }
+    *c = '\0';
+    return cn->hyp;
+}
+
+int
+ps_confnet_write(ps_confnet_t *cn, char const *filename)
+{
+    FILE *fh;
+    int32 i, j;
+
+    if ((fh = fopen(filename, "w")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open confusion network file '%s' for writing",
+                       filename);
+        return -1;
+    }
+    fprintf(fh, "numaligns %d\n", cn->n_slots);
+    fprintf(fh, "posterior 1\n");
+    for (i = 0; i < cn->n_slots; ++i) {
+        fprintf(fh, "align %d", i);
+        for (j = 0; j < cn->slots[i].n_arcs; ++j) {
+            confarc_t *ca = cn->arcs + cn->slots[i].first_arc + j;
+            fprintf(fh, " %s %g",
+                    ca->wid == BAD_S3WID
+                    ? "*DELETE*" : dict_wordstr(cn->dict, ca->wid),
+                    logmath_exp(cn->lmath, ca->prob));
+        }
+        fprintf(fh, "\n");
+    }
+    if (fclose(fh) != 0) {
+        E_ERROR_SYSTEM("Failed to write confusion network file '%s'",
+                       filename);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+
+/**
+ * @file ps_governor.c
+ * @brief Real-time governor for the decoder
+ */
+
+#include <pocketsphinx.h>
+
+#include "util/ckd_alloc.h"
+#include "acmod.h"
+#include "ps_governor.h"
+
+/* Weight of the most recent frame in the estimate of real-time factor. */
+#define GOVERNOR_DECAY 0.05
+/* Frames to wait after changing level. */
+#define GOVERNOR_HOLD 20
+/* Restore a level only when comfortably below the target. */
+#define GOVERNOR_RELAX 0.7
+
+/* Levels of degradation, from none to most. */
+static const struct {
+    float32 beam_scale; /* Scaling of beams. */
+    int topn_div;       /* Divisor of top-N Gaussians. */
+    int ds_mul;         /* Multiplier of frame downsampling. */
+} levels[] = {
+    { 1.0f, 1, 1 },
+    { 0.8f, 1, 1 },
+    { 0.8f, 2, 1 },
+    { 0.6f, 2, 2 },
+    { 0.5f, 4, 2 }
+};
+#define GOVERNOR_MAX_LEVEL ((int)(sizeof(levels) / sizeof(levels[0])) - 1)
+
+ps_governor_t *
+ps_governor_init(ps_config_t *config)
+{
+    ps_governor_t *gov;
+
+    gov = ckd_calloc(1, sizeof(*gov));
+    gov->maxrtf = ps_config_float(config, "maxrtf");
+    gov->frate = ps_config_int(config, "frate");
+    gov->topn = ps_config_int(config, "topn");
+    gov->ds_ratio = ps_config_int(config, "ds");
+    gov->stats.beam_scale = 1.0;
+    gov->stats.topn = gov->topn;
+    gov->stats.ds_ratio = gov->ds_ratio;
+    ptmr_init(&gov->tmr);
+    E_INFO("Degrading search to keep real-time factor below %.2f\n",
+           gov->maxrtf);
+
+    return gov;
+}
+
+void
+ps_governor_free(ps_governor_t *gov)
+{
+    ckd_free(gov);
+}
+
+void
+ps_governor_set_cb(ps_governor_t *gov, ps_governor_cb_t cb, void *user_data)
+{
+    gov->cb = cb;
+    gov->cb_data = user_data;
+}
+
+void
+ps_governor_apply(ps_governor_t *gov, ps_search_t *search)
+{
+    acmod_t *acmod = ps_search_acmod(search);
+    int level = gov->stats.level;
+    int topn, ds_ratio;
+
+    gov->stats.beam_scale = levels[level].beam_scale;
+    ps_search_beam_scale(search) = levels[level].beam_scale;
+
+    topn = gov->topn / levels[level].topn_div;
+    if (topn < 1)
+        topn = 1;
+    ds_ratio = gov->ds_ratio * levels[level].ds_mul;
+    /* Continuous models can only have their beams narrowed. */
+    if (ps_mgau_set_approx(acmod->mgau, topn, ds_ratio) < 0) {
+        topn = gov->topn;
+        ds_ratio = gov->ds_ratio;
+    }
+    gov->stats.topn = topn;
+    gov->stats.ds_ratio = ds_ratio;
+}
+
+void
+ps_governor_frame_start(ps_governor_t *gov)
+{
+    ptmr_reset(&gov->tmr);
+    ptmr_start(&gov->tmr);
+}
+
+int
+ps_governor_frame_end(ps_governor_t *gov, ps_search_t *search)
+{
+    float64 rtf;
+    int level;
+
+    ptmr_stop(&gov->tmr);
+    rtf = gov->tmr.t_elapsed * gov->frate;
+    if (gov->stats.n_frame == 0)
+        gov->stats.rtf = rtf;
+    else
+        gov->stats.rtf = (1.0 - GOVERNOR_DECAY) * gov->stats.rtf
+            + GOVERNOR_DECAY * rtf;
+    ++gov->stats.n_frame;
+    if (gov->stats.level > 0)
+        ++gov->stats.n_frame_degraded;
+
+    if (gov->hold > 0) {
+        --gov->hold;
+        return FALSE;
+    }
+    level = gov->stats.level;
+    if (gov->stats.rtf > gov->maxrtf && level < GOVERNOR_MAX_LEVEL) {
+        ++level;
+        ++gov->stats.n_degrade;
+    }
+    else if (gov->stats.rtf < gov->maxrtf * GOVERNOR_RELAX && level > 0) {
+        --level;
+        ++gov->stats.n_restore;
+    }
+    else
+        return FALSE;
+
+    E_DEBUG("Real-time factor %.2f, search level %d -> %d\n",
+            gov->stats.rtf, gov->stats.level, level);
+    gov->stats.level = level;
+    gov->hold = GOVERNOR_HOLD;
+    ps_governor_apply(gov, search);
+    if (gov->cb)
+        (*gov->cb)(gov->cb_data, &gov->stats);
+
+    return TRUE;
+}
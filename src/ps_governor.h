@@ -0,0 +1,118 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+
+/**
+ * @file ps_governor.h
+ * @brief Real-time governor for the decoder
+ *
+ * This times each frame of search and compares it to -maxrtf.  When
+ * the decoder falls behind, it moves to the next of a fixed series of
+ * levels, each of which narrows the beams and/or computes fewer
+ * Gaussians, and when it catches up it moves back.  After each change
+ * it waits a few frames before deciding again, so the estimate of the
+ * real-time factor has time to reflect it.
+ */
+
+#ifndef __PS_GOVERNOR_H__
+#define __PS_GOVERNOR_H__
+
+#include <pocketsphinx.h>
+
+#include "util/profile.h"
+#include "pocketsphinx_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Real-time governor.
+ */
+typedef struct ps_governor_s {
+    ps_governor_stats_t stats; /**< Current state, exposed to the user. */
+    float64 maxrtf;     /**< Target real-time factor. */
+    int32 frate;        /**< Frame rate, to convert frames to seconds. */
+    int topn;           /**< Top-N Gaussians when not degraded. */
+    int ds_ratio;       /**< Frame downsampling when not degraded. */
+    int32 hold;         /**< Frames to wait before the next change. */
+    ptmr_t tmr;         /**< Timer for the current frame. */
+    ps_governor_cb_t cb; /**< Callback for changes of level. */
+    void *cb_data;      /**< Data for callback. */
+} ps_governor_t;
+
+/**
+ * Create a governor from -maxrtf, -topn, -ds and -frate.
+ */
+ps_governor_t *ps_governor_init(ps_config_t *config);
+
+/**
+ * Free a governor.
+ */
+void ps_governor_free(ps_governor_t *gov);
+
+/**
+ * Set the callback for changes of level.
+ */
+void ps_governor_set_cb(ps_governor_t *gov, ps_governor_cb_t cb,
+                        void *user_data);
+
+/**
+ * Apply the current level to a search and its acoustic model.
+ */
+void ps_governor_apply(ps_governor_t *gov, ps_search_t *search);
+
+/**
+ * Start timing a frame.
+ */
+void ps_governor_frame_start(ps_governor_t *gov);
+
+/**
+ * Stop timing a frame, and change level if necessary.
+ * @param search Search to apply any new level to.
+ * @return TRUE if the level was changed.
+ */
+int ps_governor_frame_end(ps_governor_t *gov, ps_search_t *search);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __PS_GOVERNOR_H__ */
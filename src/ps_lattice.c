@@ -49,6 +49,10 @@
 #include "util/listelem_alloc.h"
 #include "util/strfuncs.h"
 #include "util/pio.h"
+#include "util/mmio.h"
+#include "util/hash_table.h"
+#include "util/byteorder.h"
+#include "lm/ngram_model_internal.h"
 
 #include "pocketsphinx_internal.h"
 #include "ps_lattice_internal.h"
@@ -75,6 +79,7 @@ ps_lattice_link(ps_lattice_t *dag, ps_latnode_t *from, ps_latnode_t *to,
         ps_latlink_t *link;
 
         /* No link between the two nodes; create a new one */
+        ps_lattice_uncompile(dag);
         link = listelem_malloc(dag->latlink_alloc);
         fwdlink = listelem_malloc(dag->latlink_list_alloc);
         revlink = listelem_malloc(dag->latlink_list_alloc);
@@ -174,6 +179,7 @@ ps_lattice_delete_unreachable(ps_lattice_t *dag)
     ps_latnode_t *node, *prev_node, *next_node;
     int i;
 
+    ps_lattice_uncompile(dag);
     /* Remove unreachable nodes from the list of nodes. */
     prev_node = NULL;
     for (node = dag->nodes; node; node = next_node) {
@@ -384,20 +390,11 @@ dag_mark_reachable(ps_latnode_t * d)
             dag_mark_reachable(l->link->from);
 }
 
-ps_lattice_t *
-ps_lattice_read(ps_decoder_t *ps,
-                char const *file)
+/* Create an empty lattice to be read from a file. */
+static ps_lattice_t *
+lattice_init_read(ps_decoder_t *ps)
 {
-    FILE *fp;
-    int32 ispipe;
-    lineiter_t *line;
-    float64 lb;
-    float32 logratio;
-    ps_latnode_t **darray;
     ps_lattice_t *dag;
-    int i, k, n_nodes;
-    int32 pip, silpen, fillpen;
-    ps_latnode_t **pnodes;
 
     dag = ckd_calloc(1, sizeof(*dag));
 
@@ -418,6 +415,76 @@ ps_lattice_read(ps_decoder_t *ps,
     dag->latlink_list_alloc = listelem_alloc_init(sizeof(latlink_list_t));
     dag->refcount = 1;
 
+    return dag;
+}
+
+/* Find a word read from a lattice file, adding it to the dictionary
+ * if there is no decoder. */
+static int32
+lattice_read_wid(ps_lattice_t *dag, char const *wd)
+{
+    int32 w;
+
+    w = dict_wordid(dag->dict, wd);
+    if (w < 0 && dag->search == NULL) {
+        char *ww = ckd_salloc(wd);
+        if (dict_word2basestr(ww) != -1) {
+            if (dict_wordid(dag->dict, ww) == BAD_S3WID)
+                dict_add_word(dag->dict, ww, NULL, 0);
+        }
+        ckd_free(ww);
+        w = dict_add_word(dag->dict, wd, NULL, 0);
+    }
+    return w;
+}
+
+/* Clean up a lattice once all of its nodes and links are read. */
+static void
+lattice_read_finish(ps_lattice_t *dag)
+{
+    /* Minor hack: If the final node is a filler word and not </s>,
+     * then set its base word ID to </s>, so that the language model
+     * scores won't be screwed up. */
+    if (dict_filler_word(dag->dict, dag->end->wid))
+        dag->end->basewid = dag->search
+            ? ps_search_finish_wid(dag->search)
+            : dict_wordid(dag->dict, S3_FINISH_WORD);
+
+    /* Mark reachable from dag->end */
+    dag_mark_reachable(dag->end);
+
+    /* Free nodes unreachable from dag->end and their links */
+    ps_lattice_delete_unreachable(dag);
+}
+
+static int lattice_is_bin(char const *file);
+
+ps_lattice_t *
+ps_lattice_read(ps_decoder_t *ps,
+                char const *file)
+{
+    FILE *fp;
+    int32 ispipe;
+    lineiter_t *line;
+    float64 lb;
+    float32 logratio;
+    ps_latnode_t **darray;
+    ps_lattice_t *dag;
+    int i, k, n_nodes;
+    int32 pip, silpen, fillpen;
+    ps_latnode_t **pnodes;
+
+    if (lattice_is_bin(file)) {
+        ps_lattice_reader_t *reader;
+
+        if ((reader = ps_lattice_reader_open(ps, file)) == NULL)
+            return NULL;
+        dag = ps_lattice_reader_next(reader);
+        ps_lattice_reader_close(reader);
+        return dag;
+    }
+
+    dag = lattice_init_read(ps);
     darray = NULL;
 
     E_INFO("Reading DAG file: %s\n", file);
@@ -490,21 +557,9 @@ ps_lattice_read(ps_decoder_t *ps,
             goto load_error;
         }
 
-        w = dict_wordid(dag->dict, wd);
-        if (w < 0) {
-            if (dag->search == NULL) {
-                char *ww = ckd_salloc(wd);
-                if (dict_word2basestr(ww) != -1) {
-                    if (dict_wordid(dag->dict, ww) == BAD_S3WID)
-                        dict_add_word(dag->dict, ww, NULL, 0);
-                }
-                ckd_free(ww);
-                w = dict_add_word(dag->dict, wd, NULL, 0);
-            }
-            if (w < 0) {
-                E_ERROR("Unknown word in line: %s\n", line->buf);
-                goto load_error;
-            }
+        if ((w = lattice_read_wid(dag, wd)) < 0) {
+            E_ERROR("Unknown word in line: %s\n", line->buf);
+            goto load_error;
         }
 
         if (seqid != i) {
@@ -580,7 +635,8 @@ ps_lattice_read(ps_decoder_t *ps,
         if (logratio != 1.0f)
             /* FIXME: possible under/overflow!!! */
             ascr = (int32)(ascr * logratio);
-        ps_lattice_link(dag, pd, d, ascr, d->sf - 1);
+        /* Scores are written unscaled, see ps_lattice_write(). */
+        ps_lattice_link(dag, pd, d, ascr >> SENSCR_SHIFT, d->sf - 1);
     }
     if (strcmp(line->buf, "End\n") != 0) {
         E_ERROR("Terminating 'End' missing\n");
@@ -589,20 +645,7 @@ ps_lattice_read(ps_decoder_t *ps,
     lineiter_free(line);
     fclose_comp(fp, ispipe);
     ckd_free(darray);
-
-    /* Minor hack: If the final node is a filler word and not </s>,
-     * then set its base word ID to </s>, so that the language model
-     * scores won't be screwed up. */
-    if (dict_filler_word(dag->dict, dag->end->wid))
-        dag->end->basewid = dag->search
-            ? ps_search_finish_wid(dag->search)
-            : dict_wordid(dag->dict, S3_FINISH_WORD);
-
-    /* Mark reachable from dag->end */
-    dag_mark_reachable(dag->end);
-
-    /* Free nodes unreachable from dag->end and their links */
-    ps_lattice_delete_unreachable(dag);
+    lattice_read_finish(dag);
 
     if (ps) {
         /* Build links around silence and filler words, since they do
@@ -627,6 +670,585 @@ ps_lattice_read(ps_decoder_t *ps,
     return NULL;
 }
 
+#define LATTICE_BIN_MAGIC		"PSLATB"
+#define LATTICE_BIN_NATIVE_ENDIAN	0x4254414c /* 'LATB' in little-endian order */
+#define LATTICE_BIN_OTHER_ENDIAN	0x4c415442 /* 'BTAL' in little-endian order */
+#define LATTICE_BIN_FORMAT_VERSION	1
+
+static const char lattice_bin_format_desc[] =
+    "BEGIN FILE FORMAT DESCRIPTION\n"
+    "float64 logbase;    /**< Log base for scores */\n"
+    "struct {            /**< Any number of lattices */\n"
+    "    varint size;    /**< Size of the rest of this lattice */\n"
+    "    varint n_frames, n_words, n_nodes, n_links;\n"
+    "    varint start, end; /**< Initial and final nodes */\n"
+    "    char words[n_words][]; /**< Word strings (null-terminated) */\n"
+    "    struct {\n"
+    "        varint word;   /**< Index in words */\n"
+    "        zigzag sf;     /**< Start frame - previous start frame */\n"
+    "        zigzag fef;    /**< First end frame - start frame */\n"
+    "        zigzag lef;    /**< Last end frame - first end frame */\n"
+    "        varint n_exits;\n"
+    "        struct {\n"
+    "            zigzag to;   /**< Destination node - this node */\n"
+    "            zigzag ascr; /**< Acoustic score */\n"
+    "            zigzag ef;   /**< Destination start frame - 1 - end frame */\n"
+    "        } exits[n_exits];\n"
+    "    } nodes[n_nodes];\n"
+    "} lattices[];\n"
+    "END FILE FORMAT DESCRIPTION\n";
+
+/* Growable buffer for encoding lattices. */
+typedef struct latbuf_s {
+    uint8 *buf;
+    size_t len, alloc;
+} latbuf_t;
+
+static void
+latbuf_put(latbuf_t *lb, void const *data, size_t len)
+{
+    if (lb->len + len > lb->alloc) {
+        lb->alloc = (lb->len + len) * 2;
+        lb->buf = ckd_realloc(lb->buf, lb->alloc);
+    }
+    memcpy(lb->buf + lb->len, data, len);
+    lb->len += len;
+}
+
+static void
+latbuf_put_varint(latbuf_t *lb, uint32 val)
+{
+    uint8 bytes[5];
+    size_t n = 0;
+
+    while (val >= 0x80) {
+        bytes[n++] = (val & 0x7f) | 0x80;
+        val >>= 7;
+    }
+    bytes[n++] = val;
+    latbuf_put(lb, bytes, n);
+}
+
+static void
+latbuf_put_zigzag(latbuf_t *lb, int32 val)
+{
+    latbuf_put_varint(lb, ((uint32)val << 1) ^ (uint32)(val >> 31));
+}
+
+/* Decode a varint, returning -1 if it runs past end. */
+static int
+get_varint(uint8 const **ptr, uint8 const *end, uint32 *out_val)
+{
+    uint8 const *p = *ptr;
+    uint32 val = 0;
+    int shift;
+
+    for (shift = 0; p < end && shift < 35; shift += 7) {
+        val |= (uint32)(*p & 0x7f) << shift;
+        if ((*p++ & 0x80) == 0) {
+            *ptr = p;
+            *out_val = val;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int
+get_zigzag(uint8 const **ptr, uint8 const *end, int32 *out_val)
+{
+    uint32 val;
+
+    if (get_varint(ptr, end, &val) < 0)
+        return -1;
+    *out_val = (int32)(val >> 1) ^ -(int32)(val & 1);
+    return 0;
+}
+
+struct ps_lattice_writer_s {
+    FILE *fh;
+    char *filename;
+    float64 logbase;    /**< Log base of archive, or 0 if not yet written. */
+    latbuf_t lb;
+};
+
+struct ps_lattice_reader_s {
+    ps_decoder_t *ps;
+    char *filename;
+    mmio_file_t *filemap;
+    uint8 *filedata;    /**< File contents, if it could not be mapped. */
+    uint8 const *data;  /**< Start of file data. */
+    uint8 const *pos;   /**< Start of next lattice. */
+    uint8 const *end;   /**< End of file data. */
+    float32 logratio;   /**< Correction for log base of decoder. */
+};
+
+static int
+lattice_is_bin(char const *file)
+{
+    FILE *fh;
+    char magic[sizeof(LATTICE_BIN_MAGIC)];
+    int rv = FALSE;
+
+    if ((fh = fopen(file, "rb")) == NULL)
+        return FALSE;
+    if (fread(magic, 1, sizeof(magic), fh) == sizeof(magic)
+        && 0 == memcmp(magic, LATTICE_BIN_MAGIC, sizeof(magic)))
+        rv = TRUE;
+    fclose(fh);
+    return rv;
+}
+
+/* Read and check the header of an archive, returning its log base,
+ * or 0 on failure, and whether it is in the other byte order. */
+static float64
+lattice_bin_read_header(uint8 const **ptr, uint8 const *end,
+                        char const *filename, int *out_swap)
+{
+    uint8 const *p = *ptr;
+    int32 val;
+    float64 logbase;
+    uint8 bytes[8];
+    int swap, i;
+
+    if (end - p < (long)sizeof(LATTICE_BIN_MAGIC) + 12
+        || 0 != memcmp(p, LATTICE_BIN_MAGIC, sizeof(LATTICE_BIN_MAGIC))) {
+        E_ERROR("%s is not a binary lattice archive\n", filename);
+        return 0;
+    }
+    p += sizeof(LATTICE_BIN_MAGIC);
+    memcpy(&val, p, 4);
+    p += 4;
+    if (val == LATTICE_BIN_NATIVE_ENDIAN)
+        swap = FALSE;
+    else if (val == LATTICE_BIN_OTHER_ENDIAN)
+        swap = TRUE;
+    else {
+        E_ERROR("Unknown byte order marker 0x%08x in %s\n", val, filename);
+        return 0;
+    }
+    memcpy(&val, p, 4);
+    p += 4;
+    if (swap)
+        SWAP_INT32(&val);
+    if (val > LATTICE_BIN_FORMAT_VERSION) {
+        E_ERROR("File format version %d for %s is newer than library\n",
+                val, filename);
+        return 0;
+    }
+    memcpy(&val, p, 4);
+    p += 4;
+    if (swap)
+        SWAP_INT32(&val);
+    /* Skip format descriptor. */
+    if (val < 0 || end - p < (long)val + 8) {
+        E_ERROR("Binary lattice archive %s is truncated\n", filename);
+        return 0;
+    }
+    p += val;
+    memcpy(bytes, p, 8);
+    p += 8;
+    if (swap) {
+        for (i = 0; i < 4; ++i) {
+            uint8 tmp = bytes[i];
+            bytes[i] = bytes[7 - i];
+            bytes[7 - i] = tmp;
+        }
+    }
+    memcpy(&logbase, bytes, 8);
+    *ptr = p;
+    if (out_swap)
+        *out_swap = swap;
+    return logbase;
+}
+
+ps_lattice_writer_t *
+ps_lattice_writer_open(char const *filename, int append)
+{
+    ps_lattice_writer_t *writer;
+    FILE *fh;
+
+    writer = ckd_calloc(1, sizeof(*writer));
+    writer->filename = ckd_salloc(filename);
+    /* Find the log base of an existing archive. */
+    if (append && (fh = fopen(filename, "rb")) != NULL) {
+        uint8 hdr[sizeof(LATTICE_BIN_MAGIC) + 12 + sizeof(lattice_bin_format_desc) + 16];
+        size_t len = fread(hdr, 1, sizeof(hdr), fh);
+        uint8 const *p = hdr;
+        int swap;
+
+        fclose(fh);
+        if (len > 0
+            && (writer->logbase = lattice_bin_read_header(&p, hdr + len,
+                                                          filename,
+                                                          &swap)) == 0) {
+            ckd_free(writer->filename);
+            ckd_free(writer);
+            return NULL;
+        }
+        /* The lattices themselves are varints, but the fixed-width
+         * fields of the header are in host byte order, and only
+         * written once. */
+        if (len > 0 && swap) {
+            E_ERROR("Cannot append to %s, which has the other byte order\n",
+                    filename);
+            ckd_free(writer->filename);
+            ckd_free(writer);
+            return NULL;
+        }
+    }
+    if ((writer->fh = fopen(filename, append ? "ab" : "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open lattice archive '%s' for writing",
+                       filename);
+        ckd_free(writer->filename);
+        ckd_free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int
+ps_lattice_writer_add(ps_lattice_writer_t *writer, ps_lattice_t *dag)
+{
+    latbuf_t *lb = &writer->lb;
+    hash_table_t *words;
+    ps_latnode_t *d;
+    int32 n_nodes, n_links, n_words, prev_sf;
+    uint8 sizebuf[5];
+    size_t hdrlen;
+    float64 logbase;
+
+    logbase = logmath_get_base(dag->lmath);
+    if (writer->logbase == 0) {
+        int32 endian = LATTICE_BIN_NATIVE_ENDIAN;
+        int32 version = LATTICE_BIN_FORMAT_VERSION;
+        int32 desclen = sizeof(lattice_bin_format_desc);
+
+        /* New archive, write the header. */
+        if (fwrite(LATTICE_BIN_MAGIC, 1, sizeof(LATTICE_BIN_MAGIC),
+                   writer->fh) != sizeof(LATTICE_BIN_MAGIC)
+            || fwrite(&endian, 4, 1, writer->fh) != 1
+            || fwrite(&version, 4, 1, writer->fh) != 1
+            || fwrite(&desclen, 4, 1, writer->fh) != 1
+            || fwrite(lattice_bin_format_desc, 1, desclen,
+                      writer->fh) != (size_t)desclen
+            || fwrite(&logbase, 8, 1, writer->fh) != 1) {
+            E_ERROR_SYSTEM("Failed to write header to %s", writer->filename);
+            return -1;
+        }
+        writer->logbase = logbase;
+    }
+    else if (fabs(logbase - writer->logbase) >= 0.0001) {
+        E_ERROR("Log base %f of lattice does not match %f in %s\n",
+                logbase, writer->logbase, writer->filename);
+        return -1;
+    }
+
+    /* Number nodes and words and count links. */
+    words = hash_table_new(256, HASH_CASE_YES);
+    n_nodes = n_links = n_words = 0;
+    for (d = dag->nodes; d; d = d->next) {
+        latlink_list_t *x;
+        const char *word = dict_wordstr(dag->dict, d->wid);
+        if (word == NULL)
+            word = "(null)";
+        /* This returns the existing index for words already seen. */
+        if (hash_table_enter_int32(words, word, n_words) == n_words)
+            ++n_words;
+        d->id = n_nodes++;
+        for (x = d->exits; x; x = x->next)
+            ++n_links;
+    }
+
+    /* Encode the lattice. */
+    lb->len = 0;
+    latbuf_put_varint(lb, dag->n_frames);
+    latbuf_put_varint(lb, n_words);
+    latbuf_put_varint(lb, n_nodes);
+    latbuf_put_varint(lb, n_links);
+    latbuf_put_varint(lb, dag->start->id);
+    latbuf_put_varint(lb, dag->end->id);
+    n_words = 0;
+    for (d = dag->nodes; d; d = d->next) {
+        const char *word = dict_wordstr(dag->dict, d->wid);
+        int32 wordidx;
+        if (word == NULL)
+            word = "(null)";
+        hash_table_lookup_int32(words, word, &wordidx);
+        if (wordidx == n_words) {
+            latbuf_put(lb, word, strlen(word) + 1);
+            ++n_words;
+        }
+    }
+    prev_sf = 0;
+    for (d = dag->nodes; d; d = d->next) {
+        const char *word = dict_wordstr(dag->dict, d->wid);
+        latlink_list_t *x;
+        ps_latlink_t **exits;
+        int32 wordidx, n_exits;
+
+        if (word == NULL)
+            word = "(null)";
+        hash_table_lookup_int32(words, word, &wordidx);
+        latbuf_put_varint(lb, wordidx);
+        latbuf_put_zigzag(lb, d->sf - prev_sf);
+        latbuf_put_zigzag(lb, d->fef - d->sf);
+        latbuf_put_zigzag(lb, d->lef - d->fef);
+        prev_sf = d->sf;
+        for (n_exits = 0, x = d->exits; x; x = x->next)
+            ++n_exits;
+        latbuf_put_varint(lb, n_exits);
+        /* Write them backwards, since they get read back backwards. */
+        exits = ckd_calloc(n_exits, sizeof(*exits));
+        for (n_exits = 0, x = d->exits; x; x = x->next)
+            exits[n_exits++] = x->link;
+        while (n_exits-- > 0) {
+            ps_latlink_t *link = exits[n_exits];
+            latbuf_put_zigzag(lb, link->to->id - d->id);
+            latbuf_put_zigzag(lb, link->ascr);
+            latbuf_put_zigzag(lb, link->to->sf - 1 - link->ef);
+        }
+        ckd_free(exits);
+    }
+    hash_table_free(words);
+
+    /* Now write it, preceded by its size. */
+    hdrlen = 0;
+    {
+        uint32 val = lb->len;
+        while (val >= 0x80) {
+            sizebuf[hdrlen++] = (val & 0x7f) | 0x80;
+            val >>= 7;
+        }
+        sizebuf[hdrlen++] = val;
+    }
+    if (fwrite(sizebuf, 1, hdrlen, writer->fh) != hdrlen
+        || fwrite(lb->buf, 1, lb->len, writer->fh) != lb->len) {
+        E_ERROR_SYSTEM("Failed to write lattice to %s", writer->filename);
+        return -1;
+    }
+    return 0;
+}
+
+int
+ps_lattice_writer_close(ps_lattice_writer_t *writer)
+{
+    int rv = 0;
+
+    if (writer == NULL)
+        return 0;
+    if (fclose(writer->fh) != 0) {
+        E_ERROR_SYSTEM("Failed to write lattice archive %s", writer->filename);
+        rv = -1;
+    }
+    ckd_free(writer->lb.buf);
+    ckd_free(writer->filename);
+    ckd_free(writer);
+    return rv;
+}
+
+int32
+ps_lattice_write_bin(ps_lattice_t *dag, char const *filename)
+{
+    ps_lattice_writer_t *writer;
+
+    E_INFO("Writing lattice file: %s\n", filename);
+    if ((writer = ps_lattice_writer_open(filename, FALSE)) == NULL)
+        return -1;
+    if (ps_lattice_writer_add(writer, dag) < 0) {
+        ps_lattice_writer_close(writer);
+        return -1;
+    }
+    return ps_lattice_writer_close(writer);
+}
+
+ps_lattice_reader_t *
+ps_lattice_reader_open(ps_decoder_t *ps, char const *filename)
+{
+    ps_lattice_reader_t *reader;
+    FILE *fh;
+    long size;
+    float64 logbase;
+
+    E_INFO("Reading lattice archive: %s\n", filename);
+    if ((fh = fopen(filename, "rb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open lattice archive '%s' for reading",
+                       filename);
+        return NULL;
+    }
+    fseek(fh, 0, SEEK_END);
+    size = ftell(fh);
+    fseek(fh, 0, SEEK_SET);
+
+    reader = ckd_calloc(1, sizeof(*reader));
+    reader->ps = ps;
+    reader->filename = ckd_salloc(filename);
+    if (size > 0 && (reader->filemap = mmio_file_read(filename)) != NULL)
+        reader->data = mmio_file_ptr(reader->filemap);
+    else {
+        reader->filedata = ckd_malloc(size + 1);
+        if (fread(reader->filedata, 1, size, fh) != (size_t)size) {
+            E_ERROR_SYSTEM("Failed to read %ld bytes from %s", size, filename);
+            fclose(fh);
+            ps_lattice_reader_close(reader);
+            return NULL;
+        }
+        reader->data = reader->filedata;
+    }
+    fclose(fh);
+    reader->pos = reader->data;
+    reader->end = reader->data + size;
+
+    if ((logbase = lattice_bin_read_header(&reader->pos, reader->end,
+                                           filename, NULL)) == 0) {
+        ps_lattice_reader_close(reader);
+        return NULL;
+    }
+    reader->logratio = 1.0f;
+    if (ps) {
+        float64 pb = logmath_get_base(ps->lmath);
+        if (fabs(logbase - pb) >= 0.0001) {
+            E_WARN("Inconsistent logbases: %f vs %f: will compensate\n",
+                   logbase, pb);
+            reader->logratio = (float32)(log(logbase) / log(pb));
+        }
+    }
+    else if (fabs(logbase - 1.0001) >= 0.0001) {
+        /* The lattice will use a logmath with base 1.0001. */
+        reader->logratio = (float32)(log(logbase) / log(1.0001));
+    }
+    return reader;
+}
+
+ps_lattice_t *
+ps_lattice_reader_next(ps_lattice_reader_t *reader)
+{
+    ps_lattice_t *dag;
+    ps_latnode_t **darray, **pnodes;
+    int32 *wids;
+    uint8 const *p, *end;
+    uint32 size, n_words, n_nodes, n_links, start, final, i;
+    int32 sf;
+
+    if (reader->pos >= reader->end)
+        return NULL;
+    p = reader->pos;
+    if (get_varint(&p, reader->end, &size) < 0
+        || size > (uint32)(reader->end - p)) {
+        E_ERROR("Binary lattice archive %s is truncated\n", reader->filename);
+        reader->pos = reader->end;
+        return NULL;
+    }
+    end = p + size;
+    reader->pos = end;
+
+    dag = lattice_init_read(reader->ps);
+    darray = NULL;
+    wids = NULL;
+    if (get_varint(&p, end, &i) < 0
+        || get_varint(&p, end, &n_words) < 0
+        || get_varint(&p, end, &n_nodes) < 0
+        || get_varint(&p, end, &n_links) < 0
+        || get_varint(&p, end, &start) < 0
+        || get_varint(&p, end, &final) < 0)
+        goto load_error;
+    dag->n_frames = i;
+    if (n_nodes == 0 || start >= n_nodes || final >= n_nodes
+        || n_words > size || n_nodes > size)
+        goto load_error;
+
+    /* Look up all the words. */
+    wids = ckd_calloc(n_words, sizeof(*wids));
+    for (i = 0; i < n_words; ++i) {
+        uint8 const *nul = memchr(p, 0, end - p);
+        if (nul == NULL)
+            goto load_error;
+        if ((wids[i] = lattice_read_wid(dag, (char const *)p)) < 0) {
+            E_ERROR("Unknown word %s in %s\n", p, reader->filename);
+            goto load_error;
+        }
+        p = nul + 1;
+    }
+
+    /* Create all the nodes, then go back and read their links. */
+    darray = ckd_calloc(n_nodes, sizeof(*darray));
+    pnodes = &dag->nodes;
+    for (i = 0; i < n_nodes; ++i) {
+        ps_latnode_t *node = listelem_malloc(dag->latnode_alloc);
+        memset(node, 0, sizeof(*node));
+        node->id = i;
+        *pnodes = darray[i] = node;
+        pnodes = &node->next;
+    }
+    dag->start = darray[start];
+    dag->end = darray[final];
+    sf = 0;
+    for (i = 0; i < n_nodes; ++i) {
+        ps_latnode_t *node = darray[i];
+        uint32 wordidx, n_exits;
+        int32 fef, lef;
+
+        if (get_varint(&p, end, &wordidx) < 0 || wordidx >= n_words
+            || get_zigzag(&p, end, &fef) < 0)
+            goto load_error;
+        sf += fef;
+        if (get_zigzag(&p, end, &fef) < 0
+            || get_zigzag(&p, end, &lef) < 0
+            || get_varint(&p, end, &n_exits) < 0)
+            goto load_error;
+        node->wid = wids[wordidx];
+        node->basewid = dict_basewid(dag->dict, node->wid);
+        node->sf = sf;
+        node->fef = sf + fef;
+        node->lef = node->fef + lef;
+        while (n_exits-- > 0) {
+            int32 to, ascr, ef;
+
+            if (get_zigzag(&p, end, &to) < 0
+                || get_zigzag(&p, end, &ascr) < 0
+                || get_zigzag(&p, end, &ef) < 0)
+                goto load_error;
+            to += i;
+            if (to < 0 || (uint32)to >= n_nodes)
+                goto load_error;
+            if (reader->logratio != 1.0f)
+                ascr = (int32)(ascr * reader->logratio);
+            /* Nodes after this one have no start frame yet, so
+             * temporarily store the offset in ef. */
+            ps_lattice_link(dag, node, darray[to], ascr, ef);
+        }
+    }
+    /* Now fix up the end frames. */
+    for (i = 0; i < n_nodes; ++i) {
+        latlink_list_t *x;
+        for (x = darray[i]->exits; x; x = x->next)
+            x->link->ef = x->link->to->sf - 1 - x->link->ef;
+    }
+    ckd_free(wids);
+    ckd_free(darray);
+    lattice_read_finish(dag);
+    return dag;
+
+load_error:
+    E_ERROR("Corrupt lattice in %s\n", reader->filename);
+    ckd_free(wids);
+    ckd_free(darray);
+    ps_lattice_free(dag);
+    return NULL;
+}
+
+void
+ps_lattice_reader_close(ps_lattice_reader_t *reader)
+{
+    if (reader == NULL)
+        return;
+    if (reader->filemap)
+        mmio_file_unmap(reader->filemap);
+    ckd_free(reader->filedata);
+    ckd_free(reader->filename);
+    ckd_free(reader);
+}
+
 int
 ps_lattice_n_frames(ps_lattice_t *dag)
 {
@@ -671,6 +1293,7 @@ ps_lattice_free(ps_lattice_t *dag)
     listelem_alloc_free(dag->latnode_alloc);
     listelem_alloc_free(dag->latlink_alloc);
     listelem_alloc_free(dag->latlink_list_alloc);    
+    ps_lattice_uncompile(dag);
     ckd_free(dag->hyp_str);
     ckd_free(dag);
     return 0;
@@ -1051,6 +1674,108 @@ latlink_list_new(ps_lattice_t *dag, ps_latlink_t *link, latlink_list_t *next)
     return ll;
 }
 
+/*
+ * Sort nodes in dag->node_list topologically, for graphs where links
+ * may not go forward in time.  Nodes on cycles (which should not
+ * exist) go at the end.
+ */
+static void
+ps_lattice_sort_topological(ps_lattice_t *dag)
+{
+    ps_latnode_t **sorted;
+    latlink_list_t *x;
+    int32 i, head, tail;
+
+    sorted = ckd_calloc(dag->n_node_list, sizeof(*sorted));
+    for (i = 0; i < dag->n_node_list; ++i)
+        dag->node_list[i]->info.fanin = 0;
+    for (i = 0; i < dag->n_node_list; ++i)
+        for (x = dag->node_list[i]->exits; x; x = x->next)
+            ++x->link->to->info.fanin;
+    head = tail = 0;
+    for (i = 0; i < dag->n_node_list; ++i)
+        if (dag->node_list[i]->info.fanin == 0)
+            sorted[tail++] = dag->node_list[i];
+    while (head < tail) {
+        for (x = sorted[head++]->exits; x; x = x->next)
+            if (--x->link->to->info.fanin == 0)
+                sorted[tail++] = x->link->to;
+    }
+    for (i = 0; tail < dag->n_node_list && i < dag->n_node_list; ++i)
+        if (dag->node_list[i]->info.fanin > 0)
+            sorted[tail++] = dag->node_list[i];
+    ckd_free(dag->node_list);
+    dag->node_list = sorted;
+}
+
+void
+ps_lattice_compile(ps_lattice_t *dag)
+{
+    ps_latnode_t *node;
+    latlink_list_t *x;
+    int32 *sf_idx;
+    int32 i, n_links, max_sf;
+
+    if (dag->node_list)
+        return;
+
+    /* Count nodes and links. */
+    dag->n_node_list = n_links = max_sf = 0;
+    for (node = dag->nodes; node; node = node->next) {
+        ++dag->n_node_list;
+        if (node->sf > max_sf)
+            max_sf = node->sf;
+        for (x = node->exits; x; x = x->next)
+            ++n_links;
+    }
+
+    /* Sort nodes by start frame (stably, with a counting sort). */
+    dag->node_list = ckd_calloc(dag->n_node_list + 1,
+                                sizeof(*dag->node_list));
+    sf_idx = ckd_calloc(max_sf + 2, sizeof(*sf_idx));
+    for (node = dag->nodes; node; node = node->next)
+        ++sf_idx[node->sf + 1];
+    for (i = 1; i <= max_sf; ++i)
+        sf_idx[i] += sf_idx[i - 1];
+    for (node = dag->nodes; node; node = node->next)
+        dag->node_list[sf_idx[node->sf]++] = node;
+    ckd_free(sf_idx);
+
+    /* Since every word takes at least one frame, this is a
+     * topological order, unless the graph came from elsewhere. */
+    for (i = 0; i < dag->n_node_list; ++i) {
+        node = dag->node_list[i];
+        for (x = node->exits; x; x = x->next)
+            if (x->link->to->sf <= node->sf)
+                break;
+        if (x) {
+            ps_lattice_sort_topological(dag);
+            break;
+        }
+    }
+
+    /* Now store the exits of each node contiguously. */
+    dag->link_list = ckd_calloc(n_links + 1, sizeof(*dag->link_list));
+    dag->n_link_list = 0;
+    for (i = 0; i < dag->n_node_list; ++i) {
+        node = dag->node_list[i];
+        node->first_exit = dag->n_link_list;
+        for (x = node->exits; x; x = x->next)
+            dag->link_list[dag->n_link_list++] = x->link;
+        node->n_exits = dag->n_link_list - node->first_exit;
+    }
+}
+
+void
+ps_lattice_uncompile(ps_lattice_t *dag)
+{
+    ckd_free(dag->node_list);
+    ckd_free(dag->link_list);
+    dag->node_list = NULL;
+    dag->link_list = NULL;
+    dag->n_node_list = dag->n_link_list = 0;
+}
+
 void
 ps_lattice_pushq(ps_lattice_t *dag, ps_latlink_t *link)
 {
@@ -1217,12 +1942,11 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
                     float32 lwf, float32 ascale)
 {
     ps_search_t *search;
-    ps_latnode_t *node;
     ps_latlink_t *link;
     ps_latlink_t *bestend;
     latlink_list_t *x;
     logmath_t *lmath;
-    int32 bestescr;
+    int32 bestescr, i;
 
     search = dag->search;
     lmath = dag->lmath;
@@ -1230,11 +1954,10 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
     /* Initialize path scores for all links exiting dag->start, and
      * set all other scores to the minimum.  Also initialize alphas to
      * log-zero. */
-    for (node = dag->nodes; node; node = node->next) {
-        for (x = node->exits; x; x = x->next) {
-            x->link->path_scr = MAX_NEG_INT32;
-            x->link->alpha = logmath_get_zero(lmath);
-        }
+    ps_lattice_compile(dag);
+    for (i = 0; i < dag->n_link_list; ++i) {
+        dag->link_list[i]->path_scr = MAX_NEG_INT32;
+        dag->link_list[i]->alpha = logmath_get_zero(lmath);
     }
     for (x = dag->start->exits; x; x = x->next) {
         int32 n_used;
@@ -1252,17 +1975,20 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
         x->link->alpha = 0;
     }
 
-    /* Traverse the edges in the graph, updating path scores. */
-    for (link = ps_lattice_traverse_edges(dag, NULL, NULL);
-         link; link = ps_lattice_traverse_next(dag, NULL)) {
+    /* Sweep over the edges in topological order, updating path
+     * scores. */
+    for (i = 0; i < dag->n_link_list; ++i) {
         int32 bprob, n_used;
         int32 w3_wid, w2_wid;
         int16 w3_is_fil, w2_is_fil;
-        ps_latlink_t *prev_link;
+        ps_latlink_t *prev_link, **exits;
+        int32 j;
 
-        /* Sanity check, we should not be traversing edges that
-         * weren't previously updated, otherwise nasty overflows will result. */
-        assert(link->path_scr != MAX_NEG_INT32);
+        /* Skip edges which are not reachable from dag->start,
+         * otherwise nasty overflows will result. */
+        link = dag->link_list[i];
+        if (link->path_scr == MAX_NEG_INT32)
+            continue;
 
         /* Find word predecessor if from-word is filler */
         w3_wid = link->from->basewid;
@@ -1306,19 +2032,21 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
         }
 
         /* Update scores for all paths exiting link->to. */
-        for (x = link->to->exits; x; x = x->next) {
+        exits = dag->link_list + link->to->first_exit;
+        for (j = 0; j < link->to->n_exits; ++j) {
+            ps_latlink_t *next = exits[j];
             int32 score;
             int32 w1_wid;
             int16 w1_is_fil;
 
-            w1_wid = x->link->to->basewid;
-            w1_is_fil = dict_filler_word(ps_search_dict(search), w1_wid) && x->link->to != dag->end;
+            w1_wid = next->to->basewid;
+            w1_is_fil = dict_filler_word(ps_search_dict(search), w1_wid) && next->to != dag->end;
 
             /* Update alpha with sum of previous alphas. */
-            x->link->alpha = logmath_add(lmath, x->link->alpha, link->alpha + bprob);
+            next->alpha = logmath_add(lmath, next->alpha, link->alpha + bprob);
 
             /* Update link score with maximum link score. */
-            score = link->path_scr + x->link->ascr;
+            score = link->path_scr + next->ascr;
             /* Calculate language score for bestpath if possible */
             if (lmset && !w1_is_fil && !w2_is_fil) {
                 if (w3_is_fil)
@@ -1329,9 +2057,9 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
                     score += (ngram_tg_score(lmset, w1_wid, w2_wid, w3_wid, &n_used) >> SENSCR_SHIFT) * lwf;
             }
 
-            if (score BETTER_THAN x->link->path_scr) {
-                x->link->path_scr = score;
-                x->link->best_prev = link;
+            if (score BETTER_THAN next->path_scr) {
+                next->path_scr = score;
+                next->best_prev = link;
             }
         }
     }
@@ -1387,6 +2115,184 @@ ps_lattice_bestpath(ps_lattice_t *dag, ngram_model_t *lmset,
     return bestend;
 }
 
+/**
+ * Partial path used in ps_lattice_rescore(), one for each distinct
+ * language model history reaching a node.  The node and history
+ * together are its key in a hash table, so they must be contiguous.
+ */
+typedef struct rescore_path_s {
+    struct rescore_path_s *prev; /**< Previous partial path. */
+    ps_latlink_t *link;          /**< Link into node, NULL at the start. */
+    int32 score;                 /**< Best score up to this node. */
+    ps_latnode_t *node;          /**< Node where this path ends. */
+    int32 hist[NGRAM_MAX_ORDER]; /**< History, most recent word first. */
+} rescore_path_t;
+
+static int
+rescore_path_cmp(const void *a, const void *b)
+{
+    rescore_path_t const *pa = *(rescore_path_t const **)a;
+    rescore_path_t const *pb = *(rescore_path_t const **)b;
+
+    if (pa->score == pb->score)
+        return 0;
+    return pa->score > pb->score ? -1 : 1;
+}
+
+/* Keep only the best maxhist paths at a node. */
+static void
+rescore_prune(ps_latnode_t *node, int32 maxhist)
+{
+    rescore_path_t **paths;
+    gnode_t *gn;
+    int32 i, n_paths;
+
+    n_paths = glist_count(node->info.velist);
+    if (n_paths <= maxhist)
+        return;
+    paths = ckd_calloc(n_paths, sizeof(*paths));
+    for (i = 0, gn = node->info.velist; gn; gn = gnode_next(gn))
+        paths[i++] = gnode_ptr(gn);
+    qsort(paths, n_paths, sizeof(*paths), rescore_path_cmp);
+    glist_free(node->info.velist);
+    node->info.velist = NULL;
+    for (i = maxhist - 1; i >= 0; --i)
+        node->info.velist = glist_add_ptr(node->info.velist, paths[i]);
+    ckd_free(paths);
+}
+
+ps_latlink_t *
+ps_lattice_rescore(ps_lattice_t *dag, ngram_model_t *lm,
+                   float32 lwf, int32 maxhist)
+{
+    listelem_alloc_t *path_alloc;
+    hash_table_t *pathtab;
+    rescore_path_t *path, *best;
+    ps_latlink_t *link;
+    gnode_t *gn;
+    int32 *lmwid;
+    int32 n_hist, keylen, n_paths, i, j;
+
+    n_hist = ngram_model_get_size(lm) - 1;
+    keylen = sizeof(path->node) + n_hist * sizeof(*path->hist);
+
+    /* Map words to the language model by name. */
+    ps_lattice_compile(dag);
+    lmwid = ckd_calloc(dict_size(dag->dict), sizeof(*lmwid));
+    for (i = 0; i < dag->n_node_list; ++i) {
+        ps_latnode_t *node = dag->node_list[i];
+        lmwid[node->basewid] = ngram_wid(lm, dict_basestr(dag->dict,
+                                                          node->basewid));
+        node->info.velist = NULL;
+    }
+
+    /* Start with a single path with a history of <s>. */
+    path_alloc = listelem_alloc_init(sizeof(rescore_path_t));
+    pathtab = hash_table_new(dag->n_node_list * 4, HASH_CASE_YES);
+    path = listelem_malloc(path_alloc);
+    memset(path, 0, sizeof(*path));
+    path->node = dag->start;
+    for (j = 0; j < n_hist; ++j)
+        path->hist[j] = NGRAM_INVALID_WID;
+    if (n_hist > 0)
+        path->hist[0] = lmwid[dag->start->basewid];
+    dag->start->info.velist = glist_add_ptr(NULL, path);
+    n_paths = 1;
+
+    /* Extend paths over the nodes in topological order.  By the time
+     * we reach a node, all paths into it are known. */
+    for (i = 0; i < dag->n_node_list; ++i) {
+        ps_latnode_t *from = dag->node_list[i];
+        ps_latlink_t **exits = dag->link_list + from->first_exit;
+
+        if (maxhist > 0)
+            rescore_prune(from, maxhist);
+        for (gn = from->info.velist; gn; gn = gnode_next(gn)) {
+            rescore_path_t *prev = gnode_ptr(gn);
+
+            for (j = 0; j < from->n_exits; ++j) {
+                rescore_path_t *newpath, *oldpath;
+                ps_latnode_t *to = exits[j]->to;
+                int32 score;
+
+                newpath = listelem_malloc(path_alloc);
+                memcpy(newpath, prev, sizeof(*newpath));
+                newpath->prev = prev;
+                newpath->link = exits[j];
+                newpath->node = to;
+                score = prev->score + exits[j]->ascr;
+                /* Fillers get no language model score and do not
+                 * change the history. */
+                if (to == dag->end
+                    || !dict_filler_word(dag->dict, to->basewid)) {
+                    int32 wid = lmwid[to->basewid];
+                    int32 n_used, len;
+
+                    for (len = 0; len < n_hist; ++len)
+                        if (prev->hist[len] == NGRAM_INVALID_WID)
+                            break;
+                    score += (ngram_ng_score(lm, wid, prev->hist,
+                                             len, &n_used)
+                              >> SENSCR_SHIFT) * lwf;
+                    if (n_hist > 0) {
+                        memmove(newpath->hist + 1, prev->hist,
+                                (n_hist - 1) * sizeof(*newpath->hist));
+                        newpath->hist[0] = wid;
+                    }
+                }
+                newpath->score = score;
+
+                /* Recombine with any path with the same history. */
+                oldpath = hash_table_enter_bkey(pathtab,
+                                                (char const *)&newpath->node,
+                                                keylen, newpath);
+                if (oldpath != newpath) {
+                    if (newpath->score BETTER_THAN oldpath->score) {
+                        oldpath->score = newpath->score;
+                        oldpath->prev = newpath->prev;
+                        oldpath->link = newpath->link;
+                    }
+                    listelem_free(path_alloc, newpath);
+                }
+                else {
+                    to->info.velist = glist_add_ptr(to->info.velist, newpath);
+                    ++n_paths;
+                }
+            }
+        }
+    }
+
+    /* Find the best complete path. */
+    best = NULL;
+    for (gn = dag->end->info.velist; gn; gn = gnode_next(gn)) {
+        path = gnode_ptr(gn);
+        if (best == NULL || path->score BETTER_THAN best->score)
+            best = path;
+    }
+    link = NULL;
+    if (best == NULL)
+        E_ERROR("No path found to the end of the lattice\n");
+    else {
+        E_INFO("Rescored %d nodes with %d histories, best score %d\n",
+               dag->n_node_list, n_paths, best->score);
+        /* Store the best path in the lattice. */
+        link = best->link;
+        for (path = best; path->link; path = path->prev) {
+            path->link->path_scr = path->score;
+            path->link->best_prev = path->prev->link;
+        }
+    }
+
+    for (i = 0; i < dag->n_node_list; ++i) {
+        glist_free(dag->node_list[i]->info.velist);
+        dag->node_list[i]->info.velist = NULL;
+    }
+    hash_table_free(pathtab);
+    listelem_alloc_free(path_alloc);
+    ckd_free(lmwid);
+    return link;
+}
+
 static int32
 ps_lattice_joint(ps_lattice_t *dag, ps_latlink_t *link, float32 ascale)
 {
@@ -1449,29 +2355,30 @@ ps_lattice_posterior(ps_lattice_t *dag, ngram_model_t *lmset,
                      float32 ascale)
 {
     logmath_t *lmath;
-    ps_latnode_t *node;
     ps_latlink_t *link;
-    latlink_list_t *x;
     ps_latlink_t *bestend;
-    int32 bestescr;
+    int32 bestescr, zero, i;
 
     lmath = dag->lmath;
+    zero = logmath_get_zero(lmath);
 
     /* Reset all betas to zero. */
-    for (node = dag->nodes; node; node = node->next) {
-        for (x = node->exits; x; x = x->next) {
-            x->link->beta = logmath_get_zero(lmath);
-        }
-    }
+    ps_lattice_compile(dag);
+    for (i = 0; i < dag->n_link_list; ++i)
+        dag->link_list[i]->beta = zero;
 
     bestend = NULL;
     bestescr = MAX_NEG_INT32;
-    /* Accumulate backward probabilities for all links. */
-    for (link = ps_lattice_reverse_edges(dag, NULL, NULL);
-         link; link = ps_lattice_reverse_next(dag, NULL)) {
+    /* Accumulate backward probabilities for all links, sweeping
+     * backwards over them in topological order. */
+    for (i = dag->n_link_list - 1; i >= 0; --i) {
         int32 bprob, n_used;
         int32 from_wid, to_wid;
         int16 from_is_fil, to_is_fil;
+        ps_latlink_t **exits;
+        int32 j;
+
+        link = dag->link_list[i];
 
         from_wid = link->from->basewid;
         to_wid = link->to->basewid;
@@ -1509,11 +2416,15 @@ ps_lattice_posterior(ps_lattice_t *dag, ngram_model_t *lmset,
             link->beta = bprob + (int32)((dag->final_node_ascr << SENSCR_SHIFT) * ascale);
         }
         else {
-            /* Update beta from all outgoing betas. */
-            for (x = link->to->exits; x; x = x->next) {
+            /* Update beta from all outgoing betas, skipping those
+             * which do not reach dag->end. */
+            exits = dag->link_list + link->to->first_exit;
+            for (j = 0; j < link->to->n_exits; ++j) {
+                if (exits[j]->beta == zero)
+                    continue;
                 link->beta = logmath_add(lmath, link->beta,
-                                         x->link->beta + bprob
-                                         + (int)((x->link->ascr << SENSCR_SHIFT) * ascale));
+                                         exits[j]->beta + bprob
+                                         + (int)((exits[j]->ascr << SENSCR_SHIFT) * ascale));
             }
         }
     }
@@ -1528,6 +2439,7 @@ ps_lattice_posterior_prune(ps_lattice_t *dag, int32 beam)
     ps_latlink_t *link;
     int npruned = 0;
 
+    ps_lattice_uncompile(dag);
     for (link = ps_lattice_traverse_edges(dag, dag->start, dag->end);
          link; link = ps_lattice_traverse_next(dag, dag->end)) {
         link->from->reachable = FALSE;
@@ -1567,91 +2479,366 @@ ps_lattice_posterior_prune(ps_lattice_t *dag, int32 beam)
 }
 
 
+/* Score of a link for beam pruning: acoustic score and bigram,
+ * except where fillers are involved. */
+static int32
+link_beam_score(ps_lattice_t *dag, ps_latlink_t *link,
+                ngram_model_t *lmset, float32 lwf)
+{
+    int32 score, n_used;
+
+    score = link->ascr;
+    if (lmset
+        && !(dict_filler_word(dag->dict, link->from->basewid)
+             && link->from != dag->start)
+        && !(dict_filler_word(dag->dict, link->to->basewid)
+             && link->to != dag->end))
+        score += (ngram_bg_score(lmset, link->to->basewid,
+                                 link->from->basewid, &n_used)
+                  >> SENSCR_SHIFT) * lwf;
+    return score;
+}
+
+static int
+compare_beam_scores(const void *a, const void *b)
+{
+    int32 sa = *(const int32 *)a, sb = *(const int32 *)b;
+    /* Best first. */
+    return (sa > sb) ? -1 : (sa < sb);
+}
+
+int32
+ps_lattice_beam_prune(ps_lattice_t *dag, ngram_model_t *lmset,
+                      float32 lwf, int32 beam, float32 density)
+{
+    ps_latnode_t *node;
+    int32 i, j, best, thresh, n_links, npruned;
+
+    /* Forward pass: best score of a path from dag->start through each
+     * link, which goes in link->path_scr.  Links which are on no
+     * complete path (such as those leaving dag->end) are never given
+     * an alpha below, so clear them all first. */
+    ps_lattice_compile(dag);
+    for (i = 0; i < dag->n_link_list; ++i)
+        dag->link_list[i]->alpha = WORST_SCORE;
+    for (i = 0; i < dag->n_node_list; ++i) {
+        ps_latlink_t **exits;
+        latlink_list_t *x;
+        int32 score;
+
+        node = dag->node_list[i];
+        if (node == dag->start)
+            score = 0;
+        else {
+            score = WORST_SCORE;
+            for (x = node->entries; x; x = x->next)
+                if (x->link->path_scr BETTER_THAN score)
+                    score = x->link->path_scr;
+        }
+        exits = dag->link_list + node->first_exit;
+        for (j = 0; j < node->n_exits; ++j)
+            exits[j]->path_scr = (score == WORST_SCORE)
+                ? WORST_SCORE : score + link_beam_score(dag, exits[j], lmset, lwf);
+    }
+    /* Backward pass: best score from each node to dag->end, as in
+     * best_rem_score() below.  The best path through each link then
+     * goes in link->alpha. */
+    for (i = dag->n_node_list - 1; i >= 0; --i) {
+        ps_latlink_t **exits;
+        int32 bestscore;
+
+        node = dag->node_list[i];
+        if (node == dag->end) {
+            node->info.rem_score = 0;
+            continue;
+        }
+        bestscore = WORST_SCORE;
+        exits = dag->link_list + node->first_exit;
+        for (j = 0; j < node->n_exits; ++j) {
+            ps_latlink_t *link = exits[j];
+            int32 score;
+
+            if (link->to->info.rem_score == WORST_SCORE
+                || link->path_scr == WORST_SCORE) {
+                link->alpha = WORST_SCORE;
+                continue;
+            }
+            score = link->to->info.rem_score + link_beam_score(dag, link, lmset, lwf);
+            if (score BETTER_THAN bestscore)
+                bestscore = score;
+            link->alpha = link->path_scr + link->to->info.rem_score;
+        }
+        node->info.rem_score = bestscore;
+    }
+    best = dag->start->info.rem_score;
+    if (best == WORST_SCORE) {
+        E_ERROR("No path from start to end of lattice, cannot prune\n");
+        return -1;
+    }
+
+    /* Find the threshold from the beam and density.  With no beam,
+     * only links on no complete path fall outside it. */
+    if (beam <= logmath_get_zero(dag->lmath))
+        thresh = WORST_SCORE + 1;
+    else
+        thresh = best + (beam >> SENSCR_SHIFT);
+    n_links = dag->n_link_list;
+    if (density > 0 && n_links > density * dag->n_frames) {
+        int32 *scores, n_keep;
+
+        n_keep = (int32)(density * dag->n_frames);
+        if (n_keep < 1)
+            n_keep = 1;
+        scores = ckd_calloc(n_links, sizeof(*scores));
+        for (i = 0; i < n_links; ++i)
+            scores[i] = dag->link_list[i]->alpha;
+        qsort(scores, n_links, sizeof(*scores), compare_beam_scores);
+        if (n_keep < n_links && scores[n_keep - 1] BETTER_THAN thresh) {
+            thresh = scores[n_keep - 1];
+            /* Drop ties rather than exceed the limit, but always
+             * keep the best path. */
+            if (scores[n_keep] == thresh && thresh WORSE_THAN best)
+                ++thresh;
+        }
+        ckd_free(scores);
+    }
+
+    /* Remove links outside the threshold.  Those that remain are all
+     * on some complete path inside it, so only nodes left without
+     * any links need to be removed. */
+    ps_lattice_uncompile(dag);
+    npruned = 0;
+    for (node = dag->nodes; node; node = node->next) {
+        latlink_list_t *x, *next, *tmp;
+
+        tmp = NULL;
+        for (x = node->exits; x; x = next) {
+            next = x->next;
+            if (x->link->alpha WORSE_THAN thresh)
+                listelem_free(dag->latlink_list_alloc, x);
+            else {
+                x->next = tmp;
+                tmp = x;
+            }
+        }
+        node->exits = tmp;
+        node->reachable = FALSE;
+    }
+    for (node = dag->nodes; node; node = node->next) {
+        latlink_list_t *x, *next, *tmp;
+
+        tmp = NULL;
+        for (x = node->entries; x; x = next) {
+            next = x->next;
+            if (x->link->alpha WORSE_THAN thresh) {
+                listelem_free(dag->latlink_alloc, x->link);
+                listelem_free(dag->latlink_list_alloc, x);
+                ++npruned;
+            }
+            else {
+                x->next = tmp;
+                tmp = x;
+            }
+        }
+        node->entries = tmp;
+    }
+    dag_mark_reachable(dag->end);
+    ps_lattice_delete_unreachable(dag);
+    E_INFO("Pruned %d of %d links (%.2f per frame)\n",
+           npruned, n_links,
+           dag->n_frames ? (double)(n_links - npruned) / dag->n_frames : 0.0);
+
+    return npruned;
+}
+
+void
+ps_lattice_prune_config(ps_lattice_t *dag, ngram_model_t *lmset,
+                        float32 lwf)
+{
+    ps_config_t *config;
+    float64 latbeam;
+    float32 latdensity;
+
+    if (dag->search == NULL)
+        return;
+    config = ps_search_config(dag->search);
+    latbeam = ps_config_float(config, "latbeam");
+    latdensity = ps_config_float(config, "latdensity");
+    if (latbeam <= 0.0 && latdensity <= 0.0)
+        return;
+    ps_lattice_beam_prune(dag, lmset, lwf,
+                          latbeam > 0.0
+                          ? logmath_log(dag->lmath, latbeam)
+                          : logmath_get_zero(dag->lmath),
+                          latdensity);
+}
+
 /* Parameters to prune n-best alternatives search */
 #define MAX_PATHS	500     /* Max allowed active paths at any time */
 #define MAX_HYP_TRIES	10000
 
 /*
- * For each node in any path between from and end of utt, find the
- * best score from "from".sf to end of utt.  (NOTE: Uses bigram probs;
- * this is an estimate of the best score from "from".)  (NOTE #2: yes,
- * this is the "heuristic score" used in A* search)
+ * Best weighted language model score for going from one node to
+ * another, whatever word came before.  Paths are extended with
+ * trigram scores, which are better than the bigram score when the
+ * backoff weight is positive, so taking only the bigram would let a
+ * worse hypothesis come out of ps_astar_next() before a better one.
  */
-static int32
-best_rem_score(ps_astar_t *nbest, ps_latnode_t * from)
+static float32
+best_lm_score(ps_astar_t *nbest, ps_latnode_t *from, ps_latnode_t *to)
 {
     latlink_list_t *x;
-    int32 bestscore, score;
+    int32 n_used, score, best;
 
-    if (from->info.rem_score <= 0)
-        return (from->info.rem_score);
+    best = ngram_bg_score(nbest->lmset, to->basewid, from->basewid, &n_used);
+    for (x = from->entries; x; x = x->next) {
+        score = ngram_tg_score(nbest->lmset, to->basewid, from->basewid,
+                               x->link->from->basewid, &n_used);
+        if (score BETTER_THAN best)
+            best = score;
+    }
+    return (best >> SENSCR_SHIFT) * nbest->lwf;
+}
 
-    /* Best score from "from" to end of utt not known; compute from successors */
-    bestscore = WORST_SCORE;
-    for (x = from->exits; x; x = x->next) {
-        int32 n_used;
+/*
+ * For each node, find the best score from its start frame to the end
+ * of the utterance, sweeping backwards over the nodes in topological
+ * order.  (NOTE: this never underestimates the score of any path from
+ * each node, which is what the "heuristic score" used in A* search
+ * needs to find the best paths first)
+ */
+static void
+best_rem_score(ps_astar_t *nbest)
+{
+    ps_lattice_t *dag = nbest->dag;
+    int32 i, j;
+
+    ps_lattice_compile(dag);
+    for (i = dag->n_node_list - 1; i >= 0; --i) {
+        ps_latnode_t *from = dag->node_list[i];
+        ps_latlink_t **exits = dag->link_list + from->first_exit;
+        int32 bestscore, score;
 
-        score = best_rem_score(nbest, x->link->to);
-        score += x->link->ascr;
-        if (nbest->lmset)
-            score += (ngram_bg_score(nbest->lmset, x->link->to->basewid,
-                                     from->basewid, &n_used) >> SENSCR_SHIFT)
-                      * nbest->lwf;
-        if (score BETTER_THAN bestscore)
-            bestscore = score;
+        if (from == dag->end) {
+            from->info.rem_score = 0;
+            continue;
+        }
+        /* Nodes with no exits get WORST_SCORE. */
+        bestscore = WORST_SCORE;
+        for (j = 0; j < from->n_exits; ++j) {
+            score = exits[j]->to->info.rem_score;
+            score += exits[j]->ascr;
+            if (nbest->lmset)
+                score += best_lm_score(nbest, from, exits[j]->to);
+            if (score BETTER_THAN bestscore)
+                bestscore = score;
+        }
+        from->info.rem_score = bestscore;
     }
-    from->info.rem_score = bestscore;
+}
+
+/* Is heap entry a better than b?  Ties go to the older one. */
+#define ASTAR_BETTER(a, b)                              \
+    ((a)->total_score > (b)->total_score                \
+     || ((a)->total_score == (b)->total_score           \
+         && (a)->seq < (b)->seq))
+
+static int
+astar_entry_cmp(const void *a, const void *b)
+{
+    ps_astar_entry_t const *ea = (ps_astar_entry_t const *)a;
+    ps_astar_entry_t const *eb = (ps_astar_entry_t const *)b;
+
+    if (ASTAR_BETTER(ea, eb))
+        return -1;
+    else if (ASTAR_BETTER(eb, ea))
+        return 1;
+    return 0;
+}
+
+/*
+ * Keep only the best MAX_PATHS partial paths.  Rather than doing this
+ * on every insertion, we let the heap grow to twice that size, then
+ * sort it (a sorted array is also a valid heap) and drop the tail.
+ * None of the dropped paths have been extended, so nothing else
+ * refers to them.  The worst surviving score then serves as a cheap
+ * threshold for rejecting new paths, until the heap shrinks again.
+ */
+static void
+path_prune(ps_astar_t *nbest)
+{
+    int32 i;
 
-    return bestscore;
+    qsort(nbest->heap, nbest->n_path, sizeof(*nbest->heap), astar_entry_cmp);
+    for (i = MAX_PATHS; i < nbest->n_path; ++i) {
+        listelem_free(nbest->latpath_alloc, nbest->heap[i].path);
+        nbest->n_hyp_reject++;
+    }
+    nbest->n_path = MAX_PATHS;
+    nbest->reject_score = nbest->heap[MAX_PATHS - 1].total_score;
 }
 
 /*
- * Insert newpath in sorted (by path score) list of paths.  But if newpath is
- * too far down the list, drop it (FIXME: necessary?)
+ * Insert newpath in the heap of partial paths.
  * total_score = path score (newpath) + rem_score to end of utt.
  */
 static void
 path_insert(ps_astar_t *nbest, ps_latpath_t *newpath, int32 total_score)
 {
-    ps_latpath_t *prev, *p;
+    ps_astar_entry_t ent;
     int32 i;
 
-    prev = NULL;
-    for (i = 0, p = nbest->path_list; (i < MAX_PATHS) && p; p = p->next, i++) {
-        if ((p->score + p->node->info.rem_score) < total_score)
+    /* If there are enough paths better than this one, drop it. */
+    if (nbest->n_path < MAX_PATHS)
+        nbest->reject_score = WORST_SCORE;
+    else if (total_score <= nbest->reject_score) {
+        listelem_free(nbest->latpath_alloc, newpath);
+        nbest->n_hyp_reject++;
+        return;
+    }
+    if (nbest->n_path == 2 * MAX_PATHS)
+        path_prune(nbest);
+    if (nbest->n_path == nbest->n_heap_alloc) {
+        nbest->n_heap_alloc = nbest->n_heap_alloc ? nbest->n_heap_alloc * 2 : 64;
+        nbest->heap = ckd_realloc(nbest->heap,
+                                  nbest->n_heap_alloc * sizeof(*nbest->heap));
+    }
+    ent.path = newpath;
+    ent.total_score = total_score;
+    ent.seq = nbest->n_hyp_insert++;
+    /* Sift up. */
+    for (i = nbest->n_path++; i > 0; i = (i - 1) / 2) {
+        ps_astar_entry_t *parent = nbest->heap + (i - 1) / 2;
+        if (!ASTAR_BETTER(&ent, parent))
             break;
-        prev = p;
+        nbest->heap[i] = *parent;
     }
+    nbest->heap[i] = ent;
+}
 
-    /* newpath should be inserted between prev and p */
-    if (i < MAX_PATHS) {
-        /* Insert new partial hyp */
-        newpath->next = p;
-        if (!prev)
-            nbest->path_list = newpath;
-        else
-            prev->next = newpath;
-        if (!p)
-            nbest->path_tail = newpath;
-
-        nbest->n_path++;
-        nbest->n_hyp_insert++;
-        nbest->insert_depth += i;
-    }
-    else {
-        /* newpath score too low; reject it and also prune paths beyond MAX_PATHS */
-        nbest->path_tail = prev;
-        prev->next = NULL;
-        nbest->n_path = MAX_PATHS;
-        listelem_free(nbest->latpath_alloc, newpath);
+/* Remove the best partial path from the heap. */
+static ps_latpath_t *
+path_pop(ps_astar_t *nbest)
+{
+    ps_latpath_t *best;
+    ps_astar_entry_t *last;
+    int32 i, child;
 
-        nbest->n_hyp_reject++;
-        for (; p; p = newpath) {
-            newpath = p->next;
-            listelem_free(nbest->latpath_alloc, p);
-            nbest->n_hyp_reject++;
-        }
+    if (nbest->n_path == 0)
+        return NULL;
+    best = nbest->heap[0].path;
+    last = nbest->heap + --nbest->n_path;
+    /* Sift down. */
+    for (i = 0; (child = 2 * i + 1) < nbest->n_path; i = child) {
+        if (child + 1 < nbest->n_path
+            && ASTAR_BETTER(nbest->heap + child + 1, nbest->heap + child))
+            ++child;
+        if (!ASTAR_BETTER(nbest->heap + child, last))
+            break;
+        nbest->heap[i] = nbest->heap[child];
     }
+    nbest->heap[i] = *last;
+    return best;
 }
 
 /* Find all possible extensions to given partial path */
@@ -1660,7 +2847,6 @@ path_extend(ps_astar_t *nbest, ps_latpath_t * path)
 {
     latlink_list_t *x;
     ps_latpath_t *newpath;
-    int32 total_score, tail_score;
 
     /* Consider all successors of path->node */
     for (x = path->node->exits; x; x = x->next) {
@@ -1690,23 +2876,10 @@ path_extend(ps_astar_t *nbest, ps_latpath_t * path)
                        >> SENSCR_SHIFT);
         }
 
-        /* Insert new partial path hypothesis into sorted path_list */
+        /* Insert new partial path hypothesis into the heap */
         nbest->n_hyp_tried++;
-        total_score = newpath->score + newpath->node->info.rem_score;
-
-        /* First see if hyp would be worse than the worst */
-        if (nbest->n_path >= MAX_PATHS) {
-            tail_score =
-                nbest->path_tail->score
-                + nbest->path_tail->node->info.rem_score;
-            if (total_score < tail_score) {
-                listelem_free(nbest->latpath_alloc, newpath);
-                nbest->n_hyp_reject++;
-                continue;
-            }
-        }
-
-        path_insert(nbest, newpath, total_score);
+        path_insert(nbest, newpath,
+                    newpath->score + newpath->node->info.rem_score);
     }
 }
 
@@ -1733,24 +2906,15 @@ ps_astar_start(ps_lattice_t *dag,
     nbest->w2 = w2;
     nbest->latpath_alloc = listelem_alloc_init(sizeof(ps_latpath_t));
 
-    /* Initialize rem_score (A* heuristic) to default values */
-    for (node = dag->nodes; node; node = node->next) {
-        if (node == dag->end)
-            node->info.rem_score = 0;
-        else if (node->exits == NULL)
-            node->info.rem_score = WORST_SCORE;
-        else
-            node->info.rem_score = 1;   /* +ve => unknown value */
-    }
+    /* Compute rem_score (A* heuristic) for all nodes */
+    best_rem_score(nbest);
 
-    /* Create initial partial hypotheses list consisting of nodes starting at sf */
-    nbest->path_list = nbest->path_tail = NULL;
+    /* Create initial partial hypotheses consisting of nodes starting at sf */
     for (node = dag->nodes; node; node = node->next) {
         if (node->sf == sf) {
             ps_latpath_t *path;
             int32 n_used;
 
-            best_rem_score(nbest, node);
             path = listelem_malloc(nbest->latpath_alloc);
             path->node = node;
             path->parent = NULL;
@@ -1777,12 +2941,7 @@ ps_astar_next(ps_astar_t *nbest)
     dag = nbest->dag;
 
     /* Pop the top (best) partial hypothesis */
-    while ((nbest->top = nbest->path_list) != NULL) {
-        nbest->path_list = nbest->path_list->next;
-        if (nbest->top == nbest->path_tail)
-            nbest->path_tail = NULL;
-        nbest->n_path--;
-
+    while ((nbest->top = path_pop(nbest)) != NULL) {
         /* Complete hypothesis? */
         if ((nbest->top->node->sf >= nbest->ef)
             || ((nbest->top->node == dag->end) &&
@@ -1936,6 +3095,7 @@ ps_astar_finish(ps_astar_t *nbest)
     glist_free(nbest->hyps);
     /* Free all paths. */
     listelem_alloc_free(nbest->latpath_alloc);
+    ckd_free(nbest->heap);
     /* Free the Henge. */
     ckd_free(nbest);
 }
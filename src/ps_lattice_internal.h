@@ -93,6 +93,12 @@ struct ps_lattice_s {
     /* This will probably be replaced with a heap. */
     latlink_list_t *q_head; /**< Queue of links for traversal. */
     latlink_list_t *q_tail; /**< Queue of links for traversal. */
+
+    /* Compiled form of the graph, see ps_lattice_compile(). */
+    ps_latnode_t **node_list; /**< Nodes in topological order (NULL if not compiled). */
+    ps_latlink_t **link_list; /**< Links grouped by source node, in the same order. */
+    int32 n_node_list;        /**< Number of entries in node_list. */
+    int32 n_link_list;        /**< Number of entries in link_list. */
 };
 
 /**
@@ -137,6 +143,8 @@ struct ps_latnode_s {
     } info;
     latlink_list_t *exits;      /**< Links out of this node */
     latlink_list_t *entries;    /**< Links into this node */
+    int32 first_exit;           /**< Index of first exit in compiled link_list */
+    int32 n_exits;              /**< Number of exits in compiled link_list */
 
     struct ps_latnode_s *alt;   /**< Node with alternate pronunciation for this word */
     struct ps_latnode_s *next;	/**< Next node in DAG (no ordering implied) */
@@ -162,10 +170,18 @@ typedef struct dag_seg_s {
 typedef struct ps_latpath_s {
     ps_latnode_t *node;            /**< Node ending this path. */
     struct ps_latpath_s *parent;   /**< Previous element in this path. */
-    struct ps_latpath_s *next;     /**< Pointer to next path in list of paths. */
     int32 score;                  /**< Exact score from start node up to node->sf. */
 } ps_latpath_t;
 
+/**
+ * Entry in the priority queue of partial paths used in A* search.
+ */
+typedef struct ps_astar_entry_s {
+    ps_latpath_t *path;  /**< Partial path. */
+    int32 total_score;   /**< Path score plus heuristic score to the end. */
+    int32 seq;           /**< Insertion order, to break ties. */
+} ps_astar_entry_t;
+
 /**
  * A* search structure.
  */
@@ -182,11 +198,11 @@ typedef struct ps_astar_s {
     int32 n_hyp_tried;
     int32 n_hyp_insert;
     int32 n_hyp_reject;
-    int32 insert_depth;
     int32 n_path;
 
-    ps_latpath_t *path_list;
-    ps_latpath_t *path_tail;
+    ps_astar_entry_t *heap;  /**< Binary heap of partial paths, best first. */
+    int32 n_heap_alloc;      /**< Allocated size of heap. */
+    int32 reject_score;      /**< Paths scoring no better than this are dropped. */
     ps_latpath_t *top;
 
     glist_t hyps;	             /**< List of hypothesis strings. */
@@ -218,6 +234,30 @@ void ps_lattice_penalize_fillers(ps_lattice_t *dag, int32 silpen, int32 fillpen)
  */
 void ps_lattice_delete_unreachable(ps_lattice_t *dag);
 
+/**
+ * Prune a newly built word graph according to the "latbeam" and
+ * "latdensity" parameters of its search, if any.
+ */
+void ps_lattice_prune_config(ps_lattice_t *dag, ngram_model_t *lmset,
+                             float32 lwf);
+
+/**
+ * Build the compiled form of a word graph, if not already done.
+ *
+ * This sorts the nodes by start frame (or topologically, if some
+ * link does not go forward in time) and stores the exits of each
+ * node contiguously in that order, so that searches can visit all
+ * links in topological order with a linear sweep, rather than
+ * counting fan-in and queueing links as ps_lattice_traverse_edges()
+ * does.  It is discarded by any change to the links in the graph.
+ */
+void ps_lattice_compile(ps_lattice_t *dag);
+
+/**
+ * Discard the compiled form of a word graph.
+ */
+void ps_lattice_uncompile(ps_lattice_t *dag);
+
 /**
  * Add an edge to the traversal queue.
  */
@@ -58,7 +58,8 @@ static ps_mgaufuncs_t ptm_mgau_funcs = {
     "ptm",
     ptm_mgau_frame_eval,      /* frame_eval */
     ptm_mgau_mllr_transform,  /* transform */
-    ptm_mgau_free             /* free */
+    ptm_mgau_free,            /* free */
+    ptm_mgau_set_approx       /* set_approx */
 };
 
 #define COMPUTE_GMM_MAP(_idx)                           \
@@ -93,7 +94,7 @@ eval_topn(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
     topn = s->f->topn[cb][feat];
     ceplen = s->g->featlen[feat];
 
-    for (i = 0; i < s->max_topn; i++) {
+    for (i = 0; i < s->topn; i++) {
         mfcc_t *mean, diff[4], sqdiff[4], compl[4]; /* diff, diff^2, component likelihood */
         mfcc_t *var, d;
         mfcc_t *obs;
@@ -157,7 +158,7 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
     int32 i, ceplen;
 
     best = topn = s->f->topn[cb][feat];
-    worst = topn + (s->max_topn - 1);
+    worst = topn + (s->topn - 1);
     mean = s->g->mean[cb][feat][0];
     var = s->g->var[cb][feat][0];
     det = s->g->det[cb][feat];
@@ -209,12 +210,12 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
         }
         if (d < thresh)
             continue;
-        for (i = 0; i < s->max_topn; i++) {
+        for (i = 0; i < s->topn; i++) {
             /* already there, so don't need to insert */
             if (topn[i].cw == cw)
                 break;
         }
-        if (i < s->max_topn)
+        if (i < s->topn)
             continue;       /* already there.  Don't insert */
         if (d < (mfcc_t)MAX_NEG_INT32)  /* Redundant if FIXED_POINT */
             insertion_sort_cb(&cur, worst, best, cw, MAX_NEG_INT32);
@@ -281,7 +282,7 @@ ptm_mgau_codebook_norm(ptm_mgau_t *s, mfcc_t **z, int frame)
             int32 k;
             if (bitvec_is_clear(s->f->mgau_active, i))
                 continue;
-            for (k = 0; k < s->max_topn; ++k) {
+            for (k = 0; k < s->topn; ++k) {
                 s->f->topn[i][j][k].score >>= SENSCR_SHIFT;
                 s->f->topn[i][j][k].score -= norm;
                 s->f->topn[i][j][k].score = -s->f->topn[i][j][k].score;
@@ -357,7 +358,7 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
              * it wouldn't make any difference to the search code,
              * which doesn't expect senone_active to change. */
             for (f = 0; f < s->g->n_feat; ++f) {
-                for (j = 0; j < s->max_topn; ++j) {
+                for (j = 0; j < s->topn; ++j) {
                     s->f->topn[cb][f][j].score = MAX_NEG_ASCR;
                 }
             }
@@ -369,7 +370,7 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
             ptm_topn_t *topn;
             int j, fden = 0;
             topn = s->f->topn[cb][f];
-            for (j = 0; j < s->max_topn; ++j) {
+            for (j = 0; j < s->topn; ++j) {
                 int mixw;
                 /* Find mixture weight for this codeword. */
                 if (s->mixw_cb) {
@@ -869,7 +870,7 @@ ptm_mgau_init(acmod_t *acmod, bin_mdef_t *mdef)
         }
     }
     s->ds_ratio = ps_config_int(s->config, "ds");
-    s->max_topn = ps_config_int(s->config, "topn");
+    s->topn = s->max_topn = ps_config_int(s->config, "topn");
     E_INFO("Maximum top-N: %d\n", s->max_topn);
 
     /* Assume mapping of senones to their base phones, though this
@@ -903,6 +904,33 @@ ptm_mgau_mllr_transform(ps_mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
+int
+ptm_mgau_set_approx(ps_mgau_t *ps, int topn, int ds_ratio)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+
+    if (topn < 1 || topn > s->max_topn || ds_ratio < 1) {
+        E_ERROR("Invalid top-N %d (must be 1 to %d) or downsampling %d\n",
+                topn, s->max_topn, ds_ratio);
+        return -1;
+    }
+    /* Codewords beyond the old top-N are stale and may duplicate
+     * ones inside it, so start over if it grows. */
+    if (topn > s->topn) {
+        int i, j, k, m;
+        for (i = 0; i < s->n_fast_hist; ++i)
+            for (j = 0; j < s->g->n_mgau; ++j)
+                for (k = 0; k < s->g->n_feat; ++k)
+                    for (m = 0; m < s->max_topn; ++m) {
+                        s->hist[i].topn[j][k][m].cw = m;
+                        s->hist[i].topn[j][k][m].score = WORST_DIST;
+                    }
+    }
+    s->topn = topn;
+    s->ds_ratio = ds_ratio;
+    return 0;
+}
+
 void
 ptm_mgau_free(ps_mgau_t *ps)
 {
@@ -79,7 +79,8 @@ struct ptm_mgau_s {
     uint8 ***mixw;     /**< Mixture weight distributions by feature, codeword, senone */
     mmio_file_t *sendump_mmap;/* Memory map for mixw (or NULL if not mmap) */
     uint8 *mixw_cb;    /* Mixture weight codebook, if any (assume it contains 16 values) */
-    int16 max_topn;
+    int16 max_topn;     /**< Size of top-N lists. */
+    int16 topn;         /**< Current top-N, at most max_topn. */
     int16 ds_ratio;
 
     ptm_fast_eval_t *hist;   /**< Fast evaluation info for past frames. */
@@ -103,6 +104,7 @@ int ptm_mgau_frame_eval(ps_mgau_t *s,
                         int32 compallsen);
 int ptm_mgau_mllr_transform(ps_mgau_t *s,
                             ps_mllr_t *mllr);
+int ptm_mgau_set_approx(ps_mgau_t *s, int topn, int ds_ratio);
 void ptm_mgau_reset_fast_hist(ps_mgau_t *ps);
 
 #ifdef __cplusplus
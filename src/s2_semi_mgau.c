@@ -58,7 +58,8 @@ static ps_mgaufuncs_t s2_semi_mgau_funcs = {
     "s2_semi",
     s2_semi_mgau_frame_eval,      /* frame_eval */
     s2_semi_mgau_mllr_transform,  /* transform */
-    s2_semi_mgau_free             /* free */
+    s2_semi_mgau_free,            /* free */
+    s2_semi_mgau_set_approx       /* set_approx */
 };
 
 struct vqFeature_s {
@@ -75,7 +76,7 @@ eval_topn(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
     topn = s->f[feat];
     ceplen = s->g->featlen[feat];
 
-    for (i = 0; i < s->max_topn; i++) {
+    for (i = 0; i < s->topn; i++) {
         mfcc_t *mean, diff, sqdiff, compl; /* diff, diff^2, component likelihood */
         vqFeature_t vtmp;
         mfcc_t *var, d;
@@ -117,7 +118,7 @@ eval_cb(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
     int32 i, ceplen;
 
     best = topn = s->f[feat];
-    worst = topn + (s->max_topn - 1);
+    worst = topn + (s->topn - 1);
     mean = s->g->mean[0][feat][0];
     var = s->g->var[0][feat][0];
     det = s->g->det[0][feat];
@@ -153,12 +154,12 @@ eval_cb(s2_semi_mgau_t *s, int32 feat, mfcc_t *z)
             d_int = (int32) d;
         if (d_int < worst->score)
             continue;
-        for (i = 0; i < s->max_topn; i++) {
+        for (i = 0; i < s->topn; i++) {
             /* already there, so don't need to insert */
             if (topn[i].codeword == cw)
                 break;
         }
-        if (i < s->max_topn)
+        if (i < s->topn)
             continue;       /* already there.  Don't insert */
         /* remaining code inserts codeword and dist in correct spot */
         for (cur = worst - 1; cur >= best && d_int >= cur->score; --cur)
@@ -192,7 +193,7 @@ mgau_norm(s2_semi_mgau_t *s, int feat)
     norm = s->f[feat][0].score >> SENSCR_SHIFT;
 
     /* Normalize the scores, negate them, and clamp their dynamic range. */
-    for (j = 0; j < s->max_topn; ++j) {
+    for (j = 0; j < s->topn; ++j) {
         s->f[feat][j].score = -((s->f[feat][j].score >> SENSCR_SHIFT) - norm);
         if (s->f[feat][j].score > MAX_NEG_ASCR)
             s->f[feat][j].score = MAX_NEG_ASCR;
@@ -1300,7 +1301,7 @@ s2_semi_mgau_init(acmod_t *acmod)
 
     /* Determine top-N for each feature */
     s->topn_beam = ckd_calloc(n_feat, sizeof(*s->topn_beam));
-    s->max_topn = ps_config_int(s->config, "topn");
+    s->topn = s->max_topn = ps_config_int(s->config, "topn");
     split_topn(ps_config_str(s->config, "topn_beam"), s->topn_beam, n_feat);
     E_INFO("Maximum top-N: %d ", s->max_topn);
     E_INFOCONT("Top-N beams:");
@@ -1343,6 +1344,32 @@ s2_semi_mgau_mllr_transform(ps_mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
+int
+s2_semi_mgau_set_approx(ps_mgau_t *ps, int topn, int ds_ratio)
+{
+    s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
+
+    if (topn < 1 || topn > s->max_topn || ds_ratio < 1) {
+        E_ERROR("Invalid top-N %d (must be 1 to %d) or downsampling %d\n",
+                topn, s->max_topn, ds_ratio);
+        return -1;
+    }
+    /* Codewords beyond the old top-N are stale and may duplicate
+     * ones inside it, so start over if it grows. */
+    if (topn > s->topn) {
+        int i, j, k;
+        for (i = 0; i < s->n_topn_hist; ++i)
+            for (j = 0; j < s->g->n_feat; ++j)
+                for (k = 0; k < s->max_topn; ++k) {
+                    s->topn_hist[i][j][k].score = WORST_DIST;
+                    s->topn_hist[i][j][k].codeword = k;
+                }
+    }
+    s->topn = topn;
+    s->ds_ratio = ds_ratio;
+    return 0;
+}
+
 void
 s2_semi_mgau_free(ps_mgau_t *ps)
 {
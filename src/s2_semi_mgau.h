@@ -73,7 +73,8 @@ struct s2_semi_mgau_s {
     uint8 *mixw_cb;    /* mixture weight codebook, if any (assume it contains 16 values) */
     int32 n_sen;	/* Number of senones */
     uint8 *topn_beam;   /* Beam for determining per-frame top-N densities */
-    int16 max_topn;
+    int16 max_topn;     /**< Size of top-N lists. */
+    int16 topn;         /**< Current top-N, at most max_topn. */
     int16 ds_ratio;
 
     vqFeature_t ***topn_hist; /**< Top-N scores and codewords for past frames. */
@@ -98,6 +99,7 @@ int s2_semi_mgau_frame_eval(ps_mgau_t *s,
                             int32 compallsen);
 int s2_semi_mgau_mllr_transform(ps_mgau_t *s,
                                 ps_mllr_t *mllr);
+int s2_semi_mgau_set_approx(ps_mgau_t *s, int topn, int ds_ratio);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -0,0 +1,161 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+/**
+ * @file arena.c
+ * @brief Region allocator for objects which all die together
+ */
+
+#include <string.h>
+
+#include <pocketsphinx/err.h>
+
+#include "util/ckd_alloc.h"
+#include "util/arena.h"
+
+/**
+ * Blocks are kept in a singly linked list, which is never shortened
+ * except by arena_free().  Allocation bumps an offset in the current
+ * block, moving on to the next one (or linking in a new one) when it
+ * is full.  Resetting just goes back to the first block.
+ */
+typedef struct arena_block_s {
+    struct arena_block_s *next; /**< Next block in list. */
+    size_t size;                /**< Usable bytes in this block. */
+} arena_block_t;
+
+struct arena_s {
+    int refcount;
+    size_t blksize;      /**< Default size of new blocks. */
+    arena_block_t *head; /**< First block. */
+    arena_block_t *cur;  /**< Block currently allocated from. */
+    size_t pos;          /**< Offset of free space in current block. */
+    size_t used;         /**< Bytes allocated (since last reset). */
+};
+
+/** All objects are aligned to this many bytes. */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+/** Size of block header, rounded so that data is aligned. */
+#define ARENA_HDR ARENA_ROUND(sizeof(arena_block_t))
+#define ARENA_DEFAULT_BLKSIZE (64 * 1024)
+
+arena_t *
+arena_init(size_t blksize)
+{
+    arena_t *a;
+
+    a = ckd_calloc(1, sizeof(*a));
+    a->refcount = 1;
+    a->blksize = blksize ? ARENA_ROUND(blksize) : ARENA_DEFAULT_BLKSIZE;
+    return a;
+}
+
+arena_t *
+arena_retain(arena_t *a)
+{
+    if (a == NULL)
+        return NULL;
+    ++a->refcount;
+    return a;
+}
+
+int
+arena_free(arena_t *a)
+{
+    arena_block_t *b, *next;
+
+    if (a == NULL)
+        return 0;
+    if (--a->refcount > 0)
+        return a->refcount;
+    for (b = a->head; b; b = next) {
+        next = b->next;
+        ckd_free(b);
+    }
+    ckd_free(a);
+    return 0;
+}
+
+void *
+__arena_calloc__(arena_t *a, size_t n_elem, size_t elem_size,
+                 const char *file, int line)
+{
+    size_t size;
+    char *mem;
+
+    size = ARENA_ROUND(n_elem * elem_size);
+    /* Find a block with enough room, starting with the current one. */
+    while (a->cur == NULL || a->pos + size > a->cur->size) {
+        arena_block_t *next = a->cur ? a->cur->next : a->head;
+        if (next == NULL || size > next->size) {
+            /* None left (or the next one is too small, in which case
+             * a new block goes in front of it) so make a new one. */
+            size_t bsize = size > a->blksize ? size : a->blksize;
+            arena_block_t *b = __ckd_malloc__(ARENA_HDR + bsize,
+                                              file, line);
+            b->size = bsize;
+            b->next = next;
+            if (a->cur)
+                a->cur->next = b;
+            else
+                a->head = b;
+            next = b;
+        }
+        a->cur = next;
+        a->pos = 0;
+    }
+    mem = (char *)a->cur + ARENA_HDR + a->pos;
+    a->pos += size;
+    a->used += size;
+    memset(mem, 0, size);
+    return mem;
+}
+
+void
+arena_reset(arena_t *a)
+{
+    a->cur = a->head;
+    a->pos = 0;
+    a->used = 0;
+}
+
+size_t
+arena_used(arena_t *a)
+{
+    return a->used;
+}
@@ -0,0 +1,113 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2026 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced
+ * Research Projects Agency and the National Science Foundation of the
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/** @file arena.h
+ * @brief Region allocator for objects which all die together
+ *
+ * Objects allocated from an arena cannot be freed individually.
+ * Instead, the whole arena is rewound at once with arena_reset(),
+ * which keeps its memory for reuse.  The decoder owns one of these
+ * for per-utterance search data, and resets it at the start of each
+ * utterance.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+#include <stdlib.h>
+
+#include <pocketsphinx/prim_type.h>
+
+/**
+ * Region allocator object.
+ */
+typedef struct arena_s arena_t;
+
+/**
+ * Initialize and return a region allocator.
+ *
+ * No memory is allocated until the first call to arena_calloc().
+ * @param blksize Size in bytes of the blocks requested from the
+ *                system, or 0 for a default size.  Larger objects
+ *                get a block of their own.
+ */
+arena_t *arena_init(size_t blksize);
+
+/**
+ * Retain a pointer to a region allocator.
+ */
+arena_t *arena_retain(arena_t *a);
+
+/**
+ * Release a pointer to a region allocator, freeing all memory
+ * associated with it if it is the last one.
+ * @return new reference count (0 if freed)
+ */
+int arena_free(arena_t *a);
+
+void *__arena_calloc__(arena_t *a, size_t n_elem, size_t elem_size,
+                       const char *file, int line);
+
+/**
+ * Allocate zero-filled memory from a region allocator.  It will
+ * remain valid until the next call to arena_reset() or arena_free().
+ */
+#define arena_calloc(a,n,sz) __arena_calloc__((a),(n),(sz),__FILE__,__LINE__)
+
+/**
+ * Release all objects allocated from a region allocator in constant
+ * time.  Memory is retained and reused by subsequent allocations.
+ */
+void arena_reset(arena_t *a);
+
+/**
+ * Get the number of bytes currently allocated from a region allocator.
+ */
+size_t arena_used(arena_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARENA_H__ */
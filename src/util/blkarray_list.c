@@ -127,22 +127,24 @@ blkarray_list_append(blkarray_list_t * bl, void *data)
 }
 
 
-void
-blkarray_list_reset(blkarray_list_t * bl)
+static void
+blkarray_list_free_rows(blkarray_list_t * bl, int free_elems)
 {
     int32 i, j;
 
     /* Free all the allocated elements as well as the blocks */
     for (i = 0; i < bl->cur_row; i++) {
-        for (j = 0; j < bl->blksize; j++)
-            ckd_free(bl->ptr[i][j]);
+        if (free_elems)
+            for (j = 0; j < bl->blksize; j++)
+                ckd_free(bl->ptr[i][j]);
 
         ckd_free(bl->ptr[i]);
         bl->ptr[i] = NULL;
     }
     if (i == bl->cur_row) {     /* NEED THIS! (in case cur_row < 0) */
-        for (j = 0; j < bl->cur_row_free; j++)
-            ckd_free(bl->ptr[i][j]);
+        if (free_elems)
+            for (j = 0; j < bl->cur_row_free; j++)
+                ckd_free(bl->ptr[i][j]);
 
         ckd_free(bl->ptr[i]);
         bl->ptr[i] = NULL;
@@ -153,6 +155,18 @@ blkarray_list_reset(blkarray_list_t * bl)
     bl->cur_row_free = bl->blksize;
 }
 
+void
+blkarray_list_reset(blkarray_list_t * bl)
+{
+    blkarray_list_free_rows(bl, TRUE);
+}
+
+void
+blkarray_list_clear(blkarray_list_t * bl)
+{
+    blkarray_list_free_rows(bl, FALSE);
+}
+
 void *
 blkarray_list_get(blkarray_list_t *list, int32 n)
 {
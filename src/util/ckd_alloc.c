@@ -106,6 +106,31 @@
 static jmp_buf *ckd_target;
 static int jmp_abort;
 
+/**
+ * Allocator hook, NULL to use the C library directly.
+ */
+static const ckd_allocator_t *ckd_allocator;
+
+const ckd_allocator_t *
+ckd_set_allocator(const ckd_allocator_t *alloc)
+{
+    const ckd_allocator_t *old;
+
+    old = ckd_allocator;
+    ckd_allocator = alloc;
+    return old;
+}
+
+#define CKD_CALLOC(n,sz) (ckd_allocator                                 \
+                          ? ckd_allocator->calloc_fn(ckd_allocator->ctx, (n), (sz)) \
+                          : calloc((n), (sz)))
+#define CKD_MALLOC(sz) (ckd_allocator                                   \
+                        ? ckd_allocator->malloc_fn(ckd_allocator->ctx, (sz)) \
+                        : malloc(sz))
+#define CKD_REALLOC(p,sz) (ckd_allocator                                \
+                           ? ckd_allocator->realloc_fn(ckd_allocator->ctx, (p), (sz)) \
+                           : realloc((p), (sz)))
+
 jmp_buf *
 ckd_set_jump(jmp_buf *env, int abort)
 {
@@ -155,7 +180,7 @@ __ckd_calloc__(size_t n_elem, size_t elem_size,
                 elem_size, caller_file, caller_line,space_unused());
     	}
 #else
-    if ((mem = calloc(n_elem, elem_size)) == NULL) {
+    if ((mem = CKD_CALLOC(n_elem, elem_size)) == NULL) {
         ckd_fail("calloc(%d,%d) failed from %s(%d)\n", n_elem,
                 elem_size, caller_file, caller_line);
 	}
@@ -175,7 +200,7 @@ __ckd_malloc__(size_t size, const char *caller_file, int caller_line)
     if ((mem = heap_malloc(heap_lookup(0),size)) == NULL)
        	if ((mem = heap_malloc(heap_lookup(1),size)) == NULL)
 #else
-    if ((mem = malloc(size)) == NULL)
+    if ((mem = CKD_MALLOC(size)) == NULL)
 #endif
 	        ckd_fail("malloc(%d) failed from %s(%d)\n", size,
                 caller_file, caller_line);
@@ -192,7 +217,7 @@ __ckd_realloc__(void *ptr, size_t new_size,
 #if defined(__ADSPBLACKFIN__) && !defined(__linux__)
     if ((mem = heap_realloc(heap_lookup(0),ptr, new_size)) == NULL) {
 #else
-    if ((mem = realloc(ptr, new_size)) == NULL) {
+    if ((mem = CKD_REALLOC(ptr, new_size)) == NULL) {
 #endif
         ckd_fail("malloc(%d) failed from %s(%d)\n", new_size,
                 caller_file, caller_line);
@@ -248,7 +273,10 @@ ckd_free(void *ptr)
     if (ptr)
         heap_free(0,ptr);
 #else
-    free(ptr);
+    if (ckd_allocator)
+        ckd_allocator->free_fn(ckd_allocator->ctx, ptr);
+    else
+        free(ptr);
 #endif
 }
 
@@ -322,13 +350,13 @@ __ckd_calloc_4d__(size_t d1,
     void ****out;
     size_t i, j;
 
-    store = calloc(d1 * d2 * d3 * d4, elem_size);
+    store = CKD_CALLOC(d1 * d2 * d3 * d4, elem_size);
     if (store == NULL) {
 	E_FATAL("ckd_calloc_4d failed for caller at %s(%d) at %s(%d)\n",
 		file, line, __FILE__, __LINE__);
     }
 
-    tmp1 = calloc(d1 * d2 * d3, sizeof(void *));
+    tmp1 = CKD_CALLOC(d1 * d2 * d3, sizeof(void *));
     if (tmp1 == NULL) {
 	E_FATAL("ckd_calloc_4d failed for caller at %s(%d) at %s(%d)\n",
 		file, line, __FILE__, __LINE__);
@@ -91,6 +91,7 @@
 
 #include <pocketsphinx/prim_type.h>
 #include <pocketsphinx/export.h>
+#include <pocketsphinx/alloc.h>
 
 
 /** \file ckd_alloc.h
@@ -131,6 +132,8 @@ jmp_buf *ckd_set_jump(jmp_buf *env, int abort);
  */
 void ckd_fail(char *format, ...);
 
+/* ckd_set_allocator() is declared in <pocketsphinx/alloc.h>. */
+
 /*
  * The following functions are similar to the malloc family, except
  * that they have two additional parameters, caller_file and
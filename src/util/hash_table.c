@@ -100,58 +100,35 @@
 #include "util/case.h"
 
 
-#if 0
-static void
-prime_sieve(int32 max)
-{
-    char *notprime;
-    int32 p, pp;
-
-    notprime = (char *) ckd_calloc(max + 1, 1);
-    p = 2;
-    for (;;) {
-        printf("%d\n", p);
-        for (pp = p + p; pp <= max; pp += p)
-            notprime[pp] = 1;
-        for (++p; (p <= max) && notprime[p]; p++);
-        if (p > max)
-            break;
-    }
-}
-#endif
-
-
 /*
- * HACK!!  Initial hash table size is restricted by this set of primes.  (Of course,
- * collision resolution by chaining will accommodate more entries indefinitely, but
- * efficiency will drop.)
- */
-const int32 prime[] = {
-    101, 211, 307, 401, 503, 601, 701, 809, 907,
-    1009, 1201, 1601, 2003, 2411, 3001, 4001, 5003, 6007, 7001, 8009,
-    9001,
-    10007, 12007, 16001, 20011, 24001, 30011, 40009, 50021, 60013,
-    70001, 80021, 90001,
-    100003, 120011, 160001, 200003, 240007, 300007, 400009, 500009,
-    600011, 700001, 800011, 900001,
-    -1
-};
-
-
-/**
- * This function returns a very large prime. 
+ * The table is a Robin Hood open-addressed array of slots, each of
+ * which holds the full hash of its key and a pointer to the entry.
+ * Entries themselves live in a list of blocks which double in size
+ * as the table grows, so that they never move once allocated (other
+ * modules hold on to hash_entry_t pointers and iterate over tables
+ * while inserting into them).  Deleted entries are kept on a free
+ * list for reuse.
  */
+
+/** Maximum load factor for the slot array is HASH_LOAD_NUM / HASH_LOAD_DEN */
+#define HASH_LOAD_NUM 3
+#define HASH_LOAD_DEN 4
+/** Minimum number of slots and size of the first entry block. */
+#define HASH_MIN_SIZE 8
+
+/** Distance of slot i from the home position of its key. */
+#define SLOT_DIST(h, i) (((i) - (h)->slot[i].hash) & ((h)->size - 1))
+
 static int32
-prime_size(int32 size)
+slot_size(int32 size)
 {
-    int32 i;
+    int32 n;
 
-    for (i = 0; (prime[i] > 0) && (prime[i] < size); i++);
-    if (prime[i] <= 0) {
-        E_WARN("Very large hash table requested (%d entries)\n", size);
-        --i;
-    }
-    return (prime[i]);
+    /* Power of two large enough to hold size entries at the target
+     * load factor. */
+    for (n = HASH_MIN_SIZE; n * HASH_LOAD_NUM < size * HASH_LOAD_DEN; n <<= 1)
+        ;
+    return n;
 }
 
 
@@ -161,73 +138,52 @@ hash_table_new(int32 size, int32 casearg)
     hash_table_t *h;
 
     h = (hash_table_t *) ckd_calloc(1, sizeof(hash_table_t));
-    h->size = prime_size(size + (size >> 1));
+    h->size = slot_size(size);
     h->nocase = (casearg == HASH_CASE_NO);
-    h->table = (hash_entry_t *) ckd_calloc(h->size, sizeof(hash_entry_t));
-    /* The above calloc clears h->table[*].key and .next to NULL, i.e. an empty table */
+    h->slot = (hash_slot_t *) ckd_calloc(h->size, sizeof(hash_slot_t));
+    /* Entry blocks are allocated on demand, the first one large
+     * enough for the expected number of entries. */
+    h->block_size = HASH_MIN_SIZE;
+    while (h->block_size < size)
+        h->block_size <<= 1;
 
     return h;
 }
 
 
 /*
- * Compute hash value for given key string.
- * Somewhat tuned for English text word strings.
+ * Compute hash value for given key.  This is FNV-1a followed by the
+ * MurmurHash3 finalizer, so that the low bits used to index the
+ * power-of-two slot array are well mixed.
  */
 static uint32
-key2hash(hash_table_t * h, const char *key)
+key2hash(hash_table_t * h, const char *key, size_t len)
 {
+    const unsigned char *cp, *end;
+    uint32 hash;
 
-    register const char *cp;
-
-    /* This is a hack because the best way to solve it is to make sure 
-       all character representation is unsigned character in the first place.        
-       (or better unicode.) */
-    register unsigned char c;
-    register int32 s;
-    register uint32 hash;
-
-    hash = 0;
-    s = 0;
-
+    hash = 0x811c9dc5;
+    end = (const unsigned char *)key + len;
     if (h->nocase) {
-        for (cp = key; *cp; cp++) {
-            c = *cp;
-            c = UPPER_CASE(c);
-            hash += c << s;
-            s += 5;
-            if (s >= 25)
-                s -= 24;
+        for (cp = (const unsigned char *)key; cp < end; cp++) {
+            unsigned char c = *cp;
+            hash ^= UPPER_CASE(c);
+            hash *= 0x01000193;
         }
     }
     else {
-        for (cp = key; *cp; cp++) {
-            hash += (*cp) << s;
-            s += 5;
-            if (s >= 25)
-                s -= 24;
+        for (cp = (const unsigned char *)key; cp < end; cp++) {
+            hash ^= *cp;
+            hash *= 0x01000193;
         }
     }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
 
-    return (hash % h->size);
-}
-
-
-static char *
-makekey(uint8 * data, size_t len, char *key)
-{
-    size_t i, j;
-
-    if (!key)
-        key = (char *) ckd_calloc(len * 2 + 1, sizeof(char));
-
-    for (i = 0, j = 0; i < len; i++, j += 2) {
-        key[j] = 'A' + (data[i] & 0x000f);
-        key[j + 1] = 'J' + ((data[i] >> 4) & 0x000f);
-    }
-    key[j] = '\0';
-
-    return key;
+    return hash;
 }
 
 
@@ -252,71 +208,51 @@ keycmp_nocase(hash_entry_t * entry, const char *key)
 }
 
 
-static int32
-keycmp_case(hash_entry_t * entry, const char *key)
-{
-    char c1, c2;
-    int32 i;
-    const char *str;
-
-    str = entry->key;
-    for (i = 0; (uint32)i < entry->len; i++) {
-        c1 = *(str++);
-        c2 = *(key++);
-        if (c1 != c2)
-            return (c1 - c2);
-    }
-
-    return 0;
-}
-
-
 /*
- * Lookup entry with hash-value hash in table h for given key
- * Return value: hash_entry_t for key
+ * Find the slot holding given key with hash value hash in table h.
+ * Return value: index of the slot, or -1 if not found.
  */
-static hash_entry_t *
+static int32
 lookup(hash_table_t * h, uint32 hash, const char *key, size_t len)
 {
-    hash_entry_t *entry;
-
-    entry = &(h->table[hash]);
-    if (entry->key == NULL)
-        return NULL;
-
-    if (h->nocase) {
-        while (entry && ((entry->len != len)
-                         || (keycmp_nocase(entry, key) != 0)))
-            entry = entry->next;
-    }
-    else {
-        while (entry && ((entry->len != len)
-                         || (keycmp_case(entry, key) != 0)))
-            entry = entry->next;
+    uint32 mask, i, dist;
+
+    mask = h->size - 1;
+    for (i = hash & mask, dist = 0;; i = (i + 1) & mask, ++dist) {
+        hash_slot_t *s = h->slot + i;
+        if (s->ent == NULL)
+            return -1;
+        /* Robin Hood invariant: the key would have displaced this
+         * one if it were present. */
+        if (SLOT_DIST(h, i) < dist)
+            return -1;
+        if (s->hash == hash && s->ent->len == len) {
+            if (h->nocase) {
+                if (keycmp_nocase(s->ent, key) == 0)
+                    return i;
+            }
+            else {
+                if (memcmp(s->ent->key, key, len) == 0)
+                    return i;
+            }
+        }
     }
-
-    return entry;
 }
 
 
 int32
 hash_table_lookup(hash_table_t * h, const char *key, void ** val)
 {
-    hash_entry_t *entry;
-    uint32 hash;
     size_t len;
+    int32 i;
 
-    hash = key2hash(h, key);
     len = strlen(key);
-
-    entry = lookup(h, hash, key, len);
-    if (entry) {
-        if (val)
-            *val = entry->val;
-        return 0;
-    }
-    else
+    i = lookup(h, key2hash(h, key, len), key, len);
+    if (i < 0)
         return -1;
+    if (val)
+        *val = h->slot[i].ent->val;
+    return 0;
 }
 
 int32
@@ -337,22 +273,14 @@ hash_table_lookup_int32(hash_table_t * h, const char *key, int32 *val)
 int32
 hash_table_lookup_bkey(hash_table_t * h, const char *key, size_t len, void ** val)
 {
-    hash_entry_t *entry;
-    uint32 hash;
-    char *str;
-
-    str = makekey((uint8 *) key, len, NULL);
-    hash = key2hash(h, str);
-    ckd_free(str);
+    int32 i;
 
-    entry = lookup(h, hash, key, len);
-    if (entry) {
-        if (val)
-            *val = entry->val;
-        return 0;
-    }
-    else
+    i = lookup(h, key2hash(h, key, len), key, len);
+    if (i < 0)
         return -1;
+    if (val)
+        *val = h->slot[i].ent->val;
+    return 0;
 }
 
 int32
@@ -370,14 +298,97 @@ hash_table_lookup_bkey_int32(hash_table_t * h, const char *key, size_t len, int3
 }
 
 
+/*
+ * Place an entry in the slot array, displacing entries which are
+ * closer to their home position than it is to its own.
+ */
+static void
+insert_slot(hash_table_t * h, uint32 hash, hash_entry_t *ent)
+{
+    uint32 mask, i, dist;
+
+    mask = h->size - 1;
+    for (i = hash & mask, dist = 0;; i = (i + 1) & mask, ++dist) {
+        hash_slot_t *s = h->slot + i;
+        uint32 sdist;
+
+        if (s->ent == NULL) {
+            s->hash = hash;
+            s->ent = ent;
+            return;
+        }
+        sdist = SLOT_DIST(h, i);
+        if (sdist < dist) {
+            uint32 thash = s->hash;
+            hash_entry_t *tent = s->ent;
+            s->hash = hash;
+            s->ent = ent;
+            hash = thash;
+            ent = tent;
+            dist = sdist;
+        }
+    }
+}
+
+
+static void
+grow(hash_table_t * h)
+{
+    hash_slot_t *old;
+    int32 i, oldsize;
+
+    old = h->slot;
+    oldsize = h->size;
+    h->size <<= 1;
+    h->slot = (hash_slot_t *) ckd_calloc(h->size, sizeof(hash_slot_t));
+    /* Hashes are stored, so keys need not be looked at again. */
+    for (i = 0; i < oldsize; ++i)
+        if (old[i].ent)
+            insert_slot(h, old[i].hash, old[i].ent);
+    ckd_free(old);
+}
+
+
+static hash_entry_t *
+alloc_entry(hash_table_t * h)
+{
+    hash_entry_t *ent;
+    int32 n_alloc, blk, blk_size;
+
+    if (h->free_ent) {
+        ent = h->free_ent;
+        h->free_ent = ent->next;
+        return ent;
+    }
+
+    /* Find the block containing the next unused entry. */
+    n_alloc = h->n_ent;
+    for (blk = 0, blk_size = h->block_size; n_alloc >= blk_size;
+         ++blk, blk_size <<= 1)
+        n_alloc -= blk_size;
+    if (blk >= h->n_block) {
+        h->block = (hash_entry_t **) ckd_realloc(h->block,
+                                                 (blk + 1) * sizeof(*h->block));
+        h->block[blk] = (hash_entry_t *) ckd_calloc(blk_size,
+                                                    sizeof(hash_entry_t));
+        h->n_block = blk + 1;
+    }
+    ++h->n_ent;
+
+    return h->block[blk] + n_alloc;
+}
+
+
 static void *
 enter(hash_table_t * h, uint32 hash, const char *key, size_t len, void *val, int32 replace)
 {
-    hash_entry_t *cur, *new;
+    hash_entry_t *cur;
+    int32 i;
 
-    if ((cur = lookup(h, hash, key, len)) != NULL) {
+    if ((i = lookup(h, hash, key, len)) >= 0) {
         void *oldval;
         /* Key already exists. */
+        cur = h->slot[i].ent;
         oldval = cur->val;
         if (replace) {
             /* Replace the pointer if replacement is requested,
@@ -389,26 +400,14 @@ enter(hash_table_t * h, uint32 hash, const char *key, size_t len, void *val, int
         return oldval;
     }
 
-    cur = &(h->table[hash]);
-    if (cur->key == NULL) {
-        /* Empty slot at hashed location; add this entry */
-        cur->key = key;
-        cur->len = len;
-        cur->val = val;
-
-        /* Added by ARCHAN at 20050515. This allows deletion could work. */
-        cur->next = NULL;
-
-    }
-    else {
-        /* Key collision; create new entry and link to hashed location */
-        new = (hash_entry_t *) ckd_calloc(1, sizeof(hash_entry_t));
-        new->key = key;
-        new->len = len;
-        new->val = val;
-        new->next = cur->next;
-        cur->next = new;
-    }
+    if ((h->inuse + 1) * HASH_LOAD_DEN > h->size * HASH_LOAD_NUM)
+        grow(h);
+    cur = alloc_entry(h);
+    cur->key = key;
+    cur->len = len;
+    cur->val = val;
+    cur->next = NULL;
+    insert_slot(h, hash, cur);
     ++h->inuse;
 
     return val;
@@ -418,82 +417,55 @@ enter(hash_table_t * h, uint32 hash, const char *key, size_t len, void *val, int
 static void *
 delete(hash_table_t * h, uint32 hash, const char *key, size_t len)
 {
-    hash_entry_t *entry, *prev;
+    hash_entry_t *entry;
+    uint32 i, j, mask;
+    int32 k;
     void *val;
 
-    prev = NULL;
-    entry = &(h->table[hash]);
-    if (entry->key == NULL)
-        return NULL;
-
-    if (h->nocase) {
-        while (entry && ((entry->len != len)
-                         || (keycmp_nocase(entry, key) != 0))) {
-            prev = entry;
-            entry = entry->next;
-        }
-    }
-    else {
-        while (entry && ((entry->len != len)
-                         || (keycmp_case(entry, key) != 0))) {
-            prev = entry;
-            entry = entry->next;
-        }
-    }
-
-    if (entry == NULL)
+    if ((k = lookup(h, hash, key, len)) < 0)
         return NULL;
 
-    /* At this point, entry will be the one required to be deleted, prev
-       will contain the previous entry
-     */
+    entry = h->slot[k].ent;
     val = entry->val;
-
-    if (prev == NULL) {
-        /* That is to say the entry in the hash table (not the chain) matched the key. */
-        /* We will then copy the things from the next entry to the hash table */
-        prev = entry;
-        if (entry->next) {      /* There is a next entry, great, copy it. */
-            entry = entry->next;
-            prev->key = entry->key;
-            prev->len = entry->len;
-            prev->val = entry->val;
-            prev->next = entry->next;
-            ckd_free(entry);
-        }
-        else {                  /* There is not a next entry, just set the key to null */
-            prev->key = NULL;
-            prev->len = 0;
-            prev->next = NULL;
-        }
-
-    }
-    else {                      /* This case is simple */
-        prev->next = entry->next;
-        ckd_free(entry);
-    }
-
-    /* Do wiring and free the entry */
+    entry->key = NULL;
+    entry->len = 0;
+    entry->val = NULL;
+    entry->next = h->free_ent;
+    h->free_ent = entry;
+
+    /* Shift following displaced slots back by one, so no tombstones
+     * are needed. */
+    mask = h->size - 1;
+    for (i = k, j = (i + 1) & mask;
+         h->slot[j].ent && SLOT_DIST(h, j) != 0;
+         i = j, j = (j + 1) & mask)
+        h->slot[i] = h->slot[j];
+    h->slot[i].ent = NULL;
+    h->slot[i].hash = 0;
 
     --h->inuse;
 
     return val;
 }
 
-void
-hash_table_empty(hash_table_t *h)
+static void
+free_entries(hash_table_t *h)
 {
-    hash_entry_t *e, *e2;
     int32 i;
 
-    for (i = 0; i < h->size; i++) {
-        /* Free collision lists. */
-        for (e = h->table[i].next; e; e = e2) {
-            e2 = e->next;
-            ckd_free((void *) e);
-        }
-        memset(&h->table[i], 0, sizeof(h->table[i]));
-    }
+    for (i = 0; i < h->n_block; ++i)
+        ckd_free(h->block[i]);
+    ckd_free(h->block);
+    h->block = NULL;
+    h->n_block = h->n_ent = 0;
+    h->free_ent = NULL;
+}
+
+void
+hash_table_empty(hash_table_t *h)
+{
+    free_entries(h);
+    memset(h->slot, 0, h->size * sizeof(*h->slot));
     h->inuse = 0;
 }
 
@@ -501,112 +473,67 @@ hash_table_empty(hash_table_t *h)
 void *
 hash_table_enter(hash_table_t * h, const char *key, void *val)
 {
-    uint32 hash;
     size_t len;
 
-    hash = key2hash(h, key);
     len = strlen(key);
-    return (enter(h, hash, key, len, val, FALSE));
+    return (enter(h, key2hash(h, key, len), key, len, val, 0));
 }
 
 void *
 hash_table_replace(hash_table_t * h, const char *key, void *val)
 {
-    uint32 hash;
     size_t len;
 
-    hash = key2hash(h, key);
     len = strlen(key);
-    return (enter(h, hash, key, len, val, TRUE));
+    return (enter(h, key2hash(h, key, len), key, len, val, 1));
 }
 
 void *
 hash_table_delete(hash_table_t * h, const char *key)
 {
-    uint32 hash;
     size_t len;
 
-    hash = key2hash(h, key);
     len = strlen(key);
-
-    return (delete(h, hash, key, len));
+    return (delete(h, key2hash(h, key, len), key, len));
 }
 
 void *
 hash_table_enter_bkey(hash_table_t * h, const char *key, size_t len, void *val)
 {
-    uint32 hash;
-    char *str;
-
-    str = makekey((uint8 *) key, len, NULL);
-    hash = key2hash(h, str);
-    ckd_free(str);
-
-    return (enter(h, hash, key, len, val, FALSE));
+    return (enter(h, key2hash(h, key, len), key, len, val, 0));
 }
 
 void *
 hash_table_replace_bkey(hash_table_t * h, const char *key, size_t len, void *val)
 {
-    uint32 hash;
-    char *str;
-
-    str = makekey((uint8 *) key, len, NULL);
-    hash = key2hash(h, str);
-    ckd_free(str);
-
-    return (enter(h, hash, key, len, val, TRUE));
+    return (enter(h, key2hash(h, key, len), key, len, val, 1));
 }
 
 void *
 hash_table_delete_bkey(hash_table_t * h, const char *key, size_t len)
 {
-    uint32 hash;
-    char *str;
-
-    str = makekey((uint8 *) key, len, NULL);
-    hash = key2hash(h, str);
-    ckd_free(str);
-
-    return (delete(h, hash, key, len));
+    return (delete(h, key2hash(h, key, len), key, len));
 }
 
+
 void
 hash_table_display(hash_table_t * h, int32 showdisplay)
 {
-    hash_entry_t *e;
-    int i, j;
+    hash_iter_t *itor;
+    int j;
     j = 0;
 
-    printf("Hash with chaining representation of the hash table\n");
-
-    for (i = 0; i < h->size; i++) {
-        e = &(h->table[i]);
-        if (e->key != NULL) {
-            printf("|key:");
-            if (showdisplay)
-                printf("%s", e->key);
-            else
-                printf("%p", e->key);
-
-            printf("|len:%zd|val=%zd|->", e->len, (size_t)e->val);
-            if (e->next == NULL) {
-                printf("NULL\n");
-            }
-            j++;
-
-            for (e = e->next; e; e = e->next) {
-                printf("|key:");
-                if (showdisplay)
-                    printf("%s", e->key);
-
-                printf("|len:%zd|val=%zd|->", e->len, (size_t)e->val);
-                if (e->next == NULL) {
-                    printf("NULL\n");
-                }
-                j++;
-            }
-        }
+    printf("Open addressing representation of the hash table\n");
+
+    for (itor = hash_table_iter(h); itor; itor = hash_table_iter_next(itor)) {
+        hash_entry_t *e = itor->ent;
+        printf("|key:");
+        if (showdisplay)
+            printf("%s", e->key);
+        else
+            printf("%p", e->key);
+        printf("|len:%zd|val=%zd|\n", e->len, (size_t)e->val);
+        j++;
     }
 
     printf("The total number of keys =%d\n", j);
@@ -617,30 +544,22 @@ glist_t
 hash_table_tolist(hash_table_t * h, int32 * count)
 {
     glist_t g;
-    hash_entry_t *e;
-    int32 i, j;
+    hash_iter_t *itor;
+    int32 j;
 
     g = NULL;
 
     j = 0;
-    for (i = 0; i < h->size; i++) {
-        e = &(h->table[i]);
-
-        if (e->key != NULL) {
-            g = glist_add_ptr(g, (void *) e);
-            j++;
-
-            for (e = e->next; e; e = e->next) {
-                g = glist_add_ptr(g, (void *) e);
-                j++;
-            }
-        }
+    for (itor = hash_table_iter(h); itor; itor = hash_table_iter_next(itor)) {
+        g = glist_add_ptr(g, (void *) itor->ent);
+        j++;
     }
 
     if (count)
         *count = j;
 
-    return g;
+    /* Return entries in the same order as iteration. */
+    return glist_reverse(g);
 }
 
 hash_iter_t *
@@ -656,27 +575,28 @@ hash_table_iter(hash_table_t *h)
 hash_iter_t *
 hash_table_iter_next(hash_iter_t *itor)
 {
-	/* If there is an entry, walk down its list. */
-	if (itor->ent)
-		itor->ent = itor->ent->next;
-	/* If we got to the end of the chain, or we had no entry, scan
-	 * forward in the table to find the next non-empty bucket. */
-	if (itor->ent == NULL) {
-              while (itor->idx < (size_t)itor->ht->size
-		       && itor->ht->table[itor->idx].key == NULL) 
-			++itor->idx;
-		/* If we did not find one then delete the iterator and
-		 * return NULL. */
-                if (itor->idx == (size_t)itor->ht->size) {
+	hash_table_t *h = itor->ht;
+
+	/* Scan forward through the entry blocks to the next live entry.
+	 * Entries never move, so insertions made during iteration do
+	 * not disturb the position. */
+	for (;;) {
+		size_t blk_size = (size_t)h->block_size << itor->blk;
+		if (itor->n >= (size_t)h->n_ent) {
 			hash_table_iter_free(itor);
 			return NULL;
 		}
-		/* Otherwise use this next entry. */
-		itor->ent = itor->ht->table + itor->idx;
-		/* Increase idx for the next time around. */
+		if (itor->idx == blk_size) {
+			++itor->blk;
+			itor->idx = 0;
+			continue;
+		}
+		itor->ent = h->block[itor->blk] + itor->idx;
 		++itor->idx;
+		++itor->n;
+		if (itor->ent->key != NULL)
+			return itor;
 	}
-	return itor;
 }
 
 void
@@ -688,20 +608,10 @@ hash_table_iter_free(hash_iter_t *itor)
 void
 hash_table_free(hash_table_t * h)
 {
-    hash_entry_t *e, *e2;
-    int32 i;
-
     if (h == NULL)
         return;
 
-    /* Free additional entries created for key collision cases */
-    for (i = 0; i < h->size; i++) {
-        for (e = h->table[i].next; e; e = e2) {
-            e2 = e->next;
-            ckd_free((void *) e);
-        }
-    }
-
-    ckd_free((void *) h->table);
+    free_entries(h);
+    ckd_free((void *) h->slot);
     ckd_free((void *) h);
 }
@@ -138,11 +138,12 @@ extern "C" {
 
 /**
  * The hash table structures.
- * Each hash table is identified by a hash_table_t structure.  hash_table_t.table is
- * pre-allocated for a user-controlled max size, and is initially empty.  As new
- * entries are created (using hash_enter()), the empty entries get filled.  If multiple
- * keys hash to the same entry, new entries are allocated and linked together in a
- * linear list.
+ * Each hash table is identified by a hash_table_t structure.  hash_table_t.slot is
+ * an open-addressed array (using Robin Hood probing) of pointers to entries along
+ * with the full hash of their keys, so that most probes never touch the keys.  It
+ * is sized to a power of two for the expected number of entries and doubled when
+ * it gets too full.  The entries themselves are allocated in blocks which never
+ * move, so hash_entry_t pointers remain valid until the entry is deleted.
  */
 
 typedef struct hash_entry_s {
@@ -152,22 +153,34 @@ typedef struct hash_entry_s {
 	size_t len;			/** Key-length; the key string does not have to be a C-style NULL
 					    terminated string; it can have arbitrary binary bytes */
 	void *val;			/** Value associated with above key */
-	struct hash_entry_s *next;	/** For collision resolution */
+	struct hash_entry_s *next;	/** Next free entry, for deleted entries */
 } hash_entry_t;
 
+typedef struct hash_slot_s {
+	uint32 hash;		/** Full hash value of the key in this slot */
+	hash_entry_t *ent;	/** Entry in this slot, NULL if it is empty */
+} hash_slot_t;
+
 typedef struct hash_table_s {
-	hash_entry_t *table;	/**Primary hash table, excluding entries that collide */
-	int32 size;		/** Primary hash table size, (is a prime#); NOTE: This is the
-				    number of primary entries ALLOCATED, NOT the number of valid
+	hash_slot_t *slot;	/** Open-addressed slot array */
+	int32 size;		/** Number of slots (a power of two); NOTE: This is the
+				    number of slots ALLOCATED, NOT the number of valid
 				    entries in the table */
 	int32 inuse;		/** Number of valid entries in the table. */
 	int32 nocase;		/** Whether case insensitive for key comparisons */
+	hash_entry_t **block;	/** Entry storage, block i has block_size << i entries */
+	int32 n_block;		/** Number of entry blocks allocated */
+	int32 block_size;	/** Number of entries in the first block */
+	int32 n_ent;		/** Number of entries taken from the blocks */
+	hash_entry_t *free_ent;	/** List of deleted entries available for reuse */
 } hash_table_t;
 
 typedef struct hash_iter_s {
 	hash_table_t *ht;  /**< Hash table we are iterating over. */
 	hash_entry_t *ent; /**< Current entry in that table. */
-	size_t idx;        /**< Index of next bucket to search. */
+	size_t idx;        /**< Index of next entry in current block. */
+	size_t blk;        /**< Current entry block. */
+	size_t n;          /**< Number of entries visited so far. */
 } hash_iter_t;
 
 /** Access macros */
@@ -379,6 +392,9 @@ int32 hash_table_lookup_bkey_int32(hash_table_t *h,/**< In: Handle of hash table
 
 /**
  * Start iterating over key-value pairs in a hash table.
+ * Entries are visited roughly in order of insertion.  It is safe to
+ * add entries to the table while iterating over it, though they may
+ * or may not be visited.
  */
 hash_iter_t *hash_table_iter(hash_table_t *h);
 
@@ -399,6 +415,7 @@ void hash_table_iter_free(hash_iter_t *itor);
 
 /**
  * Build a glist of valid hash_entry_t pointers from the given hash table.  Return the list.
+ * Entries are listed in the same order as they are visited by hash_table_iter().
  */
 glist_t hash_table_tolist(hash_table_t *h,	/**< In: Hash table from which list is to be generated */
                           int32 *count		/**< Out: Number of entries in the list.
@@ -407,7 +424,7 @@ glist_t hash_table_tolist(hash_table_t *h,	/**< In: Hash table from which list i
 	);
 
 /**
- * Display a hash-with-chaining representation on the screen.
+ * Display the entries of a hash table on the screen.
  * Currently, it will only works for situation where hash_enter was
  * used to enter the keys. 
  */
@@ -37,12 +37,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <pocketsphinx/err.h>
 
 #include "util/ckd_alloc.h"
 #include "util/listelem_alloc.h"
 #include "util/glist.h"
+#include "util/thread_local.h"
 
 /**
  * Fast linked list allocator.
@@ -78,6 +80,86 @@ struct listelem_alloc_s {
 #define BLKID_SHIFT     16      /**< Bit position of block number in element ID */
 #define BLKID_MASK ((1<<BLKID_SHIFT)-1)
 
+/**
+ * Per-thread cache of released blocks.
+ *
+ * Allocators are typically created and destroyed over and over again
+ * (for instance, one set per word lattice) in the same thread.  When
+ * enabled with listelem_thread_cache(), the blocks of a freed
+ * allocator are kept here, chained through their first machine word
+ * with their size in the second, and handed back out to allocators
+ * which need a block of the same size, without going through the
+ * system allocator (and its locks) at all.
+ */
+#ifdef PS_USE_THREAD_LOCAL_RNG
+PS_THREAD_LOCAL static char **blk_cache;
+PS_THREAD_LOCAL static size_t blk_cache_bytes;
+PS_THREAD_LOCAL static size_t blk_cache_max;
+
+static char **
+blk_cache_get(size_t size)
+{
+    char **blk, **prev;
+
+    for (prev = NULL, blk = blk_cache; blk;
+         prev = blk, blk = (char **)blk[0]) {
+        if ((size_t)blk[1] == size) {
+            if (prev)
+                prev[0] = blk[0];
+            else
+                blk_cache = (char **)blk[0];
+            blk_cache_bytes -= size;
+            memset(blk, 0, size);
+            return blk;
+        }
+    }
+    return NULL;
+}
+
+static int
+blk_cache_put(char **blk, size_t size)
+{
+    if (blk_cache_bytes + size > blk_cache_max)
+        return FALSE;
+    blk[0] = (char *)blk_cache;
+    blk[1] = (char *)size;
+    blk_cache = blk;
+    blk_cache_bytes += size;
+    return TRUE;
+}
+#else
+#define blk_cache_get(size) NULL
+#define blk_cache_put(blk, size) FALSE
+#endif
+
+int
+listelem_thread_cache(size_t max_bytes)
+{
+#ifdef PS_USE_THREAD_LOCAL_RNG
+    blk_cache_max = max_bytes;
+    /* Release the oldest blocks until we are under the limit. */
+    while (blk_cache && blk_cache_bytes > blk_cache_max) {
+        char **blk, **prev;
+        for (prev = NULL, blk = blk_cache; blk[0];
+             prev = blk, blk = (char **)blk[0])
+            ;
+        if (prev)
+            prev[0] = NULL;
+        else
+            blk_cache = NULL;
+        blk_cache_bytes -= (size_t)blk[1];
+        ckd_free(blk);
+    }
+    return 0;
+#else
+    if (max_bytes) {
+        E_WARN("Thread-local storage not available, not caching blocks\n");
+        return -1;
+    }
+    return 0;
+#endif
+}
+
 /**
  * Allocate a new block of elements.
  */
@@ -121,11 +203,15 @@ listelem_alloc_init(size_t elemsize)
 void
 listelem_alloc_free(listelem_alloc_t *list)
 {
-    gnode_t *gn;
+    gnode_t *gn, *gn2;
     if (list == NULL)
 	return;
-    for (gn = list->blocks; gn; gn = gnode_next(gn))
-	ckd_free(gnode_ptr(gn));
+    gn2 = list->blocksize;
+    for (gn = list->blocks; gn; gn = gnode_next(gn)) {
+        if (!blk_cache_put(gnode_ptr(gn), gnode_int32(gn2) * list->elemsize))
+            ckd_free(gnode_ptr(gn));
+        gn2 = gnode_next(gn2);
+    }
     glist_free(list->blocks);
     glist_free(list->blocksize);
     ckd_free(list);
@@ -150,10 +236,11 @@ listelem_add_block(listelem_alloc_t *list, char *caller_file, int caller_line)
 	list->blk_alloc = (1 << 18) / (blocksize * list->elemsize);
     }
 
-    /* Allocate block */
-    cpp = list->freelist =
-	(char **) __ckd_calloc__(blocksize, list->elemsize,
-				 caller_file, caller_line);
+    /* Allocate block, reusing a cached one if possible */
+    if ((cpp = blk_cache_get(blocksize * list->elemsize)) == NULL)
+        cpp = (char **) __ckd_calloc__(blocksize, list->elemsize,
+                                       caller_file, caller_line);
+    list->freelist = cpp;
     list->blocks = glist_add_ptr(list->blocks, cpp);
     list->blocksize = glist_add_int32(list->blocksize, blocksize);
     cp = (char *) cpp;
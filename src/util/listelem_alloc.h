@@ -56,6 +56,7 @@ extern "C" {
 #endif
 
 #include <pocketsphinx/prim_type.h>
+#include <pocketsphinx/alloc.h>
 
 /**
  * List element allocator object.
@@ -103,6 +104,8 @@ void __listelem_free__(listelem_alloc_t *le, void *elem, char *file, int line);
  */
 #define listelem_free(le,el)	__listelem_free__((le),(el),__FILE__,__LINE__)
 
+/* listelem_thread_cache() is declared in <pocketsphinx/alloc.h>. */
+
 /**
    Print number of allocation, number of free operation stats 
 */
@@ -0,0 +1,64 @@
+#!/bin/bash
+
+: ${CMAKE_BINARY_DIR:=$(pwd)}
+. ${CMAKE_BINARY_DIR}/test/testfuncs.sh
+
+bn=`basename $0 .sh`
+
+echo "Test: $bn"
+rm -rf $bn.lat
+run_program pocketsphinx_batch \
+    -hmm $data/tidigits/hmm \
+    -lm $data/tidigits/lm/tidigits.lm.bin \
+    -dict $data/tidigits/lm/tidigits.dic \
+    -ctl $data/tidigits/tidigits.ctl \
+    -cepdir $data/tidigits \
+    -outlatdir $bn.lat \
+    -loglevel INFO \
+    > $bn.log 2>&1
+
+# Test whether it actually completed
+if [ $? = 0 ]; then
+    pass "decode"
+else
+    fail "decode"
+fi
+
+# Rescore the lattices in parallel
+run_program pocketsphinx_lattice_rescore \
+    -lm $data/tidigits/lm/tidigits.lm.bin \
+    -ctl $data/tidigits/tidigits.ctl \
+    -inlatdir $bn.lat \
+    -nthreads 2 \
+    -hyp $bn.match \
+    -loglevel INFO \
+    > $bn.rescore.log 2>&1
+
+if [ $? = 0 ]; then
+    pass "rescore"
+else
+    fail "rescore"
+fi
+
+# Check the rescoring results
+$tests/word_align.pl -i $data/tidigits/tidigits.lsn $bn.match | grep 'TOTAL Percent'
+compare_table "match" $data/tidigits/test-tidigits-simple.match $bn.match 100000
+
+# Keeping fewer histories per node must keep fewer in total
+run_program pocketsphinx_lattice_rescore \
+    -lm $data/tidigits/lm/tidigits.lm.bin \
+    -ctl $data/tidigits/tidigits.ctl \
+    -inlatdir $bn.lat \
+    -maxhist 1 \
+    -hyp $bn.maxhist.match \
+    -loglevel INFO \
+    > $bn.maxhist.log 2>&1
+rv=$?
+n_full=`awk '/Rescored/ { n += $(NF-4) } END { print n }' $bn.rescore.log`
+n_pruned=`awk '/Rescored/ { n += $(NF-4) } END { print n }' $bn.maxhist.log`
+echo "$n_full histories, $n_pruned with -maxhist 1"
+if [ $rv = 0 ] && [ -n "$n_pruned" ] && [ "$n_pruned" -lt "$n_full" ]; then
+    pass "maxhist"
+else
+    fail "maxhist"
+fi
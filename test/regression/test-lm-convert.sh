@@ -27,6 +27,30 @@ else
     fail "arpa -> bin"
 fi
 
+run_program pocketsphinx_lm_convert \
+            -i $bn.arpa \
+            -o $bn.threads.bin \
+            -nthreads 4 \
+            > $bn.log 2>&1
+if [ $? = 0 ] && cmp -s $bn.bin $bn.threads.bin; then
+    pass "arpa -> bin with threads"
+else
+    fail "arpa -> bin with threads"
+fi
+
+# Compressed files are not memory-mapped
+gzip -c $bn.arpa > $bn.arpa.gz
+run_program pocketsphinx_lm_convert \
+            -i $bn.arpa.gz \
+            -o $bn.gz.bin \
+            -nthreads 4 \
+            > $bn.log 2>&1
+if [ $? = 0 ] && cmp -s $bn.bin $bn.gz.bin; then
+    pass "arpa.gz -> bin"
+else
+    fail "arpa.gz -> bin"
+fi
+
 run_program pocketsphinx_lm_convert \
             -i $bn.arpa \
             -o $bn.dmp \
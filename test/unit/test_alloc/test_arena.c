@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "util/arena.h"
+
+#include "test_macros.h"
+
+struct bogus {
+	char const *str;
+	long foobie;
+};
+
+int
+main(int argc, char *argv[])
+{
+	arena_t *a;
+	struct bogus *bogus[600], *big;
+	int i;
+
+	(void)argc;
+	(void)argv;
+	TEST_ASSERT(a = arena_init(1024));
+	for (i = 0; i < 600; ++i) {
+		bogus[i] = arena_calloc(a, 1, sizeof(struct bogus));
+		TEST_EQUAL(0, bogus[i]->foobie);
+		TEST_EQUAL(0, (size_t)bogus[i] % sizeof(void *));
+		bogus[i]->str = "hello";
+		bogus[i]->foobie = i;
+	}
+	/* Larger than a block. */
+	big = arena_calloc(a, 1000, sizeof(*big));
+	big[999].foobie = 42;
+	for (i = 0; i < 600; ++i)
+		TEST_EQUAL(i, bogus[i]->foobie);
+	TEST_ASSERT(arena_used(a) >= 1600 * sizeof(struct bogus));
+
+	/* Memory is reused after a reset. */
+	arena_reset(a);
+	TEST_EQUAL(0, arena_used(a));
+	TEST_EQUAL(bogus[0], arena_calloc(a, 1, sizeof(struct bogus)));
+	TEST_EQUAL(0, bogus[0]->foobie);
+	for (i = 1; i < 600; ++i)
+		arena_calloc(a, 1, sizeof(struct bogus));
+	big = arena_calloc(a, 2000, sizeof(*big));
+	big[1999].foobie = 42;
+
+	TEST_ASSERT(arena_retain(a) == a);
+	TEST_EQUAL(1, arena_free(a));
+	TEST_EQUAL(0, arena_free(a));
+
+	return 0;
+}
@@ -1,9 +1,41 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "util/ckd_alloc.h"
 
 #include "test_macros.h"
 
+/* Allocator hook which just counts live allocations. */
+static void *
+count_malloc(void *ctx, size_t size)
+{
+	++*(int *)ctx;
+	return malloc(size);
+}
+
+static void *
+count_calloc(void *ctx, size_t n, size_t size)
+{
+	++*(int *)ctx;
+	return calloc(n, size);
+}
+
+static void *
+count_realloc(void *ctx, void *ptr, size_t size)
+{
+	if (ptr == NULL)
+		++*(int *)ctx;
+	return realloc(ptr, size);
+}
+
+static void
+count_free(void *ctx, void *ptr)
+{
+	if (ptr)
+		--*(int *)ctx;
+	free(ptr);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -101,5 +133,30 @@ main(int argc, char *argv[])
 	ckd_free_3d_ptr(alloc3);
 	ckd_free(alloc1);
 
+	/* Test allocator hooks. */
+	{
+		int n_live = 0;
+		ckd_allocator_t counter = {
+			count_malloc, count_calloc, count_realloc, count_free,
+			&n_live
+		};
+		void ****alloc4;
+		char *str;
+
+		TEST_ASSERT(ckd_set_allocator(&counter) == NULL);
+		alloc3 = ckd_calloc_3d(3, 3, 3, sizeof(***alloc3));
+		TEST_EQUAL(3, n_live);
+		alloc4 = ckd_calloc_4d(2, 2, 2, 2, sizeof(int));
+		TEST_EQUAL(7, n_live);
+		str = ckd_salloc("hello");
+		str = ckd_realloc(str, 100);
+		TEST_EQUAL(8, n_live);
+		ckd_free(str);
+		ckd_free_4d(alloc4);
+		ckd_free_3d(alloc3);
+		TEST_EQUAL(0, n_live);
+		TEST_ASSERT(ckd_set_allocator(NULL) == &counter);
+	}
+
 	return 0;
 }
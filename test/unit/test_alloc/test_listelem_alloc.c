@@ -61,6 +61,21 @@ main(int argc, char *argv[])
 		listelem_alloc_free(le);
 	}
 
+	/* Test the per-thread block cache. */
+	if (listelem_thread_cache(1 << 20) == 0) {
+		le = listelem_alloc_init(sizeof(struct bogus));
+		bogus1 = listelem_malloc(le);
+		bogus1->foobie = 42;
+		listelem_alloc_free(le);
+		/* Same size, so should get the same (zeroed) block back. */
+		le = listelem_alloc_init(sizeof(struct bogus));
+		bogus2 = listelem_malloc(le);
+		TEST_EQUAL(bogus1, bogus2);
+		TEST_EQUAL(0, bogus2->foobie);
+		listelem_alloc_free(le);
+		TEST_EQUAL(0, listelem_thread_cache(0));
+	}
+
 
 	return 0;
 }
@@ -0,0 +1,104 @@
+/* Only use the public API here. */
+#include <pocketsphinx.h>
+#include <pocketsphinx/alloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_macros.h"
+
+static size_t n_alloc, n_free;
+
+static void *
+count_malloc(void *ctx, size_t size)
+{
+    TEST_ASSERT(ctx == &n_alloc);
+    ++n_alloc;
+    return malloc(size);
+}
+
+static void *
+count_calloc(void *ctx, size_t n_elem, size_t elem_size)
+{
+    TEST_ASSERT(ctx == &n_alloc);
+    ++n_alloc;
+    return calloc(n_elem, elem_size);
+}
+
+static void *
+count_realloc(void *ctx, void *ptr, size_t size)
+{
+    TEST_ASSERT(ctx == &n_alloc);
+    if (ptr == NULL)
+        ++n_alloc;
+    return realloc(ptr, size);
+}
+
+static void
+count_free(void *ctx, void *ptr)
+{
+    TEST_ASSERT(ctx == &n_alloc);
+    if (ptr)
+        ++n_free;
+    free(ptr);
+}
+
+static void
+decode(void)
+{
+    ps_decoder_t *ps;
+    ps_config_t *config;
+    FILE *rawfh;
+    int i;
+
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "loglevel: \"WARN\","
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    /* Several utterances, so lattices are created and freed. */
+    for (i = 0; i < 3; ++i) {
+        fseek(rawfh, 0, SEEK_SET);
+        TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+        TEST_ASSERT(ps_get_lattice(ps) != NULL);
+        TEST_EQUAL(0, strcmp("go forward ten meters", ps_get_hyp(ps, NULL)));
+    }
+    fclose(rawfh);
+    ps_free(ps);
+    ps_config_free(config);
+}
+
+int
+main(int argc, char *argv[])
+{
+    ckd_allocator_t counter = {
+        count_malloc, count_calloc, count_realloc, count_free, &n_alloc
+    };
+
+    (void)argc;
+    (void)argv;
+
+    /* Everything the decoder allocates goes through the hook, and is
+     * given back to it. */
+    TEST_ASSERT(ckd_set_allocator(&counter) == NULL);
+    decode();
+    TEST_ASSERT(ckd_set_allocator(NULL) == &counter);
+    printf("%lu allocations, %lu frees\n",
+           (unsigned long)n_alloc, (unsigned long)n_free);
+    TEST_ASSERT(n_alloc > 0);
+    TEST_EQUAL(n_alloc, n_free);
+
+    /* The per-thread block cache can be turned on and off around
+     * decoding, if the platform supports it. */
+    if (listelem_thread_cache(1 << 20) == 0) {
+        decode();
+        TEST_EQUAL(0, listelem_thread_cache(0));
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "test_macros.h"
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag;
+    ps_confnet_t *cn;
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    char line[1024];
+    int i, j, n_slots, n_empty, last_ef;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "bestpath: true,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+    /* Getting the hypothesis also calculates posteriors. */
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_get_hyp(ps, NULL)));
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+    lmath = ps_lattice_get_logmath(dag);
+
+    TEST_ASSERT(cn = ps_lattice_confnet(dag, logmath_get_zero(lmath)));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_confnet_hyp(cn)));
+    n_slots = ps_confnet_n_slots(cn);
+    TEST_ASSERT(n_slots >= 4);
+    last_ef = -1;
+    n_empty = 0;
+    for (i = 0; i < n_slots; ++i) {
+        int sf, ef, n_arcs;
+        int32 prob, last_prob;
+        double total;
+
+        n_arcs = ps_confnet_slot(cn, i, &sf, &ef);
+        TEST_ASSERT(n_arcs > 0);
+        TEST_ASSERT(sf <= ef);
+        /* Slots are in time order. */
+        TEST_ASSERT(sf > last_ef || ef > last_ef);
+        last_ef = ef;
+        printf("%d-%d:", sf, ef);
+        total = 0;
+        last_prob = MAX_INT32;
+        for (j = 0; j < n_arcs; ++j) {
+            char const *word = ps_confnet_word(cn, i, j, &prob);
+            /* Arcs are sorted best first. */
+            TEST_ASSERT(prob <= last_prob);
+            last_prob = prob;
+            total += logmath_exp(lmath, prob);
+            if (word == NULL)
+                ++n_empty;
+            printf(" %s %.3f", word ? word : "*DELETE*",
+                   logmath_exp(lmath, prob));
+        }
+        printf("\n");
+        /* Probabilities add up (roughly) to one. */
+        TEST_ASSERT(total > 0.99);
+    }
+    /* There are some words between the pivots, which are unlikely. */
+    TEST_ASSERT(n_empty > 0);
+    TEST_EQUAL(-1, ps_confnet_slot(cn, n_slots, NULL, NULL));
+    TEST_ASSERT(NULL == ps_confnet_word(cn, 0, 1000, NULL));
+
+    TEST_EQUAL(0, ps_confnet_write(cn, "goforward.mesh"));
+    TEST_ASSERT(rawfh = fopen("goforward.mesh", "r"));
+    TEST_ASSERT(fgets(line, sizeof(line), rawfh));
+    TEST_EQUAL(n_slots, atoi(line + strlen("numaligns ")));
+    fclose(rawfh);
+    remove("goforward.mesh");
+    ps_confnet_free(cn);
+
+    /* A tight beam leaves only the likely ones. */
+    TEST_ASSERT(cn = ps_lattice_confnet(dag, logmath_log(lmath, 0.5)));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_confnet_hyp(cn)));
+    TEST_ASSERT(ps_confnet_n_slots(cn) < n_slots);
+    for (i = 0; i < ps_confnet_n_slots(cn); ++i)
+        TEST_ASSERT(ps_confnet_slot(cn, i, NULL, NULL) <= 2);
+    ps_confnet_free(cn);
+
+    ps_free(ps);
+    ps_config_free(config);
+    return 0;
+}
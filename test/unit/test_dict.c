@@ -11,7 +11,7 @@ int
 main(int argc, char *argv[])
 {
 	bin_mdef_t *mdef;
-	dict_t *dict;
+	dict_t *dict, *dict2;
 	ps_config_t *config;
 
 	int i;
@@ -37,6 +37,32 @@ main(int argc, char *argv[])
 	TEST_EQUAL(0, dict_write(dict, "_cmu07a.dic", NULL));
 	TEST_EQUAL(0, system("diff -uw " MODELDIR "/en-us/cmudict-en-us.dict _cmu07a.dic"));
 
+	/* Test binary dictionary round-trip. */
+	TEST_EQUAL(0, dict_write(dict, "_cmu07a.bin", "bin"));
+	ps_config_set_str(config, "dict", "_cmu07a.bin");
+	TEST_ASSERT(dict2 = dict_init(config, mdef));
+	TEST_EQUAL(dict_size(dict), dict_size(dict2));
+	TEST_EQUAL(dict_filler_start(dict), dict_filler_start(dict2));
+	TEST_EQUAL(dict_filler_end(dict), dict_filler_end(dict2));
+	for (i = 0; i < dict_size(dict); ++i) {
+	    int j;
+	    TEST_EQUAL(i, dict_wordid(dict2, dict_wordstr(dict, i)));
+	    TEST_EQUAL(dict_basewid(dict, i), dict_basewid(dict2, i));
+	    TEST_EQUAL(dict_nextalt(dict, i), dict_nextalt(dict2, i));
+	    TEST_EQUAL(dict_pronlen(dict, i), dict_pronlen(dict2, i));
+	    for (j = 0; j < dict_pronlen(dict, i); ++j)
+		TEST_EQUAL(dict_pron(dict, i, j), dict_pron(dict2, i, j));
+	}
+	TEST_EQUAL(BAD_S3WID, dict_wordid(dict2, "ASDFASFASSD"));
+	TEST_EQUAL(dict_silwid(dict), dict_silwid(dict2));
+	/* Words can still be added to it. */
+	TEST_EQUAL(BAD_S3WID, dict_add_word(dict2, "carnegie", NULL, 0));
+	TEST_ASSERT(BAD_S3WID != (i = dict_add_word(dict2, "ASDFASFASSD", NULL, 0)));
+	TEST_EQUAL(i, dict_wordid(dict2, "ASDFASFASSD"));
+	TEST_EQUAL(0, dict_write(dict2, "_cmu07a.dic", NULL));
+	TEST_EQUAL(0, system("diff -uw " MODELDIR "/en-us/cmudict-en-us.dict _cmu07a.dic | grep -q '^+ASDFASFASSD'"));
+	dict_free(dict2);
+
 	dict_free(dict);
 	bin_mdef_free(mdef);
 
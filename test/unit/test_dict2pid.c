@@ -12,8 +12,9 @@ int
 main(int argc, char *argv[])
 {
 	bin_mdef_t *mdef;
-	dict_t *dict;
-	dict2pid_t *d2p;
+	dict_t *dict, *dict2;
+	dict2pid_t *d2p, *d2p2;
+	int32 n_ci, b, l, r, w;
 	ps_config_t *config;
 
 	(void)argc;
@@ -25,6 +26,51 @@ main(int argc, char *argv[])
 	TEST_ASSERT(dict = dict_init(config, mdef));
 	TEST_ASSERT(d2p = dict2pid_build(mdef, dict));
 
+	/* Binary dictionaries should give the same tables. */
+	TEST_EQUAL(0, dict_write(dict, "_cmu07a_d2p.bin", "bin"));
+	ps_config_set_str(config, "dict", "_cmu07a_d2p.bin");
+	TEST_ASSERT(dict2 = dict_init(config, mdef));
+	TEST_ASSERT(d2p2 = dict2pid_build(mdef, dict2));
+	n_ci = bin_mdef_n_ciphone(mdef);
+	for (b = 0; b < n_ci; ++b) {
+		for (l = 0; l < n_ci; ++l) {
+			TEST_EQUAL(d2p->rssid[b][l].n_ssid, d2p2->rssid[b][l].n_ssid);
+			TEST_EQUAL(d2p->lrssid[b][l].n_ssid, d2p2->lrssid[b][l].n_ssid);
+			for (r = 0; r < d2p->rssid[b][l].n_ssid; ++r)
+				TEST_EQUAL(d2p->rssid[b][l].ssid[r],
+					   d2p2->rssid[b][l].ssid[r]);
+			for (r = 0; r < n_ci; ++r) {
+				TEST_EQUAL(d2p->ldiph_lc[b][l][r], d2p2->ldiph_lc[b][l][r]);
+				TEST_EQUAL(d2p->lrdiph_rc[b][l][r], d2p2->lrdiph_rc[b][l][r]);
+			}
+		}
+	}
+	dict_free(dict2);
+	dict2pid_free(d2p2);
+
+	/* Lazily filled tables should match for the words added. */
+	TEST_ASSERT(d2p2 = dict2pid_init(mdef, dict));
+	TEST_ASSERT(IS_S3WID(w = dict_wordid(dict, "carnegie")));
+	TEST_EQUAL(0, dict2pid_add_word(d2p2, w));
+	b = dict_last_phone(dict, w);
+	l = dict_second_last_phone(dict, w);
+	TEST_EQUAL(d2p->rssid[b][l].n_ssid, d2p2->rssid[b][l].n_ssid);
+	for (r = 0; r < n_ci; ++r) {
+		TEST_EQUAL(d2p->ldiph_lc[dict_first_phone(dict, w)]
+			   [dict_second_phone(dict, w)][r],
+			   d2p2->ldiph_lc[dict_first_phone(dict, w)]
+			   [dict_second_phone(dict, w)][r]);
+		TEST_EQUAL(d2p->rssid[b][l].ssid[d2p->rssid[b][l].cimap[r]],
+			   d2p2->rssid[b][l].ssid[d2p2->rssid[b][l].cimap[r]]);
+	}
+	/* Other words are not filled in. */
+	TEST_ASSERT(IS_S3WID(w = dict_wordid(dict, "a")));
+	TEST_EQUAL(0, d2p2->lrssid[dict_first_phone(dict, w)][0].n_ssid);
+	TEST_EQUAL(0, dict2pid_add_word(d2p2, w));
+	TEST_EQUAL(d2p->lrssid[dict_first_phone(dict, w)][0].n_ssid,
+		   d2p2->lrssid[dict_first_phone(dict, w)][0].n_ssid);
+	dict2pid_free(d2p2);
+
 	dict_free(dict);
 	dict2pid_free(d2p);
 	bin_mdef_free(mdef);
@@ -0,0 +1,62 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ngram_search.h"
+#include "test_macros.h"
+#include "test_ps.c"
+
+/* Decode with some order of LM lookahead, returning the number of
+ * tree channels evaluated. */
+static int32
+decode_la(cmd_ln_t *config, int la_order, char const *expected)
+{
+    ps_decoder_t *ps;
+    ngram_search_t *ngs;
+    FILE *rawfh;
+    char const *hyp;
+    int32 n_chan_eval;
+
+    ps_config_set_int(config, "fwdtreela", la_order);
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    TEST_ASSERT(hyp = ps_get_hyp(ps, NULL));
+    ngs = (ngram_search_t *)ps->search;
+    n_chan_eval = ngs->st.n_root_chan_eval + ngs->st.n_nonroot_chan_eval;
+    printf("fwdtreela %d: %s (%d channels)\n", la_order, hyp, n_chan_eval);
+    TEST_EQUAL(0, strcmp(hyp, expected));
+    ps_free(ps);
+    return n_chan_eval;
+}
+
+int
+main(int argc, char *argv[])
+{
+    cmd_ln_t *config;
+    int32 n_chan_eval;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdtree: true,"
+                    "fwdflat: false,"
+                    "bestpath: false,"
+                    "loglevel: \"WARN\","
+                    "samprate: 16000"));
+    /* Lookahead of either order prunes channels without changing the
+     * result. */
+    n_chan_eval = decode_la(config, 0, "go forward ten meters");
+    TEST_ASSERT(decode_la(config, 1, "go forward ten meters") < n_chan_eval);
+    TEST_ASSERT(decode_la(config, 2, "go forward ten meters") < n_chan_eval);
+
+    ps_config_set_str(config, "loglevel", "INFO");
+    return ps_decoder_test(config, "FWDTREE", "go forward ten meters");
+}
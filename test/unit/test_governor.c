@@ -0,0 +1,110 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_governor.h"
+#include "test_macros.h"
+
+static int n_changes;
+
+static void
+governor_cb(void *user_data, ps_governor_stats_t const *stats)
+{
+    TEST_ASSERT(user_data == &n_changes);
+    printf("level %d rtf %.3f beam %.2f topn %d ds %d\n",
+           stats->level, stats->rtf, stats->beam_scale,
+           stats->topn, stats->ds_ratio);
+    ++n_changes;
+}
+
+static char const *
+decode(ps_decoder_t *ps, int32 *out_score)
+{
+    FILE *rawfh;
+    char const *hyp;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    hyp = ps_get_hyp(ps, out_score);
+    printf("%s (%d)\n", hyp ? hyp : "(null)", *out_score);
+    return hyp;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    ps_governor_stats_t const *stats;
+    int32 score, score2;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "samprate: 16000"));
+
+    /* The governor is off by default. */
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(NULL == ps_get_governor_stats(ps));
+    TEST_EQUAL(-1, ps_set_governor_cb(ps, governor_cb, &n_changes));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps, &score)));
+    ps_free(ps);
+
+    /* And does nothing if the decoder keeps up. */
+    ps_config_set_float(config, "maxrtf", 1000);
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_EQUAL(0, ps_set_governor_cb(ps, governor_cb, &n_changes));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps, &score2)));
+    TEST_EQUAL(score, score2);
+    TEST_ASSERT(stats = ps_get_governor_stats(ps));
+    TEST_EQUAL(0, stats->level);
+    TEST_EQUAL(0, stats->n_degrade);
+    TEST_EQUAL(0, n_changes);
+    TEST_ASSERT(stats->n_frame > 0);
+    TEST_EQUAL(0, stats->n_frame_degraded);
+    TEST_ASSERT(stats->rtf > 0);
+    ps_free(ps);
+
+    /* If it can't, the search is degraded as far as possible. */
+    ps_config_set_float(config, "maxrtf", 1e-9);
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_EQUAL(0, ps_set_governor_cb(ps, governor_cb, &n_changes));
+    TEST_ASSERT(decode(ps, &score2) != NULL);
+    TEST_ASSERT(stats = ps_get_governor_stats(ps));
+    TEST_EQUAL(4, stats->level);
+    TEST_EQUAL(4, stats->n_degrade);
+    TEST_EQUAL(0, stats->n_restore);
+    TEST_EQUAL(4, n_changes);
+    TEST_ASSERT(stats->n_frame_degraded > 0);
+    TEST_ASSERT(stats->n_frame_degraded < stats->n_frame);
+    TEST_EQUAL_FLOAT(0.5, stats->beam_scale);
+    TEST_EQUAL(1, stats->topn);
+    TEST_EQUAL(2, stats->ds_ratio);
+    TEST_EQUAL_FLOAT(0.5, ps_search_beam_scale(ps->search));
+
+    /* And restored when it catches up again. */
+    ps->governor->maxrtf = 1000;
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps, &score2)));
+    TEST_EQUAL(0, stats->level);
+    TEST_EQUAL(4, stats->n_restore);
+    TEST_EQUAL(8, n_changes);
+    TEST_EQUAL(4, stats->topn);
+    TEST_EQUAL(1, stats->ds_ratio);
+
+    /* The callback survives reinitialization. */
+    ps_config_set_float(config, "maxrtf", 1e-9);
+    TEST_EQUAL(0, ps_reinit(ps, config));
+    TEST_ASSERT(decode(ps, &score2) != NULL);
+    TEST_EQUAL(12, n_changes);
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
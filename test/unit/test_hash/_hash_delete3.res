@@ -1,7 +1,9 @@
-Hash with chaining representation of the hash table
-|key:-bla|len:4|val=8|->NULL
-|key:-hmmdump|len:8|val=1|->|key:-subvq|len:6|val=7|->|key:-outlatdir|len:10|val=3|->NULL
-|key:-lminmemory|len:11|val=6|->NULL
-|key:-lm|len:3|val=4|->NULL
-|key:-beam|len:5|val=5|->NULL
+Open addressing representation of the hash table
+|key:-hmmdump|len:8|val=1|
+|key:-outlatdir|len:10|val=3|
+|key:-lm|len:3|val=4|
+|key:-beam|len:5|val=5|
+|key:-lminmemory|len:11|val=6|
+|key:-subvq|len:6|val=7|
+|key:-bla|len:4|val=8|
 The total number of keys =7
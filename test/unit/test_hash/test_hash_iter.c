@@ -19,6 +19,8 @@ main(int argc, char *argv[])
 	hash_iter_t *itor;
 	char *foo2 = ckd_salloc("foo");
 	char *foo3 = ckd_salloc("foo");
+	char **keys;
+	int i, n;
 
 	(void)argc;
 	(void)argv;
@@ -48,8 +50,44 @@ main(int argc, char *argv[])
 			TEST_EQUAL(itor->ent->val, (void*)0xbabababa);
 		}
 	}
+	hash_table_free(h);
 	ckd_free(foo2);
 	ckd_free(foo3);
 
+	/* Test growth, deletion and reuse of entries. */
+	TEST_ASSERT(h = hash_table_new(4, HASH_CASE_NO));
+	keys = ckd_calloc_2d(10000, 16, sizeof(**keys));
+	for (i = 0; i < 10000; ++i) {
+		sprintf(keys[i], "key%d", i);
+		TEST_EQUAL(i, hash_table_enter_int32(h, keys[i], i));
+	}
+	TEST_EQUAL(10000, hash_table_inuse(h));
+	for (i = 0; i < 10000; i += 2)
+		TEST_EQUAL((void *)(size_t)i, hash_table_delete(h, keys[i]));
+	TEST_EQUAL(5000, hash_table_inuse(h));
+	for (i = 0; i < 10000; ++i) {
+		int32 val;
+		if (i % 2) {
+			TEST_EQUAL(0, hash_table_lookup_int32(h, keys[i], &val));
+			TEST_EQUAL(i, val);
+		}
+		else
+			TEST_EQUAL(-1, hash_table_lookup_int32(h, keys[i], &val));
+	}
+	/* Case-insensitive lookup. */
+	TEST_EQUAL(0, hash_table_lookup(h, "KEY9999", NULL));
+	/* Insertion while iterating must not disturb the iterator. */
+	n = 0;
+	for (itor = hash_table_iter(h); itor; itor = hash_table_iter_next(itor)) {
+		i = (int)(size_t)hash_entry_val(itor->ent);
+		if (i % 2)
+			hash_table_enter(h, keys[i - 1], (void *)(size_t)(i - 1));
+		++n;
+	}
+	TEST_ASSERT(n >= 5000);
+	TEST_EQUAL(10000, hash_table_inuse(h));
+	ckd_free_2d(keys);
+	hash_table_free(h);
+
 	return 0;
 }
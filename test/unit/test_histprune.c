@@ -0,0 +1,161 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ngram_search.h"
+#include "fsg_search_internal.h"
+#include "kws_search.h"
+#include "histprune.h"
+#include "test_macros.h"
+
+static char const *
+decode(ps_decoder_t *ps)
+{
+    FILE *rawfh;
+    char const *hyp;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    hyp = ps_get_hyp(ps, NULL);
+    printf("%s: %s\n", ps_search_type(ps->search), hyp ? hyp : "(null)");
+    return hyp;
+}
+
+/* Decode with the tree search, returning the number of HMMs evaluated. */
+static int32
+decode_fwdtree(cmd_ln_t *config, int check_hyp, int32 *out_n_narrowed)
+{
+    ps_decoder_t *ps;
+    ngram_search_t *ngs;
+    char const *hyp;
+    int32 n_hmm_eval;
+
+    TEST_ASSERT(ps = ps_init(config));
+    ngs = (ngram_search_t *)ps->search;
+    hyp = decode(ps);
+    if (check_hyp)
+        TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    n_hmm_eval = ngs->st.n_root_chan_eval + ngs->st.n_nonroot_chan_eval;
+    *out_n_narrowed = ngs->hprune.n_narrowed;
+    printf("%d HMMs evaluated, beam narrowed in %d frames\n",
+           n_hmm_eval, *out_n_narrowed);
+    ps_free(ps);
+    return n_hmm_eval;
+}
+
+/* Decode with a grammar, returning the number of HMMs evaluated. */
+static int32
+decode_fsg(cmd_ln_t *config, int32 *out_n_narrowed)
+{
+    ps_decoder_t *ps;
+    fsg_search_t *fsgs;
+    char const *hyp;
+    int32 n_hmm_eval;
+
+    TEST_ASSERT(ps = ps_init(config));
+    fsgs = (fsg_search_t *)ps->search;
+    hyp = decode(ps);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    n_hmm_eval = fsgs->n_hmm_eval;
+    *out_n_narrowed = fsgs->hprune.n_narrowed;
+    printf("%d HMMs evaluated, beam narrowed in %d frames\n",
+           n_hmm_eval, *out_n_narrowed);
+    ps_free(ps);
+    return n_hmm_eval;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    histprune_t hp;
+    int32 n_hmm, n_narrowed, i;
+
+    (void)argc;
+    (void)argv;
+
+    /* The beam is narrowed to keep only the budgeted HMMs. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false, bestpath: false,"
+                    "samprate: 16000"));
+    histprune_init(&hp, config);
+    TEST_EQUAL(30000, histprune_budget(&hp));
+    histprune_reset(&hp, -25600);
+    TEST_EQUAL(100, hp.bw);
+    for (i = 0; i < 50; ++i)
+        histprune_add(&hp, i * 100);
+    /* Anything outside the beam goes in the last bin. */
+    histprune_add(&hp, 1000000);
+    TEST_EQUAL(1, hp.bins[HISTPRUNE_NBINS - 1]);
+    TEST_EQUAL(-1000, histprune_beam(&hp, 10));
+    TEST_EQUAL(1, hp.n_narrowed);
+    TEST_EQUAL(-25600, histprune_beam(&hp, 100));
+    TEST_EQUAL(1, hp.n_narrowed);
+
+    /* The time limit allows for time spent outside the HMMs, and
+     * never leaves fewer than HISTPRUNE_MIN_HMM. */
+    hp.maxuspf = 1000;
+    for (i = 0; i < 50; ++i) {
+        int32 n = (i & 1) ? 100 : 300;
+        histprune_update(&hp, n, 500.0 + 2.0 * n);
+    }
+    TEST_EQUAL_FLOAT(2.0, hp.us_per_hmm);
+    TEST_EQUAL_FLOAT(500.0, hp.us_fixed);
+    TEST_ASSERT(abs(histprune_budget(&hp) - 250) <= 1);
+    hp.maxuspf = 600;
+    TEST_EQUAL(HISTPRUNE_MIN_HMM, histprune_budget(&hp));
+
+    /* In the tree search. */
+    n_hmm = decode_fwdtree(config, TRUE, &n_narrowed);
+    TEST_EQUAL(0, n_narrowed);
+    ps_config_set_int(config, "maxhmmpf", 20);
+    TEST_ASSERT(decode_fwdtree(config, TRUE, &n_narrowed) < n_hmm);
+    TEST_ASSERT(n_narrowed > 0);
+
+    /* And a limit on time per frame does the same thing (one
+     * microsecond is too little, so HISTPRUNE_MIN_HMM are kept). */
+    ps_config_set_int(config, "maxhmmpf", -1);
+    ps_config_set_int(config, "maxuspf", 1);
+    TEST_ASSERT(decode_fwdtree(config, TRUE, &n_narrowed) < n_hmm);
+    TEST_ASSERT(n_narrowed > 0);
+    ps_config_set_int(config, "maxuspf", -1);
+
+    /* Grammars are also pruned. */
+    ps_config_set_str(config, "lm", NULL);
+    ps_config_set_str(config, "fsg", DATADIR "/goforward.fsg");
+    n_hmm = decode_fsg(config, &n_narrowed);
+    TEST_EQUAL(0, n_narrowed);
+    ps_config_set_int(config, "maxhmmpf", 5);
+    TEST_ASSERT(decode_fsg(config, &n_narrowed) < n_hmm);
+    TEST_ASSERT(n_narrowed > 0);
+    /* But never to nothing, even with an impossible budget. */
+    ps_config_set_int(config, "maxhmmpf", 1);
+    TEST_ASSERT(decode_fsg(config, &n_narrowed) < n_hmm);
+    TEST_ASSERT(n_narrowed > 0);
+    ps_config_free(config);
+
+    /* And keyphrases, which should still be found. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "kws: \"" DATADIR "/goforward.kws\","
+                    "dict: \"" MODELDIR "/en-us/cmudict-en-us.dict\","
+                    "maxhmmpf: 10,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(strstr(decode(ps), "forward") != NULL);
+    TEST_ASSERT(((kws_search_t *)ps->search)->hprune.n_narrowed > 0);
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
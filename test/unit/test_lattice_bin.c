@@ -0,0 +1,196 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+/* Verify that two lattices have exactly the same nodes and links. */
+static void
+compare_lattices(ps_lattice_t *a, ps_lattice_t *b)
+{
+    ps_latnode_t *na, *nb;
+
+    TEST_EQUAL(a->n_frames, b->n_frames);
+    TEST_EQUAL(a->start->id, b->start->id);
+    TEST_EQUAL(a->end->id, b->end->id);
+    for (na = a->nodes, nb = b->nodes; na && nb;
+         na = na->next, nb = nb->next) {
+        latlink_list_t *xa, *xb;
+
+        TEST_EQUAL(0, strcmp(ps_latnode_word(a, na), ps_latnode_word(b, nb)));
+        TEST_EQUAL(na->id, nb->id);
+        TEST_EQUAL(na->sf, nb->sf);
+        TEST_EQUAL(na->fef, nb->fef);
+        TEST_EQUAL(na->lef, nb->lef);
+        for (xa = na->exits, xb = nb->exits; xa && xb;
+             xa = xa->next, xb = xb->next) {
+            TEST_EQUAL(xa->link->to->id, xb->link->to->id);
+            TEST_EQUAL(xa->link->ascr, xb->link->ascr);
+            TEST_EQUAL(xa->link->ef, xb->link->ef);
+        }
+        TEST_ASSERT(xa == NULL && xb == NULL);
+    }
+    TEST_ASSERT(na == NULL && nb == NULL);
+}
+
+static long
+file_size(char const *path)
+{
+    struct stat st;
+    TEST_EQUAL(0, stat(path, &st));
+    return st.st_size;
+}
+
+/* Reverse some bytes in place. */
+static void
+reverse_bytes(unsigned char *p, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len / 2; ++i) {
+        unsigned char tmp = p[i];
+        p[i] = p[len - 1 - i];
+        p[len - 1 - i] = tmp;
+    }
+}
+
+/* Copy an archive, either converting its header to the other byte
+ * order or clobbering its byte order marker. */
+static void
+copy_archive(char const *inpath, char const *outpath, int clobber)
+{
+    unsigned char buf[65536];
+    FILE *in, *out;
+    size_t len, pos;
+    int32 desclen;
+
+    TEST_ASSERT(in = fopen(inpath, "rb"));
+    len = fread(buf, 1, sizeof(buf), in);
+    fclose(in);
+    /* After the magic string come the byte order marker, version,
+     * length of the format description, the description itself, and
+     * the log base. */
+    pos = strlen("PSLATB") + 1;
+    if (clobber)
+        memset(buf + pos, 0, 4);
+    else {
+        memcpy(&desclen, buf + pos + 8, 4);
+        reverse_bytes(buf + pos, 4);
+        reverse_bytes(buf + pos + 4, 4);
+        reverse_bytes(buf + pos + 8, 4);
+        reverse_bytes(buf + pos + 12 + desclen, 8);
+    }
+    TEST_ASSERT(out = fopen(outpath, "wb"));
+    TEST_EQUAL(len, fwrite(buf, 1, len, out));
+    fclose(out);
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag, *dag2;
+    ps_lattice_writer_t *writer;
+    ps_lattice_reader_t *reader;
+    ps_latlink_t *link;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    int i;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+
+    /* Binary lattices are much smaller than text ones. */
+    TEST_EQUAL(0, ps_lattice_write(dag, "goforward.lat"));
+    TEST_EQUAL(0, ps_lattice_write_bin(dag, "goforward.latb"));
+    printf("text %ld bytes, binary %ld bytes\n",
+           file_size("goforward.lat"), file_size("goforward.latb"));
+    TEST_ASSERT(file_size("goforward.latb") * 2 < file_size("goforward.lat"));
+
+    /* And they read back exactly. */
+    TEST_ASSERT(dag2 = ps_lattice_read(ps, "goforward.latb"));
+    compare_lattices(dag, dag2);
+    TEST_ASSERT(link = ps_lattice_bestpath(dag2, ps_get_lm(ps, NULL),
+                                           1.0, 1.0/15.0));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag2, link)));
+    ps_lattice_free(dag2);
+    /* Even without a decoder. */
+    TEST_ASSERT(dag2 = ps_lattice_read(NULL, "goforward.latb"));
+    compare_lattices(dag, dag2);
+    ps_lattice_free(dag2);
+
+    /* Write an archive in two pieces. */
+    TEST_ASSERT(writer = ps_lattice_writer_open("archive.latb", FALSE));
+    for (i = 0; i < 3; ++i)
+        TEST_EQUAL(0, ps_lattice_writer_add(writer, dag));
+    TEST_EQUAL(0, ps_lattice_writer_close(writer));
+    TEST_ASSERT(writer = ps_lattice_writer_open("archive.latb", TRUE));
+    TEST_EQUAL(0, ps_lattice_writer_add(writer, dag));
+    TEST_EQUAL(0, ps_lattice_writer_close(writer));
+    TEST_ASSERT(reader = ps_lattice_reader_open(ps, "archive.latb"));
+    for (i = 0; (dag2 = ps_lattice_reader_next(reader)) != NULL; ++i) {
+        compare_lattices(dag, dag2);
+        ps_lattice_free(dag2);
+    }
+    TEST_EQUAL(4, i);
+    ps_lattice_reader_close(reader);
+
+    /* Archives in the other byte order can be read, but not appended
+     * to. */
+    copy_archive("archive.latb", "swapped.latb", FALSE);
+    TEST_ASSERT(reader = ps_lattice_reader_open(ps, "swapped.latb"));
+    for (i = 0; (dag2 = ps_lattice_reader_next(reader)) != NULL; ++i) {
+        compare_lattices(dag, dag2);
+        ps_lattice_free(dag2);
+    }
+    TEST_EQUAL(4, i);
+    ps_lattice_reader_close(reader);
+    TEST_ASSERT(NULL == ps_lattice_writer_open("swapped.latb", TRUE));
+
+    /* Archives in neither byte order are rejected. */
+    copy_archive("archive.latb", "clobbered.latb", TRUE);
+    TEST_ASSERT(NULL == ps_lattice_reader_open(ps, "clobbered.latb"));
+    TEST_ASSERT(NULL == ps_lattice_writer_open("clobbered.latb", TRUE));
+
+    /* Text lattices can't be appended to. */
+    TEST_ASSERT(NULL == ps_lattice_writer_open("goforward.lat", TRUE));
+    TEST_ASSERT(NULL == ps_lattice_reader_open(ps, "goforward.lat"));
+
+    /* Truncated lattices fail cleanly. */
+    {
+        char buf[8192];
+        FILE *in, *out;
+        size_t len;
+
+        TEST_ASSERT(in = fopen("goforward.latb", "rb"));
+        len = fread(buf, 1, sizeof(buf), in);
+        fclose(in);
+        TEST_ASSERT(len > 10);
+        TEST_ASSERT(out = fopen("truncated.latb", "wb"));
+        TEST_EQUAL(len - 10, fwrite(buf, 1, len - 10, out));
+        fclose(out);
+    }
+    TEST_ASSERT(reader = ps_lattice_reader_open(ps, "truncated.latb"));
+    TEST_ASSERT(NULL == ps_lattice_reader_next(reader));
+    ps_lattice_reader_close(reader);
+
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
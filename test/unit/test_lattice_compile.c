@@ -0,0 +1,101 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+/* Verify that the compiled graph is complete and in topological order. */
+static void
+check_compiled(ps_lattice_t *dag, int by_frame)
+{
+    ps_latnode_t *node;
+    latlink_list_t *x;
+    int32 i, n_nodes = 0, n_links = 0;
+
+    ps_lattice_compile(dag);
+    TEST_ASSERT(dag->node_list);
+    for (node = dag->nodes; node; node = node->next) {
+        ++n_nodes;
+        for (x = node->exits; x; x = x->next)
+            ++n_links;
+    }
+    TEST_EQUAL(n_nodes, dag->n_node_list);
+    TEST_EQUAL(n_links, dag->n_link_list);
+    for (i = 0; i < dag->n_node_list; ++i) {
+        int32 j = 0;
+
+        node = dag->node_list[i];
+        if (by_frame && i > 0)
+            TEST_ASSERT(dag->node_list[i - 1]->sf <= node->sf);
+        for (x = node->exits; x; x = x->next)
+            TEST_ASSERT(dag->link_list[node->first_exit + j++] == x->link);
+        TEST_EQUAL(j, node->n_exits);
+    }
+    for (i = 0; i < dag->n_link_list; ++i) {
+        ps_latlink_t *link = dag->link_list[i];
+        TEST_ASSERT(i >= link->from->first_exit);
+        TEST_ASSERT(i < link->from->first_exit + link->from->n_exits);
+        /* Exits of the destination come later. */
+        TEST_ASSERT(link->to->first_exit > i);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag;
+    ps_latlink_t *link;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    int32 post;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "bestpath: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+
+    /* Searches compile the lattice on demand. */
+    TEST_ASSERT(link = ps_lattice_bestpath(dag, ps_get_lm(ps, NULL),
+                                           1.0, 1.0/15.0));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    check_compiled(dag, TRUE);
+    post = ps_lattice_posterior(dag, ps_get_lm(ps, NULL), 1.0/15.0);
+    printf("P(S|O) = %d\n", post);
+    TEST_ASSERT(post <= 0);
+
+    /* Changing the graph discards it. */
+    ps_lattice_posterior_prune(dag, logmath_log(ps_lattice_get_logmath(dag),
+                                                1e-2));
+    TEST_ASSERT(dag->node_list == NULL);
+    TEST_ASSERT(link = ps_lattice_bestpath(dag, ps_get_lm(ps, NULL),
+                                           1.0, 1.0/15.0));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    check_compiled(dag, TRUE);
+    ps_free(ps);
+    ps_config_free(config);
+
+    /* Links which go backwards in time need a topological sort. */
+    TEST_ASSERT(dag = ps_lattice_read(NULL, DATADIR "/unreachable.lat"));
+    check_compiled(dag, FALSE);
+    ps_lattice_delete_unreachable(dag);
+    TEST_ASSERT(dag->node_list == NULL);
+    check_compiled(dag, TRUE);
+    ps_lattice_free(dag);
+
+    return 0;
+}
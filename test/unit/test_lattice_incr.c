@@ -0,0 +1,102 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+/* Count nodes and links, and sum up node times, for comparison. */
+static void
+summarize(ps_lattice_t *dag, int32 *out_n_nodes, int32 *out_n_links,
+          int32 *out_times)
+{
+    ps_latnode_t *node;
+    latlink_list_t *x;
+
+    *out_n_nodes = *out_n_links = *out_times = 0;
+    for (node = dag->nodes; node; node = node->next) {
+        ++*out_n_nodes;
+        *out_times += node->sf * 3 + node->fef * 5 + node->lef * 7;
+        for (x = node->exits; x; x = x->next)
+            ++*out_n_links;
+    }
+}
+
+/* Decode in small chunks, optionally getting a lattice after each. */
+static int
+decode(ps_decoder_t *ps, FILE *rawfh, int partial)
+{
+    ps_lattice_t *dag;
+    ps_latlink_t *link;
+    int16 buf[2048];
+    size_t nread;
+    int n_partial = 0;
+
+    fseek(rawfh, 0, SEEK_SET);
+    TEST_EQUAL(0, ps_start_utt(ps));
+    while ((nread = fread(buf, sizeof(*buf), 2048, rawfh)) > 0) {
+        TEST_ASSERT(ps_process_raw(ps, buf, nread, FALSE, FALSE) >= 0);
+        if (!partial || (dag = ps_get_lattice(ps)) == NULL)
+            continue;
+        /* The search may lag behind feature extraction. */
+        TEST_ASSERT(ps_lattice_n_frames(dag) <= ps_get_n_frames(ps));
+        if ((link = ps_lattice_bestpath(dag, ps_get_lm(ps, NULL),
+                                        1.0, 1.0/15.0)) == NULL)
+            continue;
+        ++n_partial;
+        printf("%d: %s\n", ps_lattice_n_frames(dag),
+               ps_lattice_hyp(dag, link));
+        /* Asking again gives the same one. */
+        TEST_ASSERT(dag == ps_get_lattice(ps));
+    }
+    TEST_EQUAL(0, ps_end_utt(ps));
+    return n_partial;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    int32 n_nodes, n_links, times, n_nodes2, n_links2, times2;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, decode(ps, rawfh, FALSE));
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+    summarize(dag, &n_nodes, &n_links, &times);
+    printf("%d nodes %d links\n", n_nodes, n_links);
+
+    /* Partial lattices can be obtained during the utterance. */
+    ps_free(ps);
+    /* Use a new decoder since feature extraction adapts over time. */
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(decode(ps, rawfh, TRUE) > 0);
+    fclose(rawfh);
+
+    /* And the final one is the same as if we had not asked. */
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+    summarize(dag, &n_nodes2, &n_links2, &times2);
+    TEST_EQUAL(n_nodes, n_nodes2);
+    TEST_EQUAL(n_links, n_links2);
+    TEST_EQUAL(times, times2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_get_hyp(ps, NULL)));
+
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+static int32
+count_links(ps_lattice_t *dag)
+{
+    ps_latnode_t *node;
+    latlink_list_t *x;
+    int32 n_links = 0;
+
+    for (node = dag->nodes; node; node = node->next)
+        for (x = node->exits; x; x = x->next)
+            ++n_links;
+    return n_links;
+}
+
+static ps_lattice_t *
+decode(ps_decoder_t *ps)
+{
+    ps_lattice_t *dag;
+    ps_latlink_t *link;
+    FILE *rawfh;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+    TEST_ASSERT(link = ps_lattice_bestpath(dag, ps_get_lm(ps, NULL),
+                                           1.0, 1.0/15.0));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    return dag;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag;
+    ps_latnode_t *node;
+    ps_latlink_t *link;
+    cmd_ln_t *config;
+    int32 n_links, n_pruned;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    dag = decode(ps);
+    n_links = count_links(dag);
+    printf("%d links in %d frames\n", n_links, ps_lattice_n_frames(dag));
+
+    /* No beam only removes links on no complete path. */
+    n_pruned = ps_lattice_beam_prune(dag, ps_get_lm(ps, NULL),
+                                     ps_config_float(config, "bestpathlw")
+                                     / ps_config_float(config, "lw"),
+                                     logmath_get_zero(ps_lattice_get_logmath(dag)),
+                                     0);
+    printf("%d links on no complete path\n", n_pruned);
+    TEST_ASSERT(n_pruned >= 0);
+    TEST_EQUAL(n_links - n_pruned, count_links(dag));
+    n_links = count_links(dag);
+
+    /* A beam of nothing leaves only the best path. */
+    n_pruned = ps_lattice_beam_prune(dag, ps_get_lm(ps, NULL),
+                                     ps_config_float(config, "bestpathlw")
+                                     / ps_config_float(config, "lw"),
+                                     0, 0);
+    TEST_ASSERT(n_pruned > 0);
+    TEST_EQUAL(n_links - n_pruned, count_links(dag));
+    for (node = dag->nodes; node; node = node->next) {
+        TEST_ASSERT(node == dag->end || node->exits != NULL);
+        TEST_ASSERT(node->exits == NULL || node->exits->next == NULL);
+    }
+    TEST_ASSERT(link = ps_lattice_bestpath(dag, ps_get_lm(ps, NULL),
+                                           1.0, 1.0/15.0));
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    ps_free(ps);
+
+    /* Density can be limited when lattices are built. */
+    ps_config_set_float(config, "latdensity", 1.0);
+    TEST_ASSERT(ps = ps_init(config));
+    dag = decode(ps);
+    printf("%d links in %d frames\n", count_links(dag), ps_lattice_n_frames(dag));
+    TEST_ASSERT(count_links(dag) <= ps_lattice_n_frames(dag));
+    TEST_ASSERT(count_links(dag) < n_links);
+    ps_free(ps);
+
+    /* And so can the beam. */
+    ps_config_set_float(config, "latdensity", 0);
+    ps_config_set_float(config, "latbeam", 1e-30);
+    TEST_ASSERT(ps = ps_init(config));
+    dag = decode(ps);
+    printf("%d links in %d frames\n", count_links(dag), ps_lattice_n_frames(dag));
+    TEST_ASSERT(count_links(dag) < n_links);
+    ps_free(ps);
+
+    /* It also works for grammars. */
+    ps_config_set_str(config, "lm", NULL);
+    ps_config_set_str(config, "fsg", DATADIR "/goforward.fsg");
+    ps_config_set_bool(config, "bestpath", TRUE);
+    TEST_ASSERT(ps = ps_init(config));
+    dag = decode(ps);
+    printf("%d links in %d frames\n", count_links(dag), ps_lattice_n_frames(dag));
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <pocketsphinx.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+/* Number of histories from the last rescoring, as logged. */
+static int32 n_histories = -1;
+
+static void
+count_histories(void *user_data, err_lvl_t lvl, const char *fmt, ...)
+{
+    char msg[1024];
+    char const *hist;
+    va_list ap;
+
+    (void)user_data;
+    (void)lvl;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    fputs(msg, stderr);
+    if (strstr(msg, "Rescored ") && (hist = strstr(msg, " with ")))
+        n_histories = atoi(hist + 6);
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_lattice_t *dag;
+    ps_latlink_t *link;
+    ngram_model_t *lm, *lm4;
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    int32 score, pruned_score, n_full;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "bestpath: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+    TEST_ASSERT(dag = ps_get_lattice(ps));
+
+    /* Rescore with a separate copy of the trigram model. */
+    lmath = ps_get_logmath(ps);
+    TEST_ASSERT(lm = ngram_model_read(config, DATADIR "/turtle.lm.bin",
+                                      NGRAM_AUTO, lmath));
+    ngram_model_apply_weights(lm, ps_config_float(config, "lw"),
+                              ps_config_float(config, "wip"));
+    TEST_ASSERT(link = ps_lattice_rescore(dag, lm, 1.0, 0));
+    score = link->path_scr;
+    printf("%s (%d)\n", ps_lattice_hyp(dag, link), score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    TEST_ASSERT(link->to == dag->end);
+
+    /* Keeping only one history per node can only be worse. */
+    TEST_ASSERT(link = ps_lattice_rescore(dag, lm, 1.0, 1));
+    pruned_score = link->path_scr;
+    printf("%s (%d)\n", ps_lattice_hyp(dag, link), pruned_score);
+    TEST_ASSERT(pruned_score <= score);
+
+    /* The 4-gram "two go forward ten" is only found if the paths
+     * reaching "forward" from "<s> go" and "<s> two go" are kept
+     * apart, which takes three words of history.  The second one is
+     * worse until then. */
+    err_set_loglevel(ERR_INFO);
+    err_set_callback(count_histories, NULL);
+    TEST_ASSERT(lm4 = ngram_model_read(config, DATADIR "/goforward.4gram.arpa",
+                                       NGRAM_ARPA, lmath));
+    TEST_EQUAL(4, ngram_model_get_size(lm4));
+    ngram_model_apply_weights(lm4, ps_config_float(config, "lw"),
+                              ps_config_float(config, "wip"));
+    TEST_ASSERT(link = ps_lattice_rescore(dag, lm4, 1.0, 0));
+    printf("%s (%d, %d histories)\n", ps_lattice_hyp(dag, link),
+           link->path_scr, n_histories);
+    TEST_EQUAL(0, strcmp("two go forward ten meters",
+                         ps_lattice_hyp(dag, link)));
+    n_full = n_histories;
+    TEST_ASSERT(n_full > 0);
+
+    /* With one history per node, the better path into "go" is the
+     * only one left, so the 4-gram is never used. */
+    TEST_ASSERT(link = ps_lattice_rescore(dag, lm4, 1.0, 1));
+    printf("%s (%d, %d histories)\n", ps_lattice_hyp(dag, link),
+           link->path_scr, n_histories);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    TEST_ASSERT(n_histories < n_full);
+    ngram_model_free(lm4);
+
+    /* Lattices read from files can be rescored too. */
+    TEST_EQUAL(0, ps_lattice_write(dag, "goforward.lat"));
+    ps_free(ps);
+    TEST_ASSERT(dag = ps_lattice_read(NULL, "goforward.lat"));
+    TEST_ASSERT(link = ps_lattice_rescore(dag, lm, 1.0, 0));
+    printf("%s (%d)\n", ps_lattice_hyp(dag, link), link->path_scr);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_lattice_hyp(dag, link)));
+    TEST_EQUAL(score, link->path_scr);
+    ps_lattice_free(dag);
+
+    ngram_model_free(lm);
+    ps_config_free(config);
+    return 0;
+}
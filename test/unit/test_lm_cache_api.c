@@ -0,0 +1,64 @@
+/* Only use the public API here. */
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_macros.h"
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_config_t *config;
+    FILE *rawfh;
+    int32 n_lookup, n_hit;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "loglevel: \"WARN\","
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+
+    /* Nothing has been looked up yet. */
+    n_lookup = n_hit = -1;
+    TEST_EQUAL(0, ps_get_lm_cache_stats(ps, &n_lookup, &n_hit));
+    TEST_EQUAL(0, n_lookup);
+    TEST_EQUAL(0, n_hit);
+
+    /* Decoding looks up scores, and finds some of them again. */
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    TEST_EQUAL(0, strcmp("go forward ten meters", ps_get_hyp(ps, NULL)));
+    TEST_EQUAL(0, ps_get_lm_cache_stats(ps, &n_lookup, &n_hit));
+    printf("%d lookups, %d hits\n", n_lookup, n_hit);
+    TEST_ASSERT(n_lookup > 0);
+    TEST_ASSERT(n_hit > 0);
+    TEST_ASSERT(n_hit <= n_lookup);
+    /* Either output can be left out. */
+    TEST_EQUAL(0, ps_get_lm_cache_stats(ps, NULL, &n_hit));
+    TEST_EQUAL(0, ps_get_lm_cache_stats(ps, &n_lookup, NULL));
+
+    /* The counts start over with each utterance. */
+    TEST_EQUAL(0, ps_start_utt(ps));
+    TEST_EQUAL(0, ps_get_lm_cache_stats(ps, &n_lookup, &n_hit));
+    TEST_EQUAL(0, n_lookup);
+    TEST_EQUAL(0, n_hit);
+    TEST_EQUAL(0, ps_end_utt(ps));
+
+    /* Other searches have no language model cache. */
+    TEST_EQUAL(0, ps_add_keyphrase(ps, "kws", "forward"));
+    TEST_EQUAL(0, ps_activate_search(ps, "kws"));
+    TEST_EQUAL(-1, ps_get_lm_cache_stats(ps, &n_lookup, &n_hit));
+
+    fclose(rawfh);
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/**
+ * @file test_lm_swap.c
+ * @brief Test building a language model search in another thread
+ * and swapping it in between utterances.
+ */
+
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "test_thread_utils.h"
+#include "test_macros.h"
+
+static ps_decoder_t *ps;
+static ps_search_t *built;
+
+#ifdef _WIN32
+static unsigned __stdcall
+#else
+static void *
+#endif
+build_thread(void *arg)
+{
+    built = ps_build_lm_file(ps, (const char *)arg, DATADIR "/turtle.lm.bin");
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void
+decode(void)
+{
+    FILE *rawfh;
+    char const *hyp;
+    int32 score;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    hyp = ps_get_hyp(ps, &score);
+    printf("%s: %s (%d)\n", ps_current_search(ps), hyp, score);
+    TEST_EQUAL(0, strcmp(hyp, "go forward ten meters"));
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_config_t *config;
+    thread_t thread;
+    ngram_model_t *lm;
+    char *name;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "mmap: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    name = ckd_salloc(ps_current_search(ps));
+    TEST_ASSERT(lm = ps_get_lm(ps, name));
+
+    /* Build a replacement while decoding. */
+    TEST_EQUAL(0, thread_create(&thread, build_thread, name));
+    decode();
+    TEST_EQUAL(0, thread_join(thread));
+    TEST_ASSERT(built);
+    /* Nothing changes until the next utterance. */
+    TEST_EQUAL(0, ps_swap_search(ps, built));
+    TEST_ASSERT(lm == ps_get_lm(ps, name));
+    decode();
+    TEST_ASSERT(lm != ps_get_lm(ps, name));
+    TEST_EQUAL(0, strcmp(name, ps_current_search(ps)));
+    lm = ps_get_lm(ps, name);
+
+    /* A newer search replaces one which is still pending. */
+    TEST_ASSERT(built = ps_build_lm_file(ps, name, DATADIR "/turtle.lm.bin"));
+    TEST_EQUAL(0, ps_swap_search(ps, built));
+    TEST_ASSERT(built = ps_build_lm_file(ps, name, DATADIR "/turtle.lm.bin"));
+    TEST_EQUAL(0, ps_swap_search(ps, built));
+    /* The dictionary can change after building. */
+    TEST_ASSERT(ps_add_word(ps, "foobie", "F UW B IY", FALSE) >= 0);
+    decode();
+    TEST_ASSERT(lm != ps_get_lm(ps, name));
+    TEST_EQUAL(0, strcmp(name, ps_current_search(ps)));
+
+    /* Searches with new names are added but not activated. */
+    TEST_ASSERT(built = ps_build_lm_file(ps, "other", DATADIR "/turtle.lm.bin"));
+    TEST_EQUAL(0, ps_swap_search(ps, built));
+    decode();
+    TEST_EQUAL(0, strcmp(name, ps_current_search(ps)));
+    TEST_ASSERT(ps_get_lm(ps, "other"));
+    TEST_EQUAL(0, ps_activate_search(ps, "other"));
+    decode();
+
+    /* Searches which are not needed can be thrown away. */
+    TEST_ASSERT(built = ps_build_lm_file(ps, name, DATADIR "/turtle.lm.bin"));
+    ps_discard_search(built);
+    TEST_ASSERT(NULL == ps_build_lm_file(ps, name, DATADIR "/nonexistent.lm"));
+
+    /* Or left pending when the decoder is freed. */
+    TEST_ASSERT(built = ps_build_lm_file(ps, name, DATADIR "/turtle.lm.bin"));
+    TEST_EQUAL(0, ps_swap_search(ps, built));
+
+    ckd_free(name);
+    ps_free(ps);
+    ps_config_free(config);
+    return 0;
+}
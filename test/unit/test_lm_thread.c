@@ -0,0 +1,125 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/**
+ * @file test_lm_thread.c
+ * @brief Test scoring one language model from several threads
+ */
+
+#include <pocketsphinx.h>
+
+#include "lm/ngram_model.h"
+#include "util/ckd_alloc.h"
+#include "test_thread_utils.h"
+#include "test_macros.h"
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS 4
+
+static ngram_model_t *lm;
+static int32 n_words;
+static int32 *ref_wids;
+static int32 *ref_scores;
+static barrier_t start_barrier;
+
+typedef struct decoder_s {
+    ngram_model_t *set; /* Private set wrapping the shared model */
+    int32 *wids;        /* Word IDs in the set for each word in lm */
+} decoder_t;
+
+/* Every trigram, with and without a full history. */
+static int32
+score_all(ngram_model_t *model, int32 *wids, int32 *out)
+{
+    int32 w1, w2, w3, n_used, n = 0;
+
+    for (w1 = 0; w1 < n_words; ++w1)
+        for (w2 = 0; w2 < n_words; ++w2)
+            for (w3 = 0; w3 < n_words; ++w3) {
+                out[n++] = ngram_tg_score(model, wids[w3], wids[w2],
+                                          wids[w1], &n_used);
+                out[n++] = ngram_bg_score(model, wids[w3], wids[w2],
+                                          &n_used);
+            }
+    return n;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall
+#else
+static void *
+#endif
+score_thread(void *arg)
+{
+    decoder_t *d = (decoder_t *)arg;
+    int32 *scores;
+    int32 i, n, round;
+
+    scores = ckd_calloc(n_words * n_words * n_words * 2, sizeof(*scores));
+    barrier_wait(&start_barrier);
+    for (round = 0; round < NUM_ROUNDS; ++round) {
+        /* Alternate between the shared model and a private set. */
+        if (round & 1)
+            n = score_all(lm, ref_wids, scores);
+        else
+            n = score_all(d->set, d->wids, scores);
+        for (i = 0; i < n; ++i)
+            THREAD_TEST_ASSERT(scores[i] == ref_scores[i]);
+    }
+    ckd_free(scores);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    decoder_t decoders[NUM_THREADS];
+    thread_t threads[NUM_THREADS];
+    char *name = "turtle";
+    int i, j;
+
+    (void)argc;
+    (void)argv;
+    err_set_loglevel(ERR_WARN);
+    lmath = logmath_init(1.0001, 0, 0);
+    TEST_ASSERT(lm = ngram_model_read(NULL, DATADIR "/turtle.lm.bin",
+                                      NGRAM_BIN, lmath));
+    n_words = ngram_model_get_counts(lm)[0];
+    ref_scores = ckd_calloc(n_words * n_words * n_words * 2,
+                            sizeof(*ref_scores));
+    ref_wids = ckd_calloc(n_words, sizeof(*ref_wids));
+    for (j = 0; j < n_words; ++j)
+        ref_wids[j] = j;
+    score_all(lm, ref_wids, ref_scores);
+
+    /* Each "decoder" wraps the shared model in a set of its own. */
+    for (i = 0; i < NUM_THREADS; ++i) {
+        decoder_t *d = &decoders[i];
+        TEST_ASSERT(d->set = ngram_model_set_init(NULL, &lm, &name,
+                                                  NULL, 1));
+        d->wids = ckd_calloc(n_words, sizeof(*d->wids));
+        for (j = 0; j < n_words; ++j)
+            d->wids[j] = ngram_wid(d->set, ngram_word(lm, j));
+    }
+    barrier_init(&start_barrier, NUM_THREADS);
+    for (i = 0; i < NUM_THREADS; ++i)
+        TEST_EQUAL(0, thread_create(&threads[i], score_thread,
+                                     &decoders[i]));
+    for (i = 0; i < NUM_THREADS; ++i)
+        thread_join(threads[i]);
+    barrier_destroy(&start_barrier);
+    TEST_EQUAL(0, thread_test_failed);
+
+    for (i = 0; i < NUM_THREADS; ++i) {
+        ngram_model_free(decoders[i].set);
+        ckd_free(decoders[i].wids);
+    }
+    ckd_free(ref_wids);
+    ckd_free(ref_scores);
+    ngram_model_free(lm);
+    logmath_free(lmath);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* Only use the public API here. */
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_macros.h"
+
+static const char *
+decode(ps_decoder_t *ps)
+{
+    FILE *rawfh;
+    const char *hyp;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    hyp = ps_get_hyp(ps, NULL);
+    TEST_ASSERT(hyp);
+    printf("%s: %s\n", ps_current_search(ps), hyp);
+    return hyp;
+}
+
+static ngram_model_t *
+read_class_lm(ps_config_t *config, logmath_t *lmath,
+              char **words, int32 n_words)
+{
+    ngram_model_t *lm;
+    float32 weights[4];
+    int32 i;
+
+    TEST_ASSERT(lm = ngram_model_read(config,
+                                      DATADIR "/goforward.class.arpa",
+                                      NGRAM_ARPA, lmath));
+    for (i = 0; i < n_words; ++i)
+        weights[i] = 1.0f / n_words;
+    TEST_ASSERT(ngram_model_add_class(lm, "[num]", 1.0,
+                                      words, weights, n_words) >= 0);
+    return lm;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char *numbers[] = { "two", "ten", "four", "eight" };
+    const char *two_four[] = { "two", "four" };
+    const char *ten[] = { "ten" };
+    const char *ten_ten[] = { "ten", "ten" };
+    const char *eight[] = { "eight" };
+    ps_decoder_t *ps;
+    ps_config_t *config;
+    logmath_t *lmath;
+    ngram_model_t *lm, *lms[2], *set;
+    char *names[] = { "all", "some" };
+    int32 ten_score, two_score, set_scores[2][2];
+    int i;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "loglevel: \"WARN\","
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    lmath = ps_get_logmath(ps);
+
+    /* The number can only come from the class, and any of its words
+     * can be recognized until it is updated. */
+    lm = read_class_lm(config, lmath, numbers, 4);
+    TEST_EQUAL(0, ps_add_lm(ps, "class", lm));
+    TEST_EQUAL(0, ps_activate_search(ps, "class"));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+
+    /* Without "ten", something else is recognized. */
+    TEST_EQUAL(2, ps_update_lm_class(ps, NULL, "[num]",
+                                     two_four, NULL, 2));
+    TEST_ASSERT(strstr(decode(ps), "ten") == NULL);
+
+    /* And with only "ten", it comes back. */
+    TEST_EQUAL(1, ps_update_lm_class(ps, "class", "[num]", ten, NULL, 1));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+    ten_score = ngram_score(lm, "ten", "forward", NULL);
+    two_score = ngram_score(lm, "two", "forward", NULL);
+
+    /* Failed updates change nothing. */
+    TEST_ASSERT(ps_update_lm_class(ps, NULL, "[num]",
+                                   ten_ten, NULL, 2) < 0);
+    TEST_ASSERT(ps_update_lm_class(ps, NULL, "[nope]", ten, NULL, 1) < 0);
+    TEST_ASSERT(ps_update_lm_class(ps, "nope", "[num]", ten, NULL, 1) < 0);
+    TEST_EQUAL(ten_score, ngram_score(lm, "ten", "forward", NULL));
+    TEST_EQUAL(two_score, ngram_score(lm, "two", "forward", NULL));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+    ngram_model_free(lm);
+
+    /* In a set, the class is updated in every model that has it, or
+     * in none of them. */
+    lms[0] = read_class_lm(config, lmath, numbers, 4);
+    lms[1] = read_class_lm(config, lmath, numbers, 3);
+    TEST_ASSERT(set = ngram_model_set_init(config, lms, names, NULL, 2));
+    TEST_EQUAL(0, ps_add_lm(ps, "set", set));
+    TEST_EQUAL(0, ps_activate_search(ps, "set"));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+    for (i = 0; i < 2; ++i) {
+        set_scores[i][0] = ngram_score(lms[i], "ten", "forward", NULL);
+        set_scores[i][1] = ngram_score(lms[i], "two", "forward", NULL);
+    }
+    /* "eight" is only in the first model. */
+    TEST_ASSERT(ps_update_lm_class(ps, NULL, "[num]", eight, NULL, 1) < 0);
+    TEST_ASSERT(ps_update_lm_class(ps, NULL, "[num]",
+                                   ten_ten, NULL, 2) < 0);
+    TEST_ASSERT(ps_update_lm_class(ps, NULL, "[nope]", ten, NULL, 1) < 0);
+    for (i = 0; i < 2; ++i) {
+        TEST_EQUAL(set_scores[i][0],
+                   ngram_score(lms[i], "ten", "forward", NULL));
+        TEST_EQUAL(set_scores[i][1],
+                   ngram_score(lms[i], "two", "forward", NULL));
+    }
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+
+    /* "ten" is in both of them. */
+    TEST_EQUAL(1, ps_update_lm_class(ps, NULL, "[num]", ten, NULL, 1));
+    for (i = 0; i < 2; ++i) {
+        TEST_ASSERT(ngram_score(lms[i], "ten", "forward", NULL)
+                    > set_scores[i][0]);
+        TEST_ASSERT(ngram_score(lms[i], "two", "forward", NULL)
+                    < set_scores[i][1]);
+    }
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps)));
+
+    ngram_model_free(set);
+    ngram_model_free(lms[0]);
+    ngram_model_free(lms[1]);
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "fsg_search_internal.h"
+#include "test_macros.h"
+
+static char const *
+decode(ps_decoder_t *ps, int32 *out_score)
+{
+    FILE *rawfh;
+    char const *hyp;
+
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    TEST_ASSERT(ps_decode_raw(ps, rawfh, -1) > 0);
+    fclose(rawfh);
+    hyp = ps_get_hyp(ps, out_score);
+    printf("%s: %s (%d)\n", ps_search_type(ps->search), hyp ? hyp : "(null)",
+           *out_score);
+    return hyp;
+}
+
+/* Decode with a grammar, returning the number of HMMs evaluated. */
+static int32
+decode_fsg(cmd_ln_t *config, char const *pl_search)
+{
+    ps_decoder_t *ps;
+    fsg_search_t *fsgs;
+    char const *hyp;
+    int32 score, n_hmm_eval;
+
+    ps_config_set_str(config, "pl_search", pl_search);
+    TEST_ASSERT(ps = ps_init(config));
+    fsgs = (fsg_search_t *)ps->search;
+    TEST_EQUAL((strstr(pl_search, "fsg") != NULL),
+               ps_search_lookahead(fsgs) != NULL);
+    hyp = decode(ps, &score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    n_hmm_eval = fsgs->n_hmm_eval;
+    printf("%d HMMs evaluated with weight %.1f\n", n_hmm_eval,
+           ps_search_base(fsgs)->pl_weight);
+    ps_free(ps);
+    return n_hmm_eval;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    char const *hyp;
+    int32 score, score2;
+
+    (void)argc;
+    (void)argv;
+
+    /* Grammars can use the phoneme lookahead. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "fsg: \"" DATADIR "/goforward.fsg\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "samprate: 16000"));
+    TEST_ASSERT(decode_fsg(config, "ngram,fsg")
+                < decode_fsg(config, "ngram"));
+    /* With their own weight for the penalties. */
+    TEST_ASSERT(decode_fsg(config, "ngram, fsg:6")
+                < decode_fsg(config, "fsg:0.5,ngram"));
+    ps_config_set_str(config, "pl_search", "ngram,fsg:0");
+    TEST_ASSERT(ps_init(config) == NULL);
+    ps_config_set_str(config, "pl_search", "ngram:x,fsg");
+    TEST_ASSERT(ps_init(config) == NULL);
+    ps_config_free(config);
+
+    /* So can keyphrase spotting. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "kws: \"" DATADIR "/goforward.kws\","
+                    "dict: \"" MODELDIR "/en-us/cmudict-en-us.dict\","
+                    "pl_search: \"kws\","
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(ps_search_lookahead(ps->search) != NULL);
+    TEST_ASSERT(hyp = decode(ps, &score));
+    TEST_ASSERT(strstr(hyp, "forward") != NULL);
+    ps_free(ps);
+    ps_config_free(config);
+
+    /* And phone recognition. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "allphone: \"" MODELDIR "/en-us/en-us-phone.lm.bin\","
+                    "beam: 1e-20, pbeam: 1e-10, allphone_ci: false, lw: 2.0,"
+                    "pl_search: \"allphone\","
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(ps_search_lookahead(ps->search) != NULL);
+    TEST_ASSERT(hyp = decode(ps, &score));
+    TEST_ASSERT(strstr(hyp, "F AO R W ER D") != NULL);
+    ps_free(ps);
+    ps_config_free(config);
+
+    /* Computing only CI senones for the lookahead gives the same
+     * result as computing all of them. */
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "compallsen: true,"
+                    "fwdflat: false, bestpath: false,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(ps_search_lookahead(ps->search) != NULL);
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps, &score)));
+    ps_free(ps);
+    ps_config_set_bool(config, "pl_cisen", FALSE);
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_EQUAL(0, strcmp("go forward ten meters", decode(ps, &score2)));
+    TEST_EQUAL(score, score2);
+    ps_free(ps);
+    ps_config_free(config);
+
+    return 0;
+}
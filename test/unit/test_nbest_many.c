@@ -0,0 +1,60 @@
+#include <pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pocketsphinx_internal.h"
+#include "ps_lattice_internal.h"
+#include "test_macros.h"
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    ps_nbest_t *nbest;
+    cmd_ln_t *config;
+    FILE *rawfh;
+    char const *hyp;
+    int32 score, prev_score, n;
+
+    (void)argc;
+    (void)argv;
+    TEST_ASSERT(config =
+                ps_config_parse_json(
+                    NULL,
+                    "hmm: \"" MODELDIR "/en-us/en-us\","
+                    "lm: \"" DATADIR "/turtle.lm.bin\","
+                    "dict: \"" DATADIR "/turtle.dic\","
+                    "fwdflat: false,"
+                    "bestpath: true,"
+                    "samprate: 16000"));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(rawfh = fopen(DATADIR "/goforward.raw", "rb"));
+    ps_decode_raw(ps, rawfh, -1);
+    fclose(rawfh);
+
+    /* Ask for enough hypotheses that partial paths get pruned. */
+    prev_score = 0;
+    for (n = 0, nbest = ps_nbest(ps); nbest && n < 1000;
+         nbest = ps_nbest_next(nbest), n++) {
+        TEST_ASSERT(hyp = ps_nbest_hyp(nbest, &score));
+        if (n == 0) {
+            printf("NBEST %d: %s (%d)\n", n, hyp, score);
+            TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+        }
+        /* They come out best first. */
+        else
+            TEST_ASSERT(score <= prev_score);
+        prev_score = score;
+    }
+    printf("%d hypotheses\n", n);
+    TEST_EQUAL(1000, n);
+    TEST_ASSERT(nbest);
+    printf("%d partial paths rejected\n",
+           ((ps_astar_t *)nbest)->n_hyp_reject);
+    TEST_ASSERT(((ps_astar_t *)nbest)->n_hyp_reject > 0);
+    if (nbest)
+        ps_nbest_free(nbest);
+    ps_free(ps);
+    ps_config_free(config);
+    return 0;
+}
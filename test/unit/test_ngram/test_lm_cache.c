@@ -0,0 +1,73 @@
+#include "lm/ngram_model.h"
+#include "lm/ngram_cache.h"
+#include <pocketsphinx/logmath.h>
+
+#include "test_macros.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int
+main(int argc, char *argv[])
+{
+	logmath_t *lmath;
+	ngram_model_t *model;
+	ngram_cache_t *cache;
+	int32 daines, huggins, david, n_used, n_used2, n_hit, n_miss;
+	int i;
+
+	(void)argc;
+	(void)argv;
+	lmath = logmath_init(1.0001, 0, 0);
+	TEST_ASSERT(model = ngram_model_read(NULL, LMDIR "/100.lm.bin",
+					     NGRAM_BIN, lmath));
+	daines = ngram_wid(model, "daines");
+	huggins = ngram_wid(model, "huggins");
+	david = ngram_wid(model, "david");
+
+	/* Tiny cache to force collisions. */
+	TEST_ASSERT(cache = ngram_cache_init(model, 3));
+	TEST_EQUAL(model, ngram_cache_model(cache));
+	TEST_EQUAL(0, ngram_cache_stats(cache, &n_hit, &n_miss));
+
+	/* Cached scores and orders match the model, hit or miss. */
+	for (i = 0; i < 2; ++i) {
+		TEST_EQUAL(ngram_tg_score(model, daines, huggins, david, &n_used),
+			   ngram_cache_tg_score(cache, daines, huggins, david,
+						&n_used2));
+		TEST_EQUAL(n_used, n_used2);
+		TEST_EQUAL(3, n_used2);
+		TEST_EQUAL(ngram_bg_score(model, huggins, david, &n_used),
+			   ngram_cache_bg_score(cache, huggins, david, &n_used2));
+		TEST_EQUAL(n_used, n_used2);
+		TEST_EQUAL(ngram_tg_score(model, david, david, david, &n_used),
+			   ngram_cache_tg_score(cache, david, david, david,
+						&n_used2));
+		TEST_EQUAL(n_used, n_used2);
+	}
+	/* Bigram and trigram keys are distinct. */
+	TEST_ASSERT(ngram_cache_bg_score(cache, daines, huggins, &n_used)
+		    != ngram_cache_tg_score(cache, daines, huggins, david,
+					    &n_used2));
+	TEST_EQUAL(8, ngram_cache_stats(cache, &n_hit, &n_miss));
+	TEST_ASSERT(n_hit > 0);
+	TEST_ASSERT(n_miss >= 3);
+	printf("%d hits %d misses\n", n_hit, n_miss);
+
+	/* Invalidate after changing weights. */
+	ngram_model_apply_weights(model, 7.5, 0.5);
+	ngram_cache_reset(cache);
+	TEST_EQUAL(0, ngram_cache_stats(cache, &n_hit, &n_miss));
+	TEST_EQUAL(ngram_tg_score(model, daines, huggins, david, &n_used),
+		   ngram_cache_tg_score(cache, daines, huggins, david,
+					&n_used2));
+	ngram_cache_stats(cache, &n_hit, &n_miss);
+	TEST_EQUAL(0, n_hit);
+	TEST_EQUAL(1, n_miss);
+
+	/* The cache holds a reference to the model. */
+	TEST_EQUAL(1, ngram_model_free(model));
+	ngram_cache_free(cache);
+	logmath_free(lmath);
+	return 0;
+}
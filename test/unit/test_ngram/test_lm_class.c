@@ -99,6 +99,52 @@ run_tests(logmath_t *lmath, ngram_model_t *model)
 		TEST_EQUAL_LOG(ngram_score(model, "hurf:foobie", NULL),
 			       foobie_prob + logmath_log(lmath, 0.4));
 	}
+
+	/* Fill a class with some of its words. */
+	{
+		const char *members[] = { "karybdis:scylla", "scrappy:scylla" };
+		const char *bogus[] = { "scooby:scylla", "oh:zero" };
+		const char *twice[] = { "scrappy:scylla", "scrappy:scylla" };
+		float32 weights[] = { 0.75, 0.25 };
+
+		TEST_EQUAL(2, ngram_model_update_class(model, "scylla",
+						       members, weights, 2));
+		TEST_EQUAL((uint32)ngram_wid(model, "scylla:scylla"), 0x80000000 | 400);
+		TEST_EQUAL_LOG(ngram_score(model, "karybdis:scylla", NULL),
+			       logmath_log10_to_log(lmath, -2.7884) + logmath_log(lmath, 0.75));
+		TEST_EQUAL_LOG(ngram_score(model, "scrappy:scylla", NULL),
+			       logmath_log10_to_log(lmath, -2.7884) + logmath_log(lmath, 0.25));
+		TEST_EQUAL(ngram_score(model, "scylla:scylla", NULL), ngram_zero(model));
+		TEST_EQUAL(ngram_score(model, "0:scylla", NULL), ngram_zero(model));
+		TEST_EQUAL_LOG(ngram_score(model, "scylla:scylla", "on", NULL),
+			       ngram_zero(model));
+		TEST_EQUAL_LOG(ngram_score(model, "apparently", "karybdis:scylla", NULL),
+			       logmath_log10_to_log(lmath, -0.5172));
+
+		/* Errors leave the class alone. */
+		TEST_ASSERT(ngram_model_update_class(model, "scylla",
+						     bogus, NULL, 2) < 0);
+		TEST_ASSERT(ngram_model_update_class(model, "apparently",
+						     members, NULL, 2) < 0);
+		TEST_ASSERT(ngram_model_update_class(model, "scylla",
+						     twice, NULL, 2) < 0);
+		TEST_EQUAL_LOG(ngram_score(model, "scrappy:scylla", NULL),
+			       logmath_log10_to_log(lmath, -2.7884) + logmath_log(lmath, 0.25));
+		TEST_EQUAL(ngram_score(model, "scooby:scylla", NULL), ngram_zero(model));
+
+		/* Words added later are members too. */
+		rv = ngram_model_add_class_word(model, "scylla", "shaggy:scylla", 1.0);
+		TEST_ASSERT(rv >= 0);
+		TEST_ASSERT(ngram_score(model, "shaggy:scylla", NULL) > ngram_zero(model));
+		TEST_EQUAL(1, ngram_model_update_class(model, "scylla",
+						       bogus, NULL, 1));
+		TEST_EQUAL_LOG(ngram_score(model, "scooby:scylla", NULL),
+			       logmath_log10_to_log(lmath, -2.7884));
+		TEST_EQUAL(ngram_score(model, "karybdis:scylla", NULL), ngram_zero(model));
+		TEST_EQUAL(ngram_score(model, "shaggy:scylla", NULL), ngram_zero(model));
+		TEST_EQUAL(0, ngram_model_update_class(model, "scylla", NULL, NULL, 0));
+		TEST_EQUAL(ngram_score(model, "scooby:scylla", NULL), ngram_zero(model));
+	}
 }
 
 int
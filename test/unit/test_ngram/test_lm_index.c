@@ -0,0 +1,127 @@
+#include "lm/ngram_model.h"
+#include "lm/ngram_model_trie.h"
+#include "util/ckd_alloc.h"
+#include "util/profile.h"
+#include <pocketsphinx/logmath.h>
+
+#include "test_macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Look up every N-Gram in raw, and a neighbouring one that is most
+ * likely absent, returning the sum of scores. */
+static int64
+score_all(ngram_model_t *model, ngram_raw_t **raw, int32 *scores)
+{
+	uint32 const *counts = ngram_model_get_counts(model);
+	int32 n_words = (int32)counts[0];
+	int64 total = 0;
+	int n, k;
+	uint32 i;
+
+	for (n = 2; n <= ngram_model_get_size(model); ++n) {
+		for (i = 0; i < counts[n - 1]; ++i) {
+			ngram_raw_t *ng = &raw[n - 2][i];
+			int32 hist[NGRAM_MAX_ORDER];
+			int32 wid, n_used, score;
+
+			/* Raw N-Grams are in ARPA order. */
+			for (k = 0; k < n - 1; ++k)
+				hist[k] = ng->words[n - 2 - k];
+			wid = ng->words[n - 1];
+			score = ngram_ng_prob(model, wid, hist, n - 1, &n_used);
+			total += score;
+			if (scores)
+				*scores++ = score;
+			score = ngram_ng_prob(model, (wid + 1) % n_words,
+					      hist, n - 1, &n_used);
+			total += score;
+			if (scores)
+				*scores++ = score;
+		}
+	}
+	return total;
+}
+
+static void
+benchmark(const char *lmfile)
+{
+	logmath_t *lmath;
+	ngram_model_t *model;
+	ngram_raw_t **raw;
+	ptmr_t tmr;
+	int64 plain, indexed;
+
+	lmath = logmath_init(1.0001, 0, 0);
+	TEST_ASSERT(model = ngram_model_read(NULL, lmfile, NGRAM_AUTO, lmath));
+	TEST_ASSERT(raw = ngram_model_trie_get_raw(model));
+
+	ptmr_init(&tmr);
+	ptmr_start(&tmr);
+	plain = score_all(model, raw, NULL);
+	ptmr_stop(&tmr);
+	printf("plain: %.3f sec\n", tmr.t_cpu);
+
+	TEST_EQUAL(0, ngram_model_trie_index(model));
+	ptmr_reset(&tmr);
+	ptmr_start(&tmr);
+	indexed = score_all(model, raw, NULL);
+	ptmr_stop(&tmr);
+	printf("indexed: %.3f sec\n", tmr.t_cpu);
+	TEST_ASSERT(plain == indexed);
+
+	ngrams_raw_free(raw, (uint32 *)ngram_model_get_counts(model),
+			ngram_model_get_size(model));
+	ngram_model_free(model);
+	logmath_free(lmath);
+}
+
+int
+main(int argc, char *argv[])
+{
+	logmath_t *lmath;
+	ngram_model_t *model, *indexed;
+	ngram_raw_t **raw;
+	uint32 const *counts;
+	int32 *scores, *iscores;
+	size_t n_scores;
+
+	/* Optionally time lookups in a larger model. */
+	if (argc > 1) {
+		benchmark(argv[1]);
+		return 0;
+	}
+
+	lmath = logmath_init(1.0001, 0, 0);
+	TEST_ASSERT(model = ngram_model_read(NULL, LMDIR "/turtle.lm",
+					     NGRAM_ARPA, lmath));
+	TEST_ASSERT(indexed = ngram_model_read(NULL, LMDIR "/turtle.lm",
+					       NGRAM_ARPA, lmath));
+	TEST_EQUAL(0, ngram_model_trie_index(indexed));
+	/* Indexing twice is harmless. */
+	TEST_EQUAL(0, ngram_model_trie_index(indexed));
+
+	counts = ngram_model_get_counts(model);
+	n_scores = 2 * (counts[1] + counts[2]);
+	scores = ckd_calloc(n_scores, sizeof(*scores));
+	iscores = ckd_calloc(n_scores, sizeof(*iscores));
+	TEST_ASSERT(raw = ngram_model_trie_get_raw(model));
+	score_all(model, raw, scores);
+	score_all(indexed, raw, iscores);
+	TEST_EQUAL(0, memcmp(scores, iscores, n_scores * sizeof(*scores)));
+	TEST_EQUAL(ngram_score(model, "TEN", "FORWARD", "GO", NULL),
+		   ngram_score(indexed, "TEN", "FORWARD", "GO", NULL));
+	TEST_EQUAL(ngram_score(model, "FORWARD", "GO", NULL),
+		   ngram_score(indexed, "FORWARD", "GO", NULL));
+
+	ngrams_raw_free(raw, (uint32 *)counts, ngram_model_get_size(model));
+	ckd_free(scores);
+	ckd_free(iscores);
+	ngram_model_free(indexed);
+	ngram_model_free(model);
+	logmath_free(lmath);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include "lm/ngram_model.h"
+#include "lm/ngram_model_trie.h"
+#include <pocketsphinx/logmath.h>
+
+#include "test_macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static float64
+history_mass(logmath_t *lmath, ngram_model_t *model,
+             const char *w1, const char *w2)
+{
+    float64 total = 0;
+    int32 i;
+
+    for (i = 0; i < (int32)ngram_model_get_counts(model)[0]; ++i) {
+        int32 hist[2], n_used;
+        if (i == ngram_wid(model, "<s>"))
+            continue;
+        hist[0] = ngram_wid(model, w1);
+        hist[1] = ngram_wid(model, w2);
+        total += logmath_exp(lmath,
+                             ngram_ng_prob(model, i, hist, 2, &n_used));
+    }
+    return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    ngram_model_t *model, *small;
+    uint32 const *counts, *small_counts;
+
+    (void)argc;
+    (void)argv;
+    lmath = logmath_init(1.0001, 0, 0);
+    model = ngram_model_read(NULL, LMDIR "/turtle.lm", NGRAM_ARPA, lmath);
+    TEST_ASSERT(model);
+    counts = ngram_model_get_counts(model);
+
+    /* Rebuilding without pruning keeps everything. */
+    TEST_ASSERT(small = ngram_model_trie_rebuild(model, 0, 16, 16));
+    small_counts = ngram_model_get_counts(small);
+    TEST_EQUAL(counts[1], small_counts[1]);
+    TEST_EQUAL(counts[2], small_counts[2]);
+    TEST_EQUAL(ngram_score(model, "FORWARD", "GO", NULL),
+               ngram_score(small, "FORWARD", "GO", NULL));
+    TEST_EQUAL_LOG(ngram_score(model, "TEN", "FORWARD", "GO", NULL),
+                   ngram_score(small, "TEN", "FORWARD", "GO", NULL));
+    ngram_model_free(small);
+
+    /* Quantization bits are checked. */
+    TEST_EQUAL(NULL, ngram_model_trie_rebuild(model, 0, 17, 16));
+    TEST_EQUAL(NULL, ngram_model_trie_rebuild(model, 0, 8, 0));
+
+    /* Fewer bits survive writing and reading. */
+    TEST_ASSERT(small = ngram_model_trie_rebuild(model, 0, 8, 6));
+    TEST_EQUAL(0, ngram_model_write(small, "turtle.q8.lm.bin", NGRAM_BIN));
+    ngram_model_free(small);
+    TEST_ASSERT(small = ngram_model_read(NULL, "turtle.q8.lm.bin",
+                                         NGRAM_BIN, lmath));
+    small_counts = ngram_model_get_counts(small);
+    TEST_EQUAL(counts[2], small_counts[2]);
+    TEST_EQUAL(ngram_score(model, "GO", NULL),
+               ngram_score(small, "GO", NULL));
+    TEST_ASSERT(abs(ngram_score(model, "TEN", "FORWARD", "GO", NULL)
+                    - ngram_score(small, "TEN", "FORWARD", "GO", NULL))
+                < logmath_log(lmath, 1.1));
+    ngram_model_free(small);
+
+    /* Pruning removes N-Grams but keeps histories as normalized as
+     * they were before. */
+    TEST_ASSERT(small = ngram_model_trie_rebuild(model, 1e-4, 16, 16));
+    small_counts = ngram_model_get_counts(small);
+    printf("%u %u %u => %u %u %u\n", counts[0], counts[1], counts[2],
+           small_counts[0], small_counts[1], small_counts[2]);
+    TEST_EQUAL(counts[0], small_counts[0]);
+    TEST_ASSERT(small_counts[1] <= counts[1]);
+    TEST_ASSERT(small_counts[2] < counts[2]);
+    TEST_EQUAL(ngram_score(model, "GO", NULL),
+               ngram_score(small, "GO", NULL));
+    printf("P(. | GO FORWARD) sums to %f => %f\n",
+           history_mass(lmath, model, "FORWARD", "GO"),
+           history_mass(lmath, small, "FORWARD", "GO"));
+    TEST_ASSERT(fabs(history_mass(lmath, model, "FORWARD", "GO")
+                     - history_mass(lmath, small, "FORWARD", "GO"))
+                < 0.01);
+    ngram_model_free(small);
+
+    ngram_model_free(model);
+    logmath_free(lmath);
+    remove("turtle.q8.lm.bin");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "lm/ngram_model.h"
+#include "lm/ngram_model_trie.h"
 #include <pocketsphinx/logmath.h>
 #include "util/strfuncs.h"
 #include <pocketsphinx/err.h>
@@ -43,6 +44,37 @@ test_lm_ug_vals(ngram_model_t *model)
 	return 0;
 }
 
+/* Run tasks backwards, as threads might. */
+static void
+run_tasks_backwards(ngram_task_fn fn, void **args, int n_args, void *udata)
+{
+	int *n_tasks = (int *)udata;
+
+	while (n_args-- > 0) {
+		fn(args[n_args]);
+		++*n_tasks;
+	}
+}
+
+static int
+test_lm_same(ngram_model_t *a, ngram_model_t *b)
+{
+	int32 w1, w2, w3, n_used;
+	int32 n_words = (int32)ngram_model_get_counts(a)[0];
+
+	TEST_EQUAL(n_words, (int32)ngram_model_get_counts(b)[0]);
+	for (w1 = 0; w1 < n_words; ++w1) {
+		for (w2 = 0; w2 < n_words; ++w2) {
+			TEST_EQUAL(ngram_bg_score(a, w2, w1, &n_used),
+				   ngram_bg_score(b, w2, w1, &n_used));
+			for (w3 = 0; w3 < n_words; w3 += 7)
+				TEST_EQUAL(ngram_tg_score(a, w3, w2, w1, &n_used),
+					   ngram_tg_score(b, w3, w2, w1, &n_used));
+		}
+	}
+	return 0;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -61,6 +93,24 @@ main(int argc, char *argv[])
 	test_lm_ug_vals(model);
 	TEST_EQUAL(0, ngram_model_free(model));
 
+	/* Read a language model in chunks, compare with reading it whole */
+	{
+		ngram_model_t *chunked;
+		int n_tasks = 0;
+
+		model = ngram_model_read(NULL, LMDIR "/turtle.lm", NGRAM_ARPA, lmath);
+		chunked = ngram_model_trie_read_arpa_tasks(NULL, LMDIR "/turtle.lm",
+							   lmath, 5,
+							   run_tasks_backwards,
+							   &n_tasks);
+		TEST_ASSERT(chunked);
+		/* Five chunks for each of two orders, then two sorts. */
+		TEST_EQUAL(n_tasks, 12);
+		test_lm_same(model, chunked);
+		TEST_EQUAL(0, ngram_model_free(chunked));
+		TEST_EQUAL(0, ngram_model_free(model));
+	}
+
 	/* Read a language model */
 	model = ngram_model_read(NULL, LMDIR "/turtle.ug.lm.dmp", NGRAM_BIN, lmath);
 	test_lm_ug_vals(model);
@@ -65,6 +65,33 @@ run_tests(ngram_model_t *model)
 		       ngram_wid(model, "huggins"),
 		       ngram_wid(model, "david"), &n_used);
 	TEST_EQUAL(n_used, 3);
+
+	/* Batched scoring matches scoring one word at a time. */
+	{
+		int32 wids[5], scores[5], hist[2];
+		int i, j;
+
+		for (j = 0; j < 3; ++j) {
+			wids[0] = ngram_wid(model, "daines");
+			wids[1] = ngram_wid(model, "huggins");
+			wids[2] = ngram_wid(model, "david");
+			wids[3] = ngram_wid(model, "blorglehurfle");
+			wids[4] = ngram_wid(model, "</s>");
+			hist[0] = ngram_wid(model, j == 0 ? "huggins" : "david");
+			hist[1] = j == 2 ? NGRAM_INVALID_WID
+				: ngram_wid(model, "david");
+			ngram_ng_score_words(model, wids, 5, hist, 2, scores);
+			for (i = 0; i < 5; ++i)
+				TEST_EQUAL(scores[i],
+					   ngram_tg_score(model, wids[i],
+							  hist[0], hist[1],
+							  &n_used));
+			/* In place. */
+			ngram_ng_score_words(model, wids, 5, hist, 2, wids);
+			for (i = 0; i < 5; ++i)
+				TEST_EQUAL(scores[i], wids[i]);
+		}
+	}
 }
 
 int
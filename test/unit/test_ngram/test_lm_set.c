@@ -121,6 +121,58 @@ main(int argc, char *argv[])
 
 	ngram_model_free(lmset);
 
+	/* Test compiling an interpolated set into a single model. */
+	lms[0] = ngram_model_read(NULL, LMDIR "/100.lm.dmp", NGRAM_BIN, lmath);
+	lms[1] = ngram_model_read(NULL, LMDIR "/102.lm.dmp", NGRAM_BIN, lmath);
+	lmset = ngram_model_set_init(NULL, lms, (char **)names, weights, 2);
+	TEST_ASSERT(ngram_model_set_interp(lmset, NULL, NULL));
+	{
+		ngram_model_t *merged;
+		int32 tol = logmath_log(lmath, 1.01);
+		int32 hist[2];
+		float64 total;
+		int32 i;
+
+		TEST_ASSERT(merged = ngram_model_set_merge(lmset));
+		TEST_EQUAL(ngram_model_get_size(lmset),
+			   ngram_model_get_size(merged));
+		TEST_EQUAL(ngram_model_get_counts(lmset)[0],
+			   ngram_model_get_counts(merged)[0]);
+		/* Explicit N-Grams are interpolated exactly (up to
+		 * quantization). */
+		TEST_EQUAL(ngram_score(lmset, "sphinxtrain", NULL),
+			   ngram_score(merged, "sphinxtrain", NULL));
+		TEST_ASSERT(abs(ngram_score(lmset, "huggins", "david", NULL)
+				- ngram_score(merged, "huggins", "david", NULL))
+			    < tol);
+		TEST_ASSERT(abs(ngram_score(lmset, "daines", "huggins",
+					    "david", NULL)
+				- ngram_score(merged, "daines", "huggins",
+					      "david", NULL)) < tol);
+		/* Backoff weights are normalized like those of the set
+		 * (which itself isn't, as OOVs map to <UNK> in each model). */
+		hist[0] = ngram_wid(merged, "huggins");
+		hist[1] = ngram_wid(merged, "david");
+		total = 0;
+		for (i = 0; i < (int32)ngram_model_get_counts(merged)[0]; ++i) {
+			int32 h[2], n_used;
+			if (i == ngram_wid(merged, "<s>"))
+				continue;
+			memcpy(h, hist, sizeof(h));
+			total += logmath_exp(lmath,
+					     ngram_ng_prob(merged, i, h,
+							   2, &n_used));
+			memcpy(h, hist, sizeof(h));
+			total -= logmath_exp(lmath,
+					     ngram_ng_prob(lmset, i, h,
+							   2, &n_used));
+		}
+		printf("Sum of P(w | david huggins) differs by %f\n", total);
+		TEST_ASSERT(fabs(total) < 0.01);
+		ngram_model_free(merged);
+	}
+	ngram_model_free(lmset);
+
 	/* Now test lmctl files. */
 	lmset = ngram_model_set_read(NULL, LMDIR "/100.lmctl", lmath);
 	TEST_ASSERT(lmset);